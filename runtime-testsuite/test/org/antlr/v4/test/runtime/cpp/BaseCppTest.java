@@ -854,10 +854,10 @@ public abstract class BaseCppTest {
 						+ "\n"
 						+ "class TreeShapeListener : public tree::ParseTreeListener {\n"
 						+ "public:\n"
-						+ "  void visitTerminal(Ref\\<tree::TerminalNode> node) override {}\n"
-						+ "  void visitErrorNode(Ref\\<tree::ErrorNode> node) override {}\n"
-						+ "  void exitEveryRule(Ref\\<ParserRuleContext> ctx) override {}\n"
-						+ "  void enterEveryRule(Ref\\<ParserRuleContext> ctx) override {\n"
+						+ "  void visitTerminal(tree::TerminalNode *node) override {}\n"
+						+ "  void visitErrorNode(tree::ErrorNode *node) override {}\n"
+						+ "  void exitEveryRule(ParserRuleContext *ctx) override {}\n"
+						+ "  void enterEveryRule(ParserRuleContext *ctx) override {\n"
 						+ "    for (auto child : ctx->children) {\n"
 						+ "      auto parent = child->getParent();\n"
 						+ "      if (dynamic_cast<tree::RuleNode>(parent) || parent.getRuleContext() != ctx) {\n"
@@ -0,0 +1,161 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
+#include "Benchmark.h"
+
+using namespace antlrcppbench;
+
+#ifndef ANTLR_RUNTIME_VERSION
+#define ANTLR_RUNTIME_VERSION "unknown"
+#endif
+
+static std::atomic<size_t> allocationCount(0);
+
+void* operator new(std::size_t size) {
+  ++allocationCount;
+  void *result = std::malloc(size == 0 ? 1 : size);
+  if (result == nullptr) {
+    throw std::bad_alloc();
+  }
+  return result;
+}
+
+void* operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void *pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+  std::free(pointer);
+}
+
+size_t antlrcppbench::getAllocationCount() {
+  return allocationCount.load();
+}
+
+size_t antlrcppbench::getPeakRSS() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+
+#ifdef __APPLE__
+  return (size_t)usage.ru_maxrss / 1024; // Bytes on OS X.
+#else
+  return (size_t)usage.ru_maxrss; // kB everywhere else.
+#endif
+}
+
+size_t antlrcppbench::getCurrentRSS() {
+#ifdef __APPLE__
+  mach_task_basic_info_data_t info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+    return 0;
+  }
+  return (size_t)info.resident_size / 1024;
+#else
+  // Linux: total program size and resident size, in pages.
+  std::ifstream statm("/proc/self/statm");
+  size_t size = 0;
+  size_t resident = 0;
+  if (!(statm >> size >> resident)) {
+    return 0;
+  }
+  return resident * (size_t)sysconf(_SC_PAGESIZE) / 1024;
+#endif
+}
+
+//------------------ Stopwatch -----------------------------------------------------------------------------------------
+
+Stopwatch::Stopwatch() {
+  restart();
+}
+
+void Stopwatch::restart() {
+  _start = std::chrono::steady_clock::now();
+}
+
+double Stopwatch::elapsed() const {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+}
+
+//------------------ Result --------------------------------------------------------------------------------------------
+
+Result::Result()
+  : warm(false), threads(1), inputBytes(0), tokens(0), milliseconds(0), allocations(0), syntaxErrors(0), currentRSS(0), peakRSS(0) {
+}
+
+//------------------ Report --------------------------------------------------------------------------------------------
+
+Report::Report() : inputBytes(0), iterations(0), seed(0) {
+}
+
+std::string Report::toJSON() const {
+  std::stringstream ss;
+  ss << "{\n  \"runtimeVersion\": \"" << ANTLR_RUNTIME_VERSION << "\",\n";
+  ss << "  \"settings\": {\"inputBytes\": " << inputBytes << ", \"iterations\": " << iterations << ", \"seed\": "
+    << seed << "},\n";
+  ss << "  \"results\": [";
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result &result = results[i];
+    double seconds = result.milliseconds / 1000;
+    double tokensPerSecond = seconds > 0 ? result.tokens / seconds : 0;
+    double megabytesPerSecond = seconds > 0 ? result.inputBytes / (1024.0 * 1024.0) / seconds : 0;
+    double allocationsPerToken = result.tokens > 0 ? (double)result.allocations / result.tokens : 0;
+
+    ss << (i > 0 ? ",\n" : "\n");
+    ss << "    {\"grammar\": \"" << result.grammar << "\", \"phase\": \"" << result.phase << "\", \"dfa\": \""
+      << (result.warm ? "warm" : "cold") << "\", \"threads\": " << result.threads << ", \"inputBytes\": " << result.inputBytes << ", \"tokens\": "
+      << result.tokens << ", \"milliseconds\": " << result.milliseconds << ", \"tokensPerSecond\": "
+      << tokensPerSecond << ", \"megabytesPerSecond\": " << megabytesPerSecond << ", \"allocations\": "
+      << result.allocations << ", \"allocationsPerToken\": " << allocationsPerToken << ", \"syntaxErrors\": "
+      << result.syntaxErrors << ", \"rssKB\": " << result.currentRSS << ", \"lifetimePeakRSSKB\": " << result.peakRSS << "}";
+  }
+
+  ss << "\n  ]\n}\n";
+  return ss.str();
+}
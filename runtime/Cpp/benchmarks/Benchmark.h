@@ -0,0 +1,98 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace antlrcppbench {
+
+  /// The number of calls to the global operator new since program start. The benchmark replaces the global
+  /// allocation functions to count them, so differences between two calls give the allocations of the code in between.
+  size_t getAllocationCount();
+
+  /// The current resident set size of this process in kB (0 if the platform doesn't tell).
+  size_t getCurrentRSS();
+
+  /// The peak resident set size of this process in kB. This is a high-water mark for the whole process lifetime, so run
+  /// a single grammar per process if you need isolated numbers.
+  size_t getPeakRSS();
+
+  class Stopwatch {
+  public:
+    Stopwatch();
+
+    void restart();
+
+    /// Elapsed time since construction or the last restart, in milliseconds.
+    double elapsed() const;
+
+  private:
+    std::chrono::steady_clock::time_point _start;
+  };
+
+  /// One measurement: a single phase (lexing or parsing) of one grammar, either with an empty (cold) or a filled
+  /// (warm) DFA cache.
+  struct Result {
+    std::string grammar;
+    std::string phase;
+    bool warm;
+    /// The number of threads which worked on the input (only the parallel phase uses more than one).
+    size_t threads;
+
+    size_t inputBytes;
+    size_t tokens;
+    double milliseconds;
+    size_t allocations;
+    size_t syntaxErrors;
+    /// The resident set size right after the phase, while its data (tokens, parse tree) is still alive, in kB.
+    size_t currentRSS;
+    /// The lifetime peak of the resident set size when the phase ended, in kB.
+    size_t peakRSS;
+
+    Result();
+  };
+
+  class Report {
+  public:
+    size_t inputBytes;
+    size_t iterations;
+    unsigned int seed;
+    std::vector<Result> results;
+
+    Report();
+
+    /// All results as a JSON object, including throughput and allocations per token, which are computed from the
+    /// raw numbers.
+    std::string toJSON() const;
+  };
+
+} // namespace antlrcppbench
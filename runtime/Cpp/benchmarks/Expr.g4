@@ -0,0 +1,30 @@
+grammar Expr;
+
+// An expression language with left recursive binary operators of different precedence and associativity.
+
+prog: stat* EOF;
+
+stat
+  : ID '=' expr ';'
+  | expr ';'
+;
+
+expr
+  : <assoc = right> expr '^' expr
+  | '-' expr
+  | expr ('*' | '/' | '%') expr
+  | expr ('+' | '-') expr
+  | expr ('<' | '>' | '<=' | '>=' | '==' | '!=') expr
+  | <assoc = right> expr '?' expr ':' expr
+  | ID '(' args? ')'
+  | '(' expr ')'
+  | ID
+  | INT
+;
+
+args: expr (',' expr)*;
+
+ID: [a-zA-Z_] [a-zA-Z_0-9]*;
+INT: [0-9]+;
+COMMENT: '//' ~[\r\n]* -> skip;
+WS: [ \t\r\n]+ -> skip;
@@ -0,0 +1,298 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <random>
+
+#include "InputGenerators.h"
+
+using namespace antlrcppbench;
+
+namespace {
+
+  class Generator {
+  public:
+    std::string output;
+
+    Generator(unsigned int seed) : _random(seed) {
+    }
+
+    /// A random number in [0, limit).
+    size_t next(size_t limit) {
+      return std::uniform_int_distribution<size_t>(0, limit - 1)(_random);
+    }
+
+    /// Returns true with the given probability in percent.
+    bool chance(size_t percent) {
+      return next(100) < percent;
+    }
+
+    template<size_t N>
+    const char* pick(const char* const (&values)[N]) {
+      return values[next(N)];
+    }
+
+    void appendNumber(size_t limit) {
+      output += std::to_string(next(limit));
+    }
+
+  private:
+    std::mt19937 _random;
+  };
+
+  // None of these is a keyword in any of the grammars. Some contain non-ASCII letters (UTF-8 encoded).
+  const char* const identifiers[] = {
+    "alpha", "beta", "gamma", "delta", "x", "y", "z", "i", "count", "total", "value2", "result",
+    "tmp_buffer", "index", "limit", "offset", "gr\xC3\xB6\xC3\x9F" "e", "na\xC3\xAF" "ve", "\xCE\xBB"
+  };
+
+  const char* const words[] = {
+    "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit", "caf\xC3\xA9", "\xE2\x82\xAC"
+  };
+
+  //------------------ Demo grammar ------------------------------------------------------------------------------------
+
+  void generateTExpression(Generator &generator, size_t depth) {
+    if (depth == 0 || generator.chance(30)) {
+      size_t kind = generator.next(20);
+      if (kind < 12) {
+        generator.output += generator.pick(identifiers);
+      } else if (kind < 17) {
+        generator.appendNumber(100000);
+      } else if (kind < 19) {
+        generator.output += "\"";
+        generator.output += generator.pick(words);
+        generator.output += "\"";
+      } else {
+        generator.output += "return ";
+        generator.output += generator.pick(identifiers);
+      }
+      return;
+    }
+
+    switch (generator.next(4)) {
+      case 0:
+        generateTExpression(generator, depth - 1);
+        generator.output += " * ";
+        generateTExpression(generator, depth - 1);
+        break;
+      case 1:
+        generateTExpression(generator, depth - 1);
+        generator.output += " + ";
+        generateTExpression(generator, depth - 1);
+        break;
+      case 2:
+        generator.output += "(";
+        generateTExpression(generator, depth - 1);
+        generator.output += ")";
+        break;
+      default:
+        generateTExpression(generator, depth - 1);
+        generator.output += " ? ";
+        generateTExpression(generator, depth - 1);
+        generator.output += " : ";
+        generateTExpression(generator, depth - 1);
+        break;
+    }
+  }
+
+  //------------------ Expr grammar ------------------------------------------------------------------------------------
+
+  void generateExprExpression(Generator &generator, size_t depth) {
+    if (depth == 0 || generator.chance(25)) {
+      if (generator.chance(60)) {
+        generator.output += generator.pick(identifiers);
+      } else {
+        generator.appendNumber(1000);
+      }
+      return;
+    }
+
+    static const char* const binaryOperators[] = {
+      " ^ ", " * ", " / ", " % ", " + ", " - ", " < ", " > ", " <= ", " >= ", " == ", " != "
+    };
+
+    switch (generator.next(8)) {
+      case 0:
+        generator.output += "-";
+        generateExprExpression(generator, depth - 1);
+        break;
+      case 1:
+        generator.output += "(";
+        generateExprExpression(generator, depth - 1);
+        generator.output += ")";
+        break;
+      case 2: {
+        generator.output += generator.pick(identifiers);
+        generator.output += "(";
+        size_t count = generator.next(4);
+        for (size_t i = 0; i < count; ++i) {
+          if (i > 0) {
+            generator.output += ", ";
+          }
+          generateExprExpression(generator, depth - 1);
+        }
+        generator.output += ")";
+        break;
+      }
+      case 3:
+        generateExprExpression(generator, depth - 1);
+        generator.output += " ? ";
+        generateExprExpression(generator, depth - 1);
+        generator.output += " : ";
+        generateExprExpression(generator, depth - 1);
+        break;
+      default:
+        generateExprExpression(generator, depth - 1);
+        generator.output += generator.pick(binaryOperators);
+        generateExprExpression(generator, depth - 1);
+        break;
+    }
+  }
+
+  //------------------ JSON grammar ------------------------------------------------------------------------------------
+
+  void generateJsonString(Generator &generator) {
+    static const char* const escapes[] = { "\\n", "\\t", "\\\"", "\\\\", "\\/", "\\u00e9", "\\u20AC" };
+
+    generator.output += "\"";
+    size_t count = 1 + generator.next(4);
+    for (size_t i = 0; i < count; ++i) {
+      if (i > 0) {
+        generator.output += generator.chance(20) ? generator.pick(escapes) : " ";
+      }
+      generator.output += generator.pick(words);
+    }
+    generator.output += "\"";
+  }
+
+  void generateJsonValue(Generator &generator, size_t depth, const std::string &indent) {
+    size_t kind = generator.next(depth == 0 ? 6 : 10);
+    switch (kind) {
+      case 0:
+      case 1:
+        generateJsonString(generator);
+        break;
+      case 2:
+        if (generator.chance(50)) {
+          generator.output += "-";
+        }
+        generator.appendNumber(1000000);
+        break;
+      case 3:
+        generator.appendNumber(1000);
+        generator.output += ".";
+        generator.appendNumber(1000);
+        if (generator.chance(30)) {
+          generator.output += "e-";
+          generator.appendNumber(20);
+        }
+        break;
+      case 4:
+        generator.output += generator.chance(50) ? "true" : "false";
+        break;
+      case 5:
+        generator.output += "null";
+        break;
+      case 6:
+      case 7:
+      case 8: {
+        size_t count = generator.next(6);
+        generator.output += "{";
+        for (size_t i = 0; i < count; ++i) {
+          generator.output += (i > 0 ? ",\n" : "\n") + indent + "  ";
+          generateJsonString(generator);
+          generator.output += ": ";
+          generateJsonValue(generator, depth - 1, indent + "  ");
+        }
+        generator.output += count > 0 ? "\n" + indent + "}" : "}";
+        break;
+      }
+      default: {
+        size_t count = generator.next(8);
+        generator.output += "[";
+        for (size_t i = 0; i < count; ++i) {
+          generator.output += i > 0 ? ", " : "";
+          generateJsonValue(generator, depth - 1, indent);
+        }
+        generator.output += "]";
+        break;
+      }
+    }
+  }
+
+}
+
+std::string antlrcppbench::generateTInput(size_t bytes, unsigned int seed) {
+  Generator generator(seed);
+  while (generator.output.size() < bytes) {
+    if (generator.chance(5)) {
+      generator.output += "# ";
+      generator.output += generator.pick(words);
+      generator.output += "\n";
+    }
+    if (generator.chance(25)) {
+      generator.output += generator.pick(identifiers);
+      generator.output += " = ";
+    }
+    generateTExpression(generator, 1 + generator.next(5));
+    generator.output += ";\n";
+  }
+  return generator.output;
+}
+
+std::string antlrcppbench::generateExprInput(size_t bytes, unsigned int seed) {
+  Generator generator(seed);
+  while (generator.output.size() < bytes) {
+    if (generator.chance(5)) {
+      generator.output += "// ";
+      generator.output += generator.pick(words);
+      generator.output += "\n";
+    }
+    if (generator.chance(70)) {
+      generator.output += generator.pick(identifiers);
+      generator.output += " = ";
+    }
+    generateExprExpression(generator, 1 + generator.next(6));
+    generator.output += ";\n";
+  }
+  return generator.output;
+}
+
+std::string antlrcppbench::generateJsonInput(size_t bytes, unsigned int seed) {
+  Generator generator(seed);
+  generator.output += "[\n";
+  bool first = true;
+  while (generator.output.size() + 2 < bytes || first) {
+    generator.output += first ? "  " : ",\n  ";
+    first = false;
+    generateJsonValue(generator, 1 + generator.next(5), "  ");
+  }
+  generator.output += "\n]\n";
+  return generator.output;
+}
@@ -0,0 +1,370 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#include "ANTLRInputStream.h"
+#include "BaseErrorListener.h"
+#include "CommonTokenStream.h"
+#include "ParallelParseDriver.h"
+#include "atn/LexerATNSimulator.h"
+#include "atn/ParserATNSimulator.h"
+#include "tree/ParseTreeListener.h"
+#include "tree/ParseTreeWalker.h"
+
+#include "TLexer.h"
+#include "TParser.h"
+#include "ExprLexer.h"
+#include "ExprParser.h"
+#include "JsonLexer.h"
+#include "JsonParser.h"
+
+#include "Benchmark.h"
+#include "InputGenerators.h"
+
+using namespace antlrcppbench;
+using namespace org::antlr::v4::runtime;
+
+namespace {
+
+  /// Counts syntax errors instead of printing them, so console output doesn't distort the timing.
+  class CountingErrorListener : public BaseErrorListener {
+  public:
+    size_t count;
+
+    CountingErrorListener() : count(0) {
+    }
+
+    virtual void syntaxError(IRecognizer * /*recognizer*/, Ref<Token> /*offendingSymbol*/, size_t /*line*/,
+      int /*charPositionInLine*/, const std::string &/*msg*/, std::exception_ptr /*e*/) override {
+      ++count;
+    }
+  };
+
+  /// Counts the events of a tree walk. Does as little as possible to keep the measurement focused on the walker.
+  class CountingListener : public tree::ParseTreeListener {
+  public:
+    size_t events;
+
+    CountingListener() : events(0) {
+    }
+
+    virtual void visitTerminal(tree::TerminalNode * /*node*/) override {
+      ++events;
+    }
+
+    virtual void visitErrorNode(tree::ErrorNode * /*node*/) override {
+      ++events;
+    }
+
+    virtual void enterEveryRule(ParserRuleContext * /*ctx*/) override {
+      ++events;
+    }
+
+    virtual void exitEveryRule(ParserRuleContext * /*ctx*/) override {
+      ++events;
+    }
+  };
+
+  struct Settings {
+    size_t inputBytes;
+    size_t iterations;
+    unsigned int seed;
+    std::string grammar;
+    std::string output;
+    size_t files;
+    size_t maxThreads;
+
+    Settings() : inputBytes(1024 * 1024), iterations(5), seed(42), grammar("all"), files(64),
+      maxThreads(std::max(std::thread::hardware_concurrency(), 1U)) {
+    }
+  };
+
+  template<typename LexerType>
+  Result lex(const std::string &grammar, const std::string &text, bool warm) {
+    Result result;
+    result.grammar = grammar;
+    result.phase = "lex";
+    result.warm = warm;
+    result.inputBytes = text.size();
+
+    ANTLRInputStream input(text);
+    LexerType lexer(&input);
+    CountingErrorListener errors;
+    lexer.removeErrorListeners();
+    lexer.addErrorListener(&errors);
+    if (!warm) {
+      lexer.template getInterpreter<atn::LexerATNSimulator>()->clearDFA();
+    }
+    CommonTokenStream tokens(&lexer);
+
+    size_t allocations = getAllocationCount();
+    Stopwatch stopwatch;
+    tokens.fill();
+    result.milliseconds = stopwatch.elapsed();
+    result.allocations = getAllocationCount() - allocations;
+
+    result.tokens = tokens.size();
+    result.syntaxErrors = errors.count;
+    result.currentRSS = getCurrentRSS();
+    result.peakRSS = getPeakRSS();
+    return result;
+  }
+
+  template<typename ParserType, typename ContextType>
+  Result parse(const std::string &grammar, CommonTokenStream &tokens, size_t inputBytes,
+    Ref<ContextType> (ParserType::*startRule)(), bool warm) {
+    Result result;
+    result.grammar = grammar;
+    result.phase = "parse";
+    result.warm = warm;
+    result.inputBytes = inputBytes;
+    result.tokens = tokens.size();
+
+    tokens.seek(0);
+    ParserType parser(&tokens);
+    parser.removeErrorListeners();
+    if (!warm) {
+      parser.template getInterpreter<atn::ParserATNSimulator>()->clearDFA();
+    }
+
+    size_t allocations = getAllocationCount();
+    Stopwatch stopwatch;
+    Ref<ContextType> tree = (parser.*startRule)();
+    result.milliseconds = stopwatch.elapsed();
+    result.allocations = getAllocationCount() - allocations;
+
+    result.syntaxErrors = (size_t)parser.getNumberOfSyntaxErrors();
+    result.currentRSS = getCurrentRSS();
+    result.peakRSS = getPeakRSS();
+    return result;
+  }
+
+  Result walk(const std::string &grammar, tree::ParseTree *tree, size_t tokens, size_t inputBytes) {
+    Result result;
+    result.grammar = grammar;
+    result.phase = "walk";
+    result.warm = true;
+    result.inputBytes = inputBytes;
+    result.tokens = tokens;
+
+    CountingListener listener;
+    size_t allocations = getAllocationCount();
+    Stopwatch stopwatch;
+    tree::ParseTreeWalker::DEFAULT->walk(&listener, tree);
+    result.milliseconds = stopwatch.elapsed();
+    result.allocations = getAllocationCount() - allocations;
+
+    result.currentRSS = getCurrentRSS();
+    result.peakRSS = getPeakRSS();
+    return result;
+  }
+
+  /// Lexes and parses all inputs with a ParallelParseDriver on the given number of threads. The generated recognizers
+  /// share their DFA, which the earlier phases have already filled.
+  template<typename LexerType, typename ParserType, typename ContextType>
+  Result parallel(const std::string &grammar, const std::vector<ParallelParseDriver::Input> &inputs, size_t inputBytes,
+    Ref<ContextType> (ParserType::*startRule)(), size_t threads) {
+    Result result;
+    result.grammar = grammar;
+    result.phase = "parallel";
+    result.warm = true;
+    result.threads = threads;
+    result.inputBytes = inputBytes;
+
+    ParallelParseDriver driver([](CharStream *input) {
+      return std::unique_ptr<Lexer>(new LexerType(input));
+    }, [](TokenStream *tokens) {
+      return std::unique_ptr<Parser>(new ParserType(tokens));
+    }, [startRule](Parser *parser) -> Ref<ParserRuleContext> {
+      return (static_cast<ParserType *>(parser)->*startRule)();
+    }, threads);
+
+    size_t allocations = getAllocationCount();
+    Stopwatch stopwatch;
+    std::vector<ParallelParseDriver::Result> results = driver.parse(inputs);
+    result.milliseconds = stopwatch.elapsed();
+    result.allocations = getAllocationCount() - allocations;
+
+    for (auto &fileResult : results) {
+      if (fileResult.tree != nullptr && fileResult.tree->getStop() != nullptr) {
+        result.tokens += fileResult.tree->getStop()->getTokenIndex() + 1;
+      }
+      result.syntaxErrors += fileResult.syntaxErrors.size() + (fileResult.exception != nullptr ? 1 : 0);
+    }
+    result.currentRSS = getCurrentRSS();
+    result.peakRSS = getPeakRSS();
+    return result;
+  }
+
+  /// Runs each iteration and keeps the fastest one, which is the least disturbed by other system activity.
+  template<typename Function>
+  Result best(size_t iterations, Function run) {
+    Result result = run();
+    for (size_t i = 1; i < iterations; ++i) {
+      Result next = run();
+      if (next.milliseconds < result.milliseconds) {
+        result = next;
+      }
+    }
+    return result;
+  }
+
+  /// Measures lexing and parsing of a generated text, each with a cold DFA (the first run after clearing the cache) and
+  /// then with the warm DFA that run left behind. Then measures a walk over the resulting parse tree. Finally the same
+  /// amount of input, split into many files, is parsed in parallel with 1, 2, 4, ... threads.
+  template<typename LexerType, typename ParserType, typename ContextType>
+  void runGrammar(const std::string &grammar, std::string (*generate)(size_t, unsigned int),
+    Ref<ContextType> (ParserType::*startRule)(), const Settings &settings, Report &report) {
+    std::string text = generate(settings.inputBytes, settings.seed);
+    std::cerr << "Running " << grammar << " (" << text.size() << " bytes)" << std::endl;
+
+    report.results.push_back(lex<LexerType>(grammar, text, false));
+    report.results.push_back(best(settings.iterations, [&]() {
+      return lex<LexerType>(grammar, text, true);
+    }));
+
+    ANTLRInputStream input(text);
+    LexerType lexer(&input);
+    lexer.removeErrorListeners();
+    CommonTokenStream tokens(&lexer);
+    tokens.fill();
+
+    report.results.push_back(parse(grammar, tokens, text.size(), startRule, false));
+    report.results.push_back(best(settings.iterations, [&]() {
+      return parse(grammar, tokens, text.size(), startRule, true);
+    }));
+
+    tokens.seek(0);
+    ParserType parser(&tokens);
+    parser.removeErrorListeners();
+    Ref<ContextType> tree = (parser.*startRule)();
+    report.results.push_back(best(settings.iterations, [&]() {
+      return walk(grammar, tree.get(), tokens.size(), text.size());
+    }));
+
+    std::vector<ParallelParseDriver::Input> inputs;
+    size_t inputBytes = 0;
+    for (size_t i = 0; i < settings.files; ++i) {
+      inputs.push_back(ParallelParseDriver::Input::fromBuffer(grammar + std::to_string(i),
+        generate(settings.inputBytes / settings.files, settings.seed + (unsigned int)i)));
+      inputBytes += inputs.back().text.size();
+    }
+    for (size_t threads = 1; threads <= settings.maxThreads; threads *= 2) {
+      report.results.push_back(best(settings.iterations, [&]() {
+        return parallel<LexerType>(grammar, inputs, inputBytes, startRule, threads);
+      }));
+    }
+  }
+
+  void printUsage() {
+    std::cerr << "Usage: antlr4_benchmarks [--size <bytes>] [--iterations <n>] [--seed <n>] "
+      << "[--grammar t|expr|json|all] [--output <file>] [--files <n>] [--threads <n>]" << std::endl;
+  }
+
+  bool parseArguments(int argc, const char *argv[], Settings &settings) {
+    for (int i = 1; i < argc; ++i) {
+      std::string argument = argv[i];
+      if (i + 1 == argc) {
+        return false;
+      }
+
+      std::string value = argv[++i];
+      if (argument == "--size") {
+        settings.inputBytes = std::strtoul(value.c_str(), nullptr, 10);
+      } else if (argument == "--iterations") {
+        settings.iterations = std::strtoul(value.c_str(), nullptr, 10);
+      } else if (argument == "--seed") {
+        settings.seed = (unsigned int)std::strtoul(value.c_str(), nullptr, 10);
+      } else if (argument == "--grammar") {
+        settings.grammar = value;
+      } else if (argument == "--output") {
+        settings.output = value;
+      } else if (argument == "--files") {
+        settings.files = std::strtoul(value.c_str(), nullptr, 10);
+      } else if (argument == "--threads") {
+        settings.maxThreads = std::strtoul(value.c_str(), nullptr, 10);
+      } else {
+        return false;
+      }
+    }
+
+    if (settings.iterations == 0) {
+      settings.iterations = 1;
+    }
+    if (settings.files == 0) {
+      settings.files = 1;
+    }
+    if (settings.maxThreads == 0) {
+      settings.maxThreads = 1;
+    }
+    return settings.grammar == "all" || settings.grammar == "t" || settings.grammar == "expr" ||
+      settings.grammar == "json";
+  }
+
+}
+
+int main(int argc, const char *argv[]) {
+  Settings settings;
+  if (!parseArguments(argc, argv, settings)) {
+    printUsage();
+    return 1;
+  }
+
+  Report report;
+  report.inputBytes = settings.inputBytes;
+  report.iterations = settings.iterations;
+  report.seed = settings.seed;
+
+  if (settings.grammar == "all" || settings.grammar == "t") {
+    runGrammar<TLexer>("t", &generateTInput, &TParser::main, settings, report);
+  }
+  if (settings.grammar == "all" || settings.grammar == "expr") {
+    runGrammar<ExprLexer>("expr", &generateExprInput, &ExprParser::prog, settings, report);
+  }
+  if (settings.grammar == "all" || settings.grammar == "json") {
+    runGrammar<JsonLexer>("json", &generateJsonInput, &JsonParser::json, settings, report);
+  }
+
+  if (settings.output.empty()) {
+    std::cout << report.toJSON();
+  } else {
+    std::ofstream stream(settings.output);
+    stream << report.toJSON();
+    if (!stream) {
+      std::cerr << "Could not write " << settings.output << std::endl;
+      return 1;
+    }
+  }
+
+  return 0;
+}
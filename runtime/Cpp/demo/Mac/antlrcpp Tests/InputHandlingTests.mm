@@ -30,6 +30,8 @@
 #import <XCTest/XCTest.h>
 
 #include "ANTLRInputStream.h"
+#include "UTF8CharStream.h"
+#include "RingBufferCharStream.h"
 #include "Exceptions.h"
 #include "Interval.h"
 #include "UnbufferedTokenStream.h"
@@ -165,6 +167,86 @@ using namespace org::antlr::v4::runtime::misc;
   XCTAssertEqual(stream.getSourceName(), "unit tests");
 }
 
+- (void)testUTF8CharStreamUse {
+  std::string text(u8"\xEF\xBB\xBF🚧Lorem ipsum\r\ndolor sit µ\namet🕶");
+  std::u32string wtext = utfConverter.from_bytes(text.substr(3)); // Convert to UTF-32, w/o BOM.
+  UTF8CharStream stream(text.data(), text.size());
+  XCTAssertEqual(stream.index(), 0U);
+  XCTAssertEqual(stream.size(), text.size() - 3); // Indices are byte offsets, the BOM is skipped.
+  XCTAssertEqual(stream.toString(), text.substr(3));
+
+  XCTAssertEqual(stream.LA(0), 0);
+  for (size_t i = 1; i <= wtext.size(); ++i) {
+    XCTAssertEqual(stream.LA((ssize_t)i), wtext[i - 1]);
+  }
+  XCTAssertEqual((int)stream.LA((ssize_t)wtext.size() + 1), IntStream::EOF);
+
+  std::vector<size_t> offsets;
+  for (size_t i = 0; i < wtext.size(); ++i) {
+    offsets.push_back(stream.index());
+    XCTAssertEqual(stream.LA(1), wtext[i]);
+    stream.consume();
+  }
+  XCTAssertEqual(stream.index(), stream.size());
+  XCTAssertEqual((int)stream.LA(1), IntStream::EOF);
+  XCTAssertThrows(stream.consume());
+
+  for (ssize_t i = 1; i <= (ssize_t)wtext.size(); ++i) {
+    XCTAssertEqual(stream.LA(-i), wtext[wtext.size() - (size_t)i]); // LA(-1) means: previous char.
+  }
+  XCTAssertEqual((int)stream.LA(-(ssize_t)wtext.size() - 1), IntStream::EOF);
+
+  // Text is returned as is, no re-encoding involved.
+  stream.seek(offsets[1]);
+  XCTAssertEqual(stream.LA(1), U'L');
+  XCTAssertEqual(stream.getText(misc::Interval((int)offsets[0], (int)offsets[6] - 1)), u8"🚧Lorem");
+  XCTAssertEqual(stream.getText(misc::Interval((int)offsets[0], 10000)), text.substr(3));
+  XCTAssert(stream.getText(misc::Interval(10000, 10001)).empty());
+
+  XCTAssertEqual(stream.getLineCount(), 3U);
+  XCTAssertEqual(stream.getLineText(1), u8"🚧Lorem ipsum");
+  XCTAssertEqual(stream.getLineText(2), u8"dolor sit µ");
+  XCTAssertEqual(stream.getLineText(3), u8"amet🕶");
+  XCTAssert(stream.getLineText(4).empty());
+
+  // Invalid input doesn't throw, but returns a replacement char per invalid byte.
+  std::string invalid("a\xE2\x82" "b\xFF"); // Truncated 3 byte sequence + invalid lead byte.
+  UTF8CharStream stream2(invalid.data(), invalid.size());
+  std::vector<ssize_t> chars;
+  while (stream2.LA(1) != IntStream::EOF) {
+    chars.push_back(stream2.LA(1));
+    stream2.consume();
+  }
+  XCTAssert(chars == std::vector<ssize_t>({ 'a', 0xFFFD, 0xFFFD, 'b', 0xFFFD }));
+
+  // Overlong forms, surrogates and values beyond U+10FFFF are invalid too, and decoded exactly like the ring buffer
+  // stream does it.
+  invalid = "\xC0\xAF" "\xE0\x80\xAF" "\xED\xA0\x80" "\xF5\x80\x80\x80" "\xF4\x90\x80\x80" "\xF4\x8F\xBF\xBF" "\xED\x9F\xBF";
+  UTF8CharStream stream3(invalid.data(), invalid.size());
+  chars.clear();
+  while (stream3.LA(1) != IntStream::EOF) {
+    chars.push_back(stream3.LA(1));
+    stream3.consume();
+  }
+  std::vector<ssize_t> expected(16, 0xFFFD);
+  expected.push_back(0x10FFFF);
+  expected.push_back(0xD7FF);
+  XCTAssert(chars == expected);
+
+  size_t position = 0;
+  RingBufferCharStream ringStream([&](char *buffer, size_t size) {
+    size_t count = std::min(size, invalid.size() - position);
+    std::copy(invalid.begin() + (ssize_t)position, invalid.begin() + (ssize_t)(position + count), buffer);
+    position += count;
+    return count;
+  }, false, 5);
+  for (size_t i = 0; i < chars.size(); ++i) {
+    XCTAssertEqual(ringStream.LA(1), chars[i]);
+    ringStream.consume();
+  }
+  XCTAssertEqual(ringStream.LA(1), IntStream::EOF);
+}
+
 - (void)testUnbufferedTokenSteam {
   //UnbufferedTokenStream stream;
 }
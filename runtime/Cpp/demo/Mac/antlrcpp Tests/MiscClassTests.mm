@@ -36,9 +36,14 @@
 #include "Exceptions.h"
 #include "Lexer.h"
 #include "CPPUtils.h"
+#include "BasicState.h"
+#include "ATNConfig.h"
+#include "ATNConfigSet.h"
+#include "Arena.h"
 
 using namespace org::antlr::v4::runtime;
 using namespace org::antlr::v4::runtime::misc;
+using namespace org::antlr::v4::runtime::atn;
 using namespace antlrcpp;
 
 @interface MiscClassTests : XCTestCase
@@ -407,4 +412,51 @@ using namespace antlrcpp;
   XCTAssert(IntervalSet::of(15, 20).subtract(IntervalSet::of(7, 55)) == IntervalSet::EMPTY_SET);
 }
 
+- (void)testArena {
+  BasicState state1;
+  state1.stateNumber = 1;
+  BasicState state2;
+  state2.stateNumber = 2;
+
+  Ref<ATNConfig> survivor;
+  Ref<ATNConfigSet> set = std::make_shared<ATNConfigSet>(false);
+  {
+    Arena arena;
+
+    // Released objects make room for the next prediction.
+    for (int i = 0; i < 1000; ++i) {
+      {
+        Ref<ATNConfig> config = arena.create<ATNConfig>(&state1, i, PredictionContext::EMPTY);
+        XCTAssertEqual(config->alt, i);
+      }
+      arena.reset();
+    }
+    XCTAssertEqual(arena.getChunkCount(), 1U);
+
+    // Objects which are still alive keep their chunk, and stay valid beyond the lifetime of the arena.
+    survivor = arena.create<ATNConfig>(&state1, 1, PredictionContext::EMPTY);
+    arena.reset();
+    for (int i = 0; i < 5000; ++i) {
+      Ref<ATNConfig> config = arena.create<ATNConfig>(&state2, i, PredictionContext::EMPTY);
+      if (i % 1000 == 0) {
+        set->add(config);
+      }
+    }
+    XCTAssertGreaterThan(arena.getChunkCount(), 1U);
+
+    // Promoted configs are heap copies with the same content.
+    Ref<ATNConfig> first = set->configs[0];
+    set->promoteConfigs();
+    XCTAssertNotEqual(set->configs[0].get(), first.get());
+    XCTAssert(*set->configs[0] == *first);
+    XCTAssertEqual(set->size(), 5U);
+    set->add(set->configs[1]->clone());
+    XCTAssertEqual(set->size(), 5U);
+  }
+
+  XCTAssertEqual(survivor->state, &state1);
+  XCTAssertEqual(survivor->alt, 1);
+  XCTAssertEqual(set->configs[4]->alt, 4000);
+}
+
 @end
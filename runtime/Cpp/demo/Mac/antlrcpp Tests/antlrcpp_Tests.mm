@@ -31,13 +31,521 @@
 #import <XCTest/XCTest.h>
 
 #include "ParserATNSimulator.h"
+#include "ATNConfigSet.h"
 #include "DFA.h"
+#include "DFAState.h"
 #include "ATN.h"
+#include "ATNType.h"
+#include "ATNDeserializer.h"
+#include "BasicState.h"
+#include "TokensStartState.h"
+#include "RuleStartState.h"
+#include "RuleStopState.h"
+#include "EpsilonTransition.h"
+#include "SetTransition.h"
+#include "ANTLRInputStream.h"
+#include "CommonTokenStream.h"
+#include "LexerInterpreter.h"
+#include "WritableToken.h"
+#include "DFASnapshot.h"
+#include "PredictionContextCache.h"
+#include "PredictionContextMergeCache.h"
+#include "SingletonPredictionContext.h"
+#include "ParseTelemetry.h"
+#include "ParserRuleContext.h"
+#include "CommonToken.h"
+#include "TokenStore.h"
+#include "TerminalNodeImpl.h"
+#include "ParseTreeListener.h"
+#include "ParseTreeWalker.h"
+#include "FlatATN.h"
+#include "NotSetTransition.h"
+#include "AtomTransition.h"
+#include "RingBufferCharStream.h"
+#include "CommonTokenFactory.h"
+#include "TokenSource.h"
+#include "TokenStreamRewriter.h"
+#include "XPathElement.h"
+#include "XPathMatcher.h"
+#include "RuleTagToken.h"
+#include "TokenTagToken.h"
+#include "ParseTreePattern.h"
+#include "ParseTreePatternMatcher.h"
+#include "ParseTreeMatch.h"
+#include "MultiPatternMatcher.h"
+#include "ATNDeserializationOptions.h"
+#include "LexerActionType.h"
+#include "ParserInterpreter.h"
+#include "ParallelParseDriver.h"
+#include "StarLoopEntryState.h"
+#include "ProfilingATNSimulator.h"
+#include "ParseInfo.h"
+#include "DecisionInfo.h"
+#include "LL1Analyzer.h"
+#include "RuleTransition.h"
+#include "StaticLexerDFA.h"
+#include "LexerNoViableAltException.h"
+#include "IncrementalParser.h"
+#include "ConcurrentTokenStream.h"
 
 #include <vector>
+#include <thread>
+#include <condition_variable>
 
 using namespace org::antlr::v4::runtime;
 
+// A hand-built lexer ATN for: WORD: [a-zA-Z\u0080-\u{10FFFF}]+; WS: [ \n]+;
+static void addRule(atn::ATN &atn, atn::TokensStartState *tokensStart, int ruleIndex, const misc::IntervalSet &set) {
+  atn::RuleStartState *start = new atn::RuleStartState();
+  atn::RuleStopState *stop = new atn::RuleStopState();
+  atn::BasicState *loop = new atn::BasicState();
+  atn::BasicState *matched = new atn::BasicState();
+  for (atn::ATNState *state : std::vector<atn::ATNState *>({ start, stop, loop, matched })) {
+    state->setRuleIndex(ruleIndex);
+    atn.addState(state);
+  }
+  start->stopState = stop;
+  atn.ruleToStartState.push_back(start);
+  atn.ruleToStopState.push_back(stop);
+  atn.ruleToTokenType.push_back(ruleIndex + 1);
+
+  tokensStart->addTransition(new atn::EpsilonTransition(start));
+  start->addTransition(new atn::EpsilonTransition(loop));
+  loop->addTransition(new atn::SetTransition(matched, set));
+  matched->addTransition(new atn::EpsilonTransition(loop));
+  matched->addTransition(new atn::EpsilonTransition(stop));
+}
+
+static void createWordLexerATN(atn::ATN &atn) {
+  atn.grammarType = atn::ATNType::LEXER;
+  atn.maxTokenType = 2;
+
+  atn::TokensStartState *tokensStart = new atn::TokensStartState();
+  atn.addState(tokensStart);
+  atn.defineDecisionState(tokensStart);
+  atn.modeToStartState.push_back(tokensStart);
+
+  misc::IntervalSet letters = misc::IntervalSet::of('a', 'z');
+  letters.add('A', 'Z');
+  letters.add(0x80, (int)Lexer::MAX_CHAR_VALUE);
+  addRule(atn, tokensStart, 0, letters);
+
+  misc::IntervalSet whiteSpace = misc::IntervalSet::of(' ');
+  whiteSpace.add('\n');
+  addRule(atn, tokensStart, 1, whiteSpace);
+
+  atn::ATNDeserializer().computeCharClasses(atn);
+}
+
+static size_t lexWords(const atn::ATN &atn, const std::string &text) {
+  ANTLRInputStream input(text);
+  LexerInterpreter lexer("Words.g4", std::vector<std::string>({ "WORD", "WS" }), { "WORD", "WS" }, { "DEFAULT_MODE" },
+    atn, &input);
+  CommonTokenStream tokens(&lexer);
+  tokens.fill();
+  return tokens.size();
+}
+
+// Gives access to the DFAs of a lexer for the word ATN.
+class WordLexer : public LexerInterpreter {
+public:
+  WordLexer(const atn::ATN &atn, CharStream *input)
+    : LexerInterpreter("Words.g4", std::vector<std::string>({ "WORD", "WS" }), { "WORD", "WS" }, { "DEFAULT_MODE" },
+                       atn, input) {
+  }
+
+  std::vector<dfa::DFA>& getDecisionToDFA() {
+    return _decisionToDFA;
+  }
+};
+
+// Records the walk events as a string: '(' and ')' for entering and leaving a rule, 't' and 'e' for terminals and
+// error nodes.
+class EventListener : public tree::ParseTreeListener {
+public:
+  std::string events;
+
+  virtual void visitTerminal(tree::TerminalNode * /*node*/) override {
+    events += 't';
+  }
+
+  virtual void visitErrorNode(tree::ErrorNode * /*node*/) override {
+    events += 'e';
+  }
+
+  virtual void enterEveryRule(ParserRuleContext * /*ctx*/) override {
+    events += '(';
+  }
+
+  virtual void exitEveryRule(ParserRuleContext * /*ctx*/) override {
+    events += ')';
+  }
+};
+
+// Returns one token per character, the token type being the character.
+class CharTokenSource : public TokenSource {
+public:
+  CharTokenSource(const std::string &text) : _text(text), _index(0) {
+  }
+
+  virtual Ref<Token> nextToken() override {
+    if (_index == _text.size()) {
+      return std::make_shared<CommonToken>((int)Token::EOF, "<EOF>");
+    }
+    char c = _text[_index++];
+    return std::make_shared<CommonToken>(c, std::string(1, c));
+  }
+
+  virtual size_t getLine() const override {
+    return 1;
+  }
+
+  virtual int getCharPositionInLine() override {
+    return (int)_index;
+  }
+
+  virtual CharStream* getInputStream() override {
+    return nullptr;
+  }
+
+  virtual std::string getSourceName() override {
+    return "chars";
+  }
+
+  virtual Ref<TokenFactory<CommonToken>> getTokenFactory() override {
+    return CommonTokenFactory::DEFAULT;
+  }
+
+private:
+  std::string _text;
+  size_t _index;
+};
+
+// Applies the edits to the text and returns the result (checking that both ways of rendering agree), or "error" if
+// an edit is rejected.
+static std::string rewrite(const std::string &text, const std::function<void (TokenStreamRewriter &)> &edits) {
+  CharTokenSource source(text);
+  CommonTokenStream tokens(&source);
+  tokens.fill();
+  TokenStreamRewriter rewriter(&tokens);
+  try {
+    edits(rewriter);
+  } catch (IllegalArgumentException &) {
+    return "error";
+  }
+
+  std::string result = rewriter.getText();
+  std::stringstream stream;
+  rewriter.writeText(stream);
+  return stream.str() == result ? result : "mismatch";
+}
+
+// A rule context with a given rule index, to build parse trees without a generated parser.
+class IndexedContext : public ParserRuleContext {
+public:
+  IndexedContext(Ref<ParserRuleContext> parent, size_t ruleIndex) : ParserRuleContext(parent, -1), _ruleIndex(ruleIndex) {
+  }
+
+  virtual ssize_t getRuleIndex() const override {
+    return (ssize_t)_ruleIndex;
+  }
+
+private:
+  size_t _ruleIndex;
+};
+
+// Writes a serialized ATN laid out the way the tool does it, so that tests can run small grammars with the
+// interpreters instead of generated code. Each element is a fragment between a left and a right state.
+class ATNBuilder {
+public:
+  typedef std::pair<size_t, size_t> Handle;
+
+  ATNBuilder(atn::ATNType grammarType, size_t maxTokenType) : _grammarType(grammarType), _maxTokenType(maxTokenType) {
+  }
+
+  // Lexer modes must be added before anything else, as the decision of a mode is its index.
+  size_t mode() {
+    _modes.push_back(state(atn::ATNState::TOKEN_START, -1));
+    _decisions.push_back(_modes.back());
+    return _modes.size() - 1;
+  }
+
+  // Adds a parser rule.
+  size_t rule(bool leftRecursive = false) {
+    size_t index = _rules.size();
+    _rules.push_back(state(atn::ATNState::RULE_START, (int)index));
+    _ruleTokenTypes.push_back(0);
+    state(atn::ATNState::RULE_STOP, (int)index);
+    if (leftRecursive) {
+      _precedenceRules.push_back(_rules.back());
+    }
+    return index;
+  }
+
+  // Adds a lexer rule for the token type to the mode, or a fragment rule if the mode is -1.
+  size_t lexerRule(int tokenType, int mode) {
+    size_t index = rule();
+    _ruleTokenTypes[index] = tokenType;
+    if (mode >= 0) {
+      edge(_modes[(size_t)mode], _rules[index], atn::Transition::EPSILON);
+    }
+    return index;
+  }
+
+  // Defines the alternatives of a rule; the rule's stop state is the state after the start state.
+  void define(size_t rule, const std::vector<Handle> &alts) {
+    Handle body = block(rule, alts);
+    edge(_rules[rule], body.first, atn::Transition::EPSILON);
+    edge(body.second, _rules[rule] + 1, atn::Transition::EPSILON);
+  }
+
+  Handle epsilon(size_t rule) {
+    return transition(rule, atn::Transition::EPSILON);
+  }
+
+  Handle atom(size_t rule, int symbol) {
+    return symbol == Token::EOF ? transition(rule, atn::Transition::ATOM, 0, 0, 1) : transition(rule, atn::Transition::ATOM, symbol);
+  }
+
+  Handle range(size_t rule, int from, int to) {
+    return transition(rule, atn::Transition::RANGE, from, to);
+  }
+
+  Handle set(size_t rule, const misc::IntervalSet &set, bool negated = false) {
+    _sets.push_back(set);
+    return transition(rule, negated ? atn::Transition::NOT_SET : atn::Transition::SET, (int)_sets.size() - 1);
+  }
+
+  Handle wildcard(size_t rule) {
+    return transition(rule, atn::Transition::WILDCARD);
+  }
+
+  Handle predicate(size_t rule, int predIndex) {
+    return transition(rule, atn::Transition::PREDICATE, (int)rule, predIndex);
+  }
+
+  Handle precedence(size_t rule, int precedence) {
+    return transition(rule, atn::Transition::PRECEDENCE, precedence);
+  }
+
+  // A lexer action (the data of custom actions is the rule and the action index).
+  Handle action(size_t rule, atn::LexerActionType type, int data1 = 0, int data2 = 0) {
+    _lexerActions.push_back({ (int)type, data1, data2 });
+    return transition(rule, atn::Transition::ACTION, (int)rule, (int)_lexerActions.size() - 1);
+  }
+
+  Handle ruleRef(size_t rule, size_t target, int precedence = 0) {
+    Handle result(state(atn::ATNState::BASIC, (int)rule), state(atn::ATNState::BASIC, (int)rule));
+    edge(result.first, result.second, atn::Transition::RULE, (int)_rules[target], (int)target, precedence);
+    return result;
+  }
+
+  Handle sequence(size_t /*rule*/, const std::vector<Handle> &elements) {
+    for (size_t i = 1; i < elements.size(); ++i) {
+      edge(elements[i - 1].second, elements[i].first, atn::Transition::EPSILON);
+    }
+    return Handle(elements.front().first, elements.back().second);
+  }
+
+  // (a | b), a decision if there is more than one alternative.
+  Handle block(size_t rule, const std::vector<Handle> &alts) {
+    if (alts.size() == 1) {
+      return alts[0];
+    }
+    Handle result = blockStates(rule, atn::ATNState::BLOCK_START, alts);
+    _decisions.push_back(result.first);
+    return result;
+  }
+
+  // (a | b)?
+  Handle optional(size_t rule, const std::vector<Handle> &alts, bool greedy = true) {
+    Handle result = blockStates(rule, atn::ATNState::BLOCK_START, alts);
+    if (greedy) {
+      edge(result.first, result.second, atn::Transition::EPSILON);
+    } else {
+      _edges.insert(_edges.begin() + (ssize_t)firstEdge(result.first), { result.first, result.second, atn::Transition::EPSILON, 0, 0, 0 });
+      _nonGreedy.push_back(result.first);
+    }
+    _decisions.push_back(result.first);
+    return result;
+  }
+
+  // (a | b)*
+  Handle star(size_t rule, const std::vector<Handle> &alts, bool greedy = true) {
+    Handle block = blockStates(rule, atn::ATNState::STAR_BLOCK_START, alts);
+    if (alts.size() > 1) {
+      _decisions.push_back(block.first);
+    }
+    size_t entry = state(atn::ATNState::STAR_LOOP_ENTRY, (int)rule);
+    size_t loopBack = state(atn::ATNState::STAR_LOOP_BACK, (int)rule);
+    size_t end = state(atn::ATNState::LOOP_END, (int)rule, (int)loopBack);
+    edge(entry, greedy ? block.first : end, atn::Transition::EPSILON);
+    edge(entry, greedy ? end : block.first, atn::Transition::EPSILON);
+    edge(block.second, loopBack, atn::Transition::EPSILON);
+    edge(loopBack, entry, atn::Transition::EPSILON);
+    if (!greedy) {
+      _nonGreedy.push_back(entry);
+    }
+    _decisions.push_back(entry);
+    return Handle(entry, end);
+  }
+
+  // (a | b)+
+  Handle plus(size_t rule, const std::vector<Handle> &alts) {
+    Handle block = blockStates(rule, atn::ATNState::PLUS_BLOCK_START, alts);
+    if (alts.size() > 1) {
+      _decisions.push_back(block.first);
+    }
+    size_t loopBack = state(atn::ATNState::PLUS_LOOP_BACK, (int)rule);
+    size_t end = state(atn::ATNState::LOOP_END, (int)rule, (int)loopBack);
+    edge(block.second, loopBack, atn::Transition::EPSILON);
+    edge(loopBack, block.first, atn::Transition::EPSILON);
+    edge(loopBack, end, atn::Transition::EPSILON);
+    _decisions.push_back(loopBack);
+    return Handle(block.first, end);
+  }
+
+  atn::ATN build(bool generateRuleBypassTransitions = false) {
+    // The version and the UUID of the serialization format with lexer actions.
+    std::vector<uint16_t> data = { 3, 1072, 54993, 33286, 44333, 17431, 44785, 36224, 43741 };
+    auto add = [&data](int value) {
+      data.push_back((uint16_t)(value + 2));
+    };
+
+    add((int)_grammarType);
+    add((int)_maxTokenType);
+    add((int)_states.size());
+    for (const State &state : _states) {
+      add(state.type);
+      add(state.ruleIndex < 0 ? 0xFFFF : state.ruleIndex);
+      if (state.extra >= 0) {
+        add(state.extra);
+      }
+    }
+    addList(add, _nonGreedy);
+    addList(add, _precedenceRules);
+
+    add((int)_rules.size());
+    for (size_t i = 0; i < _rules.size(); ++i) {
+      add((int)_rules[i]);
+      if (_grammarType == atn::ATNType::LEXER) {
+        add(_ruleTokenTypes[i] == Token::EOF ? 0xFFFF : _ruleTokenTypes[i]);
+      }
+    }
+    addList(add, _modes);
+
+    add((int)_sets.size());
+    for (const misc::IntervalSet &set : _sets) {
+      std::vector<misc::Interval> intervals;
+      for (const misc::Interval &interval : set.getIntervals()) {
+        if (interval.b >= 0) {
+          intervals.push_back(misc::Interval(std::max(interval.a, 0), std::min(interval.b, 0xFFFF)));
+        }
+      }
+      add((int)intervals.size());
+      add(set.contains(Token::EOF) ? 1 : 0);
+      for (const misc::Interval &interval : intervals) {
+        add(interval.a);
+        add(interval.b);
+      }
+    }
+
+    add((int)_edges.size());
+    for (const Edge &edge : _edges) {
+      add((int)edge.source);
+      add((int)edge.target);
+      add(edge.type);
+      add(edge.arg1);
+      add(edge.arg2);
+      add(edge.arg3);
+    }
+    addList(add, _decisions);
+
+    if (_grammarType == atn::ATNType::LEXER) {
+      add((int)_lexerActions.size());
+      for (const std::vector<int> &action : _lexerActions) {
+        add(action[0]);
+        add(action[1] < 0 ? 0xFFFF : action[1]);
+        add(action[2] < 0 ? 0xFFFF : action[2]);
+      }
+    }
+
+    atn::ATNDeserializationOptions options;
+    options.setGenerateRuleBypassTransitions(generateRuleBypassTransitions);
+    return atn::ATNDeserializer(options).deserialize(data);
+  }
+
+private:
+  struct State {
+    int type;
+    int ruleIndex;
+    int extra; // The loop back state of a loop end, the end state of a block start.
+  };
+
+  struct Edge {
+    size_t source;
+    size_t target;
+    int type;
+    int arg1;
+    int arg2;
+    int arg3;
+  };
+
+  atn::ATNType _grammarType;
+  size_t _maxTokenType;
+  std::vector<State> _states;
+  std::vector<Edge> _edges;
+  std::vector<size_t> _rules;
+  std::vector<int> _ruleTokenTypes;
+  std::vector<size_t> _modes;
+  std::vector<size_t> _decisions;
+  std::vector<size_t> _nonGreedy;
+  std::vector<size_t> _precedenceRules;
+  std::vector<misc::IntervalSet> _sets;
+  std::vector<std::vector<int>> _lexerActions;
+
+  size_t state(int type, int ruleIndex, int extra = -1) {
+    _states.push_back({ type, ruleIndex, extra });
+    return _states.size() - 1;
+  }
+
+  void edge(size_t source, size_t target, int type, int arg1 = 0, int arg2 = 0, int arg3 = 0) {
+    _edges.push_back({ source, target, type, arg1, arg2, arg3 });
+  }
+
+  size_t firstEdge(size_t source) const {
+    size_t i = 0;
+    while (i < _edges.size() && _edges[i].source != source) {
+      ++i;
+    }
+    return i;
+  }
+
+  Handle transition(size_t rule, int type, int arg1 = 0, int arg2 = 0, int arg3 = 0) {
+    Handle result(state(atn::ATNState::BASIC, (int)rule), state(atn::ATNState::BASIC, (int)rule));
+    edge(result.first, result.second, type, arg1, arg2, arg3);
+    return result;
+  }
+
+  Handle blockStates(size_t rule, int startType, const std::vector<Handle> &alts) {
+    size_t end = state(atn::ATNState::BLOCK_END, (int)rule);
+    size_t start = state(startType, (int)rule, (int)end);
+    for (const Handle &alt : alts) {
+      edge(start, alt.first, atn::Transition::EPSILON);
+      edge(alt.second, end, atn::Transition::EPSILON);
+    }
+    return Handle(start, end);
+  }
+
+  template<typename F>
+  static void addList(F &add, const std::vector<size_t> &list) {
+    add((int)list.size());
+    for (size_t value : list) {
+      add((int)value);
+    }
+  }
+};
+
 @interface antlrcpp_Tests : XCTestCase
 
 @end
@@ -68,4 +576,1519 @@ using namespace org::antlr::v4::runtime;
     XCTAssert(YES, @"Pass");
 }
 
+- (void)testConcurrentDFAUpdates {
+  const size_t threadCount = 8;
+  const size_t edgeCount = 128;
+
+  dfa::DFA dfa(nullptr);
+  std::vector<dfa::DFAState *> interned(threadCount);
+
+  // Equal states added from different threads must all resolve to the same instance.
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < threadCount; ++i) {
+    threads.emplace_back([&, i]() {
+      for (size_t round = 0; round < 1000; ++round) {
+        dfa::DFAState *state = new dfa::DFAState(std::make_shared<atn::ATNConfigSet>());
+        dfa::DFAState *existing = dfa.addState(state);
+        if (existing != state) {
+          delete state;
+        }
+        interned[i] = existing;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  XCTAssertEqual(dfa.states.size(), 1U);
+  XCTAssertEqual(dfa.internMisses, 1U);
+  XCTAssertEqual(dfa.internHits, threadCount * 1000 - 1);
+  for (auto state : interned) {
+    XCTAssertEqual(state, interned[0]);
+  }
+
+  // Writers and readers hammering the same edge table. Readers must only ever see null or the final target.
+  dfa::DFAState *source = interned[0];
+  dfa::DFAState target(1);
+  threads.clear();
+  for (size_t i = 0; i < threadCount; ++i) {
+    threads.emplace_back([&, i]() {
+      for (size_t round = 0; round < 1000; ++round) {
+        for (size_t edge = i; edge < edgeCount; edge += threadCount) {
+          source->setEdge(edge, &target, edgeCount);
+        }
+        for (size_t edge = 0; edge < edgeCount; ++edge) {
+          dfa::DFAState *existing = source->getEdge(edge);
+          XCTAssert(existing == nullptr || existing == &target);
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  XCTAssertEqual(source->getEdgeCount(), edgeCount);
+  for (size_t edge = 0; edge < edgeCount; ++edge) {
+    XCTAssertEqual(source->getEdge(edge), &target);
+  }
+  XCTAssert(source->getEdge(edgeCount) == nullptr);
+}
+
+- (void)testTokenStore {
+  atn::ATN atn;
+  createWordLexerATN(atn);
+
+  ANTLRInputStream input("hello world\n");
+  LexerInterpreter lexer("Words.g4", std::vector<std::string>({ "WORD", "WS" }), { "WORD", "WS" }, { "DEFAULT_MODE" },
+    atn, &input);
+
+  Ref<Token> token;
+  {
+    CommonTokenStream tokens(&lexer);
+    tokens.fill();
+    XCTAssertEqual(tokens.size(), 5U);
+    XCTAssertEqual(tokens.getText(), "hello world\n");
+
+    token = tokens.get(2);
+    XCTAssertEqual(token->getText(), "world");
+    XCTAssertEqual(token->getType(), 1);
+    XCTAssertEqual(token->getTokenIndex(), 2);
+    XCTAssertEqual(token->getStartIndex(), 6);
+    XCTAssertEqual(token->getStopIndex(), 10);
+    XCTAssertEqual(token->getCharPositionInLine(), 6);
+    XCTAssertEqual(token->getInputStream(), &input);
+    XCTAssertEqual(tokens.get(4)->getText(), "<EOF>");
+
+    // Repeated lookups share one token object and changes go to the stream.
+    XCTAssert(tokens.LT(1).get() == tokens.LT(1).get());
+    std::dynamic_pointer_cast<WritableToken>(token)->setText("there");
+    std::dynamic_pointer_cast<WritableToken>(tokens.LT(1))->setType(2);
+    XCTAssertEqual(tokens.getText(), "hello there\n");
+    XCTAssertEqual(tokens.LA(1), 2);
+  }
+
+  // Tokens stay valid after the token stream is gone.
+  XCTAssertEqual(token->getText(), "there");
+
+  // Replacing a range of tokens moves the tokens behind it, their views follow them.
+  ANTLRInputStream other("one two three");
+  lexer.setInputStream(&other);
+  Ref<TokenStore> store = std::make_shared<TokenStore>();
+  while (true) {
+    store->add(lexer.nextToken());
+    if (store->getType(store->size() - 1) == Token::EOF) {
+      break;
+    }
+  }
+  XCTAssertEqual(store->size(), 6U);
+  Ref<Token> one = store->get(0);
+  Ref<Token> two = store->get(2);
+  Ref<Token> three = store->get(4);
+
+  store->replace(2, 1, { std::make_shared<CommonToken>(1, "tw"), std::make_shared<CommonToken>(1, "o") }, 0, 1);
+  XCTAssertEqual(store->size(), 7U);
+  XCTAssertEqual(store->getVersion(), 1U);
+  XCTAssertEqual(one->getTokenIndex(), 0);
+  XCTAssertEqual(one->getLine(), 1);
+  XCTAssertEqual(three->getTokenIndex(), 5);
+  XCTAssertEqual(three->getText(), "three");
+  XCTAssertEqual(three->getLine(), 2);
+  XCTAssertEqual(store->get(2)->getTokenIndex(), 2);
+  XCTAssertEqual(store->get(3)->getText(), "o");
+  XCTAssertEqual(two->getTokenIndex(), 3); // Replaced tokens move to the last new one.
+
+  // Views catch up with several replacements at once.
+  store->replace(4, 1, {}, 0, 0);
+  store->replace(0, 0, { std::make_shared<CommonToken>(2, " ") }, 0, 0);
+  XCTAssertEqual(store->size(), 7U);
+  XCTAssertEqual(three->getTokenIndex(), 5);
+  XCTAssertEqual(three->getType(), 1);
+  XCTAssertEqual(one->getTokenIndex(), 1);
+  XCTAssertEqual(store->getType(6), Token::EOF);
+  XCTAssertThrows(store->replace(6, 2, {}, 0, 0));
+}
+
+- (void)testDFASnapshot {
+  atn::ATN atn;
+  createWordLexerATN(atn);
+
+  // The hand-built ATN has no serialized form, any data works as key here.
+  std::vector<uint16_t> serializedATN = { 1, 2, 3 };
+  std::string text = u8"hello world\nµ∰ 😎\n";
+
+  std::stringstream snapshot;
+  std::string dfaText;
+  {
+    ANTLRInputStream input(text);
+    WordLexer lexer(atn, &input);
+    CommonTokenStream tokens(&lexer);
+    tokens.fill();
+    dfaText = lexer.getDecisionToDFA()[0].toLexerString();
+    dfa::DFASnapshot::save(snapshot, serializedATN, atn, lexer.getDecisionToDFA());
+  }
+
+  ANTLRInputStream input(text);
+  WordLexer lexer(atn, &input);
+  std::vector<dfa::DFA> &decisionToDFA = lexer.getDecisionToDFA();
+
+  std::stringstream otherGrammar(snapshot.str());
+  XCTAssertFalse(dfa::DFASnapshot::load(otherGrammar, { 4, 5, 6 }, atn, decisionToDFA));
+  std::stringstream truncated(snapshot.str().substr(0, snapshot.str().size() / 2));
+  XCTAssertFalse(dfa::DFASnapshot::load(truncated, serializedATN, atn, decisionToDFA));
+  XCTAssert(decisionToDFA[0].states.empty());
+
+  XCTAssert(dfa::DFASnapshot::load(snapshot, serializedATN, atn, decisionToDFA));
+  XCTAssertEqual(decisionToDFA[0].toLexerString(), dfaText);
+
+  // Lexing the same input again needs no new DFA states.
+  size_t stateCount = decisionToDFA[0].states.size();
+  CommonTokenStream tokens(&lexer);
+  tokens.fill();
+  XCTAssertEqual(tokens.size(), 9U);
+  XCTAssertEqual(decisionToDFA[0].states.size(), stateCount);
+
+  // Edge tables larger than the simulator uses are rejected (here: one more edge for a character class).
+  std::stringstream wideSnapshot;
+  atn.charClassStarts.push_back(0x80);
+  {
+    ANTLRInputStream wideInput(text);
+    WordLexer wideLexer(atn, &wideInput);
+    CommonTokenStream wideTokens(&wideLexer);
+    wideTokens.fill();
+    dfa::DFASnapshot::save(wideSnapshot, serializedATN, atn, wideLexer.getDecisionToDFA());
+  }
+  atn.charClassStarts.clear();
+  ANTLRInputStream narrowInput(text);
+  WordLexer narrowLexer(atn, &narrowInput);
+  XCTAssertFalse(dfa::DFASnapshot::load(wideSnapshot, serializedATN, atn, narrowLexer.getDecisionToDFA()));
+  XCTAssert(narrowLexer.getDecisionToDFA()[0].states.empty());
+}
+
+- (void)testParallelParseDriver {
+  atn::ATN lexerATN;
+  createWordLexerATN(lexerATN);
+
+  // s: (WORD WS)* WORD EOF; (the loop needs two tokens of lookahead, so it is predicted with the DFA)
+  ATNBuilder builder(atn::ATNType::PARSER, 2);
+  size_t s = builder.rule();
+  builder.define(s, { builder.sequence(s, {
+    builder.star(s, { builder.sequence(s, { builder.atom(s, 1), builder.atom(s, 2) }) }),
+    builder.atom(s, 1),
+    builder.atom(s, Token::EOF)
+  }) });
+  atn::ATN parserATN = builder.build();
+
+  // Like generated recognizers, all instances share their DFAs.
+  std::vector<dfa::DFA> lexerDFA;
+  lexerDFA.push_back(dfa::DFA(lexerATN.getDecisionState(0), 0));
+  std::vector<dfa::DFA> parserDFA;
+  for (size_t i = 0; i < parserATN.getNumberOfDecisions(); ++i) {
+    parserDFA.push_back(dfa::DFA(parserATN.getDecisionState((int)i), (int)i));
+  }
+  Ref<atn::PredictionContextCache> lexerCache = std::make_shared<atn::PredictionContextCache>();
+  Ref<atn::PredictionContextCache> parserCache = std::make_shared<atn::PredictionContextCache>();
+
+  std::atomic<size_t> lexerCount(0);
+  auto createLexer = [&](CharStream *input) {
+    ++lexerCount;
+    std::unique_ptr<WordLexer> lexer(new WordLexer(lexerATN, input));
+    lexer->setInterpreter(new atn::LexerATNSimulator(lexer.get(), lexerATN, lexerDFA, lexerCache));
+    return std::unique_ptr<Lexer>(std::move(lexer));
+  };
+  auto createParser = [&](TokenStream *tokens) {
+    std::unique_ptr<ParserInterpreter> parser(new ParserInterpreter("S.g4", std::vector<std::string>(), { "s" },
+      parserATN, tokens));
+    parser->setInterpreter(new atn::ParserATNSimulator(parser.get(), parserATN, parserDFA, parserCache));
+    return std::unique_ptr<Parser>(std::move(parser));
+  };
+
+  // The input named "slow" waits until all others are parsed. The others are queued for all workers (including the
+  // one parsing "slow"), so this only finishes if idle workers take over the work of busy ones.
+  std::mutex lock;
+  std::condition_variable othersDone;
+  size_t parsedCount = 0;
+  bool waitedForOthers = false;
+  std::map<std::string, std::thread::id> threadOfInput;
+
+  std::vector<ParallelParseDriver::Input> inputs;
+  inputs.push_back(ParallelParseDriver::Input::fromBuffer("slow", "slow"));
+  for (size_t i = 1; i < 40; ++i) {
+    std::string text = "word";
+    for (size_t j = 0; j < i; ++j) {
+      text += j % 3 == 0 ? "\nmore" : " words";
+    }
+    inputs.push_back(ParallelParseDriver::Input::fromBuffer("input" + std::to_string(i), text));
+  }
+  inputs.push_back(ParallelParseDriver::Input::fromBuffer("parser error", " leading space"));
+  inputs.push_back(ParallelParseDriver::Input::fromBuffer("lexer error", "a1b"));
+  inputs.push_back(ParallelParseDriver::Input::fromFile("/no/such/file.txt"));
+
+  ParallelParseDriver driver(createLexer, createParser, [&](Parser *parser) {
+    std::string name = parser->getInputStream()->getSourceName();
+    std::unique_lock<std::mutex> guard(lock);
+    threadOfInput[name] = std::this_thread::get_id();
+    if (name == "slow") {
+      waitedForOthers = othersDone.wait_for(guard, std::chrono::seconds(30), [&] {
+        return parsedCount == inputs.size() - 2; // All but this and the unreadable file.
+      });
+    }
+    guard.unlock();
+
+    Ref<ParserRuleContext> tree = static_cast<ParserInterpreter *>(parser)->parse(0);
+
+    guard.lock();
+    ++parsedCount;
+    othersDone.notify_all();
+    return tree;
+  }, 4);
+  XCTAssertEqual(driver.getThreadCount(), 4U);
+
+  std::vector<ParallelParseDriver::Result> results = driver.parse(inputs);
+  XCTAssert(waitedForOthers);
+  XCTAssertEqual(results.size(), inputs.size());
+  XCTAssertEqual(threadOfInput.size(), inputs.size() - 1);
+  std::set<std::thread::id> threads;
+  for (auto &entry : threadOfInput) {
+    threads.insert(entry.second);
+  }
+  XCTAssert(threads.size() > 1);
+  XCTAssert(lexerCount <= 4); // Each worker reuses its recognizers.
+
+  // Each result matches a separate parse of its input.
+  for (size_t i = 0; i + 1 < inputs.size(); ++i) {
+    ParallelParseDriver::Result &result = results[i];
+    XCTAssertEqual(result.name, inputs[i].name);
+    XCTAssert(result.exception == nullptr);
+    XCTAssert(result.tree != nullptr);
+
+    ANTLRInputStream input(inputs[i].text);
+    LexerInterpreter lexer("Words.g4", std::vector<std::string>({ "WORD", "WS" }), { "WORD", "WS" },
+      { "DEFAULT_MODE" }, lexerATN, &input);
+    lexer.removeErrorListeners();
+    CommonTokenStream tokens(&lexer);
+    ParserInterpreter parser("S.g4", std::vector<std::string>(), { "s" }, parserATN, &tokens);
+    parser.removeErrorListeners();
+    XCTAssertEqual(result.tree->toStringTree(&parser), parser.parse(0)->toStringTree(&parser));
+    XCTAssertEqual(result.succeeded(), i < 40);
+  }
+
+  XCTAssertEqual(results[40].syntaxErrors.size(), 1U);
+  XCTAssertEqual(results[40].syntaxErrors[0], "line 1:0 extraneous input ' ' expecting 1");
+  XCTAssertEqual(results[41].syntaxErrors.size(), 2U);
+  XCTAssertEqual(results[41].syntaxErrors[0], "line 1:1 token recognition error at: '1'");
+  XCTAssertEqual(results[42].name, "/no/such/file.txt");
+  XCTAssert(results[42].tree == nullptr);
+  XCTAssert(results[42].exception != nullptr);
+  XCTAssertFalse(results[42].succeeded());
+
+  // All workers filled the same DFAs.
+  XCTAssertGreaterThan(parserDFA[0].states.size(), 0U);
+  XCTAssertGreaterThan(lexerDFA[0].states.size(), 0U);
+}
+
+- (void)testParseTwoStage {
+  // s: ('c' a 'x' | 'd' a) EOF; a: | 'x';
+  // SLL merges the contexts of both calls of a, so it predicts the empty alternative for "dx" and has to fall back.
+  ATNBuilder builder(atn::ATNType::PARSER, 'z');
+  size_t s = builder.rule();
+  size_t a = builder.rule();
+  builder.define(s, { builder.sequence(s, {
+    builder.block(s, {
+      builder.sequence(s, { builder.atom(s, 'c'), builder.ruleRef(s, a), builder.atom(s, 'x') }),
+      builder.sequence(s, { builder.atom(s, 'd'), builder.ruleRef(s, a) })
+    }),
+    builder.atom(s, Token::EOF)
+  }) });
+  builder.define(a, { builder.epsilon(a), builder.atom(a, 'x') });
+  atn::ATN atn = builder.build();
+
+  // Returns the tree, the listener events and the number of syntax errors, with a fallback marked by a '!'.
+  auto parse = [&atn](const std::string &text, bool twoStage, bool buildParseTrees) {
+    CharTokenSource source(text);
+    CommonTokenStream tokens(&source);
+    ParserInterpreter parser("T.g4", std::vector<std::string>(), { "s", "a" }, atn, &tokens);
+    parser.removeErrorListeners();
+    parser.setBuildParseTree(buildParseTrees);
+    Ref<EventListener> listener = std::make_shared<EventListener>();
+    parser.addParseListener(listener);
+
+    Ref<ParserRuleContext> tree;
+    if (twoStage) {
+      tree = parser.parseTwoStage([&parser]() { return parser.parse(0); });
+    } else {
+      tree = parser.parse(0);
+    }
+    XCTAssertEqual(parser.getParseListeners().size(), 1U);
+    XCTAssertEqual(parser.getInterpreter<atn::ParserATNSimulator>()->getPredictionMode(), atn::PredictionMode::LL);
+    return tree->toStringTree(&parser) + " " + listener->events + " " + std::to_string(parser.getNumberOfSyntaxErrors()) +
+      (parser.getTwoStageStatistics().lastParseFellBack ? "!" : "");
+  };
+
+  XCTAssertEqual(parse("cxx", false, true), "(s c (a x) x <EOF>) (t(t)tt) 0");
+  XCTAssertEqual(parse("cxx", true, true), "(s c (a x) x <EOF>) (t(t)tt) 0");
+  XCTAssertEqual(parse("dx", false, true), "(s d (a x) <EOF>) (t(t)t) 0");
+  XCTAssertEqual(parse("dx", true, true), "(s d (a x) <EOF>) (t(t)t) 0!");
+  XCTAssertEqual(parse("dxx", true, true), parse("dxx", false, true) + "!");
+  XCTAssertEqual(parse("cx", true, true), parse("cx", false, true));
+
+  // Nothing to replay without a tree, so the parse runs in a single LL stage.
+  XCTAssertEqual(parse("dx", true, false), parse("dx", false, false));
+}
+
+- (void)testPredictionContextCache {
+  atn::PredictionContextCache cache;
+
+  // Structurally equal nodes built separately are shared.
+  auto createStack = [](int top) {
+    Ref<atn::PredictionContext> bottom = atn::SingletonPredictionContext::create(atn::PredictionContext::EMPTY, 10);
+    return atn::SingletonPredictionContext::create(bottom, top);
+  };
+  Ref<atn::PredictionContext> first = cache.add(createStack(20));
+  Ref<atn::PredictionContext> second = createStack(20);
+  XCTAssert(first.get() != second.get());
+  XCTAssertEqual(cache.get(second).get(), first.get());
+  XCTAssertEqual(cache.add(second).get(), first.get());
+  XCTAssert(cache.get(createStack(21)) == nullptr);
+  XCTAssertEqual(cache.size(), 1U);
+
+  // Concurrent additions of equal nodes all end up with the same instance.
+  const size_t threadCount = 8;
+  std::vector<atn::PredictionContext *> interned(threadCount);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < threadCount; ++i) {
+    threads.emplace_back([&, i]() {
+      for (int top = 0; top < 1000; ++top) {
+        Ref<atn::PredictionContext> cached = cache.add(createStack(top));
+        if (top == 500) {
+          interned[i] = cached.get();
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  XCTAssertEqual(cache.size(), 1000U);
+  for (auto context : interned) {
+    XCTAssertEqual(context, interned[0]);
+  }
+
+  // With a size limit the cache never grows beyond it.
+  cache.clear();
+  cache.setMaxSize(64);
+  for (int top = 0; top < 1000; ++top) {
+    cache.add(createStack(top));
+  }
+  XCTAssert(cache.size() <= 64U);
+  XCTAssertFalse(cache.isEmpty());
+}
+
+- (void)testPredictionContextMergeCache {
+  atn::PredictionContextMergeCache cache(100);
+  Ref<atn::PredictionContext> a = atn::SingletonPredictionContext::create(atn::PredictionContext::EMPTY, 1);
+  Ref<atn::PredictionContext> b = atn::SingletonPredictionContext::create(atn::PredictionContext::EMPTY, 2);
+  Ref<atn::PredictionContext> merged = atn::PredictionContext::merge(a, b, false, nullptr);
+
+  XCTAssert(cache.get(a, b, false) == nullptr);
+  cache.put(a, b, false, merged);
+  XCTAssertEqual(cache.get(a, b, false).get(), merged.get());
+  XCTAssertEqual(cache.get(b, a, false).get(), merged.get());
+  XCTAssert(cache.get(a, b, true) == nullptr);
+  XCTAssertEqual(cache.getHits(), 2U);
+  XCTAssertEqual(cache.getMisses(), 2U);
+
+  // Merging through the cache stores the result, merging again finds it.
+  Ref<atn::PredictionContext> c = atn::SingletonPredictionContext::create(atn::PredictionContext::EMPTY, 3);
+  Ref<atn::PredictionContext> first = atn::PredictionContext::merge(a, c, false, &cache);
+  Ref<atn::PredictionContext> second = atn::PredictionContext::merge(c, a, false, &cache);
+  XCTAssertEqual(first.get(), second.get());
+
+  // The size limit holds while the table grows.
+  std::vector<Ref<atn::PredictionContext>> contexts;
+  for (int i = 0; i < 1000; ++i) {
+    contexts.push_back(atn::SingletonPredictionContext::create(atn::PredictionContext::EMPTY, i + 10));
+    cache.put(a, contexts.back(), false, a);
+    XCTAssert(cache.size() <= 100U);
+  }
+  XCTAssertEqual(cache.get(a, contexts.back(), false).get(), a.get());
+  cache.clear();
+  XCTAssertEqual(cache.size(), 0U);
+  XCTAssert(cache.get(a, b, false) == nullptr);
+}
+
+- (void)testLL1Tables {
+  // s: a b c e g EOF; a: 'x' | 'y' 'z'; b: 'x' 'y' | 'x' 'z'; c: {p}? 'w' | 'v'; e: 'p' 'o'* (left recursive);
+  // g: 'n' 'o'*;
+  ATNBuilder builder(atn::ATNType::PARSER, 'z');
+  size_t s = builder.rule();
+  size_t a = builder.rule();
+  size_t b = builder.rule();
+  size_t c = builder.rule();
+  size_t e = builder.rule(true);
+  size_t g = builder.rule();
+  builder.define(s, { builder.sequence(s, {
+    builder.ruleRef(s, a), builder.ruleRef(s, b), builder.ruleRef(s, c), builder.ruleRef(s, e), builder.ruleRef(s, g),
+    builder.atom(s, Token::EOF)
+  }) });
+  builder.define(a, { builder.atom(a, 'x'), builder.sequence(a, { builder.atom(a, 'y'), builder.atom(a, 'z') }) });
+  builder.define(b, {
+    builder.sequence(b, { builder.atom(b, 'x'), builder.atom(b, 'y') }),
+    builder.sequence(b, { builder.atom(b, 'x'), builder.atom(b, 'z') })
+  });
+  builder.define(c, { builder.sequence(c, { builder.predicate(c, 0), builder.atom(c, 'w') }), builder.atom(c, 'v') });
+  builder.define(e, { builder.sequence(e, { builder.atom(e, 'p'), builder.star(e, { builder.atom(e, 'o') }) }) });
+  builder.define(g, { builder.sequence(g, { builder.atom(g, 'n'), builder.star(g, { builder.atom(g, 'o') }) }) });
+  atn::ATN atn = builder.build();
+
+  // Every rule except s has exactly one decision.
+  std::vector<size_t> ruleToDecision(6, 0);
+  for (atn::DecisionState *state : atn.decisionToState) {
+    ruleToDecision[(size_t)state->ruleIndex] = (size_t)state->decision;
+  }
+  XCTAssertEqual(atn.decisionToState.size(), 5U);
+  XCTAssertEqual(atn.decisionToLL1Table.size(), 5U);
+  XCTAssert(static_cast<atn::StarLoopEntryState *>(atn.decisionToState[ruleToDecision[e]])->isPrecedenceDecision);
+
+  // The tables map the token type + 1 to the alternative.
+  auto entries = [](const std::vector<uint16_t> &table) {
+    return (size_t)std::count_if(table.begin(), table.end(), [](uint16_t alt) {
+      return alt != atn::ATN::INVALID_ALT_NUMBER;
+    });
+  };
+  const std::vector<uint16_t> &aTable = atn.decisionToLL1Table[ruleToDecision[a]];
+  XCTAssertEqual(aTable.size(), (size_t)'z' + 2);
+  XCTAssertEqual(aTable['x' + 1], 1U);
+  XCTAssertEqual(aTable['y' + 1], 2U);
+  XCTAssertEqual(entries(aTable), 2U);
+
+  // The exit branch of a loop predicts the follow of the rule, here EOF.
+  const std::vector<uint16_t> &gTable = atn.decisionToLL1Table[ruleToDecision[g]];
+  XCTAssertEqual(gTable['o' + 1], 1U);
+  XCTAssertEqual(gTable[Token::EOF + 1], 2U);
+  XCTAssertEqual(entries(gTable), 2U);
+
+  // Overlapping lookahead, a predicate and a precedence decision (whose lookahead alone is LL(1)) get no table.
+  XCTAssert(atn.decisionToLL1Table[ruleToDecision[b]].empty());
+  XCTAssert(atn.decisionToLL1Table[ruleToDecision[c]].empty());
+  XCTAssert(atn.decisionToLL1Table[ruleToDecision[e]].empty());
+
+  // Table hits are counted by the profiler and bypass the DFA, the other decisions go through it.
+  CharTokenSource source("xxzwpoonoo");
+  CommonTokenStream tokens(&source);
+  ParserInterpreter parser("L.g4", std::vector<std::string>(), { "s", "a", "b", "c", "e", "g" }, atn, &tokens);
+  parser.setProfile(true);
+  parser.parse(0);
+  XCTAssertEqual(parser.getNumberOfSyntaxErrors(), 0U);
+
+  std::vector<atn::DecisionInfo> decisions = parser.getParseInfo()->getDecisionInfo();
+  std::vector<dfa::DFA> &decisionToDFA = parser.getInterpreter<atn::ParserATNSimulator>()->decisionToDFA;
+  XCTAssertEqual(decisions[ruleToDecision[a]].invocations, 1);
+  XCTAssertEqual(decisions[ruleToDecision[a]].LL1_Predictions, 1);
+  XCTAssertEqual(decisions[ruleToDecision[g]].invocations, 3);
+  XCTAssertEqual(decisions[ruleToDecision[g]].LL1_Predictions, 3);
+  for (size_t rule : { a, g }) {
+    XCTAssert(decisionToDFA[ruleToDecision[rule]].s0.load() == nullptr);
+    XCTAssertEqual(decisionToDFA[ruleToDecision[rule]].getStateCount(), 0U);
+  }
+  for (size_t rule : { b, c }) {
+    XCTAssertEqual(decisions[ruleToDecision[rule]].invocations, 1);
+    XCTAssertEqual(decisions[ruleToDecision[rule]].LL1_Predictions, 0);
+    XCTAssertGreaterThan(decisionToDFA[ruleToDecision[rule]].getStateCount(), 0U);
+  }
+  XCTAssertEqual(decisions[ruleToDecision[e]].invocations, 3);
+  XCTAssertEqual(decisions[ruleToDecision[e]].LL1_Predictions, 0);
+  XCTAssert(parser.getParseInfo()->getLL1Decisions() == std::vector<size_t>({ ruleToDecision[a], ruleToDecision[g] }));
+  XCTAssertEqual(parser.getParseInfo()->getTotalLL1Predictions(), 4);
+
+  // s: q q 'y' | 'y'; q: 'a' | ; Both alternatives of s start with 'y' if q matches nothing twice, which the
+  // lookahead analysis misses if it loses track of the rules on the call stack. The input is ambiguous, prediction
+  // picks the first alternative.
+  ATNBuilder nullable(atn::ATNType::PARSER, 'z');
+  size_t ns = nullable.rule();
+  size_t nq = nullable.rule();
+  nullable.define(ns, {
+    nullable.sequence(ns, { nullable.ruleRef(ns, nq), nullable.ruleRef(ns, nq), nullable.atom(ns, 'y') }),
+    nullable.atom(ns, 'y')
+  });
+  nullable.define(nq, { nullable.atom(nq, 'a'), nullable.epsilon(nq) });
+  atn::ATN nullableATN = nullable.build();
+  for (const std::vector<uint16_t> &table : nullableATN.decisionToLL1Table) {
+    XCTAssert(table.empty());
+  }
+
+  CharTokenSource nullableSource("y");
+  CommonTokenStream nullableTokens(&nullableSource);
+  ParserInterpreter nullableParser("N.g4", std::vector<std::string>(), { "s", "q" }, nullableATN, &nullableTokens);
+  nullableParser.removeErrorListeners();
+  Ref<ParserRuleContext> tree = nullableParser.parse(0);
+  XCTAssertEqual(nullableParser.getNumberOfSyntaxErrors(), 0U);
+  XCTAssertEqual(tree->children.size(), 3U);
+}
+
+- (void)testNextTokenSets {
+  // s: a 'z'? EOF; a: b 'y'?; b: 'x' c?; c: 'w' | ;
+  ATNBuilder builder(atn::ATNType::PARSER, 'z');
+  size_t s = builder.rule();
+  size_t a = builder.rule();
+  size_t b = builder.rule();
+  size_t c = builder.rule();
+  builder.define(s, { builder.sequence(s, {
+    builder.ruleRef(s, a), builder.optional(s, { builder.atom(s, 'z') }), builder.atom(s, Token::EOF)
+  }) });
+  builder.define(a, { builder.sequence(a, { builder.ruleRef(a, b), builder.optional(a, { builder.atom(a, 'y') }) }) });
+  builder.define(b, { builder.sequence(b, { builder.atom(b, 'x'), builder.optional(b, { builder.ruleRef(b, c) }) }) });
+  builder.define(c, { builder.atom(c, 'w'), builder.epsilon(c) });
+
+  // The bit sets must agree with the LOOK sets they replace, for EPSILON, EOF, all token types and the token types of
+  // the rule bypass alternatives (one per rule, above the grammar's token types).
+  for (bool bypass : { false, true }) {
+    atn::ATN atn = builder.build(bypass);
+    atn::LL1Analyzer analyzer(atn);
+    int maxType = 'z' + (bypass ? 4 : 0);
+    size_t bypassStates = 0;
+    for (atn::ATNState *state : atn.states) {
+      misc::IntervalSet look = analyzer.LOOK(state, nullptr);
+      for (int symbol = Token::EPSILON; symbol <= maxType + 1; ++symbol) {
+        XCTAssertEqual(atn.isInNextTokens(state, symbol), look.contains(symbol));
+      }
+      XCTAssertFalse(atn.isInNextTokens(state, Token::EPSILON - 1));
+      XCTAssertFalse(atn.isInNextTokens(state, 100000));
+      if (bypass && look.contains('z' + 1)) {
+        ++bypassStates;
+      }
+    }
+    XCTAssertEqual(bypassStates, bypass ? 3U : 0U); // The start state of s, its bypass start and the match state.
+
+    // The rule stop states (only EPSILON) and the state before EOF.
+    XCTAssert(atn.isInNextTokens(atn.ruleToStopState[c], Token::EPSILON));
+    XCTAssertFalse(atn.isInNextTokens(atn.ruleToStopState[c], 'w'));
+    XCTAssert(atn.isInNextTokens(atn.ruleToStartState[c], 'w'));
+    XCTAssert(atn.isInNextTokens(atn.ruleToStartState[c], Token::EPSILON));
+    XCTAssertFalse(atn.isInNextTokens(atn.ruleToStartState[s], Token::EPSILON));
+    XCTAssertFalse(atn.isInNextTokens(atn.ruleToStartState[s], Token::EOF));
+  }
+
+  // Checks Parser::isExpectedToken in every state the parser visits against the answer computed from LOOK sets.
+  class CheckingParser : public ParserInterpreter {
+  public:
+    size_t checks = 0;
+    size_t mismatches = 0;
+
+    CheckingParser(const atn::ATN &atn, TokenStream *input)
+      : ParserInterpreter("N.g4", std::vector<std::string>(), { "s", "a", "b", "c" }, atn, input) {
+    }
+
+  protected:
+    virtual void visitState(atn::ATNState *p) override {
+      for (int symbol = Token::EOF; symbol <= 'z' + 1; ++symbol) {
+        ++checks;
+        if (isExpectedToken(symbol) != isExpectedByLOOK(symbol)) {
+          ++mismatches;
+        }
+      }
+      ParserInterpreter::visitState(p);
+    }
+
+  private:
+    // The original implementation of isExpectedToken.
+    bool isExpectedByLOOK(int symbol) {
+      atn::LL1Analyzer analyzer(getATN());
+      misc::IntervalSet following = analyzer.LOOK(getATN().states[(size_t)getState()], nullptr);
+      if (following.contains(symbol)) {
+        return true;
+      }
+
+      Ref<RuleContext> ctx = getContext();
+      while (ctx && ctx->invokingState >= 0 && following.contains(Token::EPSILON)) {
+        atn::ATNState *invokingState = getATN().states[(size_t)ctx->invokingState];
+        atn::RuleTransition *rt = static_cast<atn::RuleTransition *>(invokingState->transition(0));
+        following = analyzer.LOOK(rt->followState, nullptr);
+        if (following.contains(symbol)) {
+          return true;
+        }
+        ctx = ctx->parent.lock();
+      }
+
+      return following.contains(Token::EPSILON) && symbol == Token::EOF;
+    }
+  };
+
+  atn::ATN atn = builder.build();
+  for (std::string text : { "x", "xw", "xy", "xwy", "xz", "xwyz", "xq", "xyy" }) {
+    CharTokenSource source(text);
+    CommonTokenStream tokens(&source);
+    CheckingParser parser(atn, &tokens);
+    parser.removeErrorListeners();
+    parser.parse(0);
+    XCTAssertGreaterThan(parser.checks, 0U);
+    XCTAssertEqual(parser.mismatches, 0U);
+  }
+}
+
+- (void)testStaticLexerDFA {
+  // LONG: 'abab...' (1100 chars); KW: 'if' {keywords}?; ID: [a-zA-Z]+; NUM: [0-9]+ {number()}; GREEK: [Ͱ-Ͽ]+;
+  // CJK: [一-鿿]+; WS: [ \n]+ -> skip; QUOTE: '"' -> pushMode(STRING); COMMENT: '#' ~[\n]* ('\n' | EOF);
+  // ARROW: '->' -> channel(2);
+  // mode STRING; TEXT: ~["]+; END: {end()} '"' -> popMode;
+  ATNBuilder builder(atn::ATNType::LEXER, 12);
+  builder.mode();
+  builder.mode();
+  std::string longLiteral;
+  size_t rule = builder.lexerRule(11, 0);
+  std::vector<ATNBuilder::Handle> elements;
+  for (size_t i = 0; i < 1100; ++i) {
+    longLiteral += i % 2 == 0 ? 'a' : 'b';
+    elements.push_back(builder.atom(rule, longLiteral.back()));
+  }
+  builder.define(rule, { builder.sequence(rule, elements) });
+  rule = builder.lexerRule(3, 0);
+  builder.define(rule, { builder.sequence(rule, {
+    builder.atom(rule, 'i'), builder.atom(rule, 'f'), builder.predicate(rule, 0)
+  }) });
+  rule = builder.lexerRule(1, 0);
+  builder.define(rule, { builder.plus(rule, { builder.range(rule, 'a', 'z'), builder.range(rule, 'A', 'Z') }) });
+  rule = builder.lexerRule(2, 0);
+  builder.define(rule, { builder.sequence(rule, {
+    builder.plus(rule, { builder.range(rule, '0', '9') }), builder.action(rule, atn::LexerActionType::CUSTOM, (int)rule, 0)
+  }) });
+  rule = builder.lexerRule(4, 0);
+  builder.define(rule, { builder.plus(rule, { builder.range(rule, 0x370, 0x3FF) }) });
+  rule = builder.lexerRule(5, 0);
+  builder.define(rule, { builder.plus(rule, { builder.range(rule, 0x4E00, 0x9FFF) }) });
+  rule = builder.lexerRule(6, 0);
+  builder.define(rule, { builder.sequence(rule, {
+    builder.plus(rule, { builder.set(rule, misc::IntervalSet::of(' ').Or(misc::IntervalSet::of('\n'))) }),
+    builder.action(rule, atn::LexerActionType::SKIP)
+  }) });
+  rule = builder.lexerRule(7, 0);
+  builder.define(rule, { builder.sequence(rule, {
+    builder.atom(rule, '"'), builder.action(rule, atn::LexerActionType::PUSH_MODE, 1)
+  }) });
+  rule = builder.lexerRule(8, 0);
+  builder.define(rule, { builder.sequence(rule, {
+    builder.atom(rule, '#'), builder.star(rule, { builder.set(rule, misc::IntervalSet::of('\n'), true) }),
+    builder.block(rule, { builder.atom(rule, '\n'), builder.atom(rule, Token::EOF) })
+  }) });
+  rule = builder.lexerRule(12, 0);
+  builder.define(rule, { builder.sequence(rule, {
+    builder.atom(rule, '-'), builder.atom(rule, '>'), builder.action(rule, atn::LexerActionType::CHANNEL, 2)
+  }) });
+  rule = builder.lexerRule(9, 1);
+  builder.define(rule, { builder.plus(rule, { builder.set(rule, misc::IntervalSet::of('"'), true) }) });
+  rule = builder.lexerRule(10, 1);
+  builder.define(rule, { builder.sequence(rule, {
+    builder.action(rule, atn::LexerActionType::CUSTOM, (int)rule, 1), builder.atom(rule, '"'),
+    builder.action(rule, atn::LexerActionType::POP_MODE)
+  }) });
+  atn::ATN atn = builder.build();
+
+  // Records predicate evaluations, actions and errors.
+  class TestLexer : public LexerInterpreter {
+  public:
+    std::string log;
+    bool keywords;
+
+    TestLexer(const atn::ATN &atn, CharStream *input)
+      : LexerInterpreter("T.g4", std::vector<std::string>(),
+          { "LONG", "KW", "ID", "NUM", "GREEK", "CJK", "WS", "QUOTE", "COMMENT", "ARROW", "TEXT", "END" },
+          { "DEFAULT_MODE", "STRING" }, atn, input), keywords(true) {
+      removeErrorListeners();
+    }
+
+    virtual bool sempred(Ref<RuleContext> /*localctx*/, int ruleIndex, int predIndex) override {
+      log += "p" + std::to_string(ruleIndex) + ":" + std::to_string(predIndex) + "/" + std::to_string(_input->index()) + " ";
+      return keywords;
+    }
+
+    virtual void action(Ref<RuleContext> /*localctx*/, int ruleIndex, int actionIndex) override {
+      log += "a" + std::to_string(ruleIndex) + ":" + std::to_string(actionIndex) + "/" + std::to_string(_input->index()) + " ";
+    }
+
+    virtual void notifyListeners(const LexerNoViableAltException & /*e*/) override {
+      log += "error:" + std::to_string(tokenStartCharIndex) + " ";
+    }
+  };
+
+  auto lex = [&](const std::string &text, const std::vector<Ref<atn::StaticLexerDFA>> &dfas, bool keywords) {
+    ANTLRInputStream input(text);
+    TestLexer lexer(atn, &input);
+    lexer.keywords = keywords;
+    lexer.getInterpreter<atn::LexerATNSimulator>()->setStaticDFAs(dfas);
+    std::string result;
+    for (Ref<Token> token = lexer.nextToken(); ; token = lexer.nextToken()) {
+      result += token->toString() + "\n";
+      if (token->getType() == Token::EOF) {
+        break;
+      }
+    }
+    return result + lexer.log;
+  };
+
+  // The mode with a position dependent action cannot be compiled, and the long literal hits the state limit.
+  std::vector<Ref<atn::StaticLexerDFA>> dfas = atn::StaticLexerDFA::compileAll(atn);
+  XCTAssertEqual(dfas.size(), 2U);
+  XCTAssert(dfas[0] != nullptr);
+  XCTAssert(dfas[1] == nullptr);
+  XCTAssertEqual(dfas[0]->getNumberOfStates(), atn::StaticLexerDFA::DEFAULT_MAX_STATES);
+  std::vector<Ref<atn::StaticLexerDFA>> smallDFAs = atn::StaticLexerDFA::compileAll(atn, 5);
+  XCTAssertEqual(smallDFAs[0]->getNumberOfStates(), 5U);
+
+  // The tables can be stored and loaded by a later process instead of being computed again.
+  std::vector<uint16_t> serializedATN = { 1, 2, 3 }; // The built ATN has no serialized form, any data works as key.
+  std::stringstream stored;
+  dfa::DFASnapshot::saveStaticLexerDFAs(stored, serializedATN, atn, dfas);
+  std::vector<Ref<atn::StaticLexerDFA>> loadedDFAs;
+  std::stringstream otherGrammar(stored.str());
+  XCTAssertFalse(dfa::DFASnapshot::loadStaticLexerDFAs(otherGrammar, { 4, 5, 6 }, atn, loadedDFAs));
+  std::stringstream truncated(stored.str().substr(0, stored.str().size() - 1));
+  XCTAssertFalse(dfa::DFASnapshot::loadStaticLexerDFAs(truncated, serializedATN, atn, loadedDFAs));
+  XCTAssert(loadedDFAs.empty());
+  XCTAssert(dfa::DFASnapshot::loadStaticLexerDFAs(stored, serializedATN, atn, loadedDFAs));
+  XCTAssertEqual(loadedDFAs.size(), 2U);
+  XCTAssert(loadedDFAs[1] == nullptr);
+  XCTAssertEqual(loadedDFAs[0]->getNumberOfStates(), dfas[0]->getNumberOfStates());
+
+  std::vector<std::string> texts = {
+    "",
+    "abc if ifx xif 123 x9 -> -x",
+    "\xCE\xB1\xCE\xB2\xCE\xB3 \xE4\xB8\xAD\xE6\x96\x87 mixed\xE4\xB8\xAD\xCE\xB1", // αβγ 中文 mixed中α
+    "\"in string\" after \"\" \"\xCE\xB1\"x",
+    "#comment\nnext #at EOF",
+    "#",
+    "bad @ char \xC3\xA9 9",
+    "\"unterminated",
+    longLiteral,
+    longLiteral.substr(0, 1050) + " " + longLiteral.substr(0, 1025) + "c",
+    longLiteral + "ab" + longLiteral,
+  };
+  for (const std::string &text : texts) {
+    for (bool keywords : { true, false }) {
+      std::string expected = lex(text, std::vector<Ref<atn::StaticLexerDFA>>(), keywords);
+      XCTAssertEqual(lex(text, dfas, keywords), expected);
+      XCTAssertEqual(lex(text, smallDFAs, keywords), expected);
+      XCTAssertEqual(lex(text, loadedDFAs, keywords), expected);
+    }
+  }
+
+  // Input matched by the tables never reaches the simulator's DFA.
+  ANTLRInputStream input("abc 123 \xCE\xB1 -> #x");
+  TestLexer lexer(atn, &input);
+  lexer.getInterpreter<atn::LexerATNSimulator>()->setStaticDFAs(dfas);
+  XCTAssertEqual(lexer.getAllTokens().size(), 5U);
+  XCTAssertEqual(lexer.getInterpreter<atn::LexerATNSimulator>()->getDFA(0).getStates().size(), 0U);
+
+  // The action before the closing quote runs at the quote, and the token still ends after it.
+  ANTLRInputStream stringInput("\"ab\"c");
+  TestLexer stringLexer(atn, &stringInput);
+  stringLexer.getInterpreter<atn::LexerATNSimulator>()->setStaticDFAs(dfas);
+  std::string types;
+  for (Ref<Token> &token : stringLexer.getAllTokens()) {
+    types += std::to_string(token->getType()) + token->getText() + " ";
+  }
+  XCTAssertEqual(types, "7\" 9ab 10\" 1c ");
+  XCTAssertEqual(stringLexer.log, "a11:1/3 ");
+}
+
+- (void)testConcurrentTokenStream {
+  std::string text;
+  for (size_t i = 0; i < 500; ++i) {
+    text += (char)('a' + i % 26);
+  }
+
+  // Walks the stream with lookahead, marks and seeks, and returns what it saw.
+  auto walk = [](TokenStream &tokens) {
+    std::string result;
+    while (tokens.LA(1) != Token::EOF) {
+      ssize_t marker = tokens.mark();
+      size_t start = tokens.index();
+      for (ssize_t k = 1; k <= 3; ++k) {
+        result += tokens.LT(k)->getText() + std::to_string(tokens.LT(k)->getTokenIndex()) + " ";
+      }
+      for (size_t i = 0; i < 7 && tokens.LA(1) != Token::EOF; ++i) {
+        tokens.consume();
+      }
+      result += std::to_string(tokens.index()) + tokens.LT(-1)->getText() + " ";
+      tokens.seek(std::min(start + 2, tokens.index()));
+      result += tokens.LT(1)->getText() + std::to_string(tokens.index()) + "\n";
+      if (tokens.LA(1) != Token::EOF) {
+        tokens.consume();
+      }
+      tokens.release(marker);
+    }
+    return result + std::to_string(tokens.index()) + tokens.LT(1)->getText();
+  };
+
+  // A ring smaller than the input, so the producer has to wait for the consumer.
+  CharTokenSource source(text);
+  ConcurrentTokenStream concurrent(&source, 4);
+  CharTokenSource unbufferedSource(text);
+  UnbufferedTokenStream unbuffered(&unbufferedSource);
+  XCTAssertEqual(walk(concurrent), walk(unbuffered));
+
+  // Counts the tokens it produced, throws after the given number of tokens or never returns EOF if that is 0.
+  class CountingTokenSource : public CharTokenSource {
+  public:
+    std::atomic<size_t> count;
+
+    CountingTokenSource(size_t failAfter) : CharTokenSource("x"), count(0), _failAfter(failAfter) {
+    }
+
+    virtual Ref<Token> nextToken() override {
+      if (++count == _failAfter) {
+        throw RuntimeException("source failed");
+      }
+      return std::make_shared<CommonToken>('x', "x");
+    }
+
+  private:
+    size_t _failAfter;
+  };
+
+  // The producer must not lex further ahead than the ring allows (plus the token it waits to push).
+  {
+    CountingTokenSource endless(0);
+    ConcurrentTokenStream tokens(&endless, 8);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    XCTAssert(endless.count <= 10);
+    for (size_t i = 0; i < 20; ++i) {
+      tokens.consume();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    XCTAssert(endless.count >= 21 && endless.count <= 30);
+
+    // Destroying the stream before EOF must stop the waiting producer.
+  }
+
+  // An error in the token source reaches the consumer, after all tokens produced before it.
+  CountingTokenSource failing(10);
+  ConcurrentTokenStream tokens(&failing, 4);
+  std::string message;
+  size_t consumed = 0;
+  try {
+    while (true) {
+      tokens.consume();
+      ++consumed;
+    }
+  } catch (RuntimeException &e) {
+    message = e.what();
+  }
+  XCTAssertEqual(message, "source failed");
+  XCTAssertEqual(consumed, 8U);
+}
+
+- (void)testIncrementalParser {
+  // ID: [a-z]+; INT: [0-9]+; EQ: '='; SEMI: ';'; QUOTE: '"' -> pushMode(STRING); WS: [ \n]+ -> skip;
+  // mode STRING; TEXT: ~["\n]+; QUOTE_END: '"' -> popMode;
+  ATNBuilder lexerBuilder(atn::ATNType::LEXER, 9);
+  lexerBuilder.mode();
+  lexerBuilder.mode();
+  size_t rule = lexerBuilder.lexerRule(1, 0);
+  lexerBuilder.define(rule, { lexerBuilder.plus(rule, { lexerBuilder.range(rule, 'a', 'z') }) });
+  rule = lexerBuilder.lexerRule(2, 0);
+  lexerBuilder.define(rule, { lexerBuilder.plus(rule, { lexerBuilder.range(rule, '0', '9') }) });
+  rule = lexerBuilder.lexerRule(3, 0);
+  lexerBuilder.define(rule, { lexerBuilder.atom(rule, '=') });
+  rule = lexerBuilder.lexerRule(4, 0);
+  lexerBuilder.define(rule, { lexerBuilder.atom(rule, ';') });
+  rule = lexerBuilder.lexerRule(5, 0);
+  lexerBuilder.define(rule, { lexerBuilder.sequence(rule, {
+    lexerBuilder.atom(rule, '"'), lexerBuilder.action(rule, atn::LexerActionType::PUSH_MODE, 1)
+  }) });
+  rule = lexerBuilder.lexerRule(6, 0);
+  lexerBuilder.define(rule, { lexerBuilder.sequence(rule, {
+    lexerBuilder.plus(rule, { lexerBuilder.set(rule, misc::IntervalSet::of(' ').Or(misc::IntervalSet::of('\n'))) }),
+    lexerBuilder.action(rule, atn::LexerActionType::SKIP)
+  }) });
+  rule = lexerBuilder.lexerRule(7, 1);
+  lexerBuilder.define(rule, { lexerBuilder.plus(rule, {
+    lexerBuilder.set(rule, misc::IntervalSet::of('"').Or(misc::IntervalSet::of('\n')), true)
+  }) });
+  rule = lexerBuilder.lexerRule(8, 1);
+  lexerBuilder.define(rule, { lexerBuilder.sequence(rule, {
+    lexerBuilder.atom(rule, '"'), lexerBuilder.action(rule, atn::LexerActionType::POP_MODE)
+  }) });
+  atn::ATN lexerATN = lexerBuilder.build();
+
+  // file: stat* EOF; stat: ID EQ value SEMI; value: INT | ID | string; string: QUOTE TEXT? QUOTE_END;
+  ATNBuilder builder(atn::ATNType::PARSER, 9);
+  size_t file = builder.rule();
+  size_t stat = builder.rule();
+  size_t value = builder.rule();
+  size_t string = builder.rule();
+  builder.define(file, { builder.sequence(file, {
+    builder.star(file, { builder.ruleRef(file, stat) }), builder.atom(file, Token::EOF)
+  }) });
+  builder.define(stat, { builder.sequence(stat, {
+    builder.atom(stat, 1), builder.atom(stat, 3), builder.ruleRef(stat, value), builder.atom(stat, 4)
+  }) });
+  builder.define(value, { builder.atom(value, 2), builder.atom(value, 1), builder.ruleRef(value, string) });
+  builder.define(string, { builder.sequence(string, {
+    builder.atom(string, 5), builder.optional(string, { builder.atom(string, 7) }), builder.atom(string, 8)
+  }) });
+  atn::ATN parserATN = builder.build();
+
+  std::vector<std::string> lexerRuleNames = { "ID", "INT", "EQ", "SEMI", "QUOTE", "WS", "TEXT", "QUOTE_END" };
+  std::vector<std::string> modeNames = { "DEFAULT_MODE", "STRING" };
+  std::vector<std::string> ruleNames = { "file", "stat", "value", "string" };
+
+  // A fresh parse of the text as a tree and the list of tokens.
+  auto parse = [&](const std::string &text) {
+    ANTLRInputStream input(text);
+    LexerInterpreter lexer("T.g4", std::vector<std::string>(), lexerRuleNames, modeNames, lexerATN, &input);
+    CommonTokenStream tokens(&lexer);
+    ParserInterpreter parser("T.g4", std::vector<std::string>(), ruleNames, parserATN, &tokens);
+    std::string result = parser.parse(0)->toStringTree(&parser) + "\n";
+    for (Ref<Token> &token : tokens.getTokens()) {
+      result += token->toString() + "\n";
+    }
+    return result;
+  };
+
+  ANTLRInputStream dummy("");
+  LexerInterpreter lexer("T.g4", std::vector<std::string>(), lexerRuleNames, modeNames, lexerATN, &dummy);
+  ParserInterpreter parser("T.g4", std::vector<std::string>(), ruleNames, parserATN, nullptr);
+  IncrementalParser incrementalParser(&lexer, &parser, [](Parser *parser) {
+    return static_cast<ParserInterpreter *>(parser)->parse(0);
+  });
+
+  std::string text = "a = 1;\nb = \"hello world\";\nc = b;\nd = \"x\";\ne = 42;";
+  auto current = [&]() {
+    std::string result = incrementalParser.getTree()->toStringTree(&parser) + "\n";
+    for (Ref<Token> &token : incrementalParser.getTokenStream()->getTokens()) {
+      result += token->toString() + "\n";
+    }
+    return result;
+  };
+  // Parse listeners get matching enter and exit events, for reused subtrees too.
+  class BalanceListener : public tree::ParseTreeListener {
+  public:
+    std::vector<ParserRuleContext *> stack;
+    size_t mismatches = 0;
+    size_t completeEnters = 0; // Contexts which already had all their children when entered.
+
+    virtual void visitTerminal(tree::TerminalNode * /*node*/) override {
+    }
+
+    virtual void visitErrorNode(tree::ErrorNode * /*node*/) override {
+    }
+
+    virtual void enterEveryRule(ParserRuleContext *ctx) override {
+      if (ctx->stop != nullptr) {
+        ++completeEnters;
+      }
+      stack.push_back(ctx);
+    }
+
+    virtual void exitEveryRule(ParserRuleContext *ctx) override {
+      if (stack.empty() || stack.back() != ctx) {
+        ++mismatches;
+      } else {
+        stack.pop_back();
+      }
+    }
+  };
+  auto balance = std::make_shared<BalanceListener>();
+  parser.addParseListener(balance);
+
+  incrementalParser.parse(text);
+  XCTAssertEqual(current(), parse(text));
+  XCTAssertEqual(incrementalParser.getReusedSubtreeCount(), 0U);
+
+  auto edit = [&](const std::string &before, size_t offset, size_t length, const std::string &replacement) {
+    size_t start = text.find(before) + offset;
+    text.replace(start, length, replacement);
+    balance->completeEnters = 0;
+    incrementalParser.reparse(IncrementalParser::Edit(start, length, replacement));
+    XCTAssertEqual(current(), parse(text));
+    XCTAssertGreaterThan(incrementalParser.getReusedSubtreeCount(), 0U);
+    XCTAssertEqual(parser.getNumberOfSyntaxErrors(), 0);
+    XCTAssertEqual(balance->mismatches, 0U);
+    XCTAssert(balance->stack.empty());
+    XCTAssertEqual(balance->completeEnters, incrementalParser.getReusedSubtreeCount());
+  };
+
+  edit("42", 1, 0, "7"); // Inside a token.
+  edit("1;\nb", 0, 4, "12;\nbb"); // Across lines.
+  edit("hello", 5, 0, ","); // Inside the string mode.
+  edit("world", 0, 5, "there\" ;\nf = \"again"); // Ending the mode earlier.
+  edit("472;", 4, 0, "\ng = h;"); // At the end of the input.
+  XCTAssertEqual(text, "a = 12;\nbb = \"hello, there\" ;\nf = \"again\";\nc = b;\nd = \"x\";\ne = 472;\ng = h;");
+}
+
+- (void)testParseTelemetry {
+  XCTAssertEqual(atn::DecisionTelemetry::getLookaheadBucket(1), 0U);
+  XCTAssertEqual(atn::DecisionTelemetry::getLookaheadBucket(2), 1U);
+  XCTAssertEqual(atn::DecisionTelemetry::getLookaheadBucket(4), 2U);
+  XCTAssertEqual(atn::DecisionTelemetry::getLookaheadBucket(5), 3U);
+  XCTAssertEqual(atn::DecisionTelemetry::getLookaheadBucket(100000), atn::DecisionTelemetry::LookaheadBuckets - 1);
+
+  atn::ParseTelemetry telemetry(3, 16);
+  telemetry.decisionRules = { 0, 1, 1 };
+  telemetry.decisions[1].invocations = 4;
+  telemetry.decisions[1].sllDFATransitions = 3;
+  telemetry.decisions[1].sllATNTransitions = 1;
+  telemetry.decisions[1].sllLookahead[0] = 4;
+  telemetry.stackSamples[{ 0, 1, 2 }] = 32;
+  XCTAssertEqual(telemetry.decisions[1].getDFAHitRatio(), 0.75);
+  XCTAssertEqual(telemetry.decisions[0].getDFAHitRatio(), 1.0);
+
+  std::vector<std::string> ruleNames = { "start", "expr" };
+  std::string json = telemetry.toJSON(ruleNames);
+  XCTAssert(json.find("\"decision\": 1, \"rule\": \"expr\", \"invocations\": 4") != std::string::npos);
+  XCTAssert(json.find("\"decision\": 0,") == std::string::npos); // Decisions never invoked are left out.
+  XCTAssert(json.find("\"sllLookahead\": [4, 0, 0, 0, 0, 0, 0, 0]") != std::string::npos);
+  XCTAssertEqual(telemetry.toFoldedStacks(ruleNames), "start;expr;decision:2 32\n");
+
+  telemetry.reset();
+  XCTAssertEqual(telemetry.decisions[1].invocations, 0U);
+  XCTAssertEqual(telemetry.toFoldedStacks(ruleNames), "");
+
+  // s: b b g EOF; b: 'x' 'y' | 'x' 'z'; g: 'n' 'o'*;
+  ATNBuilder builder(atn::ATNType::PARSER, 'z');
+  size_t s = builder.rule();
+  size_t b = builder.rule();
+  size_t g = builder.rule();
+  builder.define(s, { builder.sequence(s, {
+    builder.ruleRef(s, b), builder.ruleRef(s, b), builder.ruleRef(s, g), builder.atom(s, Token::EOF)
+  }) });
+  builder.define(b, {
+    builder.sequence(b, { builder.atom(b, 'x'), builder.atom(b, 'y') }),
+    builder.sequence(b, { builder.atom(b, 'x'), builder.atom(b, 'z') })
+  });
+  builder.define(g, { builder.sequence(g, { builder.atom(g, 'n'), builder.star(g, { builder.atom(g, 'o') }) }) });
+  atn::ATN atn = builder.build();
+  XCTAssertEqual(atn.decisionToState.size(), 2U);
+  size_t bDecision = atn.decisionToState[0]->ruleIndex == (int)b ? 0 : 1;
+  size_t gDecision = 1 - bDecision;
+
+  // The first prediction of b computes the DFA from the ATN, the second walks it. The loop in g is LL(1).
+  CharTokenSource source("xyxynoo");
+  CommonTokenStream tokens(&source);
+  ParserInterpreter parser("T.g4", std::vector<std::string>(), { "s", "b", "g" }, atn, &tokens);
+  parser.setTelemetry(true, 1);
+  parser.parse(0);
+  XCTAssertEqual(parser.getNumberOfSyntaxErrors(), 0U);
+
+  Ref<atn::ParseTelemetry> data = parser.getParseTelemetry();
+  XCTAssertEqual(data->decisions[bDecision].invocations, 2U);
+  XCTAssertEqual(data->decisions[bDecision].ll1Predictions, 0U);
+  XCTAssertEqual(data->decisions[bDecision].dfaPredictions, 1U);
+  XCTAssertGreaterThan(data->decisions[bDecision].sllATNTransitions, 0U);
+  XCTAssertGreaterThan(data->decisions[bDecision].sllDFATransitions, 0U);
+  XCTAssertGreaterThan(data->decisions[bDecision].dfaStatesAdded, 0U);
+  XCTAssertEqual(data->decisions[gDecision].invocations, 3U);
+  XCTAssertEqual(data->decisions[gDecision].ll1Predictions, 3U);
+  XCTAssertEqual(data->decisions[gDecision].dfaPredictions, 0U);
+  XCTAssertEqual(data->decisions[gDecision].dfaStates, 0U);
+  XCTAssertEqual(data->sampleInterval, 1U);
+  XCTAssertFalse(data->stackSamples.empty());
+
+  // Enabling telemetry again keeps the simulator and what it collected.
+  atn::ParserATNSimulator *simulator = parser.getInterpreter<atn::ParserATNSimulator>();
+  parser.setTelemetry(true);
+  XCTAssertEqual(parser.getInterpreter<atn::ParserATNSimulator>(), simulator);
+  XCTAssertEqual(parser.getParseTelemetry()->decisions[bDecision].invocations, 2U);
+  XCTAssertEqual(parser.getParseTelemetry()->sampleInterval, 1U);
+
+  parser.setTelemetry(false);
+  XCTAssert(parser.getParseTelemetry() == nullptr);
+}
+
+- (void)testFlatATN {
+  atn::ATN atn;
+  createWordLexerATN(atn);
+  XCTAssert(atn.flat.isEmpty());
+
+  // Add a not-set and an atom transition for EOF, so that all label kinds are covered.
+  misc::IntervalSet vowels = misc::IntervalSet::of('a');
+  vowels.add('e');
+  vowels.add(0x3B1); // Greek alpha, above the bit set range.
+  atn.states[3]->addTransition(new atn::NotSetTransition(atn.states[4], vowels));
+  atn.states[3]->addTransition(new atn::AtomTransition(atn.states[4], (size_t)Token::EOF));
+
+  atn::ATNDeserializer().computeFlatATN(atn);
+  XCTAssertEqual(atn.flat.states.size(), atn.states.size() + 1);
+
+  std::vector<size_t> symbols = { (size_t)Token::EOF, 0, ' ', '\n', 'a', 'b', 'e', 'z', 'A', 0x7F, 0x80, 0xFF, 0x100, 0x3B1,
+    0x3B2, 0x10FFFF };
+  for (atn::ATNState *state : atn.states) {
+    const atn::FlatATN::Edge *edge = atn.flat.transitionsBegin((size_t)state->stateNumber);
+    XCTAssertEqual((size_t)(atn.flat.transitionsEnd((size_t)state->stateNumber) - edge), state->getNumberOfTransitions());
+    XCTAssertEqual(atn.flat.states[(size_t)state->stateNumber].type, state->getStateType());
+
+    for (atn::Transition *transition : state->getTransitions()) {
+      XCTAssertEqual(edge->target, (uint32_t)transition->target->stateNumber);
+      XCTAssertEqual(edge->epsilon, transition->isEpsilon());
+      for (size_t symbol : symbols) {
+        XCTAssertEqual(atn.flat.matches(*edge, symbol, Lexer::MIN_CHAR_VALUE, Lexer::MAX_CHAR_VALUE),
+          transition->matches(symbol, Lexer::MIN_CHAR_VALUE, Lexer::MAX_CHAR_VALUE));
+      }
+      ++edge;
+    }
+  }
+}
+
+- (void)testParseTreeWalker {
+  Ref<Token> token = std::make_shared<CommonToken>(1, "x");
+
+  // (root t (inner) (inner t e) t)
+  Ref<ParserRuleContext> root = std::make_shared<ParserRuleContext>();
+  root->addChild(token);
+  root->addChild(std::make_shared<ParserRuleContext>(root, 1));
+  Ref<ParserRuleContext> inner = std::make_shared<ParserRuleContext>(root, 2);
+  root->addChild(inner);
+  inner->addChild(token);
+  inner->addErrorNode(token);
+  root->addChild(token);
+
+  XCTAssert(root->getTreeType() == tree::ParseTreeType::RULE_NODE);
+  XCTAssert(root->children[0]->getTreeType() == tree::ParseTreeType::TERMINAL_NODE);
+  XCTAssert(inner->children[1]->getTreeType() == tree::ParseTreeType::ERROR_NODE);
+
+  EventListener listener;
+  tree::ParseTreeWalker::DEFAULT->walk(&listener, root.get());
+  XCTAssertEqual(listener.events, "(t()(te)t)");
+
+  // A leaf alone.
+  listener.events.clear();
+  tree::ParseTreeWalker::DEFAULT->walk(&listener, root->children[0].get());
+  XCTAssertEqual(listener.events, "t");
+
+  // Much deeper than a recursive walk could go.
+  const size_t depth = 1000000;
+  std::vector<Ref<ParserRuleContext>> chain = { std::make_shared<ParserRuleContext>() };
+  for (size_t i = 1; i < depth; ++i) {
+    Ref<ParserRuleContext> child = std::make_shared<ParserRuleContext>(chain.back(), 1);
+    chain.back()->addChild(child);
+    chain.push_back(child);
+  }
+  chain.back()->addChild(token);
+
+  listener.events.clear();
+  tree::ParseTreeWalker::DEFAULT->walk(&listener, chain[0].get());
+  XCTAssertEqual(listener.events, std::string(depth, '(') + "t" + std::string(depth, ')'));
+
+  // Releasing the chain from its root would recurse as deep as the tree.
+  for (size_t i = chain.size(); i-- > 0;) {
+    chain[i]->children.clear();
+  }
+}
+
+- (void)testRingBufferCharStream {
+  // BOM, 2, 3 and 4 byte sequences, a stray continuation byte. Read one byte at a time, so that every sequence is
+  // split across chunks.
+  std::string text = "\xEF\xBB\xBF" "a\xC3\xA4\xE2\x82\xAC\xF0\x9F\x98\x80\x80z";
+  size_t position = 0;
+  RingBufferCharStream input([&](char *buffer, size_t size) {
+    size_t count = std::min(size, text.size() - position);
+    std::copy(text.begin() + position, text.begin() + position + count, buffer);
+    position += count;
+    return count;
+  }, false, 1);
+
+  XCTAssertEqual(input.LA(1), 'a');
+  XCTAssertEqual(input.LA(2), 0xE4);
+  XCTAssertEqual(input.LA(3), 0x20AC);
+  XCTAssertEqual(input.LA(4), 0x1F600);
+  XCTAssertEqual(input.LA(5), 0xFFFD);
+  XCTAssertEqual(input.LA(6), 'z');
+  XCTAssertEqual(input.LA(7), IntStream::EOF);
+
+  input.consume();
+  ssize_t marker = input.mark();
+  input.consume();
+  input.consume();
+  XCTAssertEqual(input.LA(-1), 0x20AC);
+  XCTAssertEqual(input.getText(misc::Interval(1, 3)), "\xC3\xA4\xE2\x82\xAC\xF0\x9F\x98\x80");
+  input.seek(1);
+  XCTAssertEqual(input.LA(-1), 'a');
+  XCTAssertEqual(input.LA(1), 0xE4);
+  input.release(marker);
+  input.seek(6);
+  XCTAssertEqual(input.index(), 6U);
+  XCTAssertEqual(input.LA(1), IntStream::EOF);
+  XCTAssertThrows(input.consume());
+
+  // A failing read-ahead is reported once, the next refill reads again.
+  text = "abcdefgh";
+  position = 0;
+  size_t reads = 0;
+  RingBufferCharStream failingInput([&](char *buffer, size_t size) {
+    if (++reads == 2) {
+      throw std::runtime_error("read error");
+    }
+    size_t count = std::min(size, text.size() - position);
+    std::copy(text.begin() + position, text.begin() + position + count, buffer);
+    position += count;
+    return count;
+  }, true, 4);
+
+  XCTAssertEqual(failingInput.LA(4), 'd');
+  XCTAssertThrows(failingInput.LA(5));
+  XCTAssertEqual(failingInput.LA(5), 'e');
+  XCTAssertEqual(failingInput.LA(8), 'h');
+  XCTAssertEqual(failingInput.LA(9), IntStream::EOF);
+
+  // Lex a large input with read-ahead. The window only holds the current token and a chunk.
+  atn::ATN atn;
+  createWordLexerATN(atn);
+  std::string words;
+  for (size_t i = 0; i < 20000; ++i) {
+    words += "lorem ipsum dolor sit amet\n";
+  }
+  position = 0;
+  text = words;
+  RingBufferCharStream wordInput([&](char *buffer, size_t size) {
+    size_t count = std::min(size, text.size() - position);
+    std::copy(text.begin() + position, text.begin() + position + count, buffer);
+    position += count;
+    return count;
+  }, true, 4096);
+
+  WordLexer lexer(atn, &wordInput);
+  lexer.setTokenFactory(std::make_shared<CommonTokenFactory>(true)); // The window doesn't keep the text of old tokens.
+  size_t count = 0;
+  Ref<Token> token;
+  do {
+    token = lexer.nextToken();
+    ++count;
+  } while (token->getType() != Token::EOF);
+  XCTAssertEqual(count, 200001U);
+  XCTAssertEqual(token->getStartIndex(), words.size());
+  XCTAssertEqual(wordInput.getCapacity(), 16384U);
+}
+
+- (void)testTokenStreamRewriter {
+  typedef TokenStreamRewriter R;
+  const size_t first = 0; // A literal 0 would also match the Token * overloads.
+
+  XCTAssertEqual(rewrite("abc", [&](R &r) { r.insertBefore(first, "0"); }), "0abc");
+  XCTAssertEqual(rewrite("abc", [](R &r) { r.insertAfter(2, "x"); }), "abcx");
+  XCTAssertEqual(rewrite("abc", [](R &r) { r.insertBefore(1, "x"); r.insertAfter(1, "x"); }), "axbxc");
+  XCTAssertEqual(rewrite("abc", [&](R &r) { r.insertBefore(1, "x"); r.insertBefore(first, "y"); r.insertBefore(1, "z"); }),
+                 "yazxbc");
+  XCTAssertEqual(rewrite("abc", [](R &r) { r.insertBefore(2, "y"); r.Delete(2); }), "aby");
+  XCTAssertEqual(rewrite("abc", [](R &r) { r.replace(2, "x"); r.insertBefore(2, "y"); }), "abyx");
+  XCTAssertEqual(rewrite("abc", [](R &r) { r.replace(2, "x"); r.insertAfter(2, "y"); }), "abxy");
+  XCTAssertEqual(rewrite("abc", [&](R &r) { r.Delete(first, 2); r.insertBefore(first, "z"); }), "z");
+  XCTAssertEqual(rewrite("abc", [](R &r) { r.insertBefore(1, "foo"); r.replace(1, 2, "foo"); }), "afoofoo");
+  XCTAssertEqual(rewrite("abcccba", [](R &r) { r.replace(2, 4, "x"); r.insertBefore(4, "y"); }), "error");
+  XCTAssertEqual(rewrite("abcccba", [](R &r) { r.replace(2, 4, "x"); r.insertAfter(4, "y"); }), "abxyba");
+  XCTAssertEqual(rewrite("abcccba", [](R &r) { r.replace(2, 4, "xyz"); r.replace(3, 5, "foo"); }), "error");
+  XCTAssertEqual(rewrite("abcc", [&](R &r) { r.replace(1, 2, "foo"); r.replace(first, 3, "bar"); }), "bar");
+  XCTAssertEqual(rewrite("abcc", [](R &r) { r.replace(1, 2, "foo"); r.replace(1, 3, "bar"); }), "abar");
+  XCTAssertEqual(rewrite("abcc", [](R &r) { r.replace(1, 2, "foo"); r.replace(1, 2, "foo"); }), "afooc");
+  XCTAssertEqual(rewrite("abcc", [](R &r) { r.replace(2, 3, "foo"); r.insertBefore(1, "x"); }), "axbfoo");
+
+  // Overlapping deletes are merged, also if the merged range reaches further deletes.
+  XCTAssertEqual(rewrite("abcdefgh", [](R &r) { r.Delete(1, 2); r.Delete(5, 6); r.Delete(2, 5); }), "ah");
+
+  // A rejected edit leaves the program unchanged.
+  bool rejected = false;
+  XCTAssertEqual(rewrite("abcc", [&](R &r) {
+    r.replace(first, 3, "bar");
+    try {
+      r.replace(1, 2, "foo");
+    } catch (IllegalArgumentException &) {
+      rejected = true;
+    }
+  }), "bar");
+  XCTAssert(rejected);
+
+  XCTAssertEqual(rewrite("abc", [&](R &r) {
+    r.insertBefore(first, "x");
+    r.replace(1, "y");
+    r.insertBefore(1, "z");
+    r.rollback(1);
+  }), "xabc");
+
+  // Intervals and programs.
+  CharTokenSource source("abcccba");
+  CommonTokenStream tokens(&source);
+  tokens.fill();
+  TokenStreamRewriter rewriter(&tokens);
+  rewriter.replace(2, 4, "xyz");
+  rewriter.insertAfter("second", 6, "!");
+  XCTAssertEqual(rewriter.getText(misc::Interval(0, 6)), "abxyzba");
+  XCTAssertEqual(rewriter.getText(misc::Interval(3, 5)), "ccb");
+  XCTAssertEqual(rewriter.getText("second"), "abcccba!");
+  XCTAssertEqual(rewriter.getText("unknown"), "abcccba");
+  XCTAssertEqual(rewriter.getText(), "abxyzba"); // Rendering doesn't change the program.
+}
+
+- (void)testXPathMatcher {
+  typedef tree::xpath::XPathElement E;
+  Ref<Token> a = std::make_shared<CommonToken>(1, "a");
+  Ref<Token> b = std::make_shared<CommonToken>(2, "b");
+
+  // (0 a (1 b) (2 a (1 a)) <error b>)
+  Ref<ParserRuleContext> root = std::make_shared<IndexedContext>(nullptr, 0);
+  Ref<tree::ParseTree> a1 = root->addChild(a);
+  Ref<ParserRuleContext> r1 = std::make_shared<IndexedContext>(root, 1);
+  root->addChild(r1);
+  Ref<tree::ParseTree> b1 = r1->addChild(b);
+  Ref<ParserRuleContext> r2 = std::make_shared<IndexedContext>(root, 2);
+  root->addChild(r2);
+  Ref<tree::ParseTree> a2 = r2->addChild(a);
+  Ref<ParserRuleContext> r3 = std::make_shared<IndexedContext>(r2, 1);
+  r2->addChild(r3);
+  Ref<tree::ParseTree> a3 = r3->addChild(a);
+  Ref<tree::ParseTree> error = root->addErrorNode(b);
+
+  tree::xpath::XPathMatcher matcher;
+  XCTAssertEqual(matcher.add({ E("1", E::Kind::RULE, 1, true, false) }), 0U); // //1
+  matcher.add({ E("0", E::Kind::RULE, 0, false, false), E("A", E::Kind::TOKEN, 1, false, false) }); // /0/A
+  matcher.add({ E("2", E::Kind::RULE, 2, true, false), E("A", E::Kind::TOKEN, 1, true, false) }); // //2//A
+  matcher.add({ E("0", E::Kind::RULE, 0, false, false), E("1", E::Kind::RULE, 1, false, true) }); // /0/!1
+  matcher.add({ E("B", E::Kind::TOKEN, 2, true, false) }); // //B
+  matcher.add({ E("*", E::Kind::WILDCARD, 0, false, false), E("*", E::Kind::WILDCARD, 0, true, false) }); // /*//*
+  matcher.add({ E("1", E::Kind::RULE, 1, true, false), E("*", E::Kind::WILDCARD, 0, true, false) }); // //1//*
+  matcher.add({ E("1", E::Kind::RULE, 1, false, false) }); // /1
+  XCTAssertEqual(matcher.size(), 8U);
+  XCTAssertThrows(matcher.add(std::vector<E>()));
+
+  typedef std::vector<Ref<tree::ParseTree>> Nodes;
+  std::vector<Nodes> result = matcher.evaluate(root);
+  XCTAssert(result[0] == Nodes({ r1, r3 }));
+  XCTAssert(result[1] == Nodes({ a1 }));
+  XCTAssert(result[2] == Nodes({ a2, a3 }));
+  XCTAssert(result[3] == Nodes({ r2 }));
+  XCTAssert(result[4] == Nodes({ b1, error }));
+  XCTAssert(result[5] == Nodes({ a1, r1, b1, r2, a2, r3, a3, error }));
+  XCTAssert(result[6] == Nodes({ b1, a3 }));
+  XCTAssert(result[7].empty());
+
+  // Matches are reported in document order, and for each path (in the order added) at the same node.
+  std::vector<size_t> paths;
+  matcher.match(root, [&](size_t path, const Ref<tree::ParseTree> &node) {
+    if (node == r3) {
+      paths.push_back(path);
+    }
+  });
+  XCTAssert(paths == std::vector<size_t>({ 0, 5 }));
+}
+
+- (void)testMultiPatternMatcher {
+  using namespace tree::pattern;
+
+  // (0 (1 a) + (1 b))
+  Ref<ParserRuleContext> sum = std::make_shared<IndexedContext>(nullptr, 0);
+  Ref<ParserRuleContext> left = std::make_shared<IndexedContext>(sum, 1);
+  sum->addChild(left);
+  Ref<tree::ParseTree> a = left->addChild(std::make_shared<CommonToken>(1, "a"));
+  sum->addChild(std::make_shared<CommonToken>(3, "+"));
+  Ref<ParserRuleContext> right = std::make_shared<IndexedContext>(sum, 1);
+  sum->addChild(right);
+  right->addChild(std::make_shared<CommonToken>(2, "b"));
+
+  // Pattern trees as compiled from a grammar with bypass alternatives (rule 1 being expr, with bypass token 100).
+  auto ruleTag = [](Ref<ParserRuleContext> parent, const std::string &label) {
+    Ref<ParserRuleContext> context = std::make_shared<IndexedContext>(parent, 1);
+    context->addChild(std::make_shared<RuleTagToken>("expr", 100, label));
+    return context;
+  };
+  auto singleToken = [](Ref<Token> token) {
+    Ref<ParserRuleContext> context = std::make_shared<IndexedContext>(nullptr, 1);
+    context->addChild(token);
+    return context;
+  };
+
+  Ref<ParserRuleContext> plus = std::make_shared<IndexedContext>(nullptr, 0); // <lhs:expr> + <expr>
+  plus->addChild(ruleTag(plus, "lhs"));
+  plus->addChild(std::make_shared<CommonToken>(3, "+"));
+  plus->addChild(ruleTag(plus, ""));
+  Ref<ParserRuleContext> minus = std::make_shared<IndexedContext>(nullptr, 0); // <expr> - <expr>
+  minus->addChild(ruleTag(minus, ""));
+  minus->addChild(std::make_shared<CommonToken>(4, "-"));
+  minus->addChild(ruleTag(minus, ""));
+
+  ParseTreePatternMatcher matcher(nullptr, nullptr);
+  std::vector<ParseTreePattern> patterns = {
+    ParseTreePattern(&matcher, "<lhs:expr> + <expr>", 0, plus),
+    ParseTreePattern(&matcher, "<A>", 1, singleToken(std::make_shared<TokenTagToken>("A", 1))),
+    ParseTreePattern(&matcher, "b", 1, singleToken(std::make_shared<CommonToken>(2, "b"))),
+    ParseTreePattern(&matcher, "c", 1, singleToken(std::make_shared<CommonToken>(1, "c"))),
+    ParseTreePattern(&matcher, "<expr> - <expr>", 0, minus),
+    ParseTreePattern(&matcher, "<expr>", 1, ruleTag(nullptr, "")),
+  };
+
+  MultiPatternMatcher multi;
+  for (auto &pattern : patterns) {
+    multi.add(pattern);
+  }
+  XCTAssertEqual(multi.size(), 6U);
+
+  std::vector<std::pair<Ref<tree::ParseTree>, size_t>> found;
+  multi.match(sum, [&](size_t pattern, ParseTreeMatch &match) {
+    found.push_back({ match.getTree(), pattern });
+    XCTAssert(&match.getPattern() == &patterns[pattern]);
+
+    // Same result as matching the pattern alone.
+    ParseTreeMatch single = matcher.match(match.getTree(), patterns[pattern]);
+    XCTAssert(single.succeeded());
+    XCTAssert(single.getLabels() == match.getLabels());
+  });
+
+  std::vector<std::pair<Ref<tree::ParseTree>, size_t>> expected = {
+    { sum, 0 }, { left, 1 }, { left, 5 }, { right, 2 }, { right, 5 }
+  };
+  XCTAssert(found == expected);
+
+  // No other pattern matches any of these nodes.
+  for (auto &node : std::vector<Ref<ParserRuleContext>>({ sum, left, right })) {
+    for (size_t i = 0; i < patterns.size(); ++i) {
+      bool isExpected = std::find(expected.begin(), expected.end(), std::make_pair(Ref<tree::ParseTree>(node), i)) !=
+        expected.end();
+      XCTAssert(patterns[i].getPatternRuleIndex() != node->getRuleIndex() || matcher.matches(node, patterns[i]) == isExpected);
+    }
+  }
+
+  multi.match(sum, [&](size_t pattern, ParseTreeMatch &match) {
+    if (pattern == 0) {
+      XCTAssert(match.get("lhs") == left);
+      XCTAssertEqual(match.getAll("expr").size(), 2U);
+    } else if (pattern == 1) {
+      XCTAssert(match.get("A") == a);
+    }
+  });
+}
+
+- (void)testASCIILexerPerformance {
+  atn::ATN atn;
+  createWordLexerATN(atn);
+
+  std::string text;
+  for (size_t i = 0; i < 20000; ++i) {
+    text += "lorem ipsum dolor sit amet\n";
+  }
+
+  // Blocks copy captured C++ objects, so use pointers instead.
+  const atn::ATN *atnPointer = &atn;
+  const std::string *textPointer = &text;
+  [self measureBlock: ^{
+    XCTAssertEqual(lexWords(*atnPointer, *textPointer), 200001U);
+  }];
+}
+
+- (void)testNonASCIILexerPerformance {
+  // Should run at about the same speed as the ASCII test, as the non-ASCII code points map to DFA edges too.
+  atn::ATN atn;
+  createWordLexerATN(atn);
+  XCTAssertEqual(atn.charClassStarts.size(), 1U);
+
+  std::string text;
+  for (size_t i = 0; i < 20000; ++i) {
+    text += u8"日本語の 文章 😎 中文 µ∰\n";
+  }
+
+  // Blocks copy captured C++ objects, so use pointers instead.
+  const atn::ATN *atnPointer = &atn;
+  const std::string *textPointer = &text;
+  [self measureBlock: ^{
+    XCTAssertEqual(lexWords(*atnPointer, *textPointer), 200001U);
+  }];
+}
+
 @end
@@ -71,7 +71,7 @@ void BufferedTokenStream::seek(size_t index) {
 }
 
 size_t BufferedTokenStream::size() {
-  return _tokens.size();
+  return _tokens->size();
 }
 
 void BufferedTokenStream::consume() {
@@ -80,10 +80,10 @@ void BufferedTokenStream::consume() {
     if (_fetchedEOF) {
       // the last token in tokens is EOF. skip check if p indexes any
       // fetched token except the last.
-      skipEofCheck = _p < _tokens.size() - 1;
+      skipEofCheck = _p < _tokens->size() - 1;
     } else {
       // no EOF token in tokens. skip check if p indexes a fetched token.
-      skipEofCheck = _p < _tokens.size();
+      skipEofCheck = _p < _tokens->size();
     }
   } else {
     // not yet initialized
@@ -100,9 +100,9 @@ void BufferedTokenStream::consume() {
 }
 
 bool BufferedTokenStream::sync(size_t i) {
-  if (i + 1 < _tokens.size())
+  if (i + 1 < _tokens->size())
     return true;
-  size_t n = i - _tokens.size() + 1; // how many more elements we need?
+  size_t n = i - _tokens->size() + 1; // how many more elements we need?
 
   if (n > 0) {
     size_t fetched = fetch(n);
@@ -120,9 +120,9 @@ size_t BufferedTokenStream::fetch(size_t n) {
   for (size_t i = 0; i < n; i++) {
     Ref<Token> t = _tokenSource->nextToken();
     if (is<WritableToken>(t)) {
-      (std::dynamic_pointer_cast<WritableToken>(t))->setTokenIndex((int)_tokens.size());
+      (std::dynamic_pointer_cast<WritableToken>(t))->setTokenIndex((int)_tokens->size());
     }
-    _tokens.push_back(t);
+    _tokens->add(t);
     if (t->getType() == Token::EOF) {
       _fetchedEOF = true;
       return i + 1;
@@ -133,13 +133,13 @@ size_t BufferedTokenStream::fetch(size_t n) {
 }
 
 Ref<Token> BufferedTokenStream::get(size_t i) const {
-  if (i >= _tokens.size()) {
+  if (i >= _tokens->size()) {
     throw IndexOutOfBoundsException(std::string("token index ") +
                                     std::to_string(i) +
                                     std::string(" out of range 0..") +
-                                    std::to_string(_tokens.size() - 1));
+                                    std::to_string(_tokens->size() - 1));
   }
-  return _tokens[i];
+  return _tokens->get(i);
 }
 
 std::vector<Ref<Token>> BufferedTokenStream::get(size_t start, size_t stop) {
@@ -147,51 +147,62 @@ std::vector<Ref<Token>> BufferedTokenStream::get(size_t start, size_t stop) {
 
   lazyInit();
 
-  if (_tokens.empty()) {
+  if (_tokens->size() == 0) {
     return subset;
   }
 
-  if (stop >= _tokens.size()) {
-    stop = _tokens.size() - 1;
+  if (stop >= _tokens->size()) {
+    stop = _tokens->size() - 1;
   }
   for (size_t i = start; i <= stop; i++) {
-    Ref<Token> t = _tokens[i];
-    if (t->getType() == Token::EOF) {
+    if (_tokens->getType(i) == Token::EOF) {
       break;
     }
-    subset.push_back(t);
+    subset.push_back(_tokens->get(i));
   }
   return subset;
 }
 
 ssize_t BufferedTokenStream::LA(ssize_t i) {
-  return LT(i)->getType();
+  ssize_t index = LTIndex(i);
+  if (index < 0) {
+    return Token::INVALID_TYPE;
+  }
+  return _tokens->getType((size_t)index);
 }
 
-Ref<Token> BufferedTokenStream::LB(size_t k) {
-  if (k > _p) {
+Ref<Token> BufferedTokenStream::LT(ssize_t k) {
+  ssize_t index = LTIndex(k);
+  if (index < 0) {
     return nullptr;
   }
-  return _tokens[(size_t)(_p - k)];
+  return _tokens->get((size_t)index);
 }
 
-Ref<Token> BufferedTokenStream::LT(ssize_t k) {
+ssize_t BufferedTokenStream::LTIndex(ssize_t k) {
   lazyInit();
   if (k == 0) {
-    return nullptr;
+    return -1;
   }
   if (k < 0) {
-    return LB(-k);
+    return LBIndex((size_t)-k);
   }
 
   size_t i = _p + k - 1;
   sync(i);
-  if (i >= _tokens.size()) { // return EOF token
-                             // EOF must be last token
-    return _tokens.back();
+  if (i >= _tokens->size()) { // return EOF token
+                              // EOF must be last token
+    return (ssize_t)_tokens->size() - 1;
   }
 
-  return _tokens[i];
+  return (ssize_t)i;
+}
+
+ssize_t BufferedTokenStream::LBIndex(size_t k) {
+  if (k > _p) {
+    return -1;
+  }
+  return (ssize_t)(_p - k);
 }
 
 ssize_t BufferedTokenStream::adjustSeekIndex(size_t i) {
@@ -212,12 +223,20 @@ void BufferedTokenStream::setup() {
 
 void BufferedTokenStream::setTokenSource(TokenSource *tokenSource) {
   _tokenSource = tokenSource;
-  _tokens.clear();
+
+  // Don't clear the old store, token objects handed out before might still refer to it.
+  _tokens = std::make_shared<TokenStore>();
   _needSetup = true;
+  _fetchedEOF = false;
 }
 
 std::vector<Ref<Token>> BufferedTokenStream::getTokens() {
-  return _tokens;
+  std::vector<Ref<Token>> result;
+  result.reserve(_tokens->size());
+  for (size_t i = 0; i < _tokens->size(); i++) {
+    result.push_back(_tokens->get(i));
+  }
+  return result;
 }
 
 std::vector<Ref<Token>> BufferedTokenStream::getTokens(int start, int stop) {
@@ -226,13 +245,13 @@ std::vector<Ref<Token>> BufferedTokenStream::getTokens(int start, int stop) {
 
 std::vector<Ref<Token>> BufferedTokenStream::getTokens(int start, int stop, const std::vector<int> &types) {
   lazyInit();
-  if (start < 0 || stop >= (int)_tokens.size() || stop < 0 || start >= (int)_tokens.size()) {
+  if (start < 0 || stop >= (int)_tokens->size() || stop < 0 || start >= (int)_tokens->size()) {
     throw IndexOutOfBoundsException(std::string("start ") +
                                     std::to_string(start) +
                                     std::string(" or stop ") +
                                     std::to_string(stop) +
                                     std::string(" not in 0..") +
-                                    std::to_string(_tokens.size() - 1));
+                                    std::to_string(_tokens->size() - 1));
   }
 
   std::vector<Ref<Token>> filteredTokens;
@@ -243,10 +262,8 @@ std::vector<Ref<Token>> BufferedTokenStream::getTokens(int start, int stop, cons
 
   // list = tokens[start:stop]:{T t, t.getType() in types}
   for (size_t i = (size_t)start; i <= (size_t)stop; i++) {
-    Ref<Token> tok = _tokens[i];
-
-    if (types.empty() || std::find(types.begin(), types.end(), tok->getType()) != types.end()) {
-      filteredTokens.push_back(tok);
+    if (types.empty() || std::find(types.begin(), types.end(), _tokens->getType(i)) != types.end()) {
+      filteredTokens.push_back(_tokens->get(i));
     }
   }
   return filteredTokens;
@@ -264,14 +281,12 @@ ssize_t BufferedTokenStream::nextTokenOnChannel(size_t i, size_t channel) {
     return size() - 1;
   }
 
-  Ref<Token> token = _tokens[i];
-  while (token->getChannel() != channel) {
-    if (token->getType() == Token::EOF) {
+  while (_tokens->getChannel(i) != channel) {
+    if (_tokens->getType(i) == Token::EOF) {
       return i;
     }
     i++;
     sync(i);
-    token = _tokens[i];
   }
   return i;
 }
@@ -284,8 +299,7 @@ ssize_t BufferedTokenStream::previousTokenOnChannel(size_t i, size_t channel) {
   }
 
   while (true) {
-    Ref<Token> token = _tokens[i];
-    if (token->getType() == Token::EOF || token->getChannel() == channel) {
+    if (_tokens->getType(i) == Token::EOF || _tokens->getChannel(i) == channel) {
       return i;
     }
 
@@ -298,8 +312,8 @@ ssize_t BufferedTokenStream::previousTokenOnChannel(size_t i, size_t channel) {
 
 std::vector<Ref<Token>> BufferedTokenStream::getHiddenTokensToRight(size_t tokenIndex, size_t channel) {
   lazyInit();
-  if (tokenIndex >= _tokens.size()) {
-    throw IndexOutOfBoundsException(std::to_string(tokenIndex) + " not in 0.." + std::to_string(_tokens.size() - 1));
+  if (tokenIndex >= _tokens->size()) {
+    throw IndexOutOfBoundsException(std::to_string(tokenIndex) + " not in 0.." + std::to_string(_tokens->size() - 1));
   }
 
   ssize_t nextOnChannel = nextTokenOnChannel(tokenIndex + 1, Lexer::DEFAULT_TOKEN_CHANNEL);
@@ -321,8 +335,8 @@ std::vector<Ref<Token>> BufferedTokenStream::getHiddenTokensToRight(size_t token
 
 std::vector<Ref<Token>> BufferedTokenStream::getHiddenTokensToLeft(size_t tokenIndex, size_t channel) {
   lazyInit();
-  if (tokenIndex >= _tokens.size()) {
-    throw IndexOutOfBoundsException(std::to_string(tokenIndex) + " not in 0.." + std::to_string(_tokens.size() - 1));
+  if (tokenIndex >= _tokens->size()) {
+    throw IndexOutOfBoundsException(std::to_string(tokenIndex) + " not in 0.." + std::to_string(_tokens->size() - 1));
   }
 
   if (tokenIndex == 0) {
@@ -348,14 +362,13 @@ std::vector<Ref<Token>> BufferedTokenStream::getHiddenTokensToLeft(size_t tokenI
 std::vector<Ref<Token>> BufferedTokenStream::filterForChannel(size_t from, size_t to, ssize_t channel) {
   std::vector<Ref<Token>> hidden;
   for (size_t i = from; i <= to; i++) {
-    Ref<Token> t = _tokens[i];
     if (channel == -1) {
-      if (t->getChannel() != Lexer::DEFAULT_TOKEN_CHANNEL) {
-        hidden.push_back(t);
+      if (_tokens->getChannel(i) != Lexer::DEFAULT_TOKEN_CHANNEL) {
+        hidden.push_back(_tokens->get(i));
       }
     } else {
-      if (t->getChannel() == (size_t)channel) {
-        hidden.push_back(t);
+      if (_tokens->getChannel(i) == (size_t)channel) {
+        hidden.push_back(_tokens->get(i));
       }
     }
   }
@@ -388,17 +401,16 @@ std::string BufferedTokenStream::getText(const misc::Interval &interval) {
     return "";
   }
   lazyInit();
-  if (stop >= (int)_tokens.size()) {
-    stop = (int)_tokens.size() - 1;
+  if (stop >= (int)_tokens->size()) {
+    stop = (int)_tokens->size() - 1;
   }
 
   std::stringstream ss;
   for (size_t i = (size_t)start; i <= (size_t)stop; i++) {
-    Ref<Token> t = _tokens[i];
-    if (t->getType() == Token::EOF) {
+    if (_tokens->getType(i) == Token::EOF) {
       break;
     }
-    ss << t->getText();
+    ss << _tokens->getText(i);
   }
   return ss.str();
 }
@@ -427,6 +439,7 @@ void BufferedTokenStream::fill() {
 }
 
 void BufferedTokenStream::InitializeInstanceFields() {
+  _tokens = std::make_shared<TokenStore>();
   _needSetup = true;
   _fetchedEOF = false;
 }
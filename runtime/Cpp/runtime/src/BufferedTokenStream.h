@@ -32,6 +32,7 @@
 #pragma once
 
 #include "TokenStream.h"
+#include "TokenStore.h"
 
 namespace org {
 namespace antlr {
@@ -131,8 +132,12 @@ namespace runtime {
      * A collection of all tokens fetched from the token source. The list is
      * considered a complete view of the input once {@link #fetchedEOF} is set
      * to {@code true}.
+     *
+     * Tokens are kept in compact form, token objects are only created when requested
+     * (see {@link TokenStore}). Use the store accessors to look at token fields without
+     * creating them.
      */
-    std::vector<Ref<Token>> _tokens;
+    Ref<TokenStore> _tokens;
 
     /**
      * The index into {@link #tokens} of the current token (next token to
@@ -178,7 +183,11 @@ namespace runtime {
     /// <returns> The actual number of elements added to the buffer. </returns>
     virtual size_t fetch(size_t n);
     
-    virtual Ref<Token> LB(size_t k);
+    /// Returns the buffer index of the token {@link #LT LT(k)} would return, or -1 if there is none.
+    virtual ssize_t LTIndex(ssize_t k);
+
+    /// Returns the buffer index of the k-th token before the current one, or -1 if there is none.
+    virtual ssize_t LBIndex(size_t k);
 
     /// Allowed derived classes to modify the behavior of operations which change
     /// the current stream position by adjusting the target token index of a seek
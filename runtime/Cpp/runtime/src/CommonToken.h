@@ -39,6 +39,8 @@ namespace v4 {
 namespace runtime {
 
   class ANTLR4CPP_PUBLIC CommonToken : public WritableToken {
+    friend class TokenStore;
+
   protected:
     /**
      * An empty {@link Pair} which is used as the default value of
@@ -47,9 +47,9 @@ ssize_t CommonTokenStream::adjustSeekIndex(size_t i) {
   return nextTokenOnChannel(i, channel);
 }
 
-Ref<Token> CommonTokenStream::LB(size_t k) {
+ssize_t CommonTokenStream::LBIndex(size_t k) {
   if (k == 0 || k > _p) {
-    return Ref<Token>();
+    return -1;
   }
 
   ssize_t i = (ssize_t)_p;
@@ -61,19 +61,19 @@ Ref<Token> CommonTokenStream::LB(size_t k) {
     n++;
   }
   if (i < 0) {
-    return nullptr;
+    return -1;
   }
 
-  return _tokens[i];
+  return i;
 }
 
-Ref<Token> CommonTokenStream::LT(ssize_t k) {
+ssize_t CommonTokenStream::LTIndex(ssize_t k) {
   lazyInit();
   if (k == 0) {
-    return nullptr;
+    return -1;
   }
   if (k < 0) {
-    return LB((size_t)-k);
+    return LBIndex((size_t)-k);
   }
   size_t i = _p;
   ssize_t n = 1; // we know tokens[p] is a good one
@@ -86,18 +86,17 @@ Ref<Token> CommonTokenStream::LT(ssize_t k) {
     n++;
   }
 
-  return _tokens[i];
+  return (ssize_t)i;
 }
 
 int CommonTokenStream::getNumberOfOnChannelTokens() {
   int n = 0;
   fill();
-  for (size_t i = 0; i < _tokens.size(); i++) {
-    Ref<Token> t = _tokens[i];
-    if (t->getChannel() == channel) {
+  for (size_t i = 0; i < _tokens->size(); i++) {
+    if (_tokens->getChannel(i) == channel) {
       n++;
     }
-    if (t->getType() == Token::EOF) {
+    if (_tokens->getType(i) == Token::EOF) {
       break;
     }
   }
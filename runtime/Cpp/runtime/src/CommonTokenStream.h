@@ -97,11 +97,10 @@ namespace runtime {
   protected:
     virtual ssize_t adjustSeekIndex(size_t i) override;
 
-    virtual Ref<Token> LB(size_t k) override;
+    virtual ssize_t LTIndex(ssize_t k) override;
+    virtual ssize_t LBIndex(size_t k) override;
 
   public:
-    virtual Ref<Token> LT(ssize_t k) override;
-
     /// Count EOF just once.
     virtual int getNumberOfOnChannelTokens();
 
@@ -0,0 +1,145 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Exceptions.h"
+#include "Token.h"
+#include "TokenSource.h"
+
+#include "ConcurrentTokenStream.h"
+
+using namespace org::antlr::v4::runtime;
+
+ConcurrentTokenStream::ConcurrentTokenStream(TokenSource *tokenSource, size_t capacity)
+  : UnbufferedTokenStream(tokenSource), _head(0), _tail(0), _consumerWaiting(false), _producerWaiting(false),
+    _stopping(false), _producerDone(false) {
+  size_t size = 1;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  _ring.resize(size);
+  _mask = size - 1;
+
+  // The base class already fetched the first token, on this thread.
+  if (_tokens.back()->getType() != EOF) {
+    _producer = std::thread(&ConcurrentTokenStream::produce, this);
+  }
+}
+
+ConcurrentTokenStream::~ConcurrentTokenStream() {
+  if (_producer.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stopping = true;
+      _notFull.notify_one();
+    }
+    _producer.join();
+  }
+}
+
+size_t ConcurrentTokenStream::fill(size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    if (_tokens.size() > 0 && _tokens.back()->getType() == EOF) {
+      return i;
+    }
+
+    Ref<Token> t = pop();
+    if (t == nullptr) {
+      if (_producerException) {
+        std::rethrow_exception(_producerException);
+      }
+      throw IllegalStateException("The token source stopped before EOF.");
+    }
+    add(t);
+  }
+
+  return n;
+}
+
+void ConcurrentTokenStream::produce() {
+  try {
+    while (!_stopping) {
+      Ref<Token> t = _tokenSource->nextToken();
+      bool isEOF = t->getType() == EOF;
+      if (!push(t) || isEOF) {
+        break;
+      }
+    }
+  } catch (...) {
+    _producerException = std::current_exception();
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  _producerDone = true;
+  _notEmpty.notify_one();
+}
+
+bool ConcurrentTokenStream::push(Ref<Token> token) {
+  size_t tail = _tail.load(std::memory_order_relaxed);
+  if (tail - _head.load() == _ring.size()) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _producerWaiting = true;
+    _notFull.wait(lock, [this, tail] { return tail - _head.load() < _ring.size() || _stopping; });
+    _producerWaiting = false;
+    if (_stopping) {
+      return false;
+    }
+  }
+
+  _ring[tail & _mask] = std::move(token);
+  _tail.store(tail + 1); // Publishes the token.
+
+  // Sequentially consistent with the flag write in pop(), so either we see the flag or the consumer sees the token.
+  if (_consumerWaiting) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _notEmpty.notify_one();
+  }
+  return true;
+}
+
+Ref<Token> ConcurrentTokenStream::pop() {
+  size_t head = _head.load(std::memory_order_relaxed);
+  if (head == _tail.load()) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _consumerWaiting = true;
+    _notEmpty.wait(lock, [this, head] { return head != _tail.load() || _producerDone; });
+    _consumerWaiting = false;
+    if (head == _tail.load()) {
+      return nullptr; // The producer is done and everything was consumed.
+    }
+  }
+
+  Ref<Token> token = std::move(_ring[head & _mask]);
+  _head.store(head + 1); // Frees the slot.
+
+  if (_producerWaiting) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _notFull.notify_one();
+  }
+  return token;
+}
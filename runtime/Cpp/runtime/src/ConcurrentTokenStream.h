@@ -0,0 +1,93 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "UnbufferedTokenStream.h"
+
+#include <condition_variable>
+#include <thread>
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+
+  /// A token stream which runs its token source on a separate thread, so that lexing and parsing overlap.
+  ///
+  /// The producer thread pushes the tokens into a bounded lock-free single producer/single consumer ring, which the
+  /// stream (the consumer) drains into its window. The ring size bounds the number of tokens lexed ahead: the producer
+  /// blocks while the ring is full, the consumer while it is empty. Apart from that, the stream behaves exactly like
+  /// UnbufferedTokenStream: LT(k), mark/release and seek work within the buffered window, size() is not supported.
+  ///
+  /// The token source must not be used by anyone else while the stream exists (it runs on the producer thread). Its
+  /// error listeners are called on the producer thread too. Token text is read from the char stream of the token
+  /// source (CommonToken::getText), so the char stream must allow reading text while being consumed, which is the case
+  /// for all fully buffered char streams (ANTLRInputStream, UTF8CharStream, MappedFileStream). An exception thrown by
+  /// the token source is rethrown by the stream when the token after the last produced one is requested.
+  class ANTLR4CPP_PUBLIC ConcurrentTokenStream : public UnbufferedTokenStream {
+  public:
+    static const size_t DEFAULT_CAPACITY = 1024;
+
+    /// <param name="capacity"> The size of the ring, rounded up to a power of 2. </param>
+    ConcurrentTokenStream(TokenSource *tokenSource, size_t capacity = DEFAULT_CAPACITY);
+
+    /// Stops the producer thread.
+    virtual ~ConcurrentTokenStream();
+
+  protected:
+    virtual size_t fill(size_t n) override;
+
+  private:
+    std::vector<Ref<Token>> _ring;
+    size_t _mask;
+    std::atomic<size_t> _head; // Next slot to read, only written by the consumer.
+    std::atomic<size_t> _tail; // Next slot to write, only written by the producer.
+
+    // Used only to sleep when the ring is full or empty. The flags tell the other side that it has to wake us up.
+    std::mutex _mutex;
+    std::condition_variable _notEmpty;
+    std::condition_variable _notFull;
+    std::atomic<bool> _consumerWaiting;
+    std::atomic<bool> _producerWaiting;
+    std::atomic<bool> _stopping;
+    bool _producerDone; // Guarded by _mutex.
+    std::exception_ptr _producerException;
+
+    std::thread _producer;
+
+    void produce();
+    bool push(Ref<Token> token);
+    Ref<Token> pop();
+  };
+
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
@@ -62,6 +62,7 @@ bool DefaultErrorStrategy::inErrorRecoveryMode(Parser * /*recognizer*/) {
 
 void DefaultErrorStrategy::endErrorCondition(Parser * /*recognizer*/) {
   errorRecoveryMode = false;
+  lastErrorStates.clear();
   lastErrorIndex = -1;
 }
 
@@ -116,7 +117,7 @@ void DefaultErrorStrategy::sync(Parser *recognizer) {
   ssize_t la = tokens->LA(1);
 
   // try cheaper subset first; might get lucky. seems to shave a wee bit off
-  if (recognizer->getATN().nextTokens(s).contains((int)la) || la == Token::EOF) {
+  if (la == Token::EOF || recognizer->getATN().isInNextTokens(s, la)) {
     return;
   }
 
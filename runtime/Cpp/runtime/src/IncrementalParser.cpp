@@ -0,0 +1,525 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ANTLRErrorStrategy.h"
+#include "ANTLRInputStream.h"
+#include "CommonTokenStream.h"
+#include "Exceptions.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "ParserRuleContext.h"
+#include "TokenStore.h"
+#include "tree/ParseTreeListener.h"
+#include "tree/TerminalNodeImpl.h"
+#include "support/CPPUtils.h"
+#include "support/StringUtils.h"
+
+#include "IncrementalParser.h"
+
+using namespace org::antlr::v4::runtime;
+using namespace antlrcpp;
+
+//------------------ Document ------------------------------------------------------------------------------------------
+
+/// The text being edited. Records how far the lexer looks into it.
+class IncrementalParser::Document : public ANTLRInputStream {
+public:
+  /// One past the highest index LA() was asked for since this was last set.
+  size_t readEnd = 0;
+
+  void setText(const std::string &text) {
+    data = utfConverter.from_bytes(text);
+    p = 0;
+  }
+
+  void replace(size_t start, size_t length, const std::u32string &text) {
+    data.replace(start, length, text);
+    p = 0;
+  }
+
+  const std::u32string& getData() const {
+    return data;
+  }
+
+  /// Moves to the given index directly (seek() consumes its way forward).
+  void jump(size_t index) {
+    p = index;
+  }
+
+  virtual ssize_t LA(ssize_t i) override {
+    if (i > 0 && p + (size_t)i > readEnd) {
+      readEnd = p + (size_t)i;
+    }
+    return ANTLRInputStream::LA(i);
+  }
+};
+
+//------------------ TrackingTokenStream -------------------------------------------------------------------------------
+
+/// The token stream the parser reads. Its tokens are replaced as a whole after an edit. Records the highest token index
+/// the parser looked at (see RuleTracker).
+class IncrementalParser::TrackingTokenStream : public CommonTokenStream {
+public:
+  size_t lookaheadEnd = 0;
+
+  TrackingTokenStream(TokenSource *tokenSource) : CommonTokenStream(tokenSource) {
+  }
+
+  void load(Ref<TokenStore> const& tokens) {
+    _tokens = tokens;
+    _fetchedEOF = true;
+    setup();
+  }
+
+  Ref<TokenStore> getStore() const {
+    return _tokens;
+  }
+
+protected:
+  virtual ssize_t LTIndex(ssize_t k) override {
+    ssize_t index = CommonTokenStream::LTIndex(k);
+    if (k > 0 && index > (ssize_t)lookaheadEnd) {
+      lookaheadEnd = (size_t)index;
+    }
+    return index;
+  }
+};
+
+//------------------ RuleTracker ---------------------------------------------------------------------------------------
+
+/// Follows the rules entered and left by the parser, to record for each context the last token its parse looked at
+/// and whether there were syntax errors in it.
+class IncrementalParser::RuleTracker : public tree::ParseTreeListener {
+public:
+  RuleTracker(IncrementalParser *owner) : _owner(owner) {
+  }
+
+  void clear() {
+    _frames.clear();
+    _reused = false;
+  }
+
+  /// The context entered next is a reused subtree whose parse looked up to the given token.
+  void setReused(size_t lookaheadEnd) {
+    _reused = true;
+    _reusedLookaheadEnd = lookaheadEnd;
+  }
+
+  virtual void visitTerminal(tree::TerminalNode * /*node*/) override {
+  }
+
+  virtual void visitErrorNode(tree::ErrorNode * /*node*/) override {
+  }
+
+  virtual void enterEveryRule(ParserRuleContext *ctx) override {
+    // For left recursive rules the parser enters a new context for the current one (which already is its child when
+    // it is entered) and only leaves the outermost one. Treat that as a single rule invocation.
+    if (!_reused && !ctx->children.empty()) {
+      return;
+    }
+
+    TrackingTokenStream &tokens = *_owner->_tokens;
+    Frame frame;
+    frame.outerLookaheadEnd = tokens.lookaheadEnd;
+    frame.syntaxErrors = _owner->_parser->getNumberOfSyntaxErrors();
+    frame.recovering = _owner->_parser->getErrorHandler()->inErrorRecoveryMode(_owner->_parser);
+    frame.reused = _reused;
+    _frames.push_back(frame);
+    tokens.lookaheadEnd = _reused ? _reusedLookaheadEnd : (size_t)ctx->start->getTokenIndex();
+    _reused = false;
+  }
+
+  virtual void exitEveryRule(ParserRuleContext *ctx) override {
+    if (_frames.empty()) {
+      return;
+    }
+
+    Frame frame = _frames.back();
+    _frames.pop_back();
+
+    TrackingTokenStream &tokens = *_owner->_tokens;
+    // Errors are not reported while the parser recovers from an earlier one, so a context entered in that state may
+    // contain unreported errors.
+    if (!frame.reused && !frame.recovering && ctx->exception == nullptr &&
+        frame.syntaxErrors == _owner->_parser->getNumberOfSyntaxErrors()) {
+      _owner->recordRule(std::static_pointer_cast<ParserRuleContext>(ctx->shared_from_this()), tokens.lookaheadEnd);
+    }
+
+    // What the context looked at also counts for the enclosing one.
+    tokens.lookaheadEnd = std::max(tokens.lookaheadEnd, frame.outerLookaheadEnd);
+  }
+
+private:
+  struct Frame {
+    size_t outerLookaheadEnd;
+    int syntaxErrors;
+    bool recovering;
+    bool reused;
+  };
+
+  IncrementalParser *_owner;
+  std::vector<Frame> _frames;
+  bool _reused = false;
+  size_t _reusedLookaheadEnd = 0;
+};
+
+//------------------ Edit ----------------------------------------------------------------------------------------------
+
+IncrementalParser::Edit::Edit(size_t start, size_t length, const std::string &text)
+  : start(start), length(length), text(text) {
+}
+
+//------------------ IncrementalParser ---------------------------------------------------------------------------------
+
+IncrementalParser::IncrementalParser(Lexer *lexer, Parser *parser, StartRule startRule)
+  : _lexer(lexer), _parser(parser), _startRule(startRule), _maxLookahead(0), _damageStart(0), _newTokenCount(0),
+    _lexedTokenCount(0), _reusedSubtreeCount(0) {
+  _document.reset(new Document()); /* mem-check: managed by unique_ptr */
+  _tokens.reset(new TrackingTokenStream(lexer)); /* mem-check: managed by unique_ptr */
+  _tracker = std::make_shared<RuleTracker>(this);
+}
+
+IncrementalParser::~IncrementalParser() {
+}
+
+Ref<ParserRuleContext> IncrementalParser::parse(const std::string &text) {
+  _document->setText(text);
+  _lexer->setInputStream(_document.get());
+
+  _steps.clear();
+  _modeStates.clear();
+  _maxLookahead = 0;
+
+  Ref<TokenStore> tokens = std::make_shared<TokenStore>();
+  while (true) {
+    Ref<Token> token = lexStep(_steps);
+    tokens->add(token);
+    if (token->getType() == Token::EOF) {
+      break;
+    }
+  }
+  _tokens->load(tokens);
+  _lexedTokenCount = _steps.size();
+
+  _rules.assign(tokens->size(), std::vector<RuleRecord>());
+  return runParser();
+}
+
+Ref<ParserRuleContext> IncrementalParser::reparse(const Edit &edit) {
+  if (_steps.empty()) {
+    throw IllegalStateException("parse() must be called before reparse()");
+  }
+
+  const std::u32string &text = _document->getData();
+  if (edit.start > text.size() || edit.length > text.size() - edit.start) {
+    throw IllegalArgumentException("edit range exceeds the text");
+  }
+
+  std::u32string inserted = utfConverter.from_bytes(edit.text);
+  size_t editEnd = edit.start + edit.length;
+  ssize_t delta = (ssize_t)inserted.size() - (ssize_t)edit.length;
+  int lineDelta = (int)std::count(inserted.begin(), inserted.end(), U'\n') -
+    (int)std::count(text.begin() + (ssize_t)edit.start, text.begin() + (ssize_t)editEnd, U'\n');
+
+  auto byStart = [](const Step &step, size_t index) { return step.start < index; };
+  auto stepAt = [&](size_t index) { // The step which consumed the char at index.
+    size_t i = (size_t)(std::lower_bound(_steps.begin(), _steps.end(), index + 1, byStart) - _steps.begin());
+    return i > 0 ? i - 1 : 0;
+  };
+
+  // Lexing restarts with the first step which looked at the changed text. A step looks at most _maxLookahead chars
+  // beyond its end (the start of the next step), so only a few steps before the edit need to be checked.
+  size_t restart = stepAt(edit.start);
+  for (size_t i = restart; i > 0 && _steps[i].start + _maxLookahead > edit.start; --i) {
+    if (_steps[i - 1].readEnd > edit.start) {
+      restart = i - 1;
+    }
+  }
+
+  // Steps starting on a line after the end of the edit are not moved within their line, only these can be taken over.
+  size_t endStep = stepAt(editEnd);
+  size_t editEndLine = _steps[endStep].line +
+    (size_t)std::count(text.begin() + (ssize_t)_steps[endStep].start, text.begin() + (ssize_t)editEnd, U'\n');
+
+  _document->replace(edit.start, edit.length, inserted);
+
+  const Step &first = _steps[restart];
+  _lexer->reset();
+  _document->jump(first.start);
+  _lexer->setLine(first.line);
+  _lexer->setCharPositionInLine(first.charPositionInLine);
+  _lexer->mode = _modeStates[first.modeState].mode;
+  _lexer->modeStack = _modeStates[first.modeState].modeStack;
+
+  // Lex until the lexer is at the start of an old step behind the edit, in the same state.
+  size_t oldCount = _steps.size();
+  size_t resume = oldCount;
+  size_t insertedEnd = edit.start + inserted.size();
+  std::vector<Step> steps;
+  std::vector<Ref<Token>> lexed;
+  while (true) {
+    size_t position = _document->index();
+    if (position >= insertedEnd) {
+      size_t oldPosition = (size_t)((ssize_t)position - delta);
+      auto step = std::lower_bound(_steps.begin() + (ssize_t)restart, _steps.end(), oldPosition, byStart);
+      if (step != _steps.end() && step->start == oldPosition && step->line > editEndLine &&
+          isModeState(step->modeState)) {
+        resume = (size_t)(step - _steps.begin());
+        break;
+      }
+    }
+
+    Ref<Token> token = lexStep(steps);
+    lexed.push_back(token);
+    if (token->getType() == Token::EOF) {
+      break;
+    }
+  }
+
+  // Splice the new tokens, steps and (empty) context records in, behind them everything is moved.
+  Ref<TokenStore> tokens = _tokens->getStore();
+  tokens->replace(restart, resume - restart, lexed, (int)delta, lineDelta);
+  _tokens->load(tokens);
+
+  _steps.erase(_steps.begin() + (ssize_t)restart, _steps.begin() + (ssize_t)resume);
+  _steps.insert(_steps.begin() + (ssize_t)restart, steps.begin(), steps.end());
+  for (size_t i = restart + steps.size(); i < _steps.size(); ++i) {
+    Step &step = _steps[i];
+    step.start = (size_t)((ssize_t)step.start + delta);
+    step.readEnd = (size_t)((ssize_t)step.readEnd + delta);
+    step.line = (size_t)((int)step.line + lineDelta);
+  }
+
+  _rules.erase(_rules.begin() + (ssize_t)restart, _rules.begin() + (ssize_t)resume);
+  _rules.insert(_rules.begin() + (ssize_t)restart, lexed.size(), std::vector<RuleRecord>());
+
+  _damageStart = restart;
+  _newTokenCount = lexed.size();
+  _lexedTokenCount = lexed.size();
+
+  // Subtrees are taken from the previous tree, which is checked against their parents.
+  _previousTree = _tree;
+  auto onExit = finally([this] {
+    _previousTree.reset();
+  });
+
+  Ref<ParserRuleContext> tree = runParser();
+
+  // The records of the previous contexts which did not make it into the new tree are stale now.
+  if (_previousTree != nullptr) {
+    dropRecords(_previousTree.get());
+  }
+  return tree;
+}
+
+Ref<ParserRuleContext> IncrementalParser::getTree() const {
+  return _tree;
+}
+
+BufferedTokenStream* IncrementalParser::getTokenStream() {
+  return _tokens.get();
+}
+
+CharStream* IncrementalParser::getInputStream() {
+  return _document.get();
+}
+
+size_t IncrementalParser::getLexedTokenCount() const {
+  return _lexedTokenCount;
+}
+
+size_t IncrementalParser::getReusedSubtreeCount() const {
+  return _reusedSubtreeCount;
+}
+
+Ref<ParserRuleContext> IncrementalParser::takeSubtree(Ref<ParserRuleContext> localctx) {
+  if (_previousTree == nullptr) {
+    return nullptr;
+  }
+
+  // Tokens lexed for the edit have no previous contexts.
+  size_t start = (size_t)localctx->start->getTokenIndex();
+  if (start >= _rules.size() || (start >= _damageStart && start < _damageStart + _newTokenCount)) {
+    return nullptr;
+  }
+  bool beforeDamage = start < _damageStart;
+
+  for (auto &record : _rules[start]) {
+    Ref<ParserRuleContext> const& subtree = record.context;
+    if (subtree->getRuleIndex() != localctx->getRuleIndex()) {
+      continue;
+    }
+
+    // Contexts behind the damage looked only at tokens behind it, those before it may have looked into it.
+    if (beforeDamage && start + record.lookahead >= _damageStart) {
+      continue;
+    }
+
+    // The parser cannot continue after EOF.
+    if (subtree->stop != nullptr && subtree->stop->getType() == Token::EOF) {
+      continue;
+    }
+
+    if (!hasSameOuterContext(subtree.get(), localctx.get())) {
+      continue;
+    }
+
+    _tracker->setReused(start + record.lookahead);
+    ++_reusedSubtreeCount;
+    return subtree;
+  }
+
+  return nullptr;
+}
+
+Ref<Token> IncrementalParser::lexStep(std::vector<Step> &steps) {
+  Step step;
+  step.start = _document->index();
+  step.line = _lexer->getLine();
+  step.charPositionInLine = _lexer->getCharPositionInLine();
+  step.modeState = getModeState();
+
+  _document->readEnd = step.start;
+  Ref<Token> token = _lexer->nextToken();
+  step.readEnd = _document->readEnd;
+
+  size_t end = _document->index();
+  if (step.readEnd > end) {
+    _maxLookahead = std::max(_maxLookahead, step.readEnd - end);
+  }
+  steps.push_back(step);
+  return token;
+}
+
+size_t IncrementalParser::getModeState() {
+  // There are only a few distinct states and mostly the last one is used again.
+  for (size_t i = _modeStates.size(); i > 0; --i) {
+    if (isModeState(i - 1)) {
+      return i - 1;
+    }
+  }
+
+  ModeState state;
+  state.mode = _lexer->mode;
+  state.modeStack = _lexer->modeStack;
+  _modeStates.push_back(state);
+  return _modeStates.size() - 1;
+}
+
+bool IncrementalParser::isModeState(size_t modeState) const {
+  const ModeState &state = _modeStates[modeState];
+  return state.mode == _lexer->mode && state.modeStack == _lexer->modeStack;
+}
+
+Ref<ParserRuleContext> IncrementalParser::runParser() {
+  _tree.reset();
+  _reusedSubtreeCount = 0;
+  _tracker->clear();
+
+  _parser->setTokenStream(_tokens.get());
+  _parser->setIncrementalParser(this);
+  _parser->addParseListener(_tracker);
+  auto onExit = finally([this] {
+    _parser->removeParseListener(_tracker);
+    _parser->setIncrementalParser(nullptr);
+  });
+
+  try {
+    _tree = _startRule(_parser);
+  } catch (...) {
+    // Records of an unfinished tree are of no use.
+    _rules.assign(_rules.size(), std::vector<RuleRecord>());
+    throw;
+  }
+  return _tree;
+}
+
+void IncrementalParser::recordRule(Ref<ParserRuleContext> const& context, size_t lookaheadEnd) {
+  size_t start = (size_t)context->start->getTokenIndex();
+  RuleRecord record;
+  record.context = context;
+  record.lookahead = lookaheadEnd > start ? lookaheadEnd - start : 0;
+  _rules[start].push_back(record);
+}
+
+void IncrementalParser::dropRecords(ParserRuleContext *context) {
+  // A reused context got a new parent, so only the contexts which were parsed again are visited. The root can only be
+  // reused as a whole.
+  if (context == _tree.get()) {
+    return;
+  }
+
+  size_t start = (size_t)context->start->getTokenIndex();
+  if (start < _rules.size()) {
+    std::vector<RuleRecord> &records = _rules[start];
+    records.erase(std::remove_if(records.begin(), records.end(), [context](const RuleRecord &record) {
+      return record.context.get() == context;
+    }), records.end());
+  }
+
+  for (auto &child : context->children) {
+    ParserRuleContext *rule = dynamic_cast<ParserRuleContext *>(child.get());
+    if (rule != nullptr && rule->parent.lock().get() == context) {
+      dropRecords(rule);
+    }
+  }
+}
+
+bool IncrementalParser::hasSameOuterContext(RuleContext *oldContext, RuleContext *newContext) const {
+  Ref<RuleContext> oldParent;
+  Ref<RuleContext> newParent;
+  while (true) {
+    // A context of a left recursive rule which was made the first child of a new context of that rule later on (see
+    // Parser::pushNewRecursionContext) had the invoking state and parent of that one while its children were parsed.
+    while (true) {
+      Ref<RuleContext> parent = oldContext->parent.lock();
+      ParserRuleContext *wrapper = dynamic_cast<ParserRuleContext *>(parent.get());
+      if (wrapper == nullptr || wrapper->getRuleIndex() != oldContext->getRuleIndex() || wrapper->children.empty() ||
+          wrapper->children[0].get() != oldContext) {
+        break;
+      }
+      oldParent = parent;
+      oldContext = wrapper;
+    }
+
+    // A context which is part of the new tree already cannot be reused.
+    if (oldContext == newContext || oldContext->invokingState != newContext->invokingState) {
+      return false;
+    }
+
+    oldParent = oldContext->parent.lock();
+    newParent = newContext->parent.lock();
+    if (oldParent == nullptr || newParent == nullptr) {
+      // Only contexts of the previous tree can be reused.
+      return oldParent == nullptr && newParent == nullptr && oldContext == _previousTree.get();
+    }
+    oldContext = oldParent.get();
+    newContext = newParent.get();
+  }
+}
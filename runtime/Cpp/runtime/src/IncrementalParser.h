@@ -0,0 +1,179 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "antlr4-common.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+
+  /// Keeps the tokens and the parse tree of a document up to date while it is edited, e.g. in a language server.
+  ///
+  /// After an edit only the damaged part of the text is lexed again. Lexing restarts at the first token whose
+  /// recognition looked at the changed text, with the lexer mode (and mode stack) recorded for that token, and stops
+  /// as soon as the lexer reaches the start of an old token behind the edit in the same mode. The tokens behind that
+  /// point are carried over, moved by the size of the edit.
+  ///
+  /// The parser then reuses subtrees of the previous parse tree. When it enters a rule at a token where the old tree
+  /// has a context for the same rule, invoked through the same chain of ATN states (i.e. with the same outer context),
+  /// and neither the tokens of that context nor the lookahead its parse depended on were touched by the edit, the old
+  /// context is hooked into the new tree and parsing continues after it. Contexts which contained syntax errors are
+  /// never reused. This needs the generated parser to enter rules with Parser::enterReusableRule() (the C++ target
+  /// does so for all rules without arguments, ParserInterpreter for all rules which are not left recursive). It also
+  /// assumes that how a rule parses depends only on its input and outer context: embedded actions are not executed
+  /// for reused rules and semantic predicates must not depend on other state.
+  ///
+  /// Reused subtrees are not visited. Their tokens are views into the token store, which follow their tokens when a
+  /// range of the store is replaced (see TokenStore::replace()), and the records needed to reuse their contexts again
+  /// are kept per token, relative to the start token. What remains linear in the size of the document is splicing
+  /// the flat per token arrays (the tokens, the lexer steps and the context records): the entries behind the edit are
+  /// moved, and the char indexes and lines of the tokens and steps behind it are adjusted.
+  ///
+  /// Text positions are code point indexes, the text itself is UTF-8 (like for ANTLRInputStream).
+  ///
+  /// The lexer and parser are only referenced and must not be used for anything else while the driver is in use. All
+  /// tokens refer to the driver's input stream, whose content changes with each edit. Hence a tree returned earlier
+  /// is only valid until the next call to parse() or reparse(). Error listeners, error strategy etc. of lexer and
+  /// parser are used as they are set up.
+  class ANTLR4CPP_PUBLIC IncrementalParser {
+  public:
+    /// A change of the document: the code points [start, start + length) are replaced by text.
+    class ANTLR4CPP_PUBLIC Edit {
+    public:
+      size_t start;
+      size_t length;
+      std::string text;
+
+      Edit(size_t start, size_t length, const std::string &text);
+    };
+
+    /// Invokes the start rule on the given parser (e.g. by casting it to the generated class) and returns the tree.
+    typedef std::function<Ref<ParserRuleContext>(Parser *parser)> StartRule;
+
+    IncrementalParser(Lexer *lexer, Parser *parser, StartRule startRule);
+    virtual ~IncrementalParser();
+
+    /// Lexes and parses the given text from scratch and returns the parse tree.
+    Ref<ParserRuleContext> parse(const std::string &text);
+
+    /// Applies the edit to the current text and parses it again, reusing everything the edit did not touch. Returns the
+    /// new parse tree.
+    Ref<ParserRuleContext> reparse(const Edit &edit);
+
+    /// The tree returned by the last parse, null if there was none or it ended with an exception.
+    Ref<ParserRuleContext> getTree() const;
+
+    /// The tokens of the current text. The stream object stays the same for all parses.
+    BufferedTokenStream* getTokenStream();
+
+    /// The current text.
+    CharStream* getInputStream();
+
+    /// The number of tokens produced by the lexer during the last parse.
+    size_t getLexedTokenCount() const;
+
+    /// The number of subtrees of the previous tree reused by the last parse.
+    size_t getReusedSubtreeCount() const;
+
+    /// Called by Parser::enterReusableRule(): returns a subtree of the previous tree which can replace the given
+    /// context, just entered at its start token, or null if there is none.
+    Ref<ParserRuleContext> takeSubtree(Ref<ParserRuleContext> localctx);
+
+  private:
+    class Document;
+    class TrackingTokenStream;
+    class RuleTracker;
+
+    /// What the lexer did to produce a token: where it started (after the previous token), how far it looked into the
+    /// input and the state it started in.
+    struct Step {
+      size_t start;
+      size_t readEnd; // One past the last code point looked at.
+      size_t line;
+      int charPositionInLine;
+      size_t modeState; // Index into _modeStates.
+    };
+
+    struct ModeState {
+      size_t mode;
+      std::vector<size_t> modeStack;
+    };
+
+    /// A context of the current parse tree which may be reused, together with how many tokens beyond its start token
+    /// its parse looked at. Both stay valid while the tokens of the context are only moved by edits.
+    struct RuleRecord {
+      Ref<ParserRuleContext> context;
+      size_t lookahead;
+    };
+
+    Lexer *_lexer;
+    Parser *_parser;
+    StartRule _startRule;
+
+    std::unique_ptr<Document> _document;
+    std::unique_ptr<TrackingTokenStream> _tokens;
+    Ref<RuleTracker> _tracker;
+
+    std::vector<Step> _steps; // One per token.
+    std::vector<ModeState> _modeStates;
+    size_t _maxLookahead; // The furthest any lexer step looked beyond its end.
+
+    Ref<ParserRuleContext> _tree;
+    Ref<ParserRuleContext> _previousTree; // While reparsing.
+
+    /// Reusable contexts by start token index (one entry per token). Spliced along with the tokens, so the records of
+    /// reused subtrees stay in place.
+    std::vector<std::vector<RuleRecord>> _rules;
+
+    /// The tokens [_damageStart, _damageStart + _newTokenCount) were lexed for the last edit.
+    size_t _damageStart;
+    size_t _newTokenCount;
+
+    size_t _lexedTokenCount;
+    size_t _reusedSubtreeCount;
+
+    Ref<Token> lexStep(std::vector<Step> &steps);
+    size_t getModeState();
+    bool isModeState(size_t modeState) const;
+    Ref<ParserRuleContext> runParser();
+    void recordRule(Ref<ParserRuleContext> const& context, size_t lookaheadEnd);
+    void dropRecords(ParserRuleContext *context);
+    bool hasSameOuterContext(RuleContext *oldContext, RuleContext *newContext) const;
+
+    IncrementalParser(const IncrementalParser &) = delete;
+    IncrementalParser& operator = (const IncrementalParser &) = delete;
+  };
+
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
@@ -50,7 +50,9 @@ Lexer::Lexer(CharStream *input) : _input(input) {
 
 void Lexer::reset() {
   // wack Lexer state variables
-  _input->seek(0); // rewind the input
+  if (_input != nullptr) {
+    _input->seek(0); // rewind the input
+  }
 
   token.reset();
   type = Token::INVALID_TYPE;
@@ -156,6 +158,7 @@ Ref<TokenFactory<CommonToken>> Lexer::getTokenFactory() {
 }
 
 void Lexer::setInputStream(IntStream *input) {
+  _input = nullptr; // Don't touch the old input, it might be gone already.
   reset();
   _input = dynamic_cast<CharStream*>(input);
 }
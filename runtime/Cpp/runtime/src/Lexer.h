@@ -127,8 +127,7 @@ namespace runtime {
     virtual void pushMode(size_t m);
     virtual size_t popMode();
 
-    template<typename T1>
-    void setTokenFactory(TokenFactory<T1> *factory)  {
+    void setTokenFactory(Ref<TokenFactory<CommonToken>> factory)  {
       this->_factory = factory;
     }
 
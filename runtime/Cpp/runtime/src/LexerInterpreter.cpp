@@ -32,6 +32,7 @@
 #include "atn/ATNType.h"
 #include "atn/LexerATNSimulator.h"
 #include "dfa/DFA.h"
+#include "atn/PredictionContextCache.h"
 #include "atn/EmptyPredictionContext.h"
 #include "Exceptions.h"
 #include "VocabularyImpl.h"
@@ -64,7 +65,7 @@ LexerInterpreter::LexerInterpreter(const std::string &grammarFileName, Ref<dfa::
   for (size_t i = 0; i < (size_t)atn.getNumberOfDecisions(); ++i) {
     _decisionToDFA.push_back(dfa::DFA(_atn.getDecisionState((int)i), (int)i));
   }
-  _interpreter = new atn::LexerATNSimulator(_atn, _decisionToDFA, _sharedContextCache); /* mem-check: deleted in d-tor */
+  _interpreter = new atn::LexerATNSimulator(this, _atn, _decisionToDFA, _sharedContextCache); /* mem-check: deleted in d-tor */
 }
 
 LexerInterpreter::~LexerInterpreter()
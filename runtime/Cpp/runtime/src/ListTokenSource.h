@@ -106,7 +106,8 @@ namespace runtime {
     /// </param>
     /// <exception cref="NullPointerException"> if {@code tokens} is {@code null} </exception>
     template<typename T1>
-    ListTokenSource(std::vector<T1> tokens, const std::string &/*sourceName*/) {
+    ListTokenSource(std::vector<T1> tokens_, const std::string &sourceName_)
+      : tokens(tokens_.begin(), tokens_.end()), sourceName(sourceName_) {
       InitializeInstanceFields();
       if (tokens.empty()) {
         throw "tokens cannot be nul";
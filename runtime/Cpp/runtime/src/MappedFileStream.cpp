@@ -0,0 +1,137 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#include "Exceptions.h"
+
+#include "MappedFileStream.h"
+
+using namespace org::antlr::v4::runtime;
+
+#ifdef _WIN32
+
+MappedFileStream::MappedFileStream(const std::string &fileName)
+  : _fileName(fileName), _mapping(nullptr), _mappingSize(0), _fileHandle(INVALID_HANDLE_VALUE), _mappingHandle(nullptr) {
+
+  HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    throw IOException("Cannot open file: " + fileName);
+  }
+  _fileHandle = file;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    throw IOException("Cannot determine size of file: " + fileName);
+  }
+
+  _mappingSize = (size_t)size.QuadPart;
+  if (_mappingSize > 0) { // Empty files cannot be mapped.
+    _mappingHandle = CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (_mappingHandle != nullptr) {
+      _mapping = MapViewOfFile(_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    }
+
+    if (_mapping == nullptr) {
+      if (_mappingHandle != nullptr) {
+        CloseHandle(_mappingHandle);
+      }
+      CloseHandle(file);
+      throw IOException("Cannot map file: " + fileName);
+    }
+  }
+
+  setBuffer(static_cast<const char *>(_mapping), _mappingSize);
+}
+
+MappedFileStream::~MappedFileStream() {
+  if (_mapping != nullptr) {
+    UnmapViewOfFile(_mapping);
+  }
+  if (_mappingHandle != nullptr) {
+    CloseHandle(_mappingHandle);
+  }
+  CloseHandle(_fileHandle);
+}
+
+#else
+
+MappedFileStream::MappedFileStream(const std::string &fileName)
+  : _fileName(fileName), _mapping(nullptr), _mappingSize(0) {
+
+  int file = open(fileName.c_str(), O_RDONLY);
+  if (file < 0) {
+    throw IOException("Cannot open file: " + fileName);
+  }
+
+  struct stat info;
+  if (fstat(file, &info) != 0) {
+    close(file);
+    throw IOException("Cannot determine size of file: " + fileName);
+  }
+
+  _mappingSize = (size_t)info.st_size;
+  if (_mappingSize > 0) { // Empty files cannot be mapped.
+    void *mapping = mmap(nullptr, _mappingSize, PROT_READ, MAP_PRIVATE, file, 0);
+    if (mapping == MAP_FAILED) {
+      close(file);
+      throw IOException("Cannot map file: " + fileName);
+    }
+    _mapping = mapping;
+
+    // The lexer reads the input from start to end.
+    madvise(_mapping, _mappingSize, MADV_SEQUENTIAL);
+  }
+
+  // The mapping stays valid after the descriptor is closed.
+  close(file);
+
+  setBuffer(static_cast<const char *>(_mapping), _mappingSize);
+}
+
+MappedFileStream::~MappedFileStream() {
+  if (_mapping != nullptr) {
+    munmap(_mapping, _mappingSize);
+  }
+}
+
+#endif
+
+std::string MappedFileStream::getSourceName() const {
+  return _fileName;
+}
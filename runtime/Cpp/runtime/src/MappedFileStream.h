@@ -0,0 +1,69 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "UTF8CharStream.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+
+  /// A UTF8CharStream over a read-only memory mapped file. Nothing is read or converted up front, so even very large
+  /// files can be lexed immediately and only the pages actually touched are loaded into memory. The mapping is
+  /// released when the stream is destroyed, so tokens must not outlive the stream (same as for any other char stream).
+  class ANTLR4CPP_PUBLIC MappedFileStream : public UTF8CharStream {
+  protected:
+    std::string _fileName; // UTF-8 encoded file name.
+
+  public:
+    /// Maps the given file (content encoded as UTF-8, with or w/o BOM). Throws an IOException if that fails.
+    MappedFileStream(const std::string &fileName);
+    virtual ~MappedFileStream();
+
+    virtual std::string getSourceName() const override;
+
+  private:
+    void *_mapping;
+    size_t _mappingSize;
+
+#ifdef _WIN32
+    void *_fileHandle;
+    void *_mappingHandle;
+#endif
+
+    MappedFileStream(const MappedFileStream &) = delete;
+    MappedFileStream& operator = (const MappedFileStream &) = delete;
+  };
+
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
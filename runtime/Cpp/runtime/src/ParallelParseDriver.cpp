@@ -0,0 +1,240 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "BaseErrorListener.h"
+#include "CommonTokenStream.h"
+#include "Lexer.h"
+#include "MappedFileStream.h"
+#include "Parser.h"
+#include "ParserRuleContext.h"
+#include "UTF8CharStream.h"
+#include "support/CPPUtils.h"
+
+#include "ParallelParseDriver.h"
+
+#include <deque>
+#include <thread>
+
+using namespace antlrcpp;
+using namespace org::antlr::v4::runtime;
+
+namespace {
+
+  /// A UTF8CharStream which owns its buffer.
+  class BufferStream : public UTF8CharStream {
+  public:
+    BufferStream(const std::string &name, const std::string &text) : _text(text) {
+      this->name = name;
+      setBuffer(_text.data(), _text.size());
+    }
+
+  private:
+    const std::string _text;
+  };
+
+  /// Collects the syntax errors of the input currently parsed by a worker.
+  class ResultErrorListener : public BaseErrorListener {
+  public:
+    ParallelParseDriver::Result *result = nullptr;
+
+    virtual void syntaxError(IRecognizer * /*recognizer*/, Ref<Token> /*offendingSymbol*/, size_t line,
+                             int charPositionInLine, const std::string &msg, std::exception_ptr /*e*/) override {
+      if (result != nullptr) {
+        result->syntaxErrors.push_back("line " + std::to_string(line) + ":" + std::to_string(charPositionInLine) + " " +
+                                       msg);
+      }
+    }
+  };
+
+}
+
+//------------------ Input, Result -------------------------------------------------------------------------------------
+
+ParallelParseDriver::Input ParallelParseDriver::Input::fromFile(const std::string &fileName) {
+  Input input;
+  input.name = fileName;
+  input.isFile = true;
+  return input;
+}
+
+ParallelParseDriver::Input ParallelParseDriver::Input::fromBuffer(const std::string &name, const std::string &text) {
+  Input input;
+  input.name = name;
+  input.text = text;
+  input.isFile = false;
+  return input;
+}
+
+bool ParallelParseDriver::Result::succeeded() const {
+  return exception == nullptr && syntaxErrors.empty();
+}
+
+//------------------ Worker --------------------------------------------------------------------------------------------
+
+/// The recognizers of one thread and its share of the inputs.
+class ParallelParseDriver::Worker {
+public:
+  ResultErrorListener errorListener;
+  std::unique_ptr<Lexer> lexer;
+  std::unique_ptr<CommonTokenStream> tokens;
+  std::unique_ptr<Parser> parser;
+
+  /// Indices of the inputs still to parse. The owner takes them from the front, other workers steal from the back.
+  std::deque<size_t> queue;
+  std::mutex queueLock;
+};
+
+//------------------ ParallelParseDriver -------------------------------------------------------------------------------
+
+ParallelParseDriver::ParallelParseDriver(LexerFactory createLexer, ParserFactory createParser, StartRule startRule,
+                                         size_t threadCount)
+  : _createLexer(createLexer), _createParser(createParser), _startRule(startRule) {
+  if (threadCount == 0) {
+    threadCount = std::max(std::thread::hardware_concurrency(), 1U);
+  }
+
+  for (size_t i = 0; i < threadCount; ++i) {
+    _workers.emplace_back(new Worker()); /* mem-check: managed by unique_ptr */
+  }
+}
+
+ParallelParseDriver::~ParallelParseDriver() {
+}
+
+std::vector<ParallelParseDriver::Result> ParallelParseDriver::parse(const std::vector<Input> &inputs) {
+  std::vector<Result> results(inputs.size());
+  size_t workerCount = std::min(_workers.size(), inputs.size());
+  if (workerCount == 0) {
+    return results;
+  }
+
+  // Round robin distribution, so neighboring inputs (which are often of similar size) end up in different queues.
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    _workers[i % workerCount]->queue.push_back(i);
+  }
+
+  // The calling thread acts as the first worker. The threads started so far are joined even if starting another one
+  // fails, as destroying a joinable thread terminates the process.
+  std::vector<std::thread> threads;
+  threads.reserve(workerCount - 1);
+  {
+    auto onExit = finally([&threads] {
+      for (auto &thread : threads) {
+        thread.join();
+      }
+    });
+
+    for (size_t i = 1; i < workerCount; ++i) {
+      threads.emplace_back(&ParallelParseDriver::run, this, i, workerCount, std::cref(inputs), std::ref(results));
+    }
+    run(0, workerCount, inputs, results);
+  }
+
+  return results;
+}
+
+size_t ParallelParseDriver::getThreadCount() const {
+  return _workers.size();
+}
+
+void ParallelParseDriver::run(size_t workerIndex, size_t workerCount, const std::vector<Input> &inputs,
+                              std::vector<Result> &results) {
+  Worker &worker = *_workers[workerIndex];
+  size_t inputIndex;
+  while (takeWork(workerIndex, workerCount, inputIndex)) {
+    parseInput(worker, inputs[inputIndex], results[inputIndex]);
+  }
+}
+
+bool ParallelParseDriver::takeWork(size_t workerIndex, size_t workerCount, size_t &inputIndex) {
+  {
+    Worker &worker = *_workers[workerIndex];
+    std::lock_guard<std::mutex> lock(worker.queueLock);
+    if (!worker.queue.empty()) {
+      inputIndex = worker.queue.front();
+      worker.queue.pop_front();
+      return true;
+    }
+  }
+
+  // Nothing left here, steal from the others. No work is added while parsing, so once all queues were found empty
+  // we are done.
+  for (size_t i = 1; i < workerCount; ++i) {
+    Worker &victim = *_workers[(workerIndex + i) % workerCount];
+    std::lock_guard<std::mutex> lock(victim.queueLock);
+    if (!victim.queue.empty()) {
+      inputIndex = victim.queue.back();
+      victim.queue.pop_back();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ParallelParseDriver::parseInput(Worker &worker, const Input &input, Result &result) {
+  result.name = input.name;
+  worker.errorListener.result = &result;
+
+  try {
+    if (input.isFile) {
+      result.input = std::make_shared<MappedFileStream>(input.name);
+    } else {
+      result.input = std::make_shared<BufferStream>(input.name, input.text);
+    }
+
+    if (worker.parser == nullptr) {
+      worker.lexer = _createLexer(result.input.get());
+      worker.lexer->removeErrorListeners();
+      worker.lexer->addErrorListener(&worker.errorListener);
+      worker.tokens.reset(new CommonTokenStream(worker.lexer.get())); /* mem-check: managed by unique_ptr */
+
+      worker.parser = _createParser(worker.tokens.get());
+      worker.parser->removeErrorListeners();
+      worker.parser->addErrorListener(&worker.errorListener);
+    } else {
+      // Each reset starts a new token store, so tokens of earlier results stay valid.
+      worker.lexer->setInputStream(result.input.get());
+      worker.tokens->setTokenSource(worker.lexer.get());
+      worker.parser->setTokenStream(worker.tokens.get());
+    }
+
+    result.tree = _startRule(worker.parser.get());
+  } catch (...) {
+    result.exception = std::current_exception();
+
+    // If creating the recognizers failed half way, start over with the next input.
+    if (worker.parser == nullptr) {
+      worker.tokens.reset();
+      worker.lexer.reset();
+    }
+  }
+
+  worker.errorListener.result = nullptr;
+}
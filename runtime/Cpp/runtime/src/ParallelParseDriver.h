@@ -0,0 +1,119 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "antlr4-common.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+
+  /// Parses many inputs (files or in-memory buffers) concurrently, using a work stealing pool of threads.
+  ///
+  /// Each thread creates its own lexer/parser pair on first use (via the given factories) and reuses it for all inputs
+  /// it processes. Generated recognizers of the same grammar share their DFAs and prediction context cache (static
+  /// members), so what one thread learns about the grammar speeds up the others too.
+  ///
+  /// Inputs are read as UTF-8 (see UTF8CharStream, token indices are byte offsets). Files are memory mapped.
+  ///
+  /// Each result keeps its input stream alive, which is needed for the token text in its parse tree. Tokens also refer
+  /// to the lexer that created them (Token::getTokenSource()), so keep the driver alive as long as you need that.
+  class ANTLR4CPP_PUBLIC ParallelParseDriver {
+  public:
+    /// A single input: either a file or a named buffer.
+    class ANTLR4CPP_PUBLIC Input {
+    public:
+      /// The file name or, for a buffer, the name used as source name of the tokens.
+      std::string name;
+      /// The content of a buffer (UTF-8). Unused for files.
+      std::string text;
+      bool isFile;
+
+      static Input fromFile(const std::string &fileName);
+      static Input fromBuffer(const std::string &name, const std::string &text);
+    };
+
+    /// The outcome of parsing a single input.
+    class ANTLR4CPP_PUBLIC Result {
+    public:
+      /// The name of the input this result is for.
+      std::string name;
+      /// The parse tree, null if parsing stopped with an exception.
+      Ref<ParserRuleContext> tree;
+      /// The char stream the tokens in the tree refer to.
+      Ref<CharStream> input;
+      /// Syntax errors reported by lexer and parser, formatted like ConsoleErrorListener does
+      /// ("line <line>:<column> <message>").
+      std::vector<std::string> syntaxErrors;
+      /// The exception which stopped parsing this input, if any (e.g. an IOException for a file which cannot be read,
+      /// or the ParseCancellationException of a BailErrorStrategy).
+      std::exception_ptr exception;
+
+      /// True if there was neither an exception nor a syntax error.
+      bool succeeded() const;
+    };
+
+    typedef std::function<std::unique_ptr<Lexer>(CharStream *input)> LexerFactory;
+    typedef std::function<std::unique_ptr<Parser>(TokenStream *input)> ParserFactory;
+    /// Invokes the start rule on the given parser (e.g. by casting it to the generated class) and returns the tree.
+    typedef std::function<Ref<ParserRuleContext>(Parser *parser)> StartRule;
+
+    /// Creates a driver with the given number of threads (0 = one per hardware thread).
+    ParallelParseDriver(LexerFactory createLexer, ParserFactory createParser, StartRule startRule,
+                        size_t threadCount = 0);
+    virtual ~ParallelParseDriver();
+
+    /// Parses all inputs and returns their results, in the order of the inputs. Blocks until all are done.
+    /// Must not be called concurrently on the same driver.
+    std::vector<Result> parse(const std::vector<Input> &inputs);
+
+    size_t getThreadCount() const;
+
+  private:
+    class Worker;
+
+    LexerFactory _createLexer;
+    ParserFactory _createParser;
+    StartRule _startRule;
+    std::vector<std::unique_ptr<Worker>> _workers;
+
+    void run(size_t workerIndex, size_t workerCount, const std::vector<Input> &inputs, std::vector<Result> &results);
+    bool takeWork(size_t workerIndex, size_t workerCount, size_t &inputIndex);
+    void parseInput(Worker &worker, const Input &input, Result &result);
+
+    ParallelParseDriver(const ParallelParseDriver &) = delete;
+    ParallelParseDriver& operator = (const ParallelParseDriver &) = delete;
+  };
+
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
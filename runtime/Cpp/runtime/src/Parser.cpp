@@ -34,11 +34,14 @@
 #include "dfa/DFA.h"
 #include "ParserRuleContext.h"
 #include "tree/TerminalNode.h"
+#include "tree/ErrorNodeImpl.h"
+#include "tree/ParseTreeWalker.h"
 #include "Lexer.h"
 #include "atn/ParserATNSimulator.h"
 #include "misc/IntervalSet.h"
 #include "atn/RuleStartState.h"
 #include "DefaultErrorStrategy.h"
+#include "BailErrorStrategy.h"
 #include "atn/ATNDeserializer.h"
 #include "atn/RuleTransition.h"
 #include "atn/ATN.h"
@@ -47,7 +50,9 @@
 #include "tree/pattern/ParseTreePattern.h"
 
 #include "atn/ProfilingATNSimulator.h"
+#include "atn/TelemetryATNSimulator.h"
 #include "atn/ParseInfo.h"
+#include "IncrementalParser.h"
 
 #include "Parser.h"
 
@@ -55,24 +60,25 @@ using namespace org::antlr::v4::runtime;
 using namespace antlrcpp;
 
 std::map<std::vector<uint16_t>, atn::ATN> Parser::bypassAltsAtnCache;
+std::mutex Parser::bypassAltsAtnCacheLock;
 
 Parser::TraceListener::TraceListener(Parser *outerInstance) : outerInstance(outerInstance) {
 }
 
-void Parser::TraceListener::enterEveryRule(Ref<ParserRuleContext> ctx) {
+void Parser::TraceListener::enterEveryRule(ParserRuleContext *ctx) {
   std::cout << "enter   " << outerInstance->getRuleNames()[(size_t)ctx->getRuleIndex()]
     << ", LT(1)=" << outerInstance->_input->LT(1)->getText() << std::endl;
 }
 
-void Parser::TraceListener::visitTerminal(Ref<tree::TerminalNode> node) {
+void Parser::TraceListener::visitTerminal(tree::TerminalNode *node) {
   std::cout << "consume " << node->getSymbol() << " rule "
     << outerInstance->getRuleNames()[(size_t)outerInstance->getContext()->getRuleIndex()] << std::endl;
 }
 
-void Parser::TraceListener::visitErrorNode(Ref<tree::ErrorNode> /*node*/) {
+void Parser::TraceListener::visitErrorNode(tree::ErrorNode * /*node*/) {
 }
 
-void Parser::TraceListener::exitEveryRule(Ref<ParserRuleContext> ctx) {
+void Parser::TraceListener::exitEveryRule(ParserRuleContext *ctx) {
   std::cout << "exit    " << outerInstance->getRuleNames()[(size_t)ctx->getRuleIndex()]
     << ", LT(1)=" << outerInstance->_input->LT(1)->getText() << std::endl;
 }
@@ -80,19 +86,30 @@ void Parser::TraceListener::exitEveryRule(Ref<ParserRuleContext> ctx) {
 const Ref<Parser::TrimToSizeListener> Parser::TrimToSizeListener::INSTANCE =
   std::make_shared<Parser::TrimToSizeListener>();
 
-void Parser::TrimToSizeListener::enterEveryRule(Ref<ParserRuleContext> /*ctx*/) {
+void Parser::TrimToSizeListener::enterEveryRule(ParserRuleContext * /*ctx*/) {
 }
 
-void Parser::TrimToSizeListener::visitTerminal(Ref<tree::TerminalNode> /*node*/) {
+void Parser::TrimToSizeListener::visitTerminal(tree::TerminalNode * /*node*/) {
 }
 
-void Parser::TrimToSizeListener::visitErrorNode(Ref<tree::ErrorNode> /*node*/) {
+void Parser::TrimToSizeListener::visitErrorNode(tree::ErrorNode * /*node*/) {
 }
 
-void Parser::TrimToSizeListener::exitEveryRule(Ref<ParserRuleContext> ctx) {
+void Parser::TrimToSizeListener::exitEveryRule(ParserRuleContext *ctx) {
   ctx->children.shrink_to_fit();
 }
 
+Parser::TwoStageStatistics::TwoStageStatistics()
+  : parses(0), fallbacks(0), lastParseFellBack(false), lastSLLTime(0), lastLLTime(0) {
+}
+
+double Parser::TwoStageStatistics::getFallbackRate() const {
+  if (parses == 0) {
+    return 0;
+  }
+  return (double)fallbacks / parses;
+}
+
 Parser::Parser(TokenStream *input) {
   InitializeInstanceFields();
   setInputStream(input);
@@ -107,10 +124,13 @@ void Parser::reset() {
   }
   _errHandler->reset(this); // Watch out, this is not shared_ptr.reset().
 
+  _ctx = nullptr;
   _syntaxErrors = 0;
+  _matchedEOF = false;
   setTrace(false);
   _precedenceStack.clear();
   _precedenceStack.push_back(0);
+  _parseTreeArena.reset();
   atn::ATNSimulator *interpreter = getInterpreter<atn::ParserATNSimulator>();
   if (interpreter != nullptr) {
     interpreter->reset();
@@ -130,7 +150,7 @@ Ref<Token> Parser::match(int ttype) {
     if (_buildParseTrees && t->getTokenIndex() == -1) {
       // we must have conjured up a new token during single token insertion
       // if it's not the current symbol
-      _ctx->addErrorNode(t);
+      _ctx->addChild(createErrorNode(t));
     }
   }
   return t;
@@ -146,7 +166,7 @@ Ref<Token> Parser::matchWildcard() {
     if (_buildParseTrees && t->getTokenIndex() == -1) {
       // we must have conjured up a new token during single token insertion
       // if it's not the current symbol
-      _ctx->addErrorNode(t);
+      _ctx->addChild(createErrorNode(t));
     }
   }
 
@@ -176,6 +196,14 @@ bool Parser::getTrimParseTree() {
   return std::find(getParseListeners().begin(), getParseListeners().end(), TrimToSizeListener::INSTANCE) != getParseListeners().end();
 }
 
+void Parser::setUseParseTreeArena(bool useArena) {
+  _useParseTreeArena = useArena;
+}
+
+bool Parser::getUseParseTreeArena() {
+  return _useParseTreeArena;
+}
+
 std::vector<Ref<tree::ParseTreeListener>> Parser::getParseListeners() {
   return _parseListeners;
 }
@@ -202,17 +230,17 @@ void Parser::removeParseListeners() {
 }
 
 void Parser::triggerEnterRuleEvent() {
-  for (auto listener : _parseListeners) {
-    listener->enterEveryRule(_ctx);
-    _ctx->enterRule(listener);
+  for (auto &listener : _parseListeners) {
+    listener->enterEveryRule(_ctx.get());
+    _ctx->enterRule(listener.get());
   }
 }
 
 void Parser::triggerExitRuleEvent() {
   // reverse order walk of listeners
   for (auto it = _parseListeners.rbegin(); it != _parseListeners.rend(); ++it) {
-    _ctx->exitRule(*it);
-    (*it)->exitEveryRule(_ctx);
+    _ctx->exitRule(it->get());
+    (*it)->exitEveryRule(_ctx.get());
   }
 }
 
@@ -231,7 +259,7 @@ const atn::ATN& Parser::getATNWithBypassAlts() {
     throw UnsupportedOperationException("The current parser does not support an ATN with bypass alternatives.");
   }
 
-  std::lock_guard<std::recursive_mutex> lck(mtx);
+  std::lock_guard<std::mutex> lck(bypassAltsAtnCacheLock);
 
   // XXX: using the entire serialized ATN as key into the map is a big resource waste.
   //      How large can that thing become?
@@ -272,6 +300,92 @@ void Parser::setErrorHandler(Ref<ANTLRErrorStrategy> handler) {
   _errHandler = handler;
 }
 
+Ref<ParserRuleContext> Parser::parseTwoStage(const std::function<Ref<ParserRuleContext>()> &startRule) {
+  atn::ParserATNSimulator *interpreter = getInterpreter<atn::ParserATNSimulator>();
+  atn::PredictionMode mode = interpreter->getPredictionMode();
+  Ref<ANTLRErrorStrategy> errorHandler = _errHandler;
+  ProxyErrorListener errorListeners = getErrorListenerDispatch();
+  std::vector<Ref<tree::ParseTreeListener>> parseListeners = _parseListeners;
+  _input->LT(1); // Buffered streams report a valid index only after the first look ahead.
+  size_t startIndex = _input->index();
+  int syntaxErrors = _syntaxErrors;
+
+  auto restore = [&]() {
+    getInterpreter<atn::ParserATNSimulator>()->setPredictionMode(mode);
+    _errHandler = errorHandler;
+    getErrorListenerDispatch() = errorListeners;
+    _parseListeners = parseListeners;
+  };
+
+  _twoStageStatistics.parses++;
+  _twoStageStatistics.lastParseFellBack = false;
+  _twoStageStatistics.lastSLLTime = std::chrono::steady_clock::duration(0);
+  _twoStageStatistics.lastLLTime = std::chrono::steady_clock::duration(0);
+
+  // Without a tree the events of a successful first stage could not be replayed.
+  bool skipSLL = !parseListeners.empty() && !_buildParseTrees;
+
+  Ref<ParserRuleContext> result;
+  bool bailedOut = false;
+  if (!skipSLL) {
+    // Stage 1: SLL prediction, giving up on the first syntax error.
+    interpreter->setPredictionMode(atn::PredictionMode::SLL);
+    _errHandler = std::make_shared<BailErrorStrategy>();
+    removeErrorListeners();
+    _parseListeners.clear();
+
+    auto start = std::chrono::steady_clock::now();
+    try {
+      result = startRule();
+    } catch (ParseCancellationException &) {
+      bailedOut = true;
+    } catch (RecognitionException &) {
+      bailedOut = true; // Thrown directly by the bail strategy if nested exceptions are not available.
+    } catch (...) {
+      restore();
+      throw;
+    }
+    _twoStageStatistics.lastSLLTime = std::chrono::steady_clock::now() - start;
+    restore();
+
+    if (!bailedOut) {
+      for (auto &listener : _parseListeners) {
+        tree::ParseTreeWalker::DEFAULT->walk(listener, result);
+      }
+      return result;
+    }
+
+    // Stage 2: the SLL failure might be an artefact of the weaker prediction, so parse again with full LL.
+    _twoStageStatistics.fallbacks++;
+    _twoStageStatistics.lastParseFellBack = true;
+    rewindForTwoStage(startIndex, syntaxErrors);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  if (mode == atn::PredictionMode::SLL) {
+    getInterpreter<atn::ParserATNSimulator>()->setPredictionMode(atn::PredictionMode::LL);
+  }
+  try {
+    result = startRule();
+  } catch (...) {
+    getInterpreter<atn::ParserATNSimulator>()->setPredictionMode(mode);
+    _twoStageStatistics.lastLLTime = std::chrono::steady_clock::now() - start;
+    throw;
+  }
+  getInterpreter<atn::ParserATNSimulator>()->setPredictionMode(mode);
+  _twoStageStatistics.lastLLTime = std::chrono::steady_clock::now() - start;
+
+  return result;
+}
+
+const Parser::TwoStageStatistics& Parser::getTwoStageStatistics() const {
+  return _twoStageStatistics;
+}
+
+void Parser::resetTwoStageStatistics() {
+  _twoStageStatistics = TwoStageStatistics();
+}
+
 IntStream* Parser::getInputStream() {
   return getTokenStream();
 }
@@ -317,17 +431,19 @@ Ref<Token> Parser::consume() {
   bool hasListener = _parseListeners.size() > 0 && !_parseListeners.empty();
   if (_buildParseTrees || hasListener) {
     if (_errHandler->inErrorRecoveryMode(this)) {
-      Ref<tree::ErrorNode> node = _ctx->addErrorNode(o);
+      Ref<tree::ErrorNode> node = createErrorNode(o);
+      _ctx->addChild(node);
       if (_parseListeners.size() > 0) {
-        for (auto listener : _parseListeners) {
-          listener->visitErrorNode(node);
+        for (auto &listener : _parseListeners) {
+          listener->visitErrorNode(node.get());
         }
       }
     } else {
-      Ref<tree::TerminalNode> node = _ctx->addChild(o);
+      Ref<tree::TerminalNode> node = createTerminalNode(o);
+      _ctx->addChild(node);
       if (_parseListeners.size() > 0) {
-        for (auto listener : _parseListeners) {
-          listener->visitTerminal(node);
+        for (auto &listener : _parseListeners) {
+          listener->visitTerminal(node.get());
         }
       }
     }
@@ -344,6 +460,18 @@ void Parser::addContextToParseTree() {
   parent->addChild(_ctx);
 }
 
+Ref<tree::TerminalNode> Parser::createTerminalNode(Ref<Token> t) {
+  Ref<tree::TerminalNodeImpl> node = createTreeNode<tree::TerminalNodeImpl>(t);
+  node->parent = _ctx;
+  return node;
+}
+
+Ref<tree::ErrorNode> Parser::createErrorNode(Ref<Token> t) {
+  Ref<tree::ErrorNodeImpl> node = createTreeNode<tree::ErrorNodeImpl>(t);
+  node->parent = _ctx;
+  return node;
+}
+
 void Parser::enterRule(Ref<ParserRuleContext> localctx, int state, int /*ruleIndex*/) {
   setState(state);
   _ctx = localctx;
@@ -373,6 +501,49 @@ void Parser::exitRule() {
   _ctx = std::dynamic_pointer_cast<ParserRuleContext>(_ctx->parent.lock());
 }
 
+Ref<ParserRuleContext> Parser::enterReusableRule(Ref<ParserRuleContext> localctx, int state, int ruleIndex) {
+  if (_incrementalParser == nullptr || !_buildParseTrees) {
+    enterRule(localctx, state, ruleIndex);
+    return nullptr;
+  }
+
+  // As enterRule(), but the enter event waits until it is known which context is entered.
+  setState(state);
+  _ctx = localctx;
+  _ctx->start = _input->LT(1);
+  addContextToParseTree();
+
+  Ref<ParserRuleContext> subtree = _incrementalParser->takeSubtree(localctx);
+  if (subtree != nullptr) {
+    // Put the subtree where localctx was added.
+    Ref<ParserRuleContext> parent = std::dynamic_pointer_cast<ParserRuleContext>(localctx->parent.lock());
+    if (parent != nullptr && !parent->children.empty() && parent->children.back().get() == localctx.get()) {
+      parent->children.back() = subtree;
+    }
+    subtree->parent = localctx->parent;
+
+    // Continue after the last token of the subtree (which may precede its start token, if it is empty). Matching its
+    // tokens would have ended any error recovery in progress.
+    size_t start = (size_t)subtree->start->getTokenIndex();
+    if (subtree->stop != nullptr && subtree->stop->getTokenIndex() >= (int)start) {
+      _input->seek((size_t)subtree->stop->getTokenIndex() + 1);
+      _errHandler->reportMatch(this);
+    } else {
+      _input->seek(start);
+    }
+    _ctx = subtree;
+  }
+
+  if (_parseListeners.size() > 0) {
+    triggerEnterRuleEvent();
+  }
+  return subtree;
+}
+
+void Parser::setIncrementalParser(IncrementalParser *incrementalParser) {
+  _incrementalParser = incrementalParser;
+}
+
 void Parser::enterOuterAlt(Ref<ParserRuleContext> localctx, int altNum) {
   localctx->setAltNumber(altNum);
 
@@ -483,34 +654,27 @@ bool Parser::inContext(const std::string &/*context*/) {
 
 bool Parser::isExpectedToken(int symbol) {
   const atn::ATN &atn = getInterpreter<atn::ParserATNSimulator>()->atn;
-  Ref<ParserRuleContext> ctx = _ctx;
+  Ref<RuleContext> ctx = _ctx;
   atn::ATNState *s = atn.states[(size_t)getState()];
-  misc::IntervalSet following = atn.nextTokens(s);
 
-  if (following.contains(symbol)) {
+  if (atn.isInNextTokens(s, symbol)) {
     return true;
   }
 
-  if (!following.contains(Token::EPSILON)) {
-    return false;
-  }
-
-  while (ctx && ctx->invokingState >= 0 && following.contains(Token::EPSILON)) {
+  // Bit tests on the precomputed sets only, no set is copied or allocated here.
+  bool reachesRuleEnd = atn.isInNextTokens(s, Token::EPSILON);
+  while (reachesRuleEnd && ctx && ctx->invokingState >= 0) {
     atn::ATNState *invokingState = atn.states[(size_t)ctx->invokingState];
     atn::RuleTransition *rt = static_cast<atn::RuleTransition*>(invokingState->transition(0));
-    following = atn.nextTokens(rt->followState);
-    if (following.contains(symbol)) {
+    if (atn.isInNextTokens(rt->followState, symbol)) {
       return true;
     }
+    reachesRuleEnd = atn.isInNextTokens(rt->followState, Token::EPSILON);
 
-    ctx = std::dynamic_pointer_cast<ParserRuleContext>(ctx->parent.lock());
+    ctx = ctx->parent.lock();
   }
 
-  if (following.contains(Token::EPSILON) && symbol == EOF) {
-    return true;
-  }
-
-  return false;
+  return reachesRuleEnd && symbol == EOF;
 }
 
 bool Parser::isMatchedEOF() const {
@@ -610,7 +774,7 @@ Ref<atn::ParseInfo> Parser::getParseInfo() const {
 }
 
 void Parser::setProfile(bool profile) {
-  atn::ParserATNSimulator *interp = getInterpreter<atn::ProfilingATNSimulator>();
+  atn::ParserATNSimulator *interp = getInterpreter<atn::ParserATNSimulator>();
   atn::PredictionMode saveMode = interp->getPredictionMode();
   if (profile) {
     if (!is<atn::ProfilingATNSimulator *>(interp)) {
@@ -624,6 +788,30 @@ void Parser::setProfile(bool profile) {
   getInterpreter<atn::ParserATNSimulator>()->setPredictionMode(saveMode);
 }
 
+void Parser::setTelemetry(bool telemetry, size_t sampleInterval) {
+  atn::ParserATNSimulator *interp = getInterpreter<atn::ParserATNSimulator>();
+  atn::PredictionMode saveMode = interp->getPredictionMode();
+  if (telemetry) {
+    if (!is<atn::TelemetryATNSimulator *>(interp)) {
+      /* mem-check: replacing existing interpreter which gets deleted. */
+      setInterpreter(new atn::TelemetryATNSimulator(this, sampleInterval));
+    }
+  } else if (is<atn::TelemetryATNSimulator *>(interp)) {
+    /* mem-check: replacing existing interpreter which gets deleted. */
+    atn::ParserATNSimulator *sim = new atn::ParserATNSimulator(this, getATN(), interp->decisionToDFA, interp->getSharedContextCache());
+    setInterpreter(sim);
+  }
+  getInterpreter<atn::ParserATNSimulator>()->setPredictionMode(saveMode);
+}
+
+Ref<atn::ParseTelemetry> Parser::getParseTelemetry() const {
+  atn::TelemetryATNSimulator *interp = getInterpreter<atn::TelemetryATNSimulator>();
+  if (interp != nullptr) {
+    return std::make_shared<atn::ParseTelemetry>(interp->getTelemetry());
+  }
+  return nullptr;
+}
+
 void Parser::setTrace(bool trace) {
   if (!trace) {
     if (_tracer)
@@ -641,13 +829,27 @@ bool Parser::isTrace() const {
   return _tracer != nullptr;
 }
 
+void Parser::rewindForTwoStage(size_t startIndex, int syntaxErrors) {
+  // Like reset(), but resumes at the token the first stage started with and keeps tracing and the error count.
+  _input->seek(startIndex);
+  _errHandler->reset(this);
+  _ctx = nullptr;
+  _syntaxErrors = syntaxErrors;
+  _matchedEOF = false;
+  _precedenceStack.clear();
+  _precedenceStack.push_back(0);
+  getInterpreter<atn::ParserATNSimulator>()->reset();
+}
+
 void Parser::InitializeInstanceFields() {
   _errHandler = std::make_shared<DefaultErrorStrategy>();
   _precedenceStack.clear();
   _precedenceStack.push_back(0);
   _buildParseTrees = true;
+  _useParseTreeArena = false;
   _syntaxErrors = 0;
   _matchedEOF = false;
   _input = nullptr;
+  _incrementalParser = nullptr;
 }
 
@@ -36,6 +36,7 @@
 #include "TokenStream.h"
 #include "TokenSource.h"
 #include "misc/Interval.h"
+#include "support/Arena.h"
 
 namespace org {
 namespace antlr {
@@ -51,10 +52,10 @@ namespace runtime {
       TraceListener(Parser *outerInstance);
       virtual ~TraceListener() {};
 
-      virtual void enterEveryRule(Ref<ParserRuleContext> ctx) override;
-      virtual void visitTerminal(Ref<tree::TerminalNode> node) override;
-      virtual void visitErrorNode(Ref<tree::ErrorNode> node) override;
-      virtual void exitEveryRule(Ref<ParserRuleContext> ctx) override;
+      virtual void enterEveryRule(ParserRuleContext *ctx) override;
+      virtual void visitTerminal(tree::TerminalNode *node) override;
+      virtual void visitErrorNode(tree::ErrorNode *node) override;
+      virtual void exitEveryRule(ParserRuleContext *ctx) override;
 
     private:
       Parser *const outerInstance;
@@ -66,10 +67,32 @@ namespace runtime {
 
       virtual ~TrimToSizeListener() {};
 
-      virtual void enterEveryRule(Ref<ParserRuleContext> ctx) override;
-      virtual void visitTerminal(Ref<tree::TerminalNode> node) override;
-      virtual void visitErrorNode(Ref<tree::ErrorNode> node) override;
-      virtual void exitEveryRule(Ref<ParserRuleContext> ctx) override;
+      virtual void enterEveryRule(ParserRuleContext *ctx) override;
+      virtual void visitTerminal(tree::TerminalNode *node) override;
+      virtual void visitErrorNode(tree::ErrorNode *node) override;
+      virtual void exitEveryRule(ParserRuleContext *ctx) override;
+    };
+
+    /// Counters collected by parseTwoStage.
+    class ANTLR4CPP_PUBLIC TwoStageStatistics {
+    public:
+      TwoStageStatistics();
+
+      /// The number of two-stage parses run so far.
+      size_t parses;
+
+      /// The number of those parses which failed in SLL mode and were repeated with full LL prediction.
+      size_t fallbacks;
+
+      /// Whether the last parse needed the LL stage.
+      bool lastParseFellBack;
+
+      /// The time spent in the SLL and LL stages of the last parse.
+      std::chrono::steady_clock::duration lastSLLTime;
+      std::chrono::steady_clock::duration lastLLTime;
+
+      /// Returns the share of parses which fell back to LL, between 0 and 1.
+      double getFallbackRate() const;
     };
 
     Parser(TokenStream *input);
@@ -153,6 +176,25 @@ namespace runtime {
     /// using the default <seealso cref="Parser.TrimToSizeListener"/> during the parse process. </returns>
     virtual bool getTrimParseTree();
 
+    /// Allocate the nodes of the parse tree (rule contexts and terminal nodes) from an arena owned by this parser.
+    /// This makes building and in particular destroying large parse trees much cheaper. The nodes are still reference
+    /// counted and keep their part of the arena alive, so the tree stays valid after the parser is gone. Its memory goes
+    /// back to the heap a chunk at a time once the nodes are released. The default value is {@code false}.
+    virtual void setUseParseTreeArena(bool useArena);
+
+    /// <returns> {@code true} if parse tree nodes are allocated from the parser's arena. </returns>
+    virtual bool getUseParseTreeArena();
+
+    /// Creates a parse tree node, in the parse tree arena if that is enabled. Generated parsers create their rule
+    /// contexts with this.
+    template<typename T, typename... Args>
+    Ref<T> createTreeNode(Args&&... args) {
+      if (_useParseTreeArena) {
+        return _parseTreeArena.create<T>(std::forward<Args>(args)...);
+      }
+      return std::make_shared<T>(std::forward<Args>(args)...);
+    }
+
     virtual std::vector<Ref<tree::ParseTreeListener>> getParseListeners();
 
     /// <summary>
@@ -257,6 +299,34 @@ namespace runtime {
     virtual Ref<ANTLRErrorStrategy> getErrorHandler();
     virtual void setErrorHandler(Ref<ANTLRErrorStrategy> handler);
 
+    /// Runs {@code startRule} (usually a lambda calling a start rule of this parser) with two-stage parsing:
+    /// the input is first parsed in SLL prediction mode with a <seealso cref="BailErrorStrategy"/>, which is much
+    /// faster and succeeds for almost all input. Only if that fails the token stream is rewound to where the parse
+    /// began and the rule runs again with full LL prediction, the configured error strategy and error listeners.
+    /// The result is the same as with an LL-only parse, including the reported syntax errors.
+    ///
+    /// Error listeners only see errors of the second stage. Parse listeners are detached during the first stage:
+    /// if it succeeds they get the events from a walk of the finished tree (for left-recursive rules in tree order,
+    /// not in the order a parse sends them), after a fallback only those of the second stage. Without parse tree
+    /// building there is nothing to replay, so with parse listeners the rule then runs with LL prediction only.
+    /// Exceptions other than the bail out of the first stage are passed on after the parser's configuration has
+    /// been restored.
+    virtual Ref<ParserRuleContext> parseTwoStage(const std::function<Ref<ParserRuleContext>()> &startRule);
+
+    /// Convenience overload for a start rule without parameters of a generated parser, for instance
+    /// {@code parser.parseTwoStage(&MyParser::compilationUnit)}.
+    template<typename T, typename P>
+    Ref<T> parseTwoStage(Ref<T> (P::*startRule)()) {
+      P *parser = static_cast<P *>(this);
+      return std::static_pointer_cast<T>(parseTwoStage([parser, startRule]() -> Ref<ParserRuleContext> {
+        return (parser->*startRule)();
+      }));
+    }
+
+    /// Statistics about all parses run with parseTwoStage, in particular how often the LL fallback was needed.
+    virtual const TwoStageStatistics& getTwoStageStatistics() const;
+    virtual void resetTwoStageStatistics();
+
     virtual IntStream* getInputStream() override;
     void setInputStream(IntStream *input) override;
 
@@ -306,6 +376,17 @@ namespace runtime {
 
     virtual void exitRule();
 
+    /// Called instead of enterRule() by generated rule functions (and by ParserInterpreter) for rules without
+    /// arguments. If an IncrementalParser is parsing with this parser and the previous parse tree has a subtree which
+    /// can stand in for the rule, that subtree replaces localctx in the parse tree, the input is moved past it and it
+    /// becomes the current context. The caller then leaves the rule with exitRule() as usual, without parsing it.
+    /// Parse listeners get the enter event for the context which ends up in the tree, so it matches the exit event.
+    /// Returns the reused subtree, or null if the rule is parsed as usual.
+    virtual Ref<ParserRuleContext> enterReusableRule(Ref<ParserRuleContext> localctx, int state, int ruleIndex);
+
+    /// Set by an IncrementalParser while it parses with this parser (null otherwise). Not owned.
+    virtual void setIncrementalParser(IncrementalParser *incrementalParser);
+
     virtual void enterOuterAlt(Ref<ParserRuleContext> localctx, int altNum);
 
     /**
@@ -393,6 +474,15 @@ namespace runtime {
      * @since 4.3
      */
     void setProfile(bool profile);
+
+    /// Enables or disables the collection of cheap prediction counters and sampled rule invocation stacks for this
+    /// parser (see atn::TelemetryATNSimulator). Like setProfile() this replaces the interpreter, the DFA stays shared.
+    /// A stack sample is taken every sampleInterval predictions, 0 disables sampling. Enabling telemetry again while it
+    /// is on keeps the current simulator, with its data and sample interval.
+    void setTelemetry(bool telemetry, size_t sampleInterval = 64);
+
+    /// A snapshot of the telemetry collected so far, or null if telemetry is not enabled.
+    Ref<atn::ParseTelemetry> getParseTelemetry() const;
     
     /// <summary>
     /// During a parse is sometimes useful to listen in on the rule entry and exit
@@ -455,12 +545,20 @@ namespace runtime {
     
     virtual void addContextToParseTree();
 
+    /// Creates the parse tree node for a token matched in the current context. Does not add it to the context.
+    virtual Ref<tree::TerminalNode> createTerminalNode(Ref<Token> t);
+
+    /// Creates the parse tree node for a token consumed during error recovery in the current context. Does not add it
+    /// to the context.
+    virtual Ref<tree::ErrorNode> createErrorNode(Ref<Token> t);
+
   private:
     /// This field maps from the serialized ATN string to the deserialized <seealso cref="ATN"/> with
     /// bypass alternatives.
     ///
     /// <seealso cref= ATNDeserializationOptions#isGenerateRuleBypassTransitions() </seealso>
     static std::map<std::vector<uint16_t>, atn::ATN> bypassAltsAtnCache;
+    static std::mutex bypassAltsAtnCacheLock; // Shared by all parsers, like the cache.
 
     /// When setTrace(true) is called, a reference to the
     /// TraceListener is stored here so it can be easily removed in a
@@ -469,6 +567,17 @@ namespace runtime {
     /// other parser methods.
     Ref<TraceListener> _tracer;
 
+    bool _useParseTreeArena;
+    antlrcpp::Arena _parseTreeArena;
+
+    IncrementalParser *_incrementalParser;
+
+    TwoStageStatistics _twoStageStatistics;
+
+    /// Prepares the parser for running the start rule again from the given token index, after the SLL stage
+    /// of parseTwoStage gave up.
+    void rewindForTwoStage(size_t startIndex, int syntaxErrors);
+
     void InitializeInstanceFields();
   };
 
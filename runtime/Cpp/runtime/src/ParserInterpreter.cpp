@@ -30,6 +30,7 @@
  */
 
 #include "dfa/DFA.h"
+#include "atn/PredictionContextCache.h"
 #include "atn/RuleStartState.h"
 #include "InterpreterRuleContext.h"
 #include "atn/ParserATNSimulator.h"
@@ -132,6 +133,7 @@ Ref<ParserRuleContext> ParserInterpreter::parse(int startRuleIndex) {
             Ref<ParserRuleContext> result = _ctx;
             auto parentContext = _parentContextStack.top();
             _parentContextStack.pop();
+            _recursionContexts.pop();
             unrollRecursionContexts(parentContext.first);
             return result;
           } else {
@@ -161,6 +163,7 @@ Ref<ParserRuleContext> ParserInterpreter::parse(int startRuleIndex) {
 
 void ParserInterpreter::enterRecursionRule(Ref<ParserRuleContext> localctx, int state, int ruleIndex, int precedence) {
   _parentContextStack.push({ _ctx, localctx->invokingState });
+  _recursionContexts.push(localctx);
   Parser::enterRecursionRule(localctx, state, ruleIndex, precedence);
 }
 
@@ -199,6 +202,7 @@ void ParserInterpreter::visitState(atn::ATNState *p) {
         Ref<InterpreterRuleContext> localctx = createInterpreterRuleContext(_parentContextStack.top().first,
           _parentContextStack.top().second, (int)_ctx->getRuleIndex());
         pushNewRecursionContext(localctx, _atn.ruleToStartState[p->ruleIndex]->stateNumber, (int)_ctx->getRuleIndex());
+        _recursionContexts.top() = localctx;
       }
       break;
 
@@ -227,7 +231,12 @@ void ParserInterpreter::visitState(atn::ATNState *p) {
       if (ruleStartState->isLeftRecursiveRule) {
         enterRecursionRule(newctx, ruleStartState->stateNumber, ruleIndex, ((atn::RuleTransition*)(transition))->precedence);
       } else {
-        enterRule(newctx, transition->target->stateNumber, ruleIndex);
+        if (enterReusableRule(newctx, transition->target->stateNumber, ruleIndex) != nullptr) {
+          // Continue after the rule, as visitRuleStopState() would.
+          exitRule();
+          setState(((atn::RuleTransition*)(transition))->followState->stateNumber);
+          return;
+        }
       }
     }
       break;
@@ -280,7 +289,7 @@ int ParserInterpreter::visitDecisionState(DecisionState *p) {
 
 Ref<InterpreterRuleContext> ParserInterpreter::createInterpreterRuleContext(std::weak_ptr<ParserRuleContext> parent,
   int invokingStateNumber, int ruleIndex) {
-  return std::make_shared<InterpreterRuleContext>(parent, invokingStateNumber, ruleIndex);
+  return createTreeNode<InterpreterRuleContext>(parent, invokingStateNumber, ruleIndex);
 }
 
 void ParserInterpreter::visitRuleStopState(atn::ATNState *p) {
@@ -288,6 +297,7 @@ void ParserInterpreter::visitRuleStopState(atn::ATNState *p) {
   if (ruleStartState->isLeftRecursiveRule) {
     std::pair<Ref<ParserRuleContext>, int> parentContext = _parentContextStack.top();
     _parentContextStack.pop();
+    _recursionContexts.pop();
 
     unrollRecursionContexts(parentContext.first);
     setState(parentContext.second);
@@ -160,6 +160,11 @@ namespace runtime {
      *  associated with left operand of an alt like "expr '*' expr".
      */
     std::stack<std::pair<Ref<ParserRuleContext>, int>> _parentContextStack;
+
+    /** The innermost context of each active left-recursive rule invocation (the generated
+     *  function's _localctx). Until the rule is unrolled only weak parent links point at it.
+     */
+    std::stack<Ref<ParserRuleContext>> _recursionContexts;
     
     /** We need a map from (decision,inputIndex)->forced alt for computing ambiguous
      *  parse trees. For now, we allow exactly one override.
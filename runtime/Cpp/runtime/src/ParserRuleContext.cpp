@@ -41,6 +41,7 @@ using namespace org::antlr::v4::runtime;
 using namespace antlrcpp;
 
 ParserRuleContext::ParserRuleContext() {
+  treeType = tree::ParseTreeType::RULE_NODE;
 }
 
 void ParserRuleContext::copyFrom(Ref<ParserRuleContext> ctx) {
@@ -54,12 +55,13 @@ void ParserRuleContext::copyFrom(Ref<ParserRuleContext> ctx) {
 
 ParserRuleContext::ParserRuleContext(std::weak_ptr<ParserRuleContext> parent, int invokingStateNumber)
   : RuleContext(parent, invokingStateNumber) {
+  treeType = tree::ParseTreeType::RULE_NODE;
 }
 
-void ParserRuleContext::enterRule(Ref<tree::ParseTreeListener> /*listener*/) {
+void ParserRuleContext::enterRule(tree::ParseTreeListener * /*listener*/) {
 }
 
-void ParserRuleContext::exitRule(Ref<tree::ParseTreeListener> /*listener*/) {
+void ParserRuleContext::exitRule(tree::ParseTreeListener * /*listener*/) {
 }
 
 Ref<tree::TerminalNode> ParserRuleContext::addChild(Ref<tree::TerminalNode> t) {
@@ -102,14 +104,11 @@ Ref<tree::TerminalNode> ParserRuleContext::getToken(int ttype, std::size_t i) {
   }
 
   size_t j = 0; // what token with ttype have we found?
-  for (auto o : children) {
-    if (is<tree::TerminalNode>(o)) {
-      Ref<tree::TerminalNode> tnode = std::dynamic_pointer_cast<tree::TerminalNode>(o);
-      Ref<Token> symbol = tnode->getSymbol();
-      if (symbol->getType() == ttype) {
-        if (j++ == i) {
-          return tnode;
-        }
+  for (auto &o : children) {
+    tree::TerminalNode *tnode = dynamic_cast<tree::TerminalNode *>(o.get());
+    if (tnode != nullptr && tnode->getSymbol()->getType() == ttype) {
+      if (j++ == i) {
+        return Ref<tree::TerminalNode>(o, tnode);
       }
     }
   }
@@ -120,12 +119,9 @@ Ref<tree::TerminalNode> ParserRuleContext::getToken(int ttype, std::size_t i) {
 std::vector<Ref<tree::TerminalNode>> ParserRuleContext::getTokens(int ttype) {
   std::vector<Ref<tree::TerminalNode>> tokens;
   for (auto &o : children) {
-    if (is<tree::TerminalNode>(o)) {
-      Ref<tree::TerminalNode> tnode = std::dynamic_pointer_cast<tree::TerminalNode>(o);
-      Ref<Token> symbol = tnode->getSymbol();
-      if (symbol->getType() == ttype) {
-        tokens.push_back(tnode);
-      }
+    tree::TerminalNode *tnode = dynamic_cast<tree::TerminalNode *>(o.get());
+    if (tnode != nullptr && tnode->getSymbol()->getType() == ttype) {
+      tokens.push_back(Ref<tree::TerminalNode>(o, tnode));
     }
   }
 
@@ -110,8 +110,8 @@ namespace runtime {
 
     // Double dispatch methods for listeners
 
-    virtual void enterRule(Ref<tree::ParseTreeListener> listener);
-    virtual void exitRule(Ref<tree::ParseTreeListener> listener);
+    virtual void enterRule(tree::ParseTreeListener *listener);
+    virtual void exitRule(tree::ParseTreeListener *listener);
 
     /// Does not set parent link; other add methods do that.
     virtual Ref<tree::TerminalNode> addChild(Ref<tree::TerminalNode> t);
@@ -140,9 +140,10 @@ namespace runtime {
 
       size_t j = 0; // what element have we found with ctxType?
       for (auto &child : children) {
-        if (antlrcpp::is<T>(child)) {
+        T *context = dynamic_cast<T *>(child.get());
+        if (context != nullptr) {
           if (j++ == i) {
-            return std::dynamic_pointer_cast<T>(child);
+            return Ref<T>(child, context); // Share ownership with the child, no need for a second cast.
           }
         }
       }
@@ -153,8 +154,9 @@ namespace runtime {
     std::vector<Ref<T>> getRuleContexts() {
       std::vector<Ref<T>> contexts;
       for (auto &child : children) {
-        if (antlrcpp::is<T>(child)) {
-          contexts.push_back(std::dynamic_pointer_cast<T>(child));
+        T *context = dynamic_cast<T *>(child.get());
+        if (context != nullptr) {
+          contexts.push_back(Ref<T>(child, context));
         }
       }
 
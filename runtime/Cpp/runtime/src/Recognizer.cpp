@@ -47,6 +47,7 @@ using namespace org::antlr::v4::runtime;
 
 std::map<Ref<dfa::Vocabulary>, std::map<std::string, size_t>> Recognizer::_tokenTypeMapCache;
 std::map<std::vector<std::string>, std::map<std::string, size_t>> Recognizer::_ruleIndexMapCache;
+std::mutex Recognizer::_cacheLock;
 
 Recognizer::Recognizer() {
   InitializeInstanceFields();
@@ -60,7 +61,7 @@ Ref<dfa::Vocabulary> Recognizer::getVocabulary() const {
 std::map<std::string, size_t> Recognizer::getTokenTypeMap() {
   Ref<dfa::Vocabulary> vocabulary = getVocabulary();
 
-  std::lock_guard<std::recursive_mutex> lck(mtx);
+  std::lock_guard<std::mutex> lck(_cacheLock);
   std::map<std::string, size_t> result;
   auto iterator = _tokenTypeMapCache.find(vocabulary);
   if (iterator != _tokenTypeMapCache.end()) {
@@ -90,7 +91,7 @@ std::map<std::string, size_t> Recognizer::getRuleIndexMap() {
     throw "The current recognizer does not provide a list of rule names.";
   }
 
-  std::lock_guard<std::recursive_mutex> lck(mtx);
+  std::lock_guard<std::mutex> lck(_cacheLock);
   std::map<std::string, size_t> result;
   auto iterator = _ruleIndexMapCache.find(ruleNames);
   if (iterator != _ruleIndexMapCache.end()) {
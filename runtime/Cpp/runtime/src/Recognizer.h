@@ -180,6 +180,7 @@ namespace runtime {
   private:
     static std::map<Ref<dfa::Vocabulary>, std::map<std::string, size_t>> _tokenTypeMapCache;
     static std::map<std::vector<std::string>, std::map<std::string, size_t>> _ruleIndexMapCache;
+    static std::mutex _cacheLock; // The caches are shared by all recognizers, so a per instance lock isn't enough.
 
     ProxyErrorListener _proxListener; // Manages a collection of listeners.
 
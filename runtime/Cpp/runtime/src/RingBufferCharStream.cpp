@@ -0,0 +1,382 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef _WIN32
+  #include <io.h>
+#else
+  #include <errno.h>
+  #include <unistd.h>
+#endif
+
+#include "misc/Interval.h"
+#include "Exceptions.h"
+#include "support/StringUtils.h"
+
+#include "RingBufferCharStream.h"
+
+using namespace antlrcpp;
+using namespace org::antlr::v4::runtime;
+
+static const char32_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+static size_t readFromDescriptor(int fileDescriptor, char *buffer, size_t size) {
+  while (true) {
+#ifdef _WIN32
+    int count = _read(fileDescriptor, buffer, (unsigned int)std::min(size, (size_t)INT_MAX));
+#else
+    ssize_t count = read(fileDescriptor, buffer, size);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+#endif
+    if (count < 0) {
+      throw IOException("Cannot read from file descriptor " + std::to_string(fileDescriptor));
+    }
+    return (size_t)count;
+  }
+}
+
+RingBufferCharStream::RingBufferCharStream(ReadFunction read, bool prefetch, size_t chunkSize)
+  : _bufferStart(0), _bufferEnd(0), _currentCharIndex(0), _numMarkers(0), _markIndex(0), _lastChar(EOF),
+    _lastCharBufferStart(EOF), _eof(false), _read(read), _chunkSize(std::max(chunkSize, (size_t)1)),
+    _prefetch(prefetch), _pendingCount(0) {
+
+  // A chunk never decodes to more code points than it has bytes.
+  size_t capacity = 1;
+  while (capacity < 2 * (_chunkSize + PENDING_ROOM)) {
+    capacity <<= 1;
+  }
+  _ring.resize(capacity);
+  _mask = capacity - 1;
+
+  _chunk.resize(PENDING_ROOM + _chunkSize);
+  if (_prefetch) {
+    _nextChunk.resize(PENDING_ROOM + _chunkSize);
+    startPrefetch();
+  }
+}
+
+RingBufferCharStream::RingBufferCharStream(int fileDescriptor, bool prefetch, size_t chunkSize)
+  : RingBufferCharStream([fileDescriptor](char *buffer, size_t size) {
+      return readFromDescriptor(fileDescriptor, buffer, size);
+    }, prefetch, chunkSize) {
+}
+
+RingBufferCharStream::~RingBufferCharStream() {
+  // The helper thread writes into _nextChunk.
+  if (_prefetched.valid()) {
+    _prefetched.wait();
+  }
+}
+
+void RingBufferCharStream::consume() {
+  if (LA(1) == EOF) {
+    throw IllegalStateException("cannot consume EOF");
+  }
+
+  _lastChar = _ring[_currentCharIndex & _mask];
+  _currentCharIndex++;
+}
+
+ssize_t RingBufferCharStream::LA(ssize_t i) {
+  if (i == 0) {
+    return 0; // undefined
+  }
+
+  if (i < 0) {
+    if (i == -1) {
+      return _lastChar;
+    }
+    if ((size_t)-i > _currentCharIndex - _bufferStart) {
+      throw IndexOutOfBoundsException();
+    }
+    return _ring[(_currentCharIndex + i) & _mask];
+  }
+
+  size_t index = _currentCharIndex + (size_t)i - 1;
+  if (index >= _bufferEnd) {
+    sync((size_t)i);
+    if (index >= _bufferEnd) {
+      return EOF;
+    }
+  }
+
+  return _ring[index & _mask];
+}
+
+ssize_t RingBufferCharStream::mark() {
+  if (_numMarkers == 0) {
+    _markIndex = _currentCharIndex;
+  }
+
+  ssize_t mark = -(ssize_t)_numMarkers - 1;
+  _numMarkers++;
+  return mark;
+}
+
+void RingBufferCharStream::release(ssize_t marker) {
+  ssize_t expectedMark = -(ssize_t)_numMarkers;
+  if (marker != expectedMark) {
+    throw IllegalStateException("release() called with an invalid marker.");
+  }
+
+  // The window is trimmed when the next chunk comes in.
+  _numMarkers--;
+}
+
+size_t RingBufferCharStream::index() {
+  return _currentCharIndex;
+}
+
+void RingBufferCharStream::seek(size_t index) {
+  if (index == _currentCharIndex) {
+    return;
+  }
+
+  if (index > _currentCharIndex) {
+    sync(index - _currentCharIndex);
+    index = std::min(index, _bufferEnd);
+  }
+
+  if (index < _bufferStart) {
+    throw UnsupportedOperationException("Seek to index outside buffer: " + std::to_string(index) +
+                                        " not in " + std::to_string(_bufferStart) + ".." + std::to_string(_bufferEnd));
+  }
+
+  _currentCharIndex = index;
+  if (index == _bufferStart) {
+    _lastChar = _lastCharBufferStart;
+  } else {
+    _lastChar = _ring[(index - 1) & _mask];
+  }
+}
+
+size_t RingBufferCharStream::size() {
+  throw UnsupportedOperationException("Unbuffered stream cannot know its size");
+}
+
+std::string RingBufferCharStream::getSourceName() const {
+  if (name.empty()) {
+    return UNKNOWN_SOURCE_NAME;
+  }
+
+  return name;
+}
+
+std::string RingBufferCharStream::getText(const misc::Interval &interval) {
+  if (interval.a < 0 || interval.b < interval.a - 1) {
+    throw IllegalArgumentException("invalid interval");
+  }
+
+  size_t start = (size_t)interval.a;
+  size_t stop = (size_t)(interval.b + 1);
+  if (stop > _bufferEnd) {
+    sync(stop - _currentCharIndex);
+    if (_eof && stop > _bufferEnd) {
+      throw IllegalArgumentException("the interval extends past the end of the stream");
+    }
+  }
+
+  if (start < _bufferStart || stop > _bufferEnd) {
+    throw UnsupportedOperationException("interval " + interval.toString() + " outside buffer: " +
+      std::to_string(_bufferStart) + ".." + std::to_string(_bufferEnd - 1));
+  }
+
+  std::u32string text;
+  text.reserve(stop - start);
+  for (size_t i = start; i < stop; ++i) {
+    text += _ring[i & _mask];
+  }
+  return utfConverter.to_bytes(text);
+}
+
+std::string RingBufferCharStream::toString() const {
+  std::u32string text;
+  text.reserve(_bufferEnd - _bufferStart);
+  for (size_t i = _bufferStart; i < _bufferEnd; ++i) {
+    text += _ring[i & _mask];
+  }
+  return utfConverter.to_bytes(text);
+}
+
+size_t RingBufferCharStream::getCapacity() const {
+  return _ring.size();
+}
+
+void RingBufferCharStream::sync(size_t want) {
+  while (_bufferEnd < _currentCharIndex + want) {
+    if (!refill()) {
+      break;
+    }
+  }
+}
+
+bool RingBufferCharStream::refill() {
+  if (_eof) {
+    return false;
+  }
+
+  // A prefetch that threw has left no result (get() rethrew its exception). Read synchronously then.
+  size_t count;
+  if (_prefetch && _prefetched.valid()) {
+    count = _prefetched.get();
+    std::swap(_chunk, _nextChunk);
+  } else {
+    count = _read(&_chunk[PENDING_ROOM], _chunkSize);
+  }
+  if (_prefetch && count > 0) {
+    startPrefetch(); // Read the next chunk while this one is decoded.
+  }
+
+  if (count > _chunkSize) {
+    throw IllegalStateException("The read function returned more bytes than requested.");
+  }
+
+  // Put the rest of the previous chunk in front of the new data.
+  unsigned char *input = reinterpret_cast<unsigned char *>(&_chunk[PENDING_ROOM - _pendingCount]);
+  std::copy(_pending, _pending + _pendingCount, _chunk.begin() + (PENDING_ROOM - _pendingCount));
+  size_t length = _pendingCount + count;
+  _pendingCount = 0;
+
+  _eof = count == 0;
+  makeRoom(length);
+  decode(input, length, _eof);
+
+  return !_eof || length > 0;
+}
+
+void RingBufferCharStream::startPrefetch() {
+  ReadFunction &read = _read;
+  char *buffer = &_nextChunk[PENDING_ROOM];
+  size_t size = _chunkSize;
+  _prefetched = std::async(std::launch::async, [&read, buffer, size]() {
+    return read(buffer, size);
+  });
+}
+
+void RingBufferCharStream::makeRoom(size_t count) {
+  size_t keep = _numMarkers > 0 ? std::min(_markIndex, _currentCharIndex) : _currentCharIndex;
+  if (keep > _bufferStart) {
+    _lastCharBufferStart = _ring[(keep - 1) & _mask];
+    _bufferStart = keep;
+  }
+
+  size_t required = _bufferEnd - _bufferStart + count;
+  if (required <= _ring.size()) {
+    return;
+  }
+
+  size_t capacity = _ring.size();
+  while (capacity < required) {
+    capacity <<= 1;
+  }
+
+  std::vector<char32_t> ring(capacity);
+  size_t mask = capacity - 1;
+  for (size_t i = _bufferStart; i < _bufferEnd; ++i) {
+    ring[i & mask] = _ring[i & _mask];
+  }
+  _ring.swap(ring);
+  _mask = mask;
+}
+
+void RingBufferCharStream::decode(const unsigned char *input, size_t length, bool last) {
+  char32_t *ring = _ring.data();
+  size_t mask = _mask;
+  size_t end = _bufferEnd;
+
+  size_t i = 0;
+  while (i < length) {
+    // Fast path for runs of ASCII.
+    while (i < length && input[i] < 0x80) {
+      ring[end++ & mask] = input[i++];
+    }
+    if (i == length) {
+      break;
+    }
+
+    unsigned char c = input[i];
+    size_t sequenceLength;
+    char32_t result;
+    char32_t minimum;
+    if ((c & 0xE0) == 0xC0) {
+      sequenceLength = 2;
+      result = c & 0x1F;
+      minimum = 0x80;
+    } else if ((c & 0xF0) == 0xE0) {
+      sequenceLength = 3;
+      result = c & 0x0F;
+      minimum = 0x800;
+    } else if ((c & 0xF8) == 0xF0) {
+      sequenceLength = 4;
+      result = c & 0x07;
+      minimum = 0x10000;
+    } else {
+      ring[end++ & mask] = REPLACEMENT_CHARACTER; // Stray continuation byte or invalid lead byte.
+      ++i;
+      continue;
+    }
+
+    if (sequenceLength > length - i) {
+      if (!last) {
+        // Continued in the next chunk.
+        _pendingCount = length - i;
+        std::copy(input + i, input + length, _pending);
+        break;
+      }
+      ring[end++ & mask] = REPLACEMENT_CHARACTER; // Truncated sequence at the end of the input.
+      ++i;
+      continue;
+    }
+
+    bool valid = true;
+    for (size_t j = 1; j < sequenceLength; ++j) {
+      if ((input[i + j] & 0xC0) != 0x80) {
+        valid = false;
+        break;
+      }
+      result = (result << 6) | (input[i + j] & 0x3F);
+    }
+
+    // Overlong forms, surrogates and values beyond the Unicode range cannot be converted back to UTF-8.
+    if (!valid || result < minimum || (result >= 0xD800 && result <= 0xDFFF) || result > 0x10FFFF) {
+      ring[end++ & mask] = REPLACEMENT_CHARACTER;
+      ++i;
+      continue;
+    }
+
+    i += sequenceLength;
+    if (result == 0xFEFF && end == 0) {
+      continue; // Skip the BOM.
+    }
+    ring[end++ & mask] = result;
+  }
+
+  _bufferEnd = end;
+}
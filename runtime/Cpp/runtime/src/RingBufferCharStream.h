@@ -0,0 +1,151 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "CharStream.h"
+
+#include <future>
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+
+  /// A char stream for input of unknown (or huge) size, which is read in large chunks and decoded as UTF-8 into a
+  /// ring buffer of code points. Like UnbufferedCharStream it only keeps a sliding window of the input: everything
+  /// before the oldest mark (or before the current position, if there's no mark) is dropped when the next chunk is
+  /// decoded. Releasing the last mark costs nothing, no data is moved. The ring only grows (to the next power of 2) if
+  /// a marked region plus one chunk doesn't fit, so memory use is bounded by the largest token (the lexer keeps a
+  /// mark for the token being matched) plus the chunk size.
+  ///
+  /// Data comes either from a file descriptor or from a read callback. Optionally the next chunk is read on a helper
+  /// thread while the current one is decoded and lexed. The callback is then called on that thread, but never
+  /// concurrently, and an exception it throws is rethrown by the stream when the chunk is needed.
+  ///
+  /// Indices are code point counts (as in ANTLRInputStream). Like with UnbufferedCharStream, getText() works only
+  /// within the current window, hence tokens should copy their text (see CommonTokenFactory) and size() is not
+  /// supported. A leading BOM is skipped, invalid byte sequences are returned as U+FFFD (one per byte).
+  class ANTLR4CPP_PUBLIC RingBufferCharStream : public CharStream {
+  public:
+    /// Reads up to size bytes into buffer and returns the number of bytes read. 0 means the end of the input.
+    typedef std::function<size_t(char *buffer, size_t size)> ReadFunction;
+
+    static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+    /// The name or source of this char stream.
+    std::string name;
+
+    RingBufferCharStream(ReadFunction read, bool prefetch = false, size_t chunkSize = DEFAULT_CHUNK_SIZE);
+
+    /// Reads from the given file descriptor, which is not closed by the stream. Throws an IOException if reading fails.
+    RingBufferCharStream(int fileDescriptor, bool prefetch = false, size_t chunkSize = DEFAULT_CHUNK_SIZE);
+
+    /// Waits for a pending read on the helper thread.
+    virtual ~RingBufferCharStream();
+
+    virtual void consume() override;
+    virtual ssize_t LA(ssize_t i) override;
+
+    /// Pins the window at the current position until the marker is released. Markers must be released in reverse
+    /// order (see UnbufferedCharStream::mark()).
+    virtual ssize_t mark() override;
+    virtual void release(ssize_t marker) override;
+    virtual size_t index() override;
+
+    /// Seeks to an absolute character index within the current window.
+    virtual void seek(size_t index) override;
+    virtual size_t size() override;
+    virtual std::string getSourceName() const override;
+    virtual std::string getText(const misc::Interval &interval) override;
+
+    /// Returns the text of the current window.
+    virtual std::string toString() const override;
+
+    /// The number of code points the ring can hold.
+    size_t getCapacity() const;
+
+  protected:
+    std::vector<char32_t> _ring;
+    size_t _mask;
+
+    /// Absolute indices of the first character in the window and the one after the last decoded character.
+    size_t _bufferStart;
+    size_t _bufferEnd;
+
+    /// Absolute index of the character returned by LA(1).
+    size_t _currentCharIndex;
+
+    size_t _numMarkers;
+
+    /// The position of the first (outermost) mark, valid while _numMarkers > 0.
+    size_t _markIndex;
+
+    /// The LA(-1) character for the current position and for _bufferStart.
+    ssize_t _lastChar;
+    ssize_t _lastCharBufferStart;
+
+    /// Set when the read function returned 0. _bufferEnd is then the size of the input.
+    bool _eof;
+
+    /// Decodes more input until there are at least want characters after the current position (or EOF is reached).
+    virtual void sync(size_t want);
+
+    /// Reads and decodes the next chunk. Returns false at EOF.
+    virtual bool refill();
+
+  private:
+    /// Room in front of each chunk for the bytes of an incomplete UTF-8 sequence at the end of the previous chunk.
+    static const size_t PENDING_ROOM = 3;
+
+    ReadFunction _read;
+    size_t _chunkSize;
+    bool _prefetch;
+
+    std::vector<char> _chunk;
+    std::vector<char> _nextChunk; // Target of the helper thread.
+    char _pending[PENDING_ROOM];
+    size_t _pendingCount;
+
+    std::future<size_t> _prefetched;
+
+    void startPrefetch();
+
+    /// Drops what is no longer needed from the window and grows the ring so that count more characters fit.
+    void makeRoom(size_t count);
+
+    /// Appends the decoded input to the ring. An incomplete sequence at the end is kept for the next chunk, unless
+    /// this is the last one.
+    void decode(const unsigned char *input, size_t length, bool last);
+  };
+
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
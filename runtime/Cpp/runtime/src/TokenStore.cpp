@@ -0,0 +1,449 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "CommonToken.h"
+#include "CharStream.h"
+#include "Exceptions.h"
+#include "misc/Interval.h"
+
+#include "TokenStore.h"
+
+using namespace org::antlr::v4::runtime;
+
+namespace {
+
+  /// The token objects handed out for tokens kept in the arrays of a TokenStore. All access goes to the store.
+  class StoredToken : public WritableToken {
+  public:
+    StoredToken(Ref<TokenStore> store, size_t index) : _store(store), _index(index), _version(store->getVersion()) {
+    }
+
+    virtual std::string getText() override {
+      return _store->getText(index());
+    }
+
+    virtual void setText(const std::string &text) override {
+      _store->setText(index(), text);
+    }
+
+    virtual int getType() const override {
+      return _store->getType(index());
+    }
+
+    virtual void setType(int ttype) override {
+      _store->setType(index(), ttype);
+    }
+
+    virtual int getLine() override {
+      return _store->getLine(index());
+    }
+
+    virtual void setLine(int line) override {
+      _store->setLine(index(), line);
+    }
+
+    virtual int getCharPositionInLine() override {
+      return _store->getCharPositionInLine(index());
+    }
+
+    virtual void setCharPositionInLine(int pos) override {
+      _store->setCharPositionInLine(index(), pos);
+    }
+
+    virtual size_t getChannel() override {
+      return _store->getChannel(index());
+    }
+
+    virtual void setChannel(int channel) override {
+      _store->setChannel(index(), channel);
+    }
+
+    virtual int getTokenIndex() override {
+      return (int)index();
+    }
+
+    virtual void setTokenIndex(int index) override {
+      // The index of a stored token is its position in the store.
+      if (index != (int)this->index()) {
+        throw UnsupportedOperationException("cannot change the index of a buffered token");
+      }
+    }
+
+    virtual int getStartIndex() override {
+      return _store->getStartIndex(index());
+    }
+
+    virtual int getStopIndex() override {
+      return _store->getStopIndex(index());
+    }
+
+    virtual TokenSource *getTokenSource() override {
+      return _store->getTokenSource(index());
+    }
+
+    virtual CharStream *getInputStream() override {
+      return _store->getInputStream(index());
+    }
+
+  private:
+    const Ref<TokenStore> _store;
+
+    // The index of the token as of the given version of the store.
+    mutable size_t _index;
+    mutable size_t _version;
+
+    size_t index() const {
+      if (_version != _store->getVersion()) {
+        _store->updateIndex(_index, _version);
+      }
+      return _index;
+    }
+  };
+
+}
+
+TokenStore::TokenStore() : _views(VIEW_CACHE_SIZE), _hasSource(false) {
+}
+
+size_t TokenStore::size() const {
+  return _types.size();
+}
+
+void TokenStore::add(const Ref<Token> &token) {
+  size_t index = _types.size();
+  _types.push_back(token->getType());
+  _channels.push_back((int)token->getChannel());
+  _starts.push_back(token->getStartIndex());
+  _stops.push_back(token->getStopIndex());
+  _lines.push_back(token->getLine());
+  _columns.push_back(token->getCharPositionInLine());
+
+  // Only exact CommonToken instances can be stored in the arrays, subclasses may carry additional state.
+  Token &t = *token;
+  CommonToken *common = typeid(t) == typeid(CommonToken) ? static_cast<CommonToken *>(token.get()) : nullptr;
+  if (common != nullptr && !_hasSource) {
+    _source = common->_source;
+    _hasSource = true;
+  }
+
+  if (common != nullptr && common->_source == _source) {
+    if (!common->_text.empty()) {
+      _texts[index] = common->_text;
+    }
+  } else {
+    _foreignTokens[index] = token;
+  }
+}
+
+void TokenStore::append(const TokenStore &other, size_t start, size_t stop, int charDelta, int lineDelta) {
+  if (start >= stop) {
+    return;
+  }
+
+  if (other._hasSource) {
+    if (!_hasSource) {
+      _source = other._source;
+      _hasSource = true;
+    } else if (_source != other._source) {
+      throw IllegalArgumentException("cannot append tokens from a different source");
+    }
+  }
+
+  size_t offset = _types.size();
+  _types.insert(_types.end(), other._types.begin() + (ssize_t)start, other._types.begin() + (ssize_t)stop);
+  _channels.insert(_channels.end(), other._channels.begin() + (ssize_t)start, other._channels.begin() + (ssize_t)stop);
+  _starts.insert(_starts.end(), other._starts.begin() + (ssize_t)start, other._starts.begin() + (ssize_t)stop);
+  _stops.insert(_stops.end(), other._stops.begin() + (ssize_t)start, other._stops.begin() + (ssize_t)stop);
+  _lines.insert(_lines.end(), other._lines.begin() + (ssize_t)start, other._lines.begin() + (ssize_t)stop);
+  _columns.insert(_columns.end(), other._columns.begin() + (ssize_t)start, other._columns.begin() + (ssize_t)stop);
+
+  if (charDelta != 0 || lineDelta != 0) {
+    for (size_t i = offset; i < _types.size(); ++i) {
+      _starts[i] += charDelta;
+      _stops[i] += charDelta;
+      _lines[i] += lineDelta;
+    }
+  }
+
+  for (auto &entry : other._texts) {
+    if (entry.first >= start && entry.first < stop) {
+      _texts[offset + entry.first - start] = entry.second;
+    }
+  }
+
+  for (auto &entry : other._foreignTokens) {
+    if (entry.first < start || entry.first >= stop) {
+      continue;
+    }
+
+    // Foreign tokens are shared with the other store, which is expected to be discarded.
+    CommonToken *common = dynamic_cast<CommonToken *>(entry.second.get());
+    if (common != nullptr) {
+      common->setTokenIndex((int)(offset + entry.first - start));
+      common->setStartIndex(common->getStartIndex() + charDelta);
+      common->setStopIndex(common->getStopIndex() + charDelta);
+      common->setLine(common->getLine() + lineDelta);
+    }
+    _foreignTokens[offset + entry.first - start] = entry.second;
+  }
+}
+
+void TokenStore::replace(size_t start, size_t length, const std::vector<Ref<Token>> &tokens, int charDelta,
+                         int lineDelta) {
+  if (start > _types.size() || length > _types.size() - start) {
+    throw IndexOutOfBoundsException("token range exceeds the store");
+  }
+
+  // Add the new tokens at the end, then rotate them into place.
+  size_t oldSize = _types.size();
+  size_t end = start + length;
+  for (const Ref<Token> &token : tokens) {
+    add(token);
+  }
+  auto rotate = [&](std::vector<int> &values) {
+    std::rotate(values.begin() + (ssize_t)end, values.begin() + (ssize_t)oldSize, values.end());
+    values.erase(values.begin() + (ssize_t)start, values.begin() + (ssize_t)end);
+  };
+  rotate(_types);
+  rotate(_channels);
+  rotate(_starts);
+  rotate(_stops);
+  rotate(_lines);
+  rotate(_columns);
+
+  size_t tail = start + tokens.size();
+  if (charDelta != 0 || lineDelta != 0) {
+    for (size_t i = tail; i < _types.size(); ++i) {
+      _starts[i] += charDelta;
+      _stops[i] += charDelta;
+      _lines[i] += lineDelta;
+    }
+  }
+
+  // The maps are keyed by token index, so their entries have to move as well. They are rare.
+  auto newIndex = [&](size_t i) {
+    if (i < start) {
+      return i;
+    }
+    if (i >= oldSize) {
+      return start + i - oldSize; // An added token.
+    }
+    return i - length + tokens.size();
+  };
+
+  std::unordered_map<size_t, std::string> texts;
+  for (auto &entry : _texts) {
+    if (entry.first < start || entry.first >= end) {
+      texts[newIndex(entry.first)] = std::move(entry.second);
+    }
+  }
+  _texts.swap(texts);
+
+  std::unordered_map<size_t, Ref<Token>> foreignTokens;
+  for (auto &entry : _foreignTokens) {
+    if (entry.first >= start && entry.first < end) {
+      continue;
+    }
+
+    size_t index = newIndex(entry.first);
+    CommonToken *common = dynamic_cast<CommonToken *>(entry.second.get());
+    if (common != nullptr && entry.first >= end) {
+      common->setTokenIndex((int)index);
+      if (entry.first < oldSize) {
+        common->setStartIndex(common->getStartIndex() + charDelta);
+        common->setStopIndex(common->getStopIndex() + charDelta);
+        common->setLine(common->getLine() + lineDelta);
+      }
+    }
+    foreignTokens[index] = entry.second;
+  }
+  _foreignTokens.swap(foreignTokens);
+
+  _replacements.push_back({ start, length, tokens.size() });
+}
+
+size_t TokenStore::getVersion() const {
+  return _replacements.size();
+}
+
+void TokenStore::updateIndex(size_t &index, size_t &version) const {
+  for (; version < _replacements.size(); ++version) {
+    const Replacement &replacement = _replacements[version];
+    if (index >= replacement.start + replacement.length) {
+      index = index - replacement.length + replacement.count;
+    } else if (index >= replacement.start) {
+      if (replacement.count > 0) {
+        index = replacement.start + replacement.count - 1;
+      } else if (replacement.start > 0) {
+        index = replacement.start - 1;
+      }
+    }
+  }
+}
+
+Ref<Token> TokenStore::get(size_t i) {
+  Token *token = getForeignToken(i);
+  if (token != nullptr) {
+    return _foreignTokens[i];
+  }
+
+  std::weak_ptr<Token> &slot = _views[i % VIEW_CACHE_SIZE];
+  Ref<Token> view = slot.lock();
+  if (view == nullptr || (size_t)view->getTokenIndex() != i) {
+    view = std::make_shared<StoredToken>(shared_from_this(), i);
+    slot = view;
+  }
+  return view;
+}
+
+int TokenStore::getType(size_t i) const {
+  Token *token = getForeignToken(i);
+  if (token != nullptr) {
+    return token->getType();
+  }
+  return _types[i];
+}
+
+void TokenStore::setType(size_t i, int type) {
+  _types[i] = type;
+}
+
+size_t TokenStore::getChannel(size_t i) const {
+  Token *token = getForeignToken(i);
+  if (token != nullptr) {
+    return token->getChannel();
+  }
+  return (size_t)_channels[i];
+}
+
+void TokenStore::setChannel(size_t i, int channel) {
+  _channels[i] = channel;
+}
+
+int TokenStore::getStartIndex(size_t i) const {
+  Token *token = getForeignToken(i);
+  if (token != nullptr) {
+    return token->getStartIndex();
+  }
+  return _starts[i];
+}
+
+int TokenStore::getStopIndex(size_t i) const {
+  Token *token = getForeignToken(i);
+  if (token != nullptr) {
+    return token->getStopIndex();
+  }
+  return _stops[i];
+}
+
+int TokenStore::getLine(size_t i) const {
+  Token *token = getForeignToken(i);
+  if (token != nullptr) {
+    return token->getLine();
+  }
+  return _lines[i];
+}
+
+void TokenStore::setLine(size_t i, int line) {
+  _lines[i] = line;
+}
+
+int TokenStore::getCharPositionInLine(size_t i) const {
+  Token *token = getForeignToken(i);
+  if (token != nullptr) {
+    return token->getCharPositionInLine();
+  }
+  return _columns[i];
+}
+
+void TokenStore::setCharPositionInLine(size_t i, int charPositionInLine) {
+  _columns[i] = charPositionInLine;
+}
+
+std::string TokenStore::getText(size_t i) const {
+  Token *token = getForeignToken(i);
+  if (token != nullptr) {
+    return token->getText();
+  }
+
+  if (!_texts.empty()) {
+    auto iterator = _texts.find(i);
+    if (iterator != _texts.end()) {
+      return iterator->second;
+    }
+  }
+
+  // Same as CommonToken::getText().
+  CharStream *input = _source.second;
+  if (input == nullptr) {
+    return "";
+  }
+  size_t n = input->size();
+  if ((size_t)_starts[i] < n && (size_t)_stops[i] < n) {
+    return input->getText(misc::Interval(_starts[i], _stops[i]));
+  } else {
+    return "<EOF>";
+  }
+}
+
+void TokenStore::setText(size_t i, const std::string &text) {
+  if (text.empty()) {
+    _texts.erase(i);
+  } else {
+    _texts[i] = text;
+  }
+}
+
+TokenSource* TokenStore::getTokenSource(size_t i) const {
+  Token *token = getForeignToken(i);
+  if (token != nullptr) {
+    return token->getTokenSource();
+  }
+  return _source.first;
+}
+
+CharStream* TokenStore::getInputStream(size_t i) const {
+  Token *token = getForeignToken(i);
+  if (token != nullptr) {
+    return token->getInputStream();
+  }
+  return _source.second;
+}
+
+Token* TokenStore::getForeignToken(size_t i) const {
+  if (_foreignTokens.empty()) {
+    return nullptr;
+  }
+
+  auto iterator = _foreignTokens.find(i);
+  if (iterator == _foreignTokens.end()) {
+    return nullptr;
+  }
+  return iterator->second.get();
+}
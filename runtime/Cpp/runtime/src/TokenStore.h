@@ -0,0 +1,139 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "antlr4-common.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+
+  /// Structure-of-arrays storage for the tokens buffered by a BufferedTokenStream.
+  ///
+  /// Tokens created by a CommonTokenFactory (i.e. plain CommonToken instances coming from the same source) are not kept
+  /// as objects. Only their type, channel, start/stop index, line and column are recorded in parallel arrays and the
+  /// token text is sliced from the char stream when asked for. Token objects are created on demand by get() as
+  /// lightweight views into the store, which also write changes (setType, setText etc.) back to it. Any other token
+  /// (custom token classes, tokens from a different source) is kept as is and returned unchanged.
+  ///
+  /// A store must be held in a Ref, as the views returned by get() keep it alive.
+  ///
+  /// A range of tokens can be replaced in place (see replace()). Views handed out before then keep referring to the
+  /// same token, which may now be at a different index. They find their new index lazily, the first time they are used
+  /// after a replacement.
+  class ANTLR4CPP_PUBLIC TokenStore : public std::enable_shared_from_this<TokenStore> {
+  public:
+    TokenStore();
+
+    size_t size() const;
+
+    /// Appends the given token. Its token index is the current size of the store.
+    void add(const Ref<Token> &token);
+
+    /// Appends the tokens [start, stop) of another store with the same source, moving their char indexes by charDelta
+    /// and their lines by lineDelta, without creating token objects.
+    void append(const TokenStore &other, size_t start, size_t stop, int charDelta, int lineDelta);
+
+    /// Replaces the tokens [start, start + length) by the given ones and moves the char indexes of the tokens behind
+    /// them by charDelta and their lines by lineDelta (see IncrementalParser). This is linear in the number of tokens
+    /// behind the range, but only moves and adjusts the arrays. Views of tokens outside the range stay valid. Views of
+    /// replaced tokens move to the last new token (or the token before the range if there are none), which is what
+    /// the stop token of an empty rule context right behind the range must become.
+    void replace(size_t start, size_t length, const std::vector<Ref<Token>> &tokens, int charDelta, int lineDelta);
+
+    /// The number of replace() calls so far.
+    size_t getVersion() const;
+
+    /// Moves a token index from the given version to the current one.
+    void updateIndex(size_t &index, size_t &version) const;
+
+    /// Returns the token at index i, either a view into this store or the token that was added. Repeated requests for
+    /// a recently used token (e.g. LT(1) while parsing) return the same view.
+    Ref<Token> get(size_t i);
+
+    int getType(size_t i) const;
+    void setType(size_t i, int type);
+
+    size_t getChannel(size_t i) const;
+    void setChannel(size_t i, int channel);
+
+    int getStartIndex(size_t i) const;
+    int getStopIndex(size_t i) const;
+
+    int getLine(size_t i) const;
+    void setLine(size_t i, int line);
+
+    int getCharPositionInLine(size_t i) const;
+    void setCharPositionInLine(size_t i, int charPositionInLine);
+
+    std::string getText(size_t i) const;
+    void setText(size_t i, const std::string &text);
+
+    TokenSource* getTokenSource(size_t i) const;
+    CharStream* getInputStream(size_t i) const;
+
+  private:
+    std::vector<int> _types;
+    std::vector<int> _channels;
+    std::vector<int> _starts;
+    std::vector<int> _stops;
+    std::vector<int> _lines;
+    std::vector<int> _columns;
+
+    /// Explicitly set token texts, by token index. Rare, as the text of most tokens comes from the char stream.
+    std::unordered_map<size_t, std::string> _texts;
+
+    /// Tokens that could not be stored in the arrays, by token index.
+    std::unordered_map<size_t, Ref<Token>> _foreignTokens;
+
+    /// Recently created views, indexed by token index modulo the cache size. Held weakly, as views keep the store alive.
+    static const size_t VIEW_CACHE_SIZE = 64;
+    std::vector<std::weak_ptr<Token>> _views;
+
+    /// The source shared by all tokens stored in the arrays (set by the first one added).
+    std::pair<TokenSource *, CharStream *> _source;
+    bool _hasSource;
+
+    /// The ranges replaced so far, in order: the tokens [start, start + length) were replaced by count tokens.
+    struct Replacement {
+      size_t start;
+      size_t length;
+      size_t count;
+    };
+    std::vector<Replacement> _replacements;
+
+    Token* getForeignToken(size_t i) const;
+  };
+
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
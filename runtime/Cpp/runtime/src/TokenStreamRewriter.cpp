@@ -33,92 +33,20 @@
 #include "misc/Interval.h"
 #include "Token.h"
 #include "TokenStream.h"
-#include "support/CPPUtils.h"
 
 #include "TokenStreamRewriter.h"
 
 using namespace org::antlr::v4::runtime;
-using namespace antlrcpp;
 
 using org::antlr::v4::runtime::misc::Interval;
 
-TokenStreamRewriter::RewriteOperation::RewriteOperation(TokenStreamRewriter *outerInstance, size_t index) : outerInstance(outerInstance) {
-
-  InitializeInstanceFields();
-  this->index = index;
-}
-
-TokenStreamRewriter::RewriteOperation::RewriteOperation(TokenStreamRewriter *outerInstance, size_t index, const std::string& text) : outerInstance(outerInstance) {
-
-  InitializeInstanceFields();
-  this->index = index;
-  this->text = text;
-}
-
-size_t TokenStreamRewriter::RewriteOperation::execute(std::string * /*buf*/) {
-  return index;
-}
-
-std::string TokenStreamRewriter::RewriteOperation::toString() {
-  std::string opName = "TokenStreamRewriter";
-  size_t index = opName.find('$');
-  opName = opName.substr(index + 1, opName.length() - (index + 1));
-  return "<" + opName + "@" + outerInstance->tokens->get(index)->getText() + ":\"" + text + "\">";
-}
-
-void TokenStreamRewriter::RewriteOperation::InitializeInstanceFields() {
-  instructionIndex = 0;
-  index = 0;
-}
-
-TokenStreamRewriter::InsertBeforeOp::InsertBeforeOp(TokenStreamRewriter *outerInstance, size_t index, const std::string& text)
-: RewriteOperation(outerInstance, index, text), outerInstance(outerInstance) {
-}
-
-size_t TokenStreamRewriter::InsertBeforeOp::execute(std::string *buf) {
-  buf->append(text);
-  if (outerInstance->tokens->get(index)->getType() != Token::EOF) {
-    buf->append(outerInstance->tokens->get(index)->getText());
-  }
-  return index + 1;
-}
-
-TokenStreamRewriter::ReplaceOp::ReplaceOp(TokenStreamRewriter *outerInstance, size_t from, size_t to, const std::string& text) : RewriteOperation(outerInstance, from, text), outerInstance(outerInstance) {
-
-  InitializeInstanceFields();
-  lastIndex = to;
-}
-
-size_t TokenStreamRewriter::ReplaceOp::execute(std::string *buf) {
-  buf->append(text);
-  return lastIndex + 1;
-}
-
-std::string TokenStreamRewriter::ReplaceOp::toString() {
-  if (text.empty()) {
-    return "<DeleteOp@" + outerInstance->tokens->get(index)->getText() + ".." + outerInstance->tokens->get(lastIndex)->getText() + ">";
-  }
-  return "<ReplaceOp@" + outerInstance->tokens->get(index)->getText() + ".." + outerInstance->tokens->get(lastIndex)->getText() + ":\"" + text + "\">";
-}
-
-void TokenStreamRewriter::ReplaceOp::InitializeInstanceFields() {
-  lastIndex = 0;
-}
-
-//------------------ TokenStreamRewriter -------------------------------------------------------------------------------
-
 const std::string TokenStreamRewriter::DEFAULT_PROGRAM_NAME = "default";
 
 TokenStreamRewriter::TokenStreamRewriter(TokenStream *tokens) : tokens(tokens) {
-  _programs.insert({ DEFAULT_PROGRAM_NAME, std::vector<RewriteOperation*>(PROGRAM_INIT_SIZE) });
+  getProgram(DEFAULT_PROGRAM_NAME);
 }
 
 TokenStreamRewriter::~TokenStreamRewriter() {
-  for (auto program : _programs) {
-    for (auto operation : program.second) {
-      delete operation;
-    }
-  }
 }
 
 TokenStream *TokenStreamRewriter::getTokenStream() {
@@ -130,9 +58,24 @@ void TokenStreamRewriter::rollback(int instructionIndex) {
 }
 
 void TokenStreamRewriter::rollback(const std::string &programName, int instructionIndex) {
-  std::vector<RewriteOperation*> is = _programs[programName];
-  if (is.size() > 0) {
-    _programs.insert({ programName, std::vector<RewriteOperation*>(is.begin() + MIN_TOKEN_INDEX, is.begin() + instructionIndex) });
+  auto iterator = _programs.find(programName);
+  if (iterator == _programs.end() || instructionIndex < MIN_TOKEN_INDEX ||
+      (size_t)instructionIndex >= iterator->second.instructions.size()) {
+    return;
+  }
+
+  // The combined edits cannot be taken apart, so apply the remaining instructions again. They were all accepted
+  // before, hence this cannot fail.
+  Program &program = iterator->second;
+  program.instructions.resize((size_t)instructionIndex);
+  program.inserts.clear();
+  program.replaces.clear();
+  for (auto &instruction : program.instructions) {
+    if (instruction.isInsert) {
+      applyInsert(program, instruction.from, instruction.text);
+    } else {
+      applyReplace(program, instruction.from, instruction.to, instruction.text);
+    }
   }
 }
 
@@ -174,10 +117,7 @@ void TokenStreamRewriter::insertBefore(const std::string &programName, Token *t,
 }
 
 void TokenStreamRewriter::insertBefore(const std::string &programName, size_t index, const std::string& text) {
-  RewriteOperation *op = new InsertBeforeOp(this, index, text); /* mem-check: deleted in d-tor */
-  std::vector<RewriteOperation*> &rewrites = getProgram(programName);
-  op->instructionIndex = (int)rewrites.size();
-  rewrites.push_back(op);
+  addInstruction(programName, { true, index, index, text });
 }
 
 void TokenStreamRewriter::replace(size_t index, const std::string& text) {
@@ -201,10 +141,7 @@ void TokenStreamRewriter::replace(const std::string &programName, size_t from, s
     throw IllegalArgumentException("replace: range invalid: " + std::to_string(from) + ".." + std::to_string(to) +
                                    "(size = " + std::to_string(tokens->size()) + ")");
   }
-  RewriteOperation *op = new ReplaceOp(this, from, to, text); /* mem-check: deleted in d-tor */
-  std::vector<RewriteOperation*> &rewrites = getProgram(programName);
-  op->instructionIndex = (int)rewrites.size();
-  rewrites.push_back(op);
+  addInstruction(programName, { false, from, to, text });
 }
 
 void TokenStreamRewriter::replace(const std::string &programName, Token *from, Token *to, const std::string& text) {
@@ -228,17 +165,25 @@ void TokenStreamRewriter::Delete(Token *from, Token *to) {
 }
 
 void TokenStreamRewriter::Delete(const std::string &programName, size_t from, size_t to) {
-  replace(programName, from, to, nullptr);
+  replace(programName, from, to, "");
 }
 
 void TokenStreamRewriter::Delete(const std::string &programName, Token *from, Token *to) {
-  replace(programName, from, to, nullptr);
+  replace(programName, from, to, "");
 }
 
 int TokenStreamRewriter::getLastRewriteTokenIndex() {
   return getLastRewriteTokenIndex(DEFAULT_PROGRAM_NAME);
 }
 
+size_t TokenStreamRewriter::getInstructionCount(const std::string &programName) const {
+  auto iterator = _programs.find(programName);
+  if (iterator == _programs.end()) {
+    return 0;
+  }
+  return iterator->second.instructions.size();
+}
+
 int TokenStreamRewriter::getLastRewriteTokenIndex(const std::string &programName) {
   if (_lastRewriteTokenIndexes.find(programName) == _lastRewriteTokenIndexes.end()) {
     return -1;
@@ -247,21 +192,101 @@ int TokenStreamRewriter::getLastRewriteTokenIndex(const std::string &programName
 }
 
 void TokenStreamRewriter::setLastRewriteTokenIndex(const std::string &programName, int i) {
-  _lastRewriteTokenIndexes.insert({ programName, i });
+  _lastRewriteTokenIndexes[programName] = i;
 }
 
-std::vector<TokenStreamRewriter::RewriteOperation*>& TokenStreamRewriter::getProgram(const std::string &name) {
-  std::vector<TokenStreamRewriter::RewriteOperation*> &is = _programs[name];
-  if (is.empty()) {
-    is = initializeProgram(name);
+TokenStreamRewriter::Program& TokenStreamRewriter::getProgram(const std::string &name) {
+  auto iterator = _programs.find(name);
+  if (iterator == _programs.end()) {
+    iterator = _programs.insert({ name, Program() }).first;
+    iterator->second.instructions.reserve(PROGRAM_INIT_SIZE);
   }
-  return is;
+  return iterator->second;
+}
+
+void TokenStreamRewriter::addInstruction(const std::string &programName, const Instruction &instruction) {
+  Program &program = getProgram(programName);
+  if (instruction.isInsert) {
+    applyInsert(program, instruction.from, instruction.text);
+  } else {
+    applyReplace(program, instruction.from, instruction.to, instruction.text);
+  }
+
+  // Only accepted instructions are recorded, so rollback() can replay them.
+  program.instructions.push_back(instruction);
+}
+
+void TokenStreamRewriter::applyReplace(Program &program, size_t from, size_t to, const std::string &text) {
+  // Find the range this replace finally covers. Overlapping deletes are merged into it, which widens the range and
+  // can make it overlap further replaces, so repeat until it doesn't change anymore.
+  size_t first = from;
+  size_t last = to;
+  bool widened = true;
+  while (widened) {
+    widened = false;
+
+    auto iterator = program.replaces.lower_bound(first);
+    if (iterator != program.replaces.begin()) {
+      auto previous = std::prev(iterator);
+      if (previous->second.lastIndex >= first) {
+        iterator = previous;
+      }
+    }
+
+    for (; iterator != program.replaces.end() && iterator->first <= last; ++iterator) {
+      const Replacement &previous = iterator->second;
+      if (iterator->first >= first && previous.lastIndex <= last) {
+        continue; // Contained, will be dropped.
+      }
+
+      if (text.empty() && previous.text.empty()) {
+        first = std::min(first, iterator->first);
+        last = std::max(last, previous.lastIndex);
+        widened = true;
+        continue;
+      }
+
+      throw IllegalArgumentException("replace op boundaries of " + replaceToString(from, to, text) +
+                                     " overlap with previous " +
+                                     replaceToString(iterator->first, previous.lastIndex, previous.text));
+    }
+  }
+
+  // No conflicts, now change the program. Inserts within the range are wiped out, one at the start of the
+  // range becomes part of the replacement.
+  std::string replacement = text;
+  auto insertsBegin = program.inserts.lower_bound(first);
+  auto insertsEnd = program.inserts.upper_bound(last);
+  for (auto iterator = insertsBegin; iterator != insertsEnd; ++iterator) {
+    if (iterator->first == from) {
+      replacement = iterator->second + replacement;
+    }
+  }
+  program.inserts.erase(insertsBegin, insertsEnd);
+
+  program.replaces.erase(program.replaces.lower_bound(first), program.replaces.upper_bound(last));
+  program.replaces.insert({ first, { last, replacement } });
 }
 
-std::vector<TokenStreamRewriter::RewriteOperation*> TokenStreamRewriter::initializeProgram(const std::string &name) {
-  std::vector<TokenStreamRewriter::RewriteOperation*> is(PROGRAM_INIT_SIZE);
-  _programs.insert({ name, is });
-  return is;
+void TokenStreamRewriter::applyInsert(Program &program, size_t index, const std::string &text) {
+  // The only replace which can contain the index is the last one starting at or before it.
+  auto iterator = program.replaces.upper_bound(index);
+  if (iterator != program.replaces.begin()) {
+    --iterator;
+    Replacement &replacement = iterator->second;
+    if (iterator->first == index) {
+      replacement.text = text + replacement.text;
+      return;
+    }
+
+    if (index <= replacement.lastIndex) {
+      throw IllegalArgumentException("insert op " + insertToString(index, text) + " within boundaries of previous " +
+                                     replaceToString(iterator->first, replacement.lastIndex, replacement.text));
+    }
+  }
+
+  std::string &inserted = program.inserts[index];
+  inserted = text + inserted;
 }
 
 std::string TokenStreamRewriter::getText() {
@@ -277,7 +302,29 @@ std::string TokenStreamRewriter::getText(const Interval &interval) {
 }
 
 std::string TokenStreamRewriter::getText(const std::string &programName, const Interval &interval) {
-  std::vector<TokenStreamRewriter::RewriteOperation*> rewrites = _programs[programName];
+  std::string result;
+  writeText(programName, interval, [&result](const std::string &text) {
+    result += text;
+  });
+  return result;
+}
+
+void TokenStreamRewriter::writeText(std::ostream &output) {
+  writeText(output, DEFAULT_PROGRAM_NAME);
+}
+
+void TokenStreamRewriter::writeText(std::ostream &output, const std::string &programName) {
+  writeText(output, programName, Interval(0, (int)tokens->size() - 1));
+}
+
+void TokenStreamRewriter::writeText(std::ostream &output, const std::string &programName, const Interval &interval) {
+  writeText(programName, interval, [&output](const std::string &text) {
+    output << text;
+  });
+}
+
+void TokenStreamRewriter::writeText(const std::string &programName, const Interval &interval,
+                                    const WriteFunction &write) {
   int start = interval.a;
   int stop = interval.b;
 
@@ -289,162 +336,59 @@ std::string TokenStreamRewriter::getText(const std::string &programName, const I
     start = 0;
   }
 
-  if (rewrites.empty() || rewrites.empty()) {
-    return tokens->getText(interval); // no instructions to execute
-  }
-  std::string buf;
-
-  // First, optimize instruction stream
-  std::unordered_map<size_t, TokenStreamRewriter::RewriteOperation*> indexToOp = reduceToSingleOperationPerIndex(rewrites);
+  Program noEdits;
+  auto programIterator = _programs.find(programName);
+  const Program &program = programIterator == _programs.end() ? noEdits : programIterator->second;
 
-  // Walk buffer, executing instructions and emitting tokens
+  // Walk buffer and the edits, which are both ordered by token index.
+  auto insert = program.inserts.lower_bound((size_t)start);
+  auto replace = program.replaces.lower_bound((size_t)start);
   size_t i = (size_t)start;
-  while (i <= (size_t)stop && i < tokens->size()) {
-    RewriteOperation *op = indexToOp[i];
-    indexToOp.erase(i); // remove so any left have index size-1
-    Ref<Token> t = tokens->get(i);
-    if (op == nullptr) {
-      // no operation at that index, just dump token
-      if (t->getType() != Token::EOF) {
-        buf.append(t->getText());
-      }
-      i++; // move to next token
+  while ((int)i <= stop) {
+    while (insert != program.inserts.end() && insert->first < i) {
+      ++insert; // Skipped by a replace reaching into the interval.
+    }
+
+    if (replace != program.replaces.end() && replace->first == i) {
+      write(replace->second.text);
+      i = replace->second.lastIndex + 1;
+      ++replace;
+      continue;
+    }
+
+    if (insert != program.inserts.end() && insert->first == i) {
+      write(insert->second);
+      ++insert;
     }
-    else {
-      i = op->execute(&buf); // execute operation and skip
+
+    Ref<Token> t = tokens->get(i);
+    if (t->getType() != Token::EOF) {
+      write(t->getText());
     }
+    i++;
   }
 
   // include stuff after end if it's last index in buffer
   // So, if they did an insertAfter(lastValidIndex, "foo"), include
   // foo if end==lastValidIndex.
   if (stop == (int)tokens->size() - 1) {
-    // Scan any remaining operations after last token
-    // should be included (they will be inserts).
-    for (auto op : indexToOp) {
-      if (op.second->index >= tokens->size() - 1) {
-        buf.append(op.second->text);
+    for (; insert != program.inserts.end(); ++insert) {
+      if ((int)insert->first > stop) {
+        write(insert->second);
       }
     }
   }
-  return buf;
 }
 
-std::unordered_map<size_t, TokenStreamRewriter::RewriteOperation*> TokenStreamRewriter::reduceToSingleOperationPerIndex(
-  std::vector<TokenStreamRewriter::RewriteOperation*> rewrites) {
-
-  // WALK REPLACES
-  for (size_t i = 0; i < rewrites.size(); ++i) {
-    TokenStreamRewriter::RewriteOperation *op = rewrites[i];
-    if (op == nullptr) {
-      continue;
-    }
-    if (!is<ReplaceOp *>(op)) {
-      continue;
-    }
-    ReplaceOp *rop = static_cast<ReplaceOp*>(op);
-    // Wipe prior inserts within range
-    InsertBeforeOp* type = nullptr;
-    std::vector<InsertBeforeOp*> inserts = getKindOfOps(rewrites, type, i);
-    for (auto iop : inserts) {
-      if (iop->index == rop->index) {
-        // E.g., insert before 2, delete 2..2; update replace
-        // text to include insert before, kill insert
-        rewrites[(size_t)iop->instructionIndex] = nullptr;
-        rop->text = iop->text + (!rop->text.empty() ? rop->text : "");
-      }
-      else if (iop->index > rop->index && iop->index <= rop->lastIndex) {
-        // delete insert as it's a no-op.
-        rewrites[(size_t)iop->instructionIndex] = nullptr;
-      }
-    }
-    // Drop any prior replaces contained within
-    ReplaceOp* type2 = nullptr;
-    std::vector<ReplaceOp*> prevReplaces = getKindOfOps(rewrites, type2, i);
-    for (auto prevRop : prevReplaces) {
-      if (prevRop->index >= rop->index && prevRop->lastIndex <= rop->lastIndex) {
-        // delete replace as it's a no-op.
-        rewrites[(size_t)prevRop->instructionIndex] = nullptr;
-        continue;
-      }
-      // throw exception unless disjoint or identical
-      bool disjoint = prevRop->lastIndex < rop->index || prevRop->index > rop->lastIndex;
-      bool same = prevRop->index == rop->index && prevRop->lastIndex == rop->lastIndex;
-      // Delete special case of replace (text==null):
-      // D.i-j.u D.x-y.v    | boundaries overlap    combine to max(min)..max(right)
-      if (prevRop->text.empty() && rop->text.empty() && !disjoint) {
-        //System.out.println("overlapping deletes: "+prevRop+", "+rop);
-        rewrites[(size_t)prevRop->instructionIndex] = nullptr; // kill first delete
-        rop->index = std::min(prevRop->index, rop->index);
-        rop->lastIndex = std::max(prevRop->lastIndex, rop->lastIndex);
-        std::cout << "new rop " << rop << std::endl;
-      }
-      else if (!disjoint && !same) {
-        throw IllegalArgumentException("replace op boundaries of " + rop->toString() +
-                                       " overlap with previous " + prevRop->toString());
-      }
-    }
-  }
-
-  // WALK INSERTS
-  for (size_t i = 0; i < rewrites.size(); i++) {
-    RewriteOperation *op = rewrites[i];
-    if (op == nullptr) {
-      continue;
-    }
-    if (!is<InsertBeforeOp*>(op)) {
-      continue;
-    }
-    InsertBeforeOp *iop = static_cast<InsertBeforeOp*>(rewrites[i]);
-    // combine current insert with prior if any at same index
-
-    std::vector<InsertBeforeOp*> prevInserts = getKindOfOps(rewrites, iop, i);
-    for (auto prevIop : prevInserts) {
-      if (prevIop->index == iop->index) { // combine objects
-                                          // convert to strings...we're in process of toString'ing
-                                          // whole token buffer so no lazy eval issue with any templates
-        iop->text = catOpText(&iop->text, &prevIop->text);
-        // delete redundant prior insert
-        rewrites[(size_t)prevIop->instructionIndex] = nullptr;
-      }
-    }
-    // look for replaces where iop.index is in range; error
-    ReplaceOp *type = nullptr;
-    std::vector<ReplaceOp*> prevReplaces = getKindOfOps(rewrites, type, i);
-    for (auto rop : prevReplaces) {
-      if (iop->index == rop->index) {
-        rop->text = catOpText(&iop->text, &rop->text);
-        rewrites[i] = nullptr; // delete current insert
-        continue;
-      }
-      if (iop->index >= rop->index && iop->index <= rop->lastIndex) {
-        throw IllegalArgumentException("insert op " + iop->toString() + " within boundaries of previous " + rop->toString());
-      }
-    }
-  }
-
-  std::unordered_map<size_t, TokenStreamRewriter::RewriteOperation*> m;
-  for (TokenStreamRewriter::RewriteOperation *op : rewrites) {
-    if (op == nullptr) { // ignore deleted ops
-      continue;
-    }
-    if (m.count(op->index) > 0) {
-      throw RuntimeException("should only be one op per index");
-    }
-    m[op->index] = op;
-  }
-
-  return m;
+std::string TokenStreamRewriter::insertToString(size_t index, const std::string &text) {
+  std::string token = index < tokens->size() ? tokens->get(index)->getText() : "<EOF>";
+  return "<InsertBeforeOp@" + token + ":\"" + text + "\">";
 }
 
-std::string TokenStreamRewriter::catOpText(std::string *a, std::string *b) {
-  std::string x = "";
-  std::string y = "";
-  if (a != nullptr) {
-    x = std::string(*a);
-  }
-  if (b != nullptr) {
-    y = std::string(*b);
+std::string TokenStreamRewriter::replaceToString(size_t from, size_t to, const std::string &text) {
+  std::string range = tokens->get(from)->getText() + ".." + tokens->get(to)->getText();
+  if (text.empty()) {
+    return "<DeleteOp@" + range + ">";
   }
-  return x + y;
+  return "<ReplaceOp@" + range + ":\"" + text + "\">";
 }
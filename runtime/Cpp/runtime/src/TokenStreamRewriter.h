@@ -111,6 +111,17 @@ namespace runtime {
    * <p>
    * If you don't use named rewrite streams, a "default" stream is used as the
    * first example shows.</p>
+   *
+   * <p>
+   * Each program keeps its edits in ordered indices (inserts by token index,
+   * replaced ranges by their start index), so an edit costs O(log n) and it is
+   * combined with the earlier edits right away, following the rules described
+   * at {@link #applyReplace}. An edit which conflicts with an earlier one
+   * (e.g. a replace overlapping another replace) is rejected with an
+   * {@link IllegalArgumentException} when it is made and leaves the program
+   * unchanged. Rendering walks the tokens and the indices side by side in
+   * linear time. {@link #writeText} passes the text on in pieces instead of
+   * building one string, so large rewrites can be written directly to a file.</p>
    */
   class ANTLR4CPP_PUBLIC TokenStreamRewriter {
   public:
@@ -118,6 +129,9 @@ namespace runtime {
     static const int PROGRAM_INIT_SIZE = 100;
     static const int MIN_TOKEN_INDEX = 0;
 
+    /// Receives the rewritten text piece by piece.
+    typedef std::function<void(const std::string &text)> WriteFunction;
+
     TokenStreamRewriter(TokenStream *tokens);
     virtual ~TokenStreamRewriter();
 
@@ -128,7 +142,7 @@ namespace runtime {
     /// <summary>
     /// Rollback the instruction stream for a program so that
     ///  the indicated instruction (via instructionIndex) is no
-    ///  longer in the stream.  UNTESTED!
+    ///  longer in the stream. The remaining instructions are applied again.
     /// </summary>
     virtual void rollback(const std::string &programName, int instructionIndex);
 
@@ -162,7 +176,10 @@ namespace runtime {
     virtual void Delete(const std::string &programName, Token *from, Token *to);
 
     virtual int getLastRewriteTokenIndex();
-    
+
+    /// Returns the number of instructions in the given program (the value to pass to rollback() to undo the next one).
+    size_t getInstructionCount(const std::string &programName = DEFAULT_PROGRAM_NAME) const;
+
     /// Return the text from the original tokens altered per the
     ///  instructions given to this rewriter.
     virtual std::string getText();
@@ -171,7 +188,7 @@ namespace runtime {
      *  instructions given to this rewriter in programName.
      */
     std::string getText(std::string programName);
-    
+
     /// <summary>
     /// Return the text associated with the tokens in the interval from the
     ///  original token stream but with the alterations given to this rewriter.
@@ -186,60 +203,36 @@ namespace runtime {
 
     virtual std::string getText(const std::string &programName, const misc::Interval &interval);
 
-  protected:
-    class RewriteOperation {
-    private:
-      TokenStreamRewriter *const outerInstance;
-
-    public:
-      /// <summary>
-      /// What index into rewrites List are we? </summary>
-      virtual ~RewriteOperation() {};
-      /// <summary>
-      /// Token buffer index. </summary>
-      size_t index;
-      std::string text;
-
-      RewriteOperation(TokenStreamRewriter *outerInstance, size_t index);
-
-      RewriteOperation(TokenStreamRewriter *outerInstance, size_t index, const std::string& text);
-      /// <summary>
-      /// Execute the rewrite operation by possibly adding to the buffer.
-      ///  Return the index of the next token to operate on.
-      /// </summary>
-      int instructionIndex;
-
-      virtual size_t execute(std::string *buf);
+    /// Same as getText(), but the text is written to the given stream as it is produced.
+    void writeText(std::ostream &output);
+    void writeText(std::ostream &output, const std::string &programName);
+    void writeText(std::ostream &output, const std::string &programName, const misc::Interval &interval);
 
-      virtual std::string toString();
+    /// Renders the tokens in the interval with the alterations of the given program and passes the text on in pieces
+    /// (inserted text, replacement text and the text of single tokens). All getText() and writeText() overloads end up
+    /// here.
+    virtual void writeText(const std::string &programName, const misc::Interval &interval, const WriteFunction &write);
 
-    private:
-      void InitializeInstanceFields();
-    };
-
-    class InsertBeforeOp : public RewriteOperation {
-    private:
-      TokenStreamRewriter *const outerInstance;
-
-    public:
-      InsertBeforeOp(TokenStreamRewriter *outerInstance, size_t index, const std::string& text);
-
-      virtual size_t execute(std::string *buf) override;
+  protected:
+    /// An edit as it was given to the rewriter. Deletes are replaces with an empty text, inserts have from == to.
+    struct Instruction {
+      bool isInsert;
+      size_t from;
+      size_t to;
+      std::string text;
     };
 
-    class ReplaceOp : public RewriteOperation {
-    private:
-      TokenStreamRewriter *const outerInstance;
-
-    public:
+    struct Replacement {
       size_t lastIndex;
+      std::string text;
+    };
 
-      ReplaceOp(TokenStreamRewriter *outerInstance, size_t from, size_t to, const std::string& text);
-      virtual size_t execute(std::string *buf) override;
-      virtual std::string toString() override;
-
-    private:
-      void InitializeInstanceFields();
+    /// All instructions of a program (for rollback()) and their combined effect: the text to insert before a token
+    /// index and the replaced token ranges, which never overlap.
+    struct Program {
+      std::vector<Instruction> instructions;
+      std::map<size_t, std::string> inserts;
+      std::map<size_t, Replacement> replaces;
     };
 
     /// Our source stream
@@ -247,90 +240,59 @@ namespace runtime {
 
     /// You may have multiple, named streams of rewrite operations.
     /// I'm calling these things "programs."
-    /// Maps String (name) -> rewrite (List)
-    std::map<std::string, std::vector<RewriteOperation*>> _programs;
+    std::map<std::string, Program> _programs;
 
     /// <summary>
     /// Map String (program name) -> Integer index </summary>
     std::map<std::string, int> _lastRewriteTokenIndexes;
     virtual int getLastRewriteTokenIndex(const std::string &programName);
     virtual void setLastRewriteTokenIndex(const std::string &programName, int i);
-    virtual std::vector<RewriteOperation*>& getProgram(const std::string &name);
+    virtual Program& getProgram(const std::string &name);
+
+    /// Adds the instruction to the program (see applyReplace() and applyInsert()) and records it.
+    virtual void addInstruction(const std::string &programName, const Instruction &instruction);
 
     /// <summary>
-    /// We need to combine operations and report invalid operations (like
-    ///  overlapping replaces that are not completed nested).  Inserts to
-    ///  same index need to be combined etc...   Here are the cases:
-    ///
-    ///  I.i.u I.j.v                                leave alone, nonoverlapping
-    ///  I.i.u I.i.v                                combine: Iivu
-    ///
-    ///  R.i-j.u R.x-y.v    | i-j in x-y            delete first R
-    ///  R.i-j.u R.i-j.v                            delete first R
-    ///  R.i-j.u R.x-y.v    | x-y in i-j            ERROR
-    ///  R.i-j.u R.x-y.v    | boundaries overlap    ERROR
-    ///
-    ///  Delete special case of replace (text==null):
-    ///  D.i-j.u D.x-y.v    | boundaries overlap    combine to max(min)..max(right)
+    /// Combines a replace with the earlier edits of the program, or throws an IllegalArgumentException (leaving the
+    ///  program unchanged) if they conflict. The rules are those of the original, lazily evaluated rewriter:
     ///
+    ///  I.i.u R.x-y.v | i == x                 R.x-y.uv (combine, delete I)
     ///  I.i.u R.x-y.v | i in (x+1)-y           delete I (since insert before
     ///                                         we're not deleting i)
-    ///  I.i.u R.x-y.v | i not in (x+1)-y       leave alone, nonoverlapping
-    ///  R.x-y.v I.i.u | i in x-y               ERROR
-    ///  R.x-y.v I.x.u                          R.x-y.uv (combine, delete I)
-    ///  R.x-y.v I.i.u | i not in x-y           leave alone, nonoverlapping
-    ///
-    ///  I.i.u = insert u before op @ index i
-    ///  R.x-y.u = replace x-y indexed tokens with u
-    ///
-    ///  First we need to examine replaces.  For any replace op:
-    ///
-    ///         1. wipe out any insertions before op within that range.
-    ///     2. Drop any replace op before that is contained completely within
-    ///         that range.
-    ///     3. Throw exception upon boundary overlap with any previous replace.
-    ///
-    ///  Then we can deal with inserts:
+    ///  R.i-j.u R.x-y.v    | i-j in x-y        delete first R
+    ///  R.i-j.u R.i-j.v                        delete first R
+    ///  R.i-j.u R.x-y.v    | x-y in i-j        ERROR
+    ///  R.i-j.u R.x-y.v    | boundaries overlap    ERROR
     ///
-    ///         1. for any inserts to same index, combine even if not adjacent.
-    ///         2. for any prior replace with same left boundary, combine this
-    ///         insert with replace and delete this replace.
-    ///         3. throw exception if index in same range as previous replace
+    ///  Delete special case of replace (text empty):
+    ///  D.i-j.u D.x-y.v    | boundaries overlap    combine to min(left)..max(right)
     ///
-    ///  Don't actually delete; make op null in list. Easier to walk list.
-    ///  Later we can throw as we add to index -> op map.
+    ///  where I.i.u = insert u before op @ index i and R.x-y.u = replace x-y indexed tokens with u.
     ///
     ///  Note that I.2 R.2-2 will wipe out I.2 even though, technically, the
     ///  inserted stuff would be before the replace range.  But, if you
     ///  add tokens in front of a method body '{' and then delete the method
     ///  body, I think the stuff before the '{' you added should disappear too.
     ///
-    ///  Return a map from token index to operation.
+    ///  Since the replaces in a program never overlap, only the one starting before x and those starting in x-y must
+    ///  be examined.
     /// </summary>
-    virtual std::unordered_map<size_t, RewriteOperation*> reduceToSingleOperationPerIndex(std::vector<RewriteOperation*> rewrites);
-
-    virtual std::string catOpText(std::string *a, std::string *b);
+    virtual void applyReplace(Program &program, size_t from, size_t to, const std::string &text);
 
     /// <summary>
-    /// Get all operations before an index of a particular kind </summary>
-    template <typename T, typename T1>
-    std::vector<T*> getKindOfOps(std::vector<T1*> rewrites, T * /*kind*/, size_t before) {
-      std::vector<T*> ops = std::vector<T*>();
-      for (size_t i = 0; i < before && i < rewrites.size(); i++) {
-        TokenStreamRewriter::RewriteOperation *op = dynamic_cast<RewriteOperation*>(rewrites[i]);
-        if (op == nullptr) { // ignore deleted
-          continue;
-        }
-        if (op != nullptr) {
-          ops.push_back(dynamic_cast<T*>(op));
-        }
-      }
-      return ops;
-    }
+    /// Combines an insert with the earlier edits of the program:
+    ///
+    ///  I.i.u I.i.v                            combine: Iivu
+    ///  I.i.u I.j.v                            leave alone, nonoverlapping
+    ///  R.x-y.v I.x.u                          R.x-y.uv (combine, delete I)
+    ///  R.x-y.v I.i.u | i in x-y               ERROR
+    ///  R.x-y.v I.i.u | i not in x-y           leave alone, nonoverlapping
+    /// </summary>
+    virtual void applyInsert(Program &program, size_t index, const std::string &text);
 
   private:
-    std::vector<RewriteOperation*> initializeProgram(const std::string &name);
-
+    std::string insertToString(size_t index, const std::string &text);
+    std::string replaceToString(size_t from, size_t to, const std::string &text);
   };
 
 } // namespace runtime
@@ -0,0 +1,255 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Exceptions.h"
+#include "misc/Interval.h"
+
+#include "UTF8CharStream.h"
+
+using namespace org::antlr::v4::runtime;
+
+using misc::Interval;
+
+static const ssize_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+UTF8CharStream::UTF8CharStream(const char *data, size_t length) {
+  setBuffer(data, length);
+}
+
+UTF8CharStream::UTF8CharStream() {
+  setBuffer(nullptr, 0);
+}
+
+void UTF8CharStream::setBuffer(const char *data, size_t length) {
+  // Ignore BOM if there's one.
+  if (length >= 3 && (unsigned char)data[0] == 0xEF && (unsigned char)data[1] == 0xBB && (unsigned char)data[2] == 0xBF) {
+    data += 3;
+    length -= 3;
+  }
+
+  _data = data;
+  _size = length;
+  _p = 0;
+  _lineStarts.clear();
+}
+
+void UTF8CharStream::reset() {
+  _p = 0;
+}
+
+void UTF8CharStream::consume() {
+  if (_p >= _size) {
+    assert(LA(1) == IntStream::EOF);
+    throw IllegalStateException("cannot consume EOF");
+  }
+
+  if ((unsigned char)_data[_p] < 0x80) {
+    ++_p;
+    return;
+  }
+
+  size_t length;
+  decode(_p, length);
+  _p += length;
+}
+
+ssize_t UTF8CharStream::LA(ssize_t i) {
+  if (i == 1) { // Fast path for the by far most common case.
+    if (_p >= _size) {
+      return IntStream::EOF;
+    }
+
+    unsigned char c = (unsigned char)_data[_p];
+    if (c < 0x80) {
+      return c;
+    }
+
+    size_t length;
+    return decode(_p, length);
+  }
+
+  if (i == 0) {
+    return 0; // undefined
+  }
+
+  size_t position = _p;
+  size_t length;
+  if (i > 0) {
+    for (ssize_t count = 1; count < i; ++count) {
+      if (position >= _size) {
+        return IntStream::EOF;
+      }
+      decode(position, length);
+      position += length;
+    }
+  } else {
+    for (ssize_t count = 0; count > i; --count) {
+      if (position == 0) {
+        return IntStream::EOF; // invalid; no char before first char
+      }
+
+      // Step back over the continuation bytes (at most 3) to the start of the previous code point.
+      size_t limit = position > 4 ? position - 4 : 0;
+      --position;
+      while (position > limit && ((unsigned char)_data[position] & 0xC0) == 0x80) {
+        --position;
+      }
+    }
+  }
+
+  if (position >= _size) {
+    return IntStream::EOF;
+  }
+
+  return decode(position, length);
+}
+
+size_t UTF8CharStream::index() {
+  return _p;
+}
+
+size_t UTF8CharStream::size() {
+  return _size;
+}
+
+// Mark/release do nothing. We have entire buffer.
+ssize_t UTF8CharStream::mark() {
+  return -1;
+}
+
+void UTF8CharStream::release(ssize_t /* marker */) {
+}
+
+void UTF8CharStream::seek(size_t index) {
+  // No line or position state to update here, so we can just jump.
+  _p = std::min(index, _size);
+}
+
+std::string UTF8CharStream::getText(const Interval &interval) {
+  if (interval.a < 0 || (size_t)interval.a >= _size || interval.b < interval.a) {
+    return "";
+  }
+
+  size_t start = (size_t)interval.a;
+  size_t stop = std::min((size_t)interval.b, _size - 1);
+  return std::string(_data + start, stop - start + 1);
+}
+
+std::string UTF8CharStream::getSourceName() const {
+  if (name.empty()) {
+    return IntStream::UNKNOWN_SOURCE_NAME;
+  }
+  return name;
+}
+
+std::string UTF8CharStream::toString() const {
+  if (_size == 0) {
+    return "";
+  }
+  return std::string(_data, _size);
+}
+
+size_t UTF8CharStream::getLineCount() {
+  if (_lineStarts.empty()) {
+    _lineStarts.push_back(0);
+    if (_size == 0) {
+      return 1;
+    }
+
+    const char *end = _data + _size;
+    for (const char *run = std::find(_data, end, '\n'); run != end; run = std::find(run, end, '\n')) {
+      ++run;
+      _lineStarts.push_back((size_t)(run - _data));
+    }
+  }
+
+  return _lineStarts.size();
+}
+
+std::string UTF8CharStream::getLineText(size_t line) {
+  if (line == 0 || line > getLineCount()) {
+    return "";
+  }
+
+  size_t start = _lineStarts[line - 1];
+  size_t stop = line < _lineStarts.size() ? _lineStarts[line] - 1 : _size; // Exclusive, without the \n.
+  if (stop > start && _data[stop - 1] == '\r') {
+    --stop;
+  }
+
+  return std::string(_data + start, stop - start);
+}
+
+ssize_t UTF8CharStream::decode(size_t position, size_t &length) const {
+  const unsigned char *input = reinterpret_cast<const unsigned char *>(_data) + position;
+  length = 1;
+
+  unsigned char c = input[0];
+  if (c < 0x80) {
+    return c;
+  }
+
+  size_t sequenceLength;
+  ssize_t result;
+  ssize_t minimum;
+  if ((c & 0xE0) == 0xC0) {
+    sequenceLength = 2;
+    result = c & 0x1F;
+    minimum = 0x80;
+  } else if ((c & 0xF0) == 0xE0) {
+    sequenceLength = 3;
+    result = c & 0x0F;
+    minimum = 0x800;
+  } else if ((c & 0xF8) == 0xF0) {
+    sequenceLength = 4;
+    result = c & 0x07;
+    minimum = 0x10000;
+  } else {
+    return REPLACEMENT_CHARACTER; // Stray continuation byte or invalid lead byte.
+  }
+
+  if (sequenceLength > _size - position) {
+    return REPLACEMENT_CHARACTER; // Truncated sequence at the end of the input.
+  }
+
+  for (size_t i = 1; i < sequenceLength; ++i) {
+    if ((input[i] & 0xC0) != 0x80) {
+      return REPLACEMENT_CHARACTER;
+    }
+    result = (result << 6) | (input[i] & 0x3F);
+  }
+
+  // Overlong forms, surrogates and values beyond the Unicode range cannot be converted back to UTF-8.
+  if (result < minimum || (result >= 0xD800 && result <= 0xDFFF) || result > 0x10FFFF) {
+    return REPLACEMENT_CHARACTER;
+  }
+
+  length = sequenceLength;
+  return result;
+}
@@ -0,0 +1,109 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "CharStream.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+
+  /// A char stream which reads UTF-8 encoded text directly from a buffer, without copying it or converting it to
+  /// UTF-32 first (as ANTLRInputStream does). Code points are decoded on the fly in LA() and consume(). A leading BOM
+  /// is skipped, invalid byte sequences are returned as U+FFFD (one per byte).
+  ///
+  /// All indices of this stream (index(), seek(), size(), getText() and hence the start/stop indices of tokens)
+  /// are byte offsets into the buffer, not code point counts. For pure ASCII input both are the same. This way
+  /// getText() can return the original bytes of the input without any re-encoding.
+  class ANTLR4CPP_PUBLIC UTF8CharStream : public CharStream {
+  public:
+    /// What is name or source of this char stream?
+    std::string name;
+
+    /// Wraps the given buffer, which is owned by the caller and must stay valid (and unchanged) as long as this
+    /// stream is in use.
+    UTF8CharStream(const char *data, size_t length);
+
+    /// Reset the stream so that it's in the same state it was when the object was created.
+    virtual void reset();
+    virtual void consume() override;
+    virtual ssize_t LA(ssize_t i) override;
+
+    /// The byte offset of the code point returned by LA(1).
+    virtual size_t index() override;
+
+    /// The size of the input in bytes.
+    virtual size_t size() override;
+
+    /// mark/release do nothing; we have entire buffer.
+    virtual ssize_t mark() override;
+    virtual void release(ssize_t marker) override;
+
+    /// Moves to the given byte offset, which should be the start of a code point (e.g. a value returned by index()).
+    virtual void seek(size_t index) override;
+
+    /// Returns the bytes between the two (inclusive) offsets given in the interval.
+    virtual std::string getText(const misc::Interval &interval) override;
+    virtual std::string getSourceName() const override;
+    virtual std::string toString() const override;
+
+    /// Returns the number of lines in the input. The line index used for this and getLineText() is built on first
+    /// use, so it doesn't delay the start of lexing.
+    size_t getLineCount();
+
+    /// Returns the text of the given line (1-based, like Token::getLine()), without its line terminator.
+    std::string getLineText(size_t line);
+
+  protected:
+    const char *_data;
+    size_t _size;
+
+    /// Byte offset of the next code point (LA(1)).
+    size_t _p;
+
+    /// Byte offsets of the first character of each line. Empty until needed.
+    std::vector<size_t> _lineStarts;
+
+    /// For derived classes which provide the buffer later (via setBuffer()).
+    UTF8CharStream();
+
+    void setBuffer(const char *data, size_t length);
+
+  private:
+    /// Decodes the code point starting at the given byte offset (which must be < _size) and returns it along
+    /// with its length in bytes.
+    ssize_t decode(size_t position, size_t &length) const;
+  };
+
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
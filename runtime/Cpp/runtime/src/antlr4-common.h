@@ -30,10 +30,12 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <assert.h>
 #include <codecvt>
 #include <chrono>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <limits.h>
 #include <list>
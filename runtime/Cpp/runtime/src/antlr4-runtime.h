@@ -44,12 +44,14 @@
 #include "CommonToken.h"
 #include "CommonTokenFactory.h"
 #include "CommonTokenStream.h"
+#include "ConcurrentTokenStream.h"
 #include "ConsoleErrorListener.h"
 #include "DefaultErrorStrategy.h"
 #include "DiagnosticErrorListener.h"
 #include "Exceptions.h"
 #include "FailedPredicateException.h"
 #include "IRecognizer.h"
+#include "IncrementalParser.h"
 #include "InputMismatchException.h"
 #include "IntStream.h"
 #include "InterpreterRuleContext.h"
@@ -57,21 +59,26 @@
 #include "LexerInterpreter.h"
 #include "LexerNoViableAltException.h"
 #include "ListTokenSource.h"
+#include "MappedFileStream.h"
 #include "NoViableAltException.h"
+#include "ParallelParseDriver.h"
 #include "Parser.h"
 #include "ParserInterpreter.h"
 #include "ParserRuleContext.h"
 #include "ProxyErrorListener.h"
 #include "RecognitionException.h"
 #include "Recognizer.h"
+#include "RingBufferCharStream.h"
 #include "RuleContext.h"
 #include "RuleContextWithAltNum.h"
 #include "RuntimeMetaData.h"
 #include "Token.h"
 #include "TokenFactory.h"
 #include "TokenSource.h"
+#include "TokenStore.h"
 #include "TokenStream.h"
 #include "TokenStreamRewriter.h"
+#include "UTF8CharStream.h"
 #include "UnbufferedCharStream.h"
 #include "UnbufferedTokenStream.h"
 #include "Vocabulary.h"
@@ -103,6 +110,7 @@
 #include "atn/EmptyPredictionContext.h"
 #include "atn/EpsilonTransition.h"
 #include "atn/ErrorInfo.h"
+#include "atn/FlatATN.h"
 #include "atn/LL1Analyzer.h"
 #include "atn/LexerATNConfig.h"
 #include "atn/LexerATNSimulator.h"
@@ -124,12 +132,15 @@
 #include "atn/OrderedATNConfigSet.h"
 #include "atn/ParseInfo.h"
 #include "atn/ParserATNSimulator.h"
+#include "atn/ParseTelemetry.h"
 #include "atn/PlusBlockStartState.h"
 #include "atn/PlusLoopbackState.h"
 #include "atn/PrecedencePredicateTransition.h"
 #include "atn/PredicateEvalInfo.h"
 #include "atn/PredicateTransition.h"
 #include "atn/PredictionContext.h"
+#include "atn/PredictionContextCache.h"
+#include "atn/PredictionContextMergeCache.h"
 #include "atn/PredictionMode.h"
 #include "atn/ProfilingATNSimulator.h"
 #include "atn/RangeTransition.h"
@@ -142,11 +153,14 @@
 #include "atn/StarBlockStartState.h"
 #include "atn/StarLoopEntryState.h"
 #include "atn/StarLoopbackState.h"
+#include "atn/StaticLexerDFA.h"
+#include "atn/TelemetryATNSimulator.h"
 #include "atn/TokensStartState.h"
 #include "atn/Transition.h"
 #include "atn/WildcardTransition.h"
 #include "dfa/DFA.h"
 #include "dfa/DFASerializer.h"
+#include "dfa/DFASnapshot.h"
 #include "dfa/DFAState.h"
 #include "dfa/LexerDFASerializer.h"
 #include "misc/Interval.h"
@@ -154,6 +168,7 @@
 #include "misc/MurmurHash.h"
 #include "misc/Predicate.h"
 #include "misc/TestRig.h"
+#include "support/Arena.h"
 #include "support/Arrays.h"
 #include "support/BitSet.h"
 #include "support/CPPUtils.h"
@@ -165,6 +180,7 @@
 #include "tree/ParseTree.h"
 #include "tree/ParseTreeListener.h"
 #include "tree/ParseTreeProperty.h"
+#include "tree/ParseTreeType.h"
 #include "tree/ParseTreeVisitor.h"
 #include "tree/ParseTreeWalker.h"
 #include "tree/RuleNode.h"
@@ -174,6 +190,7 @@
 #include "tree/Tree.h"
 #include "tree/Trees.h"
 #include "tree/pattern/Chunk.h"
+#include "tree/pattern/MultiPatternMatcher.h"
 #include "tree/pattern/ParseTreeMatch.h"
 #include "tree/pattern/ParseTreePattern.h"
 #include "tree/pattern/ParseTreePatternMatcher.h"
@@ -181,4 +198,7 @@
 #include "tree/pattern/TagChunk.h"
 #include "tree/pattern/TextChunk.h"
 #include "tree/pattern/TokenTagToken.h"
+#include "tree/xpath/XPath.h"
+#include "tree/xpath/XPathElement.h"
 #include "tree/xpath/XPathLexer.h"
+#include "tree/xpath/XPathMatcher.h"
@@ -59,9 +59,15 @@ ATN::ATN(ATN &&other) {
   ruleToTokenType = std::move(other.ruleToTokenType);
   lexerActions = std::move(other.lexerActions);
   modeToStartState = std::move(other.modeToStartState);
+  charClassStarts = std::move(other.charClassStarts);
+  decisionToLL1Table = std::move(other.decisionToLL1Table);
+  nextTokenSets = std::move(other.nextTokenSets);
+  nextTokenSetWords = other.nextTokenSetWords;
+  flat = std::move(other.flat);
 }
 
-ATN::ATN(ATNType grammarType, size_t maxTokenType) : grammarType(grammarType), maxTokenType(maxTokenType) {
+ATN::ATN(ATNType grammarType, size_t maxTokenType)
+  : grammarType(grammarType), maxTokenType(maxTokenType), nextTokenSetWords(0) {
 }
 
 ATN::~ATN() {
@@ -83,6 +89,11 @@ ATN& ATN::operator = (ATN &other) NOEXCEPT {
   ruleToTokenType = other.ruleToTokenType;
   lexerActions = other.lexerActions;
   modeToStartState = other.modeToStartState;
+  charClassStarts = other.charClassStarts;
+  decisionToLL1Table = other.decisionToLL1Table;
+  nextTokenSets = other.nextTokenSets;
+  nextTokenSetWords = other.nextTokenSetWords;
+  flat = other.flat;
 
   return *this;
 }
@@ -101,6 +112,11 @@ ATN& ATN::operator = (ATN &&other) NOEXCEPT {
   ruleToTokenType = std::move(other.ruleToTokenType);
   lexerActions = std::move(other.lexerActions);
   modeToStartState = std::move(other.modeToStartState);
+  charClassStarts = std::move(other.charClassStarts);
+  decisionToLL1Table = std::move(other.decisionToLL1Table);
+  nextTokenSets = std::move(other.nextTokenSets);
+  nextTokenSetWords = other.nextTokenSetWords;
+  flat = std::move(other.flat);
 
   return *this;
 }
@@ -111,7 +127,13 @@ misc::IntervalSet ATN::nextTokens(ATNState *s, Ref<RuleContext> ctx) const {
 
 }
 
-misc::IntervalSet ATN::nextTokens(ATNState *s) const {
+const misc::IntervalSet& ATN::nextTokens(ATNState *s) const {
+  // Precomputed sets are immutable and can be read without locking.
+  if ((size_t)s->stateNumber * nextTokenSetWords < nextTokenSets.size()) {
+    return s->nextTokenWithinRule;
+  }
+
+  std::lock_guard<std::mutex> lck(_mutex);
   if (s->nextTokenWithinRule.isEmpty()) {
     s->nextTokenWithinRule = nextTokens(s, nullptr);
     s->nextTokenWithinRule.setReadOnly(true);
@@ -119,6 +141,22 @@ misc::IntervalSet ATN::nextTokens(ATNState *s) const {
   return s->nextTokenWithinRule;
 }
 
+bool ATN::isInNextTokens(ATNState *s, ssize_t symbol) const {
+  size_t offset = (size_t)s->stateNumber * nextTokenSetWords;
+  if (offset >= nextTokenSets.size()) {
+    return nextTokens(s).contains((int)symbol);
+  }
+
+  if (symbol < Token::EPSILON) {
+    return false;
+  }
+  size_t bit = (size_t)(symbol + 2);
+  if (bit >= nextTokenSetWords * 64) {
+    return false;
+  }
+  return (nextTokenSets[offset + bit / 64] >> (bit % 64) & 1) != 0;
+}
+
 void ATN::addState(ATNState *state) {
   if (state != nullptr) {
     //state->atn = this;
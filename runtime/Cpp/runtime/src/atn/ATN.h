@@ -32,6 +32,7 @@
 #pragma once
 
 #include "RuleContext.h"
+#include "atn/FlatATN.h"
 
 namespace org {
 namespace antlr {
@@ -83,6 +84,30 @@ namespace atn {
 
     std::vector<TokensStartState *> modeToStartState;
 
+    /// For lexer ATNs: the sorted start values of the equivalence classes of code points above the lexer's
+    /// directly indexed (ASCII) DFA edge range. All code points in one class are matched by exactly the same
+    /// transitions, so the lexer DFA needs only one edge per class. Computed by the ATNDeserializer. If empty
+    /// non-ASCII input is never cached in the DFA.
+    std::vector<size_t> charClassStarts;
+
+    /// For parser ATNs: the prediction tables of the decisions whose alternatives have disjoint and predicate free
+    /// lookahead of one token (indexed by decision number). A table maps the token type + 1 (so EOF maps to 0) to the
+    /// predicted alternative, or to INVALID_ALT_NUMBER for tokens outside the decision's lookahead. Other decisions
+    /// have an empty table. Computed by the ATNDeserializer.
+    std::vector<std::vector<uint16_t>> decisionToLL1Table;
+
+    /// For parser ATNs: nextTokens(s) of every state as a dense bit set, so error recovery can test a symbol without
+    /// locking or allocating. The set of a state occupies nextTokenSetWords words, starting at word
+    /// stateNumber * nextTokenSetWords. Bit (type + 2) is set if token type {@code type} is in the set (EPSILON maps
+    /// to bit 0, EOF to bit 1). Computed by the ATNDeserializer, which also fills ATNState::nextTokenWithinRule of
+    /// all states.
+    std::vector<uint64_t> nextTokenSets;
+    size_t nextTokenSetWords;
+
+    /// The states and transitions in contiguous arrays, used by the simulators to compute reach and closure sets.
+    /// Computed by the ATNDeserializer. If empty the simulators work on the states directly.
+    FlatATN flat;
+
     ATN& operator = (ATN &other) NOEXCEPT;
     ATN& operator = (ATN &&other) NOEXCEPT;
 
@@ -99,7 +124,10 @@ namespace atn {
     /// staying in same rule. <seealso cref="Token#EPSILON"/> is in set if we reach end of
     /// rule.
     /// </summary>
-    virtual misc::IntervalSet nextTokens(ATNState *s) const;
+    virtual const misc::IntervalSet& nextTokens(ATNState *s) const;
+
+    /// Returns true if {@code symbol} is in nextTokens(s). Uses the precomputed bit sets if available.
+    bool isInNextTokens(ATNState *s, ssize_t symbol) const;
 
     virtual void addState(ATNState *state);
 
@@ -132,6 +160,9 @@ namespace atn {
     virtual misc::IntervalSet getExpectedTokens(int stateNumber, Ref<RuleContext> context) const;
 
     std::string toString() const;
+
+  private:
+    mutable std::mutex _mutex; // Guards the lazily computed nextTokenWithinRule sets of ATNs without nextTokenSets.
   };
   
 } // namespace atn
@@ -48,25 +48,25 @@ ATNConfig::ATNConfig(ATNState *state, int alt, Ref<PredictionContext> context, R
   reachesIntoOuterContext = 0;
 }
 
-ATNConfig::ATNConfig(Ref<ATNConfig> c) : ATNConfig(c, c->state, c->context, c->semanticContext) {
+ATNConfig::ATNConfig(const Ref<ATNConfig> &c) : ATNConfig(c, c->state, c->context, c->semanticContext) {
 }
 
-ATNConfig::ATNConfig(Ref<ATNConfig> c, ATNState *state) : ATNConfig(c, state, c->context, c->semanticContext) {
+ATNConfig::ATNConfig(const Ref<ATNConfig> &c, ATNState *state) : ATNConfig(c, state, c->context, c->semanticContext) {
 }
 
-ATNConfig::ATNConfig(Ref<ATNConfig> c, ATNState *state, Ref<SemanticContext> semanticContext)
+ATNConfig::ATNConfig(const Ref<ATNConfig> &c, ATNState *state, Ref<SemanticContext> semanticContext)
   : ATNConfig(c, state, c->context, semanticContext) {
 }
 
-ATNConfig::ATNConfig(Ref<ATNConfig> c, Ref<SemanticContext> semanticContext)
+ATNConfig::ATNConfig(const Ref<ATNConfig> &c, Ref<SemanticContext> semanticContext)
   : ATNConfig(c, c->state, c->context, semanticContext) {
 }
 
-ATNConfig::ATNConfig(Ref<ATNConfig> c, ATNState *state, Ref<PredictionContext> context)
+ATNConfig::ATNConfig(const Ref<ATNConfig> &c, ATNState *state, Ref<PredictionContext> context)
   : ATNConfig(c, state, context, c->semanticContext) {
 }
 
-ATNConfig::ATNConfig(Ref<ATNConfig> c, ATNState *state, Ref<PredictionContext> context, Ref<SemanticContext> semanticContext)
+ATNConfig::ATNConfig(const Ref<ATNConfig> &c, ATNState *state, Ref<PredictionContext> context, Ref<SemanticContext> semanticContext)
   : state(state), alt(c->alt), context(context), reachesIntoOuterContext(c->reachesIntoOuterContext),
     semanticContext(semanticContext) {
 }
@@ -74,6 +74,10 @@ ATNConfig::ATNConfig(Ref<ATNConfig> c, ATNState *state, Ref<PredictionContext> c
 ATNConfig::~ATNConfig() {
 }
 
+Ref<ATNConfig> ATNConfig::clone() const {
+  return std::make_shared<ATNConfig>(*this);
+}
+
 size_t ATNConfig::hashCode() const {
   size_t hashCode = misc::MurmurHash::initialize(7);
   hashCode = misc::MurmurHash::update(hashCode, (size_t)state->stateNumber);
@@ -103,11 +107,15 @@ void ATNConfig::setPrecedenceFilterSuppressed(bool value) {
 bool ATNConfig::operator == (const ATNConfig &other) const
 {
   return state->stateNumber == other.state->stateNumber && alt == other.alt &&
-    (context == other.context || (context != nullptr && context == other.context)) &&
-    semanticContext == other.semanticContext &&
+    (context == other.context || (context != nullptr && other.context != nullptr && *context == *other.context)) &&
+    (semanticContext == other.semanticContext || *semanticContext == *other.semanticContext) &&
     isPrecedenceFilterSuppressed() == other.isPrecedenceFilterSuppressed();
 }
 
+bool ATNConfig::operator != (const ATNConfig &other) const {
+  return !operator==(other);
+}
+
 std::string ATNConfig::toString() {
   return toString(true);
 }
@@ -97,15 +97,18 @@ namespace atn {
     ATNConfig(ATNState *state, int alt, Ref<PredictionContext> context);
     ATNConfig(ATNState *state, int alt, Ref<PredictionContext> context, Ref<SemanticContext> semanticContext);
 
-    ATNConfig(Ref<ATNConfig> c); // dup
-    ATNConfig(Ref<ATNConfig> c, ATNState *state);
-    ATNConfig(Ref<ATNConfig> c, ATNState *state, Ref<SemanticContext> semanticContext);
-    ATNConfig(Ref<ATNConfig> c, Ref<SemanticContext> semanticContext);
-    ATNConfig(Ref<ATNConfig> c, ATNState *state, Ref<PredictionContext> context);
-    ATNConfig(Ref<ATNConfig> c, ATNState *state, Ref<PredictionContext> context, Ref<SemanticContext> semanticContext);
+    ATNConfig(const Ref<ATNConfig> &c); // dup
+    ATNConfig(const Ref<ATNConfig> &c, ATNState *state);
+    ATNConfig(const Ref<ATNConfig> &c, ATNState *state, Ref<SemanticContext> semanticContext);
+    ATNConfig(const Ref<ATNConfig> &c, Ref<SemanticContext> semanticContext);
+    ATNConfig(const Ref<ATNConfig> &c, ATNState *state, Ref<PredictionContext> context);
+    ATNConfig(const Ref<ATNConfig> &c, ATNState *state, Ref<PredictionContext> context, Ref<SemanticContext> semanticContext);
 
     virtual ~ATNConfig();
 
+    /// Creates a heap allocated copy of this configuration, e.g. to keep it beyond the lifetime of an arena chunk.
+    virtual Ref<ATNConfig> clone() const;
+
     virtual size_t hashCode() const;
 
     struct ATNConfigHasher
@@ -134,7 +137,9 @@ namespace atn {
     /// An ATN configuration is equal to another if both have
     /// the same state, they predict the same alternative, and
     /// syntactic/semantic contexts are the same.
-    bool operator == (const ATNConfig &other) const;
+    /// The contexts are compared by content, not by identity, which is what DFA state interning relies on.
+    virtual bool operator == (const ATNConfig &other) const;
+    bool operator != (const ATNConfig &other) const;
 
     virtual std::string toString();
     std::string toString(bool showAlt);
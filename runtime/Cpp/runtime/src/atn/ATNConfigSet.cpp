@@ -70,11 +70,11 @@ ATNConfigSet::ATNConfigSet(Ref<ATNConfigSet> old) : ATNConfigSet(old->fullCtx) {
 ATNConfigSet::~ATNConfigSet() {
 }
 
-bool ATNConfigSet::add(Ref<ATNConfig> config) {
+bool ATNConfigSet::add(const Ref<ATNConfig> &config) {
   return add(config, nullptr);
 }
 
-bool ATNConfigSet::add(Ref<ATNConfig> config, PredictionContextMergeCache *mergeCache) {
+bool ATNConfigSet::add(const Ref<ATNConfig> &config, PredictionContextMergeCache *mergeCache) {
   if (_readonly) {
     throw IllegalStateException("This set is readonly");
   }
@@ -125,7 +125,7 @@ std::vector<Ref<ATNConfig>> ATNConfigSet::elements() {
 
 std::vector<ATNState*> ATNConfigSet::getStates() {
   std::vector<ATNState*> states;
-  for (auto c : configs) {
+  for (auto &c : configs) {
     states.push_back(c->state);
   }
   return states;
@@ -142,15 +142,15 @@ std::vector<ATNState*> ATNConfigSet::getStates() {
 
 BitSet ATNConfigSet::getAlts() {
   BitSet alts;
-  for (ATNConfig config : configs) {
-    alts.set(config.alt);
+  for (auto &config : configs) {
+    alts.set(config->alt);
   }
   return alts;
 }
 
 std::vector<Ref<SemanticContext>> ATNConfigSet::getPredicates() {
   std::vector<Ref<SemanticContext>> preds;
-  for (auto c : configs) {
+  for (auto &c : configs) {
     if (c->semanticContext != SemanticContext::NONE) {
       preds.push_back(c->semanticContext);
     }
@@ -175,32 +175,41 @@ void ATNConfigSet::optimizeConfigs(ATNSimulator *interpreter) {
   }
 }
 
+void ATNConfigSet::promoteConfigs() {
+  for (auto &config : configs) {
+    config = config->clone();
+  }
+
+  if (configLookup != nullptr) {
+    configLookup->clear();
+    for (auto &config : configs) {
+      configLookup->getOrAdd(config);
+    }
+  }
+}
+
 bool ATNConfigSet::operator == (const ATNConfigSet &other) {
   if (&other == this) {
     return true;
   }
 
-  bool configEquals = true;
-  if (configs.size() == other.configs.size()) {
-    for (size_t i = 0; i < configs.size(); i++) {
-      if (other.configs.size() < i) {
-        configEquals = false;
-        break;
-      }
-      if (configs[i] != other.configs[i]) {
-        configEquals = false;
-        break;
-      }
-    }
-  } else {
-    configEquals = false;
+  if (configs.size() != other.configs.size()) {
+    return false;
   }
 
-  bool same = configs.size() > 0 && configEquals && fullCtx == other.fullCtx && uniqueAlt == other.uniqueAlt &&
-    conflictingAlts == other.conflictingAlts && hasSemanticContext == other.hasSemanticContext &&
-    dipsIntoOuterContext == other.dipsIntoOuterContext; // includes stack context
+  if (fullCtx != other.fullCtx || uniqueAlt != other.uniqueAlt || conflictingAlts != other.conflictingAlts ||
+      hasSemanticContext != other.hasSemanticContext || dipsIntoOuterContext != other.dipsIntoOuterContext) { // includes stack context
+    return false;
+  }
 
-  return same;
+  // Compare the configs by content, so that equal sets computed at different times match.
+  for (size_t i = 0; i < configs.size(); i++) {
+    if (configs[i] != other.configs[i] && *configs[i] != *other.configs[i]) {
+      return false;
+    }
+  }
+
+  return true;
 }
 
 size_t ATNConfigSet::hashCode() {
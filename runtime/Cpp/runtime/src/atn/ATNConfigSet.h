@@ -91,7 +91,7 @@ namespace atn {
 
     virtual ~ATNConfigSet();
 
-    virtual bool add(Ref<ATNConfig> config);
+    virtual bool add(const Ref<ATNConfig> &config);
 
     /// <summary>
     /// Adding a new config means merging contexts with existing configs for
@@ -103,7 +103,7 @@ namespace atn {
     /// This method updates <seealso cref="#dipsIntoOuterContext"/> and
     /// <seealso cref="#hasSemanticContext"/> when necessary.
     /// </summary>
-    virtual bool add(Ref<ATNConfig> config, PredictionContextMergeCache *mergeCache);
+    virtual bool add(const Ref<ATNConfig> &config, PredictionContextMergeCache *mergeCache);
 
     /// <summary>
     /// Return a List holding list of configs </summary>
@@ -126,6 +126,11 @@ namespace atn {
 
     virtual void optimizeConfigs(ATNSimulator *interpreter);
 
+    /// Replaces all configurations by heap allocated copies with the same content. Used for sets which are kept
+    /// beyond the prediction that computed them (the configs of a DFA state), so that they don't keep
+    /// chunks of the simulator's configuration arena alive.
+    void promoteConfigs();
+
     bool addAll(Ref<ATNConfigSet> other);
 
     bool operator == (const ATNConfigSet &other);
@@ -59,7 +59,10 @@
 #include "atn/SetTransition.h"
 #include "atn/NotSetTransition.h"
 #include "atn/WildcardTransition.h"
+#include "atn/LexerATNSimulator.h"
+#include "atn/LL1Analyzer.h"
 #include "Token.h"
+#include "Lexer.h"
 
 #include "misc/IntervalSet.h"
 #include "Exceptions.h"
@@ -280,7 +283,10 @@ ATN ATNDeserializer::deserialize(const std::vector<uint16_t>& input) {
     }
 
     for (int j = 0; j < nintervals; j++) {
-      set.add(data[p], data[p + 1]);
+      // XXX: temporary hack to make the full Unicode range available (the serialized ATN cannot hold larger values).
+      // This used to be done for every Interval, which broke intervals of stream indices ending at 0xFFFF.
+      int b = data[p + 1] == 0xFFFF ? (int)Lexer::MAX_CHAR_VALUE : data[p + 1];
+      set.add(data[p], b);
       p += 2;
     }
     sets.push_back(set);
@@ -511,6 +517,15 @@ ATN ATNDeserializer::deserialize(const std::vector<uint16_t>& input) {
     }
   }
 
+  // The derived tables must see the bypass alternatives, if any.
+  if (atn.grammarType == ATNType::LEXER) {
+    computeCharClasses(atn);
+  } else {
+    computeLL1Tables(atn);
+    computeNextTokenSets(atn);
+  }
+  computeFlatATN(atn);
+
   return atn;
 }
 
@@ -542,6 +557,194 @@ void ATNDeserializer::markPrecedenceDecisions(const ATN &atn) {
   }
 }
 
+void ATNDeserializer::computeCharClasses(ATN &atn) {
+  // Each interval of a transition label starts a new class at its first code point and right after its last one.
+  // All code points between two such boundaries are then matched (or not) by exactly the same transitions.
+  // Wildcards and negated sets match everything outside of their label, so they need no boundaries of their own.
+  std::set<ssize_t> boundaries;
+  boundaries.insert(LexerATNSimulator::MAX_DFA_EDGE + 1);
+  for (ATNState *state : atn.states) {
+    for (size_t i = 0; i < state->getNumberOfTransitions(); i++) {
+      Transition *transition = state->transition(i);
+      if (transition->isEpsilon()) {
+        continue;
+      }
+
+      for (const misc::Interval &interval : transition->label().getIntervals()) {
+        boundaries.insert(interval.a);
+        boundaries.insert((ssize_t)interval.b + 1);
+      }
+    }
+  }
+
+  atn.charClassStarts.clear();
+  for (ssize_t boundary : boundaries) {
+    if (boundary > LexerATNSimulator::MAX_DFA_EDGE && boundary <= (ssize_t)Lexer::MAX_CHAR_VALUE) {
+      atn.charClassStarts.push_back((size_t)boundary);
+    }
+  }
+}
+
+void ATNDeserializer::computeLL1Tables(ATN &atn) {
+  LL1Analyzer analyzer(atn);
+  atn.decisionToLL1Table.clear();
+  atn.decisionToLL1Table.resize(atn.decisionToState.size());
+  for (size_t decision = 0; decision < atn.decisionToState.size(); decision++) {
+    DecisionState *state = atn.decisionToState[decision];
+    if (state->getNumberOfTransitions() < 2 || state->getNumberOfTransitions() > UINT16_MAX) {
+      continue;
+    }
+
+    // Precedence decisions depend on the precedence level of the current invocation.
+    if (is<StarLoopEntryState *>(state) && static_cast<StarLoopEntryState *>(state)->isPrecedenceDecision) {
+      continue;
+    }
+
+    // The lookahead of an alternative is empty if it hits a predicate. It contains EPSILON if the decision can
+    // only be made with the lookahead of the calling rule.
+    std::vector<misc::IntervalSet> lookahead = analyzer.getDecisionLookahead(state);
+    std::vector<uint16_t> table(atn.maxTokenType + 2, (uint16_t)ATN::INVALID_ALT_NUMBER);
+    bool isLL1 = true;
+    for (size_t alt = 0; alt < lookahead.size() && isLL1; alt++) {
+      if (lookahead[alt].isEmpty() || lookahead[alt].contains(Token::EPSILON)) {
+        isLL1 = false;
+        break;
+      }
+
+      for (const misc::Interval &interval : lookahead[alt].getIntervals()) {
+        if (interval.a < Token::EOF || interval.b > (int)atn.maxTokenType) {
+          isLL1 = false;
+          break;
+        }
+
+        for (int type = interval.a; type <= interval.b; type++) {
+          uint16_t &entry = table[(size_t)(type + 1)];
+          if (entry != ATN::INVALID_ALT_NUMBER) {
+            isLL1 = false; // The lookahead of two alternatives overlaps.
+            break;
+          }
+          entry = (uint16_t)(alt + 1);
+        }
+        if (!isLL1) {
+          break;
+        }
+      }
+    }
+
+    if (isLL1) {
+      atn.decisionToLL1Table[decision] = std::move(table);
+    }
+  }
+}
+
+void ATNDeserializer::computeNextTokenSets(ATN &atn) {
+  LL1Analyzer analyzer(atn);
+  int maxType = (int)atn.maxTokenType;
+  for (ATNState *state : atn.states) {
+    if (state == nullptr) {
+      continue;
+    }
+
+    state->nextTokenWithinRule = analyzer.LOOK(state, nullptr);
+    state->nextTokenWithinRule.setReadOnly(true);
+    if (!state->nextTokenWithinRule.isEmpty()) {
+      maxType = std::max(maxType, state->nextTokenWithinRule.getMaxElement()); // Includes rule bypass tokens.
+    }
+  }
+
+  // Bit (type + 2) of a state's set stands for token type {@code type}, which starts with EPSILON (-2).
+  size_t words = (size_t)(maxType + 2) / 64 + 1;
+  atn.nextTokenSets.assign(atn.states.size() * words, 0);
+  for (ATNState *state : atn.states) {
+    if (state == nullptr) {
+      continue;
+    }
+
+    uint64_t *bits = &atn.nextTokenSets[(size_t)state->stateNumber * words];
+    for (const misc::Interval &interval : state->nextTokenWithinRule.getIntervals()) {
+      for (int type = std::max(interval.a, (int)Token::EPSILON); type <= interval.b; type++) {
+        size_t bit = (size_t)(type + 2);
+        bits[bit / 64] |= (uint64_t)1 << (bit % 64);
+      }
+    }
+  }
+  atn.nextTokenSetWords = words;
+}
+
+void ATNDeserializer::computeFlatATN(ATN &atn) {
+  FlatATN &flat = atn.flat;
+  flat.states.clear();
+  flat.transitions.clear();
+  flat.sets.clear();
+
+  // Lexer sets can contain any code point, so their bit sets only cover Latin-1 (which is where most input is).
+  flat.setBitsLimit = atn.grammarType == ATNType::LEXER ? 256 : atn.maxTokenType + 1;
+  flat.setWords = (flat.setBitsLimit + 1) / 64 + 1;
+
+  for (ATNState *state : atn.states) {
+    FlatATN::State flatState;
+    flatState.firstTransition = (uint32_t)flat.transitions.size();
+    flatState.type = ATNState::ATN_INVALID_TYPE;
+    flatState.epsilonOnlyTransitions = false;
+    if (state != nullptr) {
+      flatState.type = (uint8_t)state->getStateType();
+      flatState.epsilonOnlyTransitions = state->onlyHasEpsilonTransitions();
+      for (Transition *transition : state->getTransitions()) {
+        FlatATN::Edge edge;
+        edge.target = (uint32_t)transition->target->stateNumber;
+        edge.type = (uint8_t)transition->getSerializationType();
+        edge.epsilon = transition->isEpsilon();
+        edge.label = 0;
+        edge.labelEnd = 0;
+
+        switch (edge.type) {
+          case Transition::ATOM:
+            edge.label = static_cast<AtomTransition *>(transition)->_label;
+            break;
+
+          case Transition::RANGE: {
+            RangeTransition *range = static_cast<RangeTransition *>(transition);
+            edge.label = range->from;
+            edge.labelEnd = range->to;
+            break;
+          }
+
+          case Transition::SET:
+          case Transition::NOT_SET: {
+            // NotSetTransition is a SetTransition with the result inverted.
+            const misc::IntervalSet &set = static_cast<SetTransition *>(transition)->set;
+            edge.label = flat.sets.size();
+            flat.sets.push_back(&set);
+            flat.setBits.resize(flat.sets.size() * flat.setWords);
+
+            uint64_t *bits = &flat.setBits[edge.label * flat.setWords];
+            for (const misc::Interval &interval : set.getIntervals()) {
+              int last = std::min(interval.b, (int)flat.setBitsLimit - 1);
+              for (int symbol = std::max(interval.a, (int)Token::EOF); symbol <= last; symbol++) {
+                size_t bit = (size_t)(symbol + 1);
+                bits[bit / 64] |= (uint64_t)1 << (bit % 64);
+              }
+            }
+            break;
+          }
+
+          default:
+            break;
+        }
+        flat.transitions.push_back(edge);
+      }
+    }
+    flat.states.push_back(flatState);
+  }
+
+  // The end marker for the transitions of the last state.
+  FlatATN::State end;
+  end.firstTransition = (uint32_t)flat.transitions.size();
+  end.type = ATNState::ATN_INVALID_TYPE;
+  end.epsilonOnlyTransitions = false;
+  flat.states.push_back(end);
+}
+
 void ATNDeserializer::verifyATN(const ATN &atn) {
   // verify assumptions
   for (ATNState *state : atn.states) {
@@ -57,6 +57,23 @@ namespace atn {
     virtual ATN deserialize(const std::vector<uint16_t> &input);
     virtual void verifyATN(const ATN &atn);
 
+    /// Splits the code points above the lexer's directly indexed DFA range into classes of code points which are
+    /// matched by the same transitions and stores them in ATN::charClassStarts. Done automatically for deserialized
+    /// lexer ATNs.
+    void computeCharClasses(ATN &atn);
+
+    /// Finds the decisions which can be predicted from the next token alone and stores a prediction table for them
+    /// in ATN::decisionToLL1Table. Done automatically for deserialized parser ATNs.
+    void computeLL1Tables(ATN &atn);
+
+    /// Computes ATN::nextTokens(s) for every state, stores it in ATNState::nextTokenWithinRule and as a bit set in
+    /// ATN::nextTokenSets. Done automatically for deserialized parser ATNs.
+    void computeNextTokenSets(ATN &atn);
+
+    /// Copies the states and transitions into ATN::flat. Done automatically for deserialized ATNs. Must be repeated
+    /// after changing the transitions of the ATN.
+    void computeFlatATN(ATN &atn);
+
     static void checkCondition(bool condition);
     static void checkCondition(bool condition, const std::string &message);
 
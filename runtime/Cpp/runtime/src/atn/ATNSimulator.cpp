@@ -56,7 +56,7 @@ Ref<PredictionContextCache> ATNSimulator::getSharedContextCache() {
 }
 
 Ref<PredictionContext> ATNSimulator::getCachedContext(Ref<PredictionContext> context) {
-  std::lock_guard<std::recursive_mutex> lck(mtx);
+  // The cache synchronizes itself, the visited map is local to this call.
   std::map<Ref<PredictionContext>, Ref<PredictionContext>> visited;
   return PredictionContext::getCachedContext(context, _sharedContextCache, visited);
 }
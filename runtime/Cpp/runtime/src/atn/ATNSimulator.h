@@ -34,6 +34,7 @@
 #include "atn/ATN.h"
 #include "misc/IntervalSet.h"
 #include "atn/PredictionContext.h"
+#include "support/Arena.h"
 
 namespace org {
 namespace antlr {
@@ -109,7 +110,11 @@ namespace atn {
     ///  so it's not worth the complexity.
     /// </summary>
     Ref<PredictionContextCache> _sharedContextCache;
-    
+
+    /// Storage for the configurations created while computing a prediction. Reset at the end of each prediction.
+    /// Configurations stored in DFA states are copied to the heap (see ATNConfigSet::promoteConfigs()), so they don't
+    /// keep chunks alive for the lifetime of the DFA.
+    antlrcpp::Arena _configArena;
   };
 
 } // namespace atn
@@ -85,7 +85,7 @@ std::string ATNState::toString() const {
   return ss.str();
 }
 
-std::vector<Transition*> ATNState::getTransitions() {
+const std::vector<Transition*>& ATNState::getTransitions() const {
   return transitions;
 }
 
@@ -117,8 +117,9 @@ void ATNState::setTransition(size_t i, Transition *e) {
 }
 
 Transition *ATNState::removeTransition(int index) {
+  Transition *result = transitions[(size_t)index];
   transitions.erase(transitions.begin() + index);
-  return nullptr;
+  return result;
 }
 
 bool ATNState::onlyHasEpsilonTransitions() {
@@ -136,7 +136,7 @@ namespace atn {
     std::vector<Transition*> transitions;
 
   public:
-    /// Used to cache lookahead during parsing, not used during construction.
+    /// Used to cache lookahead during parsing, not used during construction. Precomputed for deserialized parser ATNs.
     misc::IntervalSet nextTokenWithinRule;
 
     virtual size_t hashCode();
@@ -144,7 +144,7 @@ namespace atn {
 
     virtual bool isNonGreedyExitState();
     virtual std::string toString() const;
-    virtual  std::vector<Transition*> getTransitions();
+    virtual const std::vector<Transition*>& getTransitions() const;
     virtual size_t getNumberOfTransitions();
     virtual void addTransition(Transition *e);
     virtual void addTransition(int index, Transition *e);
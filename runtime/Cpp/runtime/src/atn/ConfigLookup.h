@@ -54,7 +54,7 @@ namespace atn {
     virtual ~ConfigLookup() {}
 
     // Java iterator interface.
-    virtual Ref<ATNConfig> getOrAdd(Ref<ATNConfig> config) = 0;
+    virtual Ref<ATNConfig> getOrAdd(const Ref<ATNConfig> &config) = 0;
     virtual bool isEmpty() const = 0;
     virtual bool contains(Ref<ATNConfig> config) const = 0;
     virtual void clear() = 0;
@@ -82,7 +82,7 @@ namespace atn {
   public:
     using Set = std::unordered_set<Ref<ATNConfig>, Hasher, Comparer>;
 
-    virtual Ref<ATNConfig> getOrAdd(Ref<ATNConfig> config) override {
+    virtual Ref<ATNConfig> getOrAdd(const Ref<ATNConfig> &config) override {
       auto result = Set::find(config);
       if (result != Set::end())
         // Can potentially be a different config instance which however is considered equal to the given config
@@ -42,7 +42,7 @@ DecisionInfo::DecisionInfo(size_t decision) : decision(decision) {
 std::string DecisionInfo::toString() const {
   std::stringstream ss;
 
-  ss << "{decision=" << decision << ", contextSensitivities=" << contextSensitivities.size() << ", errors=";
+  ss << "{decision=" << decision << ", LL1_Predictions=" << LL1_Predictions << ", contextSensitivities=" << contextSensitivities.size() << ", errors=";
   ss << errors.size() << ", ambiguities=" << ambiguities.size() << ", SLL_lookahead=" << SLL_TotalLook;
   ss << ", SLL_ATNTransitions=" << SLL_ATNTransitions << ", SLL_DFATransitions=" << SLL_DFATransitions;
   ss << ", LL_Fallback=" << LL_Fallback << ", LL_lookahead=" << LL_TotalLook << ", LL_ATNTransitions=" << LL_ATNTransitions << '}';
@@ -86,6 +86,14 @@ namespace atn {
     /// </summary>
     long long timeInPrediction = 0;
 
+    /// <summary>
+    /// The number of invocations answered from the decision's LL(1) table (see
+    /// <seealso cref="ATN#decisionToLL1Table"/>) without SLL or LL prediction. These
+    /// invocations are included in <seealso cref="#invocations"/>, but not in the
+    /// lookahead and transition counts below.
+    /// </summary>
+    long long LL1_Predictions = 0;
+
     /// <summary>
     /// The sum of the lookahead required for SLL prediction for this decision.
     /// Note that SLL prediction is used before LL prediction for performance
@@ -0,0 +1,136 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "atn/Transition.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+namespace atn {
+
+  /// A read-only copy of the states and transitions of an ATN in contiguous arrays, for the inner loops of the
+  /// simulators. Transitions carry their type and label inline, so matching a symbol needs neither a virtual call nor
+  /// a pointer chase. The object graph (ATN::states) stays the reference for everything else (predicates, actions,
+  /// rule transitions, tooling), using the same state numbers and transition order.
+  /// Built by the ATNDeserializer (see ATNDeserializer::computeFlatATN).
+  class ANTLR4CPP_PUBLIC FlatATN {
+  public:
+    struct State {
+      /// Index of the first transition of this state in transitions. The transitions of the state end where those of
+      /// the next state start (there is an extra state at the end for that).
+      uint32_t firstTransition;
+
+      /// The value of ATNState::getStateType(), or ATNState::ATN_INVALID_TYPE for removed states.
+      uint8_t type;
+
+      bool epsilonOnlyTransitions;
+    };
+
+    struct Edge {
+      /// The target state number.
+      uint32_t target;
+
+      /// The value of Transition::getSerializationType().
+      uint8_t type;
+
+      bool epsilon;
+
+      /// Atom: the symbol. Range: the lower bound. Set and not-set: the set index (see setBits).
+      size_t label;
+
+      /// Range: the upper bound.
+      size_t labelEnd;
+    };
+
+    std::vector<State> states;
+    std::vector<Edge> transitions;
+
+    /// The labels of all set and not-set transitions as bit sets, each occupying setWords words. Bit (symbol + 1)
+    /// stands for symbol (so EOF maps to bit 0). Only symbols below setBitsLimit are in the bit sets. Larger ones
+    /// (code points outside of Latin-1 in lexers) are looked up in the original label, referenced from sets.
+    std::vector<uint64_t> setBits;
+    size_t setWords;
+    size_t setBitsLimit;
+    std::vector<const misc::IntervalSet *> sets;
+
+    FlatATN();
+
+    bool isEmpty() const {
+      return states.empty();
+    };
+
+    const Edge* transitionsBegin(size_t stateNumber) const {
+      return transitions.data() + states[stateNumber].firstTransition;
+    };
+
+    const Edge* transitionsEnd(size_t stateNumber) const {
+      return transitions.data() + states[stateNumber + 1].firstTransition;
+    };
+
+    /// The same as Transition::matches() of the transition the edge was created from.
+    bool matches(const Edge &edge, size_t symbol, size_t minVocabSymbol, size_t maxVocabSymbol) const {
+      switch (edge.type) {
+        case Transition::ATOM:
+          return symbol == edge.label;
+
+        case Transition::RANGE:
+          return symbol >= edge.label && symbol <= edge.labelEnd;
+
+        case Transition::SET:
+          return setContains(edge.label, symbol);
+
+        case Transition::NOT_SET:
+          return symbol >= minVocabSymbol && symbol <= maxVocabSymbol && !setContains(edge.label, symbol);
+
+        case Transition::WILDCARD:
+          return symbol >= minVocabSymbol && symbol <= maxVocabSymbol;
+
+        default:
+          return false;
+      }
+    };
+
+  private:
+    bool setContains(size_t set, size_t symbol) const {
+      size_t bit = symbol + 1; // EOF (all bits set) wraps around to 0.
+      if (bit < setBitsLimit + 1) {
+        return (setBits[set * setWords + bit / 64] & ((uint64_t)1 << (bit % 64))) != 0;
+      }
+      return sets[set]->contains((int)symbol);
+    };
+  };
+
+} // namespace atn
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
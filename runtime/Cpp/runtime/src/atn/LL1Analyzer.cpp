@@ -126,14 +126,15 @@ void LL1Analyzer::_LOOK(ATNState *s, ATNState *stopState, Ref<PredictionContext>
       for (size_t i = 0; i < ctx->size(); i++) {
         ATNState *returnState = _atn.states[(size_t)ctx->getReturnState(i)];
 
-        bool removed = calledRuleStack.test((size_t)returnState->ruleIndex);
-        auto onExit = finally([removed, &calledRuleStack, returnState] {
+        // The rule being exited is no longer on the call stack, the rule we return to still is.
+        bool removed = calledRuleStack.test((size_t)s->ruleIndex);
+        auto onExit = finally([removed, &calledRuleStack, s] {
           if (removed) {
-            calledRuleStack.set((size_t)returnState->ruleIndex);
+            calledRuleStack.set((size_t)s->ruleIndex);
           }
         });
 
-        calledRuleStack[(size_t)returnState->ruleIndex] = false;
+        calledRuleStack[(size_t)s->ruleIndex] = false;
         _LOOK(returnState, stopState, ctx->getParent(i).lock(), look, lookBusy, calledRuleStack, seeThruPreds, addEOF);
       }
       return;
@@ -52,17 +52,23 @@ LexerATNConfig::LexerATNConfig(ATNState *state, int alt, Ref<PredictionContext>
     _passedThroughNonGreedyDecision(false) {
 }
 
-LexerATNConfig::LexerATNConfig(Ref<LexerATNConfig> c, ATNState *state)
+LexerATNConfig::LexerATNConfig(ATNState *state, int alt, Ref<PredictionContext> context,
+                               Ref<LexerActionExecutor> lexerActionExecutor, bool passedThroughNonGreedyDecision)
+  : ATNConfig(state, alt, context, SemanticContext::NONE), _lexerActionExecutor(lexerActionExecutor),
+    _passedThroughNonGreedyDecision(passedThroughNonGreedyDecision) {
+}
+
+LexerATNConfig::LexerATNConfig(const Ref<LexerATNConfig> &c, ATNState *state)
   : ATNConfig(c, state, c->context, c->semanticContext), _lexerActionExecutor(c->_lexerActionExecutor),
    _passedThroughNonGreedyDecision(checkNonGreedyDecision(c, state)) {
 }
 
-LexerATNConfig::LexerATNConfig(Ref<LexerATNConfig> c, ATNState *state, Ref<LexerActionExecutor> lexerActionExecutor)
+LexerATNConfig::LexerATNConfig(const Ref<LexerATNConfig> &c, ATNState *state, Ref<LexerActionExecutor> lexerActionExecutor)
   : ATNConfig(c, state, c->context, c->semanticContext), _lexerActionExecutor(lexerActionExecutor),
     _passedThroughNonGreedyDecision(checkNonGreedyDecision(c, state)) {
 }
 
-LexerATNConfig::LexerATNConfig(Ref<LexerATNConfig> c, ATNState *state, Ref<PredictionContext> context)
+LexerATNConfig::LexerATNConfig(const Ref<LexerATNConfig> &c, ATNState *state, Ref<PredictionContext> context)
   : ATNConfig(c, state, context, c->semanticContext), _lexerActionExecutor(c->_lexerActionExecutor),
     _passedThroughNonGreedyDecision(checkNonGreedyDecision(c, state)) {
 }
@@ -75,6 +81,10 @@ bool LexerATNConfig::hasPassedThroughNonGreedyDecision() {
   return _passedThroughNonGreedyDecision;
 }
 
+Ref<ATNConfig> LexerATNConfig::clone() const {
+  return std::make_shared<LexerATNConfig>(*this);
+}
+
 size_t LexerATNConfig::hashCode() const {
   size_t hashCode = misc::MurmurHash::initialize(7);
   hashCode = misc::MurmurHash::update(hashCode, (size_t)state->stateNumber);
@@ -93,13 +103,26 @@ bool LexerATNConfig::operator == (const LexerATNConfig& other) const
     return false;
 
   if (_lexerActionExecutor != other._lexerActionExecutor) {
-    return false;
+    if (_lexerActionExecutor == nullptr || other._lexerActionExecutor == nullptr ||
+        !(*_lexerActionExecutor == *other._lexerActionExecutor)) {
+      return false;
+    }
   }
 
   return ATNConfig::operator == (other);
 }
 
-bool LexerATNConfig::checkNonGreedyDecision(Ref<LexerATNConfig> source, ATNState *target) {
+bool LexerATNConfig::operator == (const ATNConfig& other) const
+{
+  const LexerATNConfig *lexerConfig = dynamic_cast<const LexerATNConfig *>(&other);
+  if (lexerConfig == nullptr) {
+    return false;
+  }
+
+  return operator == (*lexerConfig);
+}
+
+bool LexerATNConfig::checkNonGreedyDecision(const Ref<LexerATNConfig> &source, ATNState *target) {
   return source->_passedThroughNonGreedyDecision ||
     (is<DecisionState*>(target) && (static_cast<DecisionState*>(target))->nonGreedy);
 }
@@ -44,9 +44,13 @@ namespace atn {
     LexerATNConfig(ATNState *state, int alt, Ref<PredictionContext> context);
     LexerATNConfig(ATNState *state, int alt, Ref<PredictionContext> context, Ref<LexerActionExecutor> lexerActionExecutor);
 
-    LexerATNConfig(Ref<LexerATNConfig> c, ATNState *state);
-    LexerATNConfig(Ref<LexerATNConfig> c, ATNState *state, Ref<LexerActionExecutor> lexerActionExecutor);
-    LexerATNConfig(Ref<LexerATNConfig> c, ATNState *state, Ref<PredictionContext> context);
+    /// Restores a configuration with all of its fields, e.g. when loading a DFA snapshot (see dfa::DFASnapshot).
+    LexerATNConfig(ATNState *state, int alt, Ref<PredictionContext> context, Ref<LexerActionExecutor> lexerActionExecutor,
+                   bool passedThroughNonGreedyDecision);
+
+    LexerATNConfig(const Ref<LexerATNConfig> &c, ATNState *state);
+    LexerATNConfig(const Ref<LexerATNConfig> &c, ATNState *state, Ref<LexerActionExecutor> lexerActionExecutor);
+    LexerATNConfig(const Ref<LexerATNConfig> &c, ATNState *state, Ref<PredictionContext> context);
 
     /**
      * Gets the {@link LexerActionExecutor} capable of executing the embedded
@@ -55,9 +59,11 @@ namespace atn {
     Ref<LexerActionExecutor> getLexerActionExecutor() const;
     bool hasPassedThroughNonGreedyDecision();
 
+    virtual Ref<ATNConfig> clone() const override;
     virtual size_t hashCode() const override;
 
     bool operator == (const LexerATNConfig& other) const;
+    virtual bool operator == (const ATNConfig& other) const override;
 
   private:
     /**
@@ -66,7 +72,7 @@ namespace atn {
     const Ref<LexerActionExecutor> _lexerActionExecutor;
     const bool _passedThroughNonGreedyDecision;
 
-    static bool checkNonGreedyDecision(Ref<LexerATNConfig> source, ATNState *target);
+    static bool checkNonGreedyDecision(const Ref<LexerATNConfig> &source, ATNState *target);
   };
 
 } // namespace atn
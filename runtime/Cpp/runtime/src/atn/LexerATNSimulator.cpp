@@ -46,6 +46,7 @@
 #include "atn/LexerATNConfig.h"
 #include "atn/LexerActionExecutor.h"
 #include "atn/EmptyPredictionContext.h"
+#include "atn/StaticLexerDFA.h"
 
 #include "atn/LexerATNSimulator.h"
 
@@ -66,7 +67,7 @@ void LexerATNSimulator::SimState::InitializeInstanceFields() {
   charPos = -1;
 }
 
-int LexerATNSimulator::match_calls = 0;
+std::atomic<int> LexerATNSimulator::match_calls(0);
 
 
 LexerATNSimulator::LexerATNSimulator(const ATN &atn, std::vector<dfa::DFA> &decisionToDFA,
@@ -92,12 +93,20 @@ int LexerATNSimulator::match(CharStream *input, size_t mode) {
   _mode = mode;
   ssize_t mark = input->mark();
 
-  auto onExit = finally([input, mark] {
+  auto onExit = finally([this, input, mark] {
+    _configArena.reset();
     input->release(mark);
   });
 
   _startIndex = (int)input->index();
   _prevAccept.reset();
+  if (_mode < _staticDFAs.size() && _staticDFAs[_mode] != nullptr) {
+    int ttype;
+    if (matchStatic(input, *_staticDFAs[_mode], ttype)) {
+      return ttype;
+    }
+  }
+
   const dfa::DFA &dfa = _decisionToDFA[mode];
   if (dfa.s0 == nullptr) {
     return matchATN(input);
@@ -125,6 +134,26 @@ void LexerATNSimulator::clearDFA() {
   }
 }
 
+void LexerATNSimulator::setStaticDFAs(const std::vector<Ref<StaticLexerDFA>> &staticDFAs) {
+  _staticDFAs = staticDFAs;
+}
+
+const std::vector<Ref<StaticLexerDFA>>& LexerATNSimulator::getStaticDFAs() const {
+  return _staticDFAs;
+}
+
+bool LexerATNSimulator::matchStatic(CharStream *input, const StaticLexerDFA &dfa, int &ttype) {
+  StaticLexerDFA::Match result;
+  if (!dfa.match(input, _line, _charPositionInLine, result) || !result.accepted) {
+    input->seek((size_t)_startIndex);
+    return false;
+  }
+
+  accept(input, result.lexerActionExecutor, _startIndex, result.index, result.line, (size_t)result.charPos);
+  ttype = result.prediction;
+  return true;
+}
+
 int LexerATNSimulator::matchATN(CharStream *input) {
   ATNState *startState = (ATNState *)atn.modeToStartState[_mode];
 
@@ -221,11 +250,12 @@ int LexerATNSimulator::execATN(CharStream *input, dfa::DFAState *ds0) {
 }
 
 dfa::DFAState *LexerATNSimulator::getExistingTargetState(dfa::DFAState *s, ssize_t t) {
-  if (s->edges.size() == 0 || t < MIN_DFA_EDGE || t > MAX_DFA_EDGE) {
+  ssize_t index = getEdgeIndex(t);
+  if (index < 0) {
     return nullptr;
   }
 
-  dfa::DFAState *target = s->edges[(size_t)(t - MIN_DFA_EDGE)];
+  dfa::DFAState *target = s->getEdge((size_t)index);
   if (debug && target != nullptr) {
     std::cout << std::string("reuse state ") << s->stateNumber << std::string(" edge to ") << target->stateNumber << std::endl;
   }
@@ -276,7 +306,7 @@ void LexerATNSimulator::getReachableConfigSet(CharStream *input, Ref<ATNConfigSe
   // than a config that already reached an accept state for the same rule
   int skipAlt = ATN::INVALID_ALT_NUMBER;
 
-  for (auto c : closure_->configs) {
+  for (auto &c : closure_->configs) {
     bool currentAltReachedAcceptState = c->alt == skipAlt;
     if (currentAltReachedAcceptState && (std::static_pointer_cast<LexerATNConfig>(c))->hasPassedThroughNonGreedyDecision()) {
       continue;
@@ -287,9 +317,15 @@ void LexerATNSimulator::getReachableConfigSet(CharStream *input, Ref<ATNConfigSe
     }
 
     size_t n = c->state->getNumberOfTransitions();
+    const FlatATN::Edge *edges = atn.flat.isEmpty() ? nullptr : atn.flat.transitionsBegin((size_t)c->state->stateNumber);
     for (size_t ti = 0; ti < n; ti++) { // for each transition
-      Transition *trans = c->state->transition(ti);
-      ATNState *target = getReachableTarget(trans, (int)t);
+      ATNState *target;
+      if (edges != nullptr) {
+        target = atn.flat.matches(edges[ti], (size_t)t, std::numeric_limits<char32_t>::min(),
+          std::numeric_limits<char32_t>::max()) ? atn.states[edges[ti].target] : nullptr;
+      } else {
+        target = getReachableTarget(c->state->transition(ti), (int)t);
+      }
       if (target != nullptr) {
         Ref<LexerActionExecutor> lexerActionExecutor = std::static_pointer_cast<LexerATNConfig>(c)->getLexerActionExecutor();
         if (lexerActionExecutor != nullptr) {
@@ -297,7 +333,7 @@ void LexerATNSimulator::getReachableConfigSet(CharStream *input, Ref<ATNConfigSe
         }
 
         bool treatEofAsEpsilon = t == Token::EOF;
-        Ref<LexerATNConfig> config = std::make_shared<LexerATNConfig>(std::static_pointer_cast<LexerATNConfig>(c),
+        Ref<LexerATNConfig> config = _configArena.create<LexerATNConfig>(std::static_pointer_cast<LexerATNConfig>(c),
           target, lexerActionExecutor);
 
         if (closure(input, config, reach, currentAltReachedAcceptState, true, treatEofAsEpsilon)) {
@@ -341,19 +377,23 @@ Ref<ATNConfigSet> LexerATNSimulator::computeStartState(CharStream *input, ATNSta
   Ref<ATNConfigSet> configs = std::make_shared<OrderedATNConfigSet>();
   for (size_t i = 0; i < p->getNumberOfTransitions(); i++) {
     ATNState *target = p->transition(i)->target;
-    Ref<LexerATNConfig> c = std::make_shared<LexerATNConfig>(target, (int)(i + 1), initialContext);
+    Ref<LexerATNConfig> c = _configArena.create<LexerATNConfig>(target, (int)(i + 1), initialContext);
     closure(input, c, configs, false, false, false);
   }
   return configs;
 }
 
-bool LexerATNSimulator::closure(CharStream *input, Ref<LexerATNConfig> config, Ref<ATNConfigSet> configs,
+bool LexerATNSimulator::closure(CharStream *input, const Ref<LexerATNConfig> &config, const Ref<ATNConfigSet> &configs,
                                 bool currentAltReachedAcceptState, bool speculative, bool treatEofAsEpsilon) {
   if (debug) {
     std::cout << "closure(" << config->toString(true) << ")" << std::endl;
   }
 
-  if (is<RuleStopState *>(config->state)) {
+  ATNState *p = config->state;
+  const FlatATN::Edge *edges = atn.flat.isEmpty() ? nullptr : atn.flat.transitionsBegin((size_t)p->stateNumber);
+  bool isRuleStopState = edges != nullptr ? atn.flat.states[(size_t)p->stateNumber].type == ATNState::RULE_STOP :
+    is<RuleStopState *>(p);
+  if (isRuleStopState) {
     if (debug) {
       if (_recog != nullptr) {
         std::cout << "closure at " << _recog->getRuleNames()[(size_t)config->state->ruleIndex] << " rule stop " << config << std::endl;
@@ -367,7 +407,7 @@ bool LexerATNSimulator::closure(CharStream *input, Ref<LexerATNConfig> config, R
         configs->add(config);
         return true;
       } else {
-        configs->add(std::make_shared<LexerATNConfig>(config, config->state, PredictionContext::EMPTY));
+        configs->add(_configArena.create<LexerATNConfig>(config, config->state, PredictionContext::EMPTY));
         currentAltReachedAcceptState = true;
       }
     }
@@ -377,7 +417,7 @@ bool LexerATNSimulator::closure(CharStream *input, Ref<LexerATNConfig> config, R
         if (config->context->getReturnState(i) != PredictionContext::EMPTY_RETURN_STATE) {
           std::weak_ptr<PredictionContext> newContext = config->context->getParent(i); // "pop" return state
           ATNState *returnState = atn.states[(size_t)config->context->getReturnState(i)];
-          Ref<LexerATNConfig> c = std::make_shared<LexerATNConfig>(config, returnState, newContext.lock());
+          Ref<LexerATNConfig> c = _configArena.create<LexerATNConfig>(config, returnState, newContext.lock());
           currentAltReachedAcceptState = closure(input, c, configs, currentAltReachedAcceptState, speculative, treatEofAsEpsilon);
         }
       }
@@ -393,9 +433,13 @@ bool LexerATNSimulator::closure(CharStream *input, Ref<LexerATNConfig> config, R
     }
   }
 
-  ATNState *p = config->state;
-  for (size_t i = 0; i < p->getNumberOfTransitions(); i++) {
-    Transition *t = p->transition(i);
+  const std::vector<Transition *> &transitions = p->getTransitions();
+  for (size_t i = 0; i < transitions.size(); i++) {
+    if (edges != nullptr && !edges[i].epsilon && !treatEofAsEpsilon) {
+      continue; // Transitions consuming a symbol only lead to a closure config for EOF.
+    }
+
+    Transition *t = transitions[i];
     Ref<LexerATNConfig> c = getEpsilonTarget(input, config, t, configs, speculative, treatEofAsEpsilon);
     if (c != nullptr) {
       currentAltReachedAcceptState = closure(input, c, configs, currentAltReachedAcceptState, speculative, treatEofAsEpsilon);
@@ -405,15 +449,15 @@ bool LexerATNSimulator::closure(CharStream *input, Ref<LexerATNConfig> config, R
   return currentAltReachedAcceptState;
 }
 
-Ref<LexerATNConfig> LexerATNSimulator::getEpsilonTarget(CharStream *input, Ref<LexerATNConfig> config, Transition *t,
-  Ref<ATNConfigSet> configs, bool speculative, bool treatEofAsEpsilon) {
+Ref<LexerATNConfig> LexerATNSimulator::getEpsilonTarget(CharStream *input, const Ref<LexerATNConfig> &config,
+  Transition *t, const Ref<ATNConfigSet> &configs, bool speculative, bool treatEofAsEpsilon) {
   
   Ref<LexerATNConfig> c = nullptr;
   switch (t->getSerializationType()) {
     case Transition::RULE: {
       RuleTransition *ruleTransition = static_cast<RuleTransition*>(t);
       Ref<PredictionContext> newContext = SingletonPredictionContext::create(config->context, ruleTransition->followState->stateNumber);
-      c = std::make_shared<LexerATNConfig>(config, t->target, newContext);
+      c = _configArena.create<LexerATNConfig>(config, t->target, newContext);
       break;
     }
 
@@ -445,7 +489,7 @@ Ref<LexerATNConfig> LexerATNSimulator::getEpsilonTarget(CharStream *input, Ref<L
       }
       configs->hasSemanticContext = true;
       if (evaluatePredicate(input, pt->ruleIndex, pt->predIndex, speculative)) {
-        c = std::make_shared<LexerATNConfig>(config, t->target);
+        c = _configArena.create<LexerATNConfig>(config, t->target);
       }
       break;
     }
@@ -466,17 +510,17 @@ Ref<LexerATNConfig> LexerATNSimulator::getEpsilonTarget(CharStream *input, Ref<L
         // the split operation.
         Ref<LexerActionExecutor> lexerActionExecutor = LexerActionExecutor::append(config->getLexerActionExecutor(),
           atn.lexerActions[static_cast<ActionTransition *>(t)->actionIndex]);
-        c = std::make_shared<LexerATNConfig>(config, t->target, lexerActionExecutor);
+        c = _configArena.create<LexerATNConfig>(config, t->target, lexerActionExecutor);
         break;
       }
       else {
         // ignore actions in referenced rules
-        c = std::make_shared<LexerATNConfig>(config, t->target);
+        c = _configArena.create<LexerATNConfig>(config, t->target);
         break;
       }
 
     case Transition::EPSILON:
-      c = std::make_shared<LexerATNConfig>(config, t->target);
+      c = _configArena.create<LexerATNConfig>(config, t->target);
       break;
 
     case Transition::ATOM:
@@ -484,7 +528,7 @@ Ref<LexerATNConfig> LexerATNSimulator::getEpsilonTarget(CharStream *input, Ref<L
     case Transition::SET:
       if (treatEofAsEpsilon) {
         if (t->matches(Token::EOF, Lexer::MIN_CHAR_VALUE, Lexer::MAX_CHAR_VALUE)) {
-          c = std::make_shared<LexerATNConfig>(config, t->target);
+          c = _configArena.create<LexerATNConfig>(config, t->target);
           break;
         }
       }
@@ -554,7 +598,8 @@ dfa::DFAState *LexerATNSimulator::addDFAEdge(dfa::DFAState *from, ssize_t t, Ref
 }
 
 void LexerATNSimulator::addDFAEdge(dfa::DFAState *p, ssize_t t, dfa::DFAState *q) {
-  if (t < MIN_DFA_EDGE || t > MAX_DFA_EDGE) {
+  ssize_t index = getEdgeIndex(t);
+  if (index < 0) {
     // Only track edges within the DFA bounds
     return;
   }
@@ -563,12 +608,30 @@ void LexerATNSimulator::addDFAEdge(dfa::DFAState *p, ssize_t t, dfa::DFAState *q
     std::cerr << std::string("EDGE ") << p << std::string(" -> ") << q << std::string(" upon ") << (static_cast<char>(t)) << std::endl;
   }
 
-  std::lock_guard<std::recursive_mutex> lck(mtx);
-  if (p->edges.empty()) {
-    //  make room for tokens 1..n and -1 masquerading as index 0
-    p->edges.resize(MAX_DFA_EDGE - MIN_DFA_EDGE + 1);
+  // No lock needed, edges are published atomically (see DFAState::setEdge).
+  p->setEdge((size_t)index, q, getEdgeCount()); // connect
+}
+
+ssize_t LexerATNSimulator::getEdgeIndex(ssize_t t) const {
+  if (t < MIN_DFA_EDGE) {
+    return -1;
+  }
+
+  if (t <= MAX_DFA_EDGE) {
+    return t - MIN_DFA_EDGE;
+  }
+
+  if (atn.charClassStarts.empty() || t > (ssize_t)Lexer::MAX_CHAR_VALUE) {
+    return -1;
   }
-  p->edges[(size_t)(t - MIN_DFA_EDGE)] = q; // connect
+
+  // The first class starts right after MAX_DFA_EDGE, so we always find at least one start value <= t.
+  auto next = std::upper_bound(atn.charClassStarts.begin(), atn.charClassStarts.end(), (size_t)t);
+  return MAX_DFA_EDGE - MIN_DFA_EDGE + (next - atn.charClassStarts.begin());
+}
+
+size_t LexerATNSimulator::getEdgeCount() const {
+  return MAX_DFA_EDGE - MIN_DFA_EDGE + 1 + atn.charClassStarts.size();
 }
 
 dfa::DFAState *LexerATNSimulator::addDFAState(Ref<ATNConfigSet> configs) {
@@ -579,7 +642,7 @@ dfa::DFAState *LexerATNSimulator::addDFAState(Ref<ATNConfigSet> configs) {
 
   dfa::DFAState *proposed = new dfa::DFAState(configs); /* mem-check: managed by the DFA or deleted below */
   Ref<ATNConfig> firstConfigWithRuleStopState = nullptr;
-  for (auto c : configs->configs) {
+  for (auto &c : configs->configs) {
     if (is<RuleStopState*>(c->state)) {
       firstConfigWithRuleStopState = c;
       break;
@@ -594,23 +657,14 @@ dfa::DFAState *LexerATNSimulator::addDFAState(Ref<ATNConfigSet> configs) {
 
   dfa::DFA &dfa = _decisionToDFA[_mode];
 
-  {
-    std::lock_guard<std::recursive_mutex> lck(mtx);
-    
-    auto iterator = dfa.states.find(proposed);
-    if (iterator != dfa.states.end()) {
-      delete proposed;
-      return iterator->second;
-    }
-
-    dfa::DFAState *newState = proposed;
-
-    newState->stateNumber = (int)dfa.states.size();
-    configs->setReadonly(true);
-    newState->configs = configs;
-    dfa.states[newState] = newState;
-    return newState;
+  // Freeze the configs before the state becomes visible to other threads.
+  configs->setReadonly(true);
+  dfa::DFAState *existing = dfa.addState(proposed);
+  if (existing != proposed) {
+    delete proposed;
   }
+
+  return existing;
 }
 
 dfa::DFA& LexerATNSimulator::getDFA(size_t mode) {
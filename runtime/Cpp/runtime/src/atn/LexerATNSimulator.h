@@ -70,8 +70,10 @@ namespace atn {
     static const bool debug = false;
     static const bool dfa_debug = false;
 
+    /// Code points in this range have their own DFA edge. Edges for code points above MAX_DFA_EDGE are
+    /// stored per equivalence class (see ATN::charClassStarts), after the directly indexed ones.
     static const int MIN_DFA_EDGE = 0;
-    static const int MAX_DFA_EDGE = 127; // forces unicode to stay in ATN
+    static const int MAX_DFA_EDGE = 127;
 
     /// <summary>
     /// When we hit an accept state in either the DFA or the ATN, we
@@ -117,7 +119,7 @@ namespace atn {
     SimState _prevAccept;
 
   public:
-    static int match_calls;
+    static std::atomic<int> match_calls;
 
     LexerATNSimulator(const ATN &atn, std::vector<dfa::DFA> &decisionToDFA,
                       Ref<PredictionContextCache> sharedContextCache);
@@ -129,8 +131,19 @@ namespace atn {
     virtual void reset() override;
 
     virtual void clearDFA() override;
+
+    /// Sets the precompiled DFAs to match tokens with, indexed by mode (see StaticLexerDFA). Modes without one (null
+    /// or missing entries) and tokens the static DFA cannot decide are matched with the ATN and the lazily built DFA.
+    void setStaticDFAs(const std::vector<Ref<StaticLexerDFA>> &staticDFAs);
+    const std::vector<Ref<StaticLexerDFA>>& getStaticDFAs() const;
     
   protected:
+    std::vector<Ref<StaticLexerDFA>> _staticDFAs;
+
+    /// Matches the next token with the given static DFA. Returns false, with the input back at the token start, if
+    /// the DFA cannot decide the token or no token matches (the ATN simulation then reports the error).
+    virtual bool matchStatic(CharStream *input, const StaticLexerDFA &dfa, int &ttype);
+
     virtual int matchATN(CharStream *input);
     virtual int execATN(CharStream *input, dfa::DFAState *ds0);
 
@@ -172,6 +185,7 @@ namespace atn {
     virtual void accept(CharStream *input, Ref<LexerActionExecutor> lexerActionExecutor, int startIndex, size_t index,
                         size_t line, size_t charPos);
 
+    /// Only used for ATNs without a flat representation (see ATN::flat).
     virtual ATNState *getReachableTarget(Transition *trans, ssize_t t);
 
     virtual Ref<ATNConfigSet> computeStartState(CharStream *input, ATNState *p);
@@ -185,12 +199,12 @@ namespace atn {
     /// </summary>
     /// <returns> {@code true} if an accept state is reached, otherwise
     /// {@code false}. </returns>
-    virtual bool closure(CharStream *input, Ref<LexerATNConfig> config, Ref<ATNConfigSet> configs,
+    virtual bool closure(CharStream *input, const Ref<LexerATNConfig> &config, const Ref<ATNConfigSet> &configs,
                          bool currentAltReachedAcceptState, bool speculative, bool treatEofAsEpsilon);
 
     // side-effect: can alter configs.hasSemanticContext
-    virtual Ref<LexerATNConfig> getEpsilonTarget(CharStream *input, Ref<LexerATNConfig> config, Transition *t,
-      Ref<ATNConfigSet> configs, bool speculative, bool treatEofAsEpsilon);
+    virtual Ref<LexerATNConfig> getEpsilonTarget(CharStream *input, const Ref<LexerATNConfig> &config, Transition *t,
+      const Ref<ATNConfigSet> &configs, bool speculative, bool treatEofAsEpsilon);
 
     /// <summary>
     /// Evaluate a predicate specified in the lexer.
@@ -218,6 +232,13 @@ namespace atn {
     virtual dfa::DFAState* addDFAEdge(dfa::DFAState *from, ssize_t t, Ref<ATNConfigSet> q);
     virtual void addDFAEdge(dfa::DFAState *p, ssize_t t, dfa::DFAState *q);
 
+    /// Returns the index of the DFA edge for input symbol {@code t} or -1 if that symbol is not cached in the DFA
+    /// (EOF and, for ATNs without character classes, non-ASCII code points).
+    ssize_t getEdgeIndex(ssize_t t) const;
+
+    /// The number of edges each lexer DFA state needs to cover all code points.
+    size_t getEdgeCount() const;
+
     /// <summary>
     /// Add a new DFA state if there isn't one with this set of
     /// configurations already. This method also detects the first
@@ -82,7 +82,7 @@ void LexerActionExecutor::execute(Lexer *lexer, CharStream *input, int startInde
   bool requiresSeek = false;
   size_t stopIndex = input->index();
 
-  auto onExit = finally([requiresSeek, input, stopIndex]() {
+  auto onExit = finally([&requiresSeek, input, stopIndex]() {
     if (requiresSeek) {
       input->seek(stopIndex);
     }
@@ -55,6 +55,26 @@ std::vector<size_t> ParseInfo::getLLDecisions() {
   return LL;
 }
 
+std::vector<size_t> ParseInfo::getLL1Decisions() {
+  std::vector<DecisionInfo> decisions = _atnSimulator->getDecisionInfo();
+  std::vector<size_t> LL1;
+  for (size_t i = 0; i < decisions.size(); ++i) {
+    if (decisions[i].LL1_Predictions > 0) {
+      LL1.push_back(i);
+    }
+  }
+  return LL1;
+}
+
+long long ParseInfo::getTotalLL1Predictions() {
+  std::vector<DecisionInfo> decisions = _atnSimulator->getDecisionInfo();
+  long long n = 0;
+  for (size_t i = 0; i < decisions.size(); ++i) {
+    n += decisions[i].LL1_Predictions;
+  }
+  return n;
+}
+
 long long ParseInfo::getTotalTimeInPrediction() {
   std::vector<DecisionInfo> decisions = _atnSimulator->getDecisionInfo();
   long long t = 0;
@@ -112,7 +132,7 @@ long long ParseInfo::getTotalATNLookaheadOps() {
 
 size_t ParseInfo::getDFASize() {
   size_t n = 0;
-  std::vector<dfa::DFA> decisionToDFA = _atnSimulator->decisionToDFA;
+  std::vector<dfa::DFA> &decisionToDFA = _atnSimulator->decisionToDFA;
   for (size_t i = 0; i < decisionToDFA.size(); ++i) {
     n += getDFASize(i);
   }
@@ -123,3 +143,19 @@ size_t ParseInfo::getDFASize(size_t decision) {
   dfa::DFA &decisionToDFA = _atnSimulator->decisionToDFA[decision];
   return decisionToDFA.states.size();
 }
+
+size_t ParseInfo::getDFAInternHits() {
+  size_t n = 0;
+  for (auto &dfa : _atnSimulator->decisionToDFA) {
+    n += dfa.internHits;
+  }
+  return n;
+}
+
+size_t ParseInfo::getDFAInternMisses() {
+  size_t n = 0;
+  for (auto &dfa : _atnSimulator->decisionToDFA) {
+    n += dfa.internMisses;
+  }
+  return n;
+}
@@ -65,6 +65,20 @@ namespace atn {
     /// full-context predictions during parsing. </returns>
     virtual std::vector<size_t> getLLDecisions();
 
+    /// <summary>
+    /// Gets the decision numbers for decisions that were predicted from their
+    /// LL(1) table at least once. These are decisions for which
+    /// <seealso cref="DecisionInfo#LL1_Predictions"/> is non-zero.
+    /// </summary>
+    virtual std::vector<size_t> getLL1Decisions();
+
+    /// <summary>
+    /// Gets the total number of predictions answered from LL(1) tables across
+    /// all decisions. This value is the sum of
+    /// <seealso cref="DecisionInfo#LL1_Predictions"/> for all decisions.
+    /// </summary>
+    virtual long long getTotalLL1Predictions();
+
     /// <summary>
     /// Gets the total time spent during prediction across all decisions made
     /// during parsing. This value is the sum of
@@ -120,6 +134,20 @@ namespace atn {
     /// </summary>
     virtual size_t getDFASize(size_t decision);
 
+    /// <summary>
+    /// Gets the total number of DFA state additions for all decisions which
+    /// found an equal state already in the DFA cache, i.e. which did not
+    /// grow the DFA.
+    /// </summary>
+    virtual size_t getDFAInternHits();
+
+    /// <summary>
+    /// Gets the total number of DFA state additions for all decisions which
+    /// added a new state to the DFA cache. This value equals
+    /// <seealso cref="#getDFASize"/> unless the DFA has been cleared.
+    /// </summary>
+    virtual size_t getDFAInternMisses();
+
   protected:
     const ProfilingATNSimulator *_atnSimulator; // non-owning, we are created by this simulator.
   };
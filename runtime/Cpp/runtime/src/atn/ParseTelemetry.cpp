@@ -0,0 +1,131 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atn/ParseTelemetry.h"
+
+using namespace org::antlr::v4::runtime::atn;
+
+//------------------ DecisionTelemetry ---------------------------------------------------------------------------------
+
+DecisionTelemetry::DecisionTelemetry()
+  : invocations(0), ll1Predictions(0), dfaPredictions(0), sllDFATransitions(0), sllATNTransitions(0), llFallbacks(0),
+    llATNTransitions(0), dfaStatesAdded(0), dfaStates(0) {
+  std::fill(sllLookahead, sllLookahead + LookaheadBuckets, 0);
+  std::fill(llLookahead, llLookahead + LookaheadBuckets, 0);
+}
+
+double DecisionTelemetry::getDFAHitRatio() const {
+  size_t transitions = sllDFATransitions + sllATNTransitions;
+  if (transitions == 0) {
+    return 1;
+  }
+  return (double)sllDFATransitions / transitions;
+}
+
+size_t DecisionTelemetry::getLookaheadBucket(size_t lookahead) {
+  size_t bucket = 0;
+  for (size_t limit = 1; limit < lookahead && bucket + 1 < LookaheadBuckets; limit *= 2) {
+    ++bucket;
+  }
+  return bucket;
+}
+
+//------------------ ParseTelemetry ------------------------------------------------------------------------------------
+
+ParseTelemetry::ParseTelemetry(size_t decisionCount, size_t sampleInterval)
+  : decisions(decisionCount), decisionRules(decisionCount), sampleInterval(sampleInterval) {
+}
+
+void ParseTelemetry::reset() {
+  std::fill(decisions.begin(), decisions.end(), DecisionTelemetry());
+  stackSamples.clear();
+}
+
+static std::string getRuleName(const std::vector<std::string> &ruleNames, size_t ruleIndex) {
+  if (ruleIndex < ruleNames.size()) {
+    return ruleNames[ruleIndex];
+  }
+  return std::to_string(ruleIndex);
+}
+
+static void writeHistogram(std::stringstream &ss, const size_t (&histogram)[DecisionTelemetry::LookaheadBuckets]) {
+  ss << "[";
+  for (size_t i = 0; i < DecisionTelemetry::LookaheadBuckets; ++i) {
+    ss << (i > 0 ? ", " : "") << histogram[i];
+  }
+  ss << "]";
+}
+
+std::string ParseTelemetry::toJSON(const std::vector<std::string> &ruleNames) const {
+  std::stringstream ss;
+  ss << "{\n  \"sampleInterval\": " << sampleInterval << ",\n  \"decisions\": [";
+
+  bool first = true;
+  for (size_t i = 0; i < decisions.size(); ++i) {
+    const DecisionTelemetry &decision = decisions[i];
+    if (decision.invocations == 0) {
+      continue;
+    }
+
+    // Rule names are identifiers, so they need no escaping.
+    ss << (first ? "\n" : ",\n");
+    first = false;
+    ss << "    {\"decision\": " << i << ", \"rule\": \"" << getRuleName(ruleNames, decisionRules[i]) << "\""
+      << ", \"invocations\": " << decision.invocations
+      << ", \"ll1Predictions\": " << decision.ll1Predictions
+      << ", \"dfaPredictions\": " << decision.dfaPredictions
+      << ", \"sllDFATransitions\": " << decision.sllDFATransitions
+      << ", \"sllATNTransitions\": " << decision.sllATNTransitions
+      << ", \"dfaHitRatio\": " << decision.getDFAHitRatio()
+      << ", \"llFallbacks\": " << decision.llFallbacks
+      << ", \"llATNTransitions\": " << decision.llATNTransitions
+      << ", \"dfaStatesAdded\": " << decision.dfaStatesAdded
+      << ", \"dfaStates\": " << decision.dfaStates
+      << ", \"sllLookahead\": ";
+    writeHistogram(ss, decision.sllLookahead);
+    ss << ", \"llLookahead\": ";
+    writeHistogram(ss, decision.llLookahead);
+    ss << "}";
+  }
+
+  ss << (first ? "]\n}\n" : "\n  ]\n}\n");
+  return ss.str();
+}
+
+std::string ParseTelemetry::toFoldedStacks(const std::vector<std::string> &ruleNames) const {
+  std::stringstream ss;
+  for (auto &sample : stackSamples) {
+    const std::vector<size_t> &stack = sample.first;
+    for (size_t i = 0; i + 1 < stack.size(); ++i) {
+      ss << getRuleName(ruleNames, stack[i]) << ";";
+    }
+    ss << "decision:" << stack.back() << " " << sample.second << "\n";
+  }
+  return ss.str();
+}
@@ -0,0 +1,119 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "antlr4-common.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+namespace atn {
+
+  /// Counters gathered by a TelemetryATNSimulator for one decision. Unlike DecisionInfo these are plain numbers, which
+  /// are cheap enough to be collected in production.
+  class ANTLR4CPP_PUBLIC DecisionTelemetry {
+  public:
+    /// Lookahead histograms have one bucket per power of 2: bucket i counts predictions which looked at
+    /// (2^(i-1), 2^i] tokens (i.e. 1, 2, 3-4, 5-8, ...), the last bucket also takes everything beyond.
+    static const size_t LookaheadBuckets = 8;
+
+    /// Calls of adaptivePredict() for this decision.
+    size_t invocations;
+
+    /// Predictions answered from the LL(1) table, without looking at the DFA.
+    size_t ll1Predictions;
+
+    /// Predictions answered by walking the DFA alone, i.e. without any ATN simulation.
+    size_t dfaPredictions;
+
+    /// Lookahead steps taken over existing DFA edges resp. computed by ATN simulation during SLL prediction.
+    /// Their ratio is the DFA hit ratio.
+    size_t sllDFATransitions;
+    size_t sllATNTransitions;
+
+    /// Predictions which fell back to full context (LL) prediction and the lookahead steps needed for them.
+    size_t llFallbacks;
+    size_t llATNTransitions;
+
+    /// DFA states this parser added to the decision's DFA.
+    size_t dfaStatesAdded;
+
+    /// The size of the decision's DFA (shared between all parsers using it) when the telemetry was taken.
+    size_t dfaStates;
+
+    /// Lookahead depth of SLL predictions (including LL(1) ones) and of full context predictions.
+    size_t sllLookahead[LookaheadBuckets];
+    size_t llLookahead[LookaheadBuckets];
+
+    DecisionTelemetry();
+
+    /// The share of SLL lookahead steps taken over existing DFA edges, 1 if there were none.
+    double getDFAHitRatio() const;
+
+    static size_t getLookaheadBucket(size_t lookahead);
+  };
+
+  /// Telemetry data of a parser, see Parser::setTelemetry(). Besides the per decision counters this contains samples
+  /// of the rule invocation stacks predictions were made in, taken every sampleInterval predictions.
+  ///
+  /// The data can be exported as JSON and in the folded stack format used by flame graph tools (one line per stack,
+  /// the frames separated by ';', followed by a space and the sample weight).
+  class ANTLR4CPP_PUBLIC ParseTelemetry {
+  public:
+    std::vector<DecisionTelemetry> decisions;
+
+    /// For each decision the rule it belongs to.
+    std::vector<size_t> decisionRules;
+
+    /// Sampled rule invocation stacks (outermost rule first, followed by the decision which was predicted) with the
+    /// number of predictions the samples stand for.
+    std::map<std::vector<size_t>, size_t> stackSamples;
+
+    size_t sampleInterval;
+
+    ParseTelemetry(size_t decisionCount, size_t sampleInterval);
+
+    /// Sets all counters to 0 and drops the stack samples.
+    void reset();
+
+    /// Exports the counters of all decisions which were invoked at least once.
+    std::string toJSON(const std::vector<std::string> &ruleNames) const;
+
+    /// Exports the stack samples, with the decision as leaf frame. The weight of each line is the estimated number of
+    /// predictions made in that stack.
+    std::string toFoldedStacks(const std::vector<std::string> &ruleNames) const;
+  };
+
+} // namespace atn
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
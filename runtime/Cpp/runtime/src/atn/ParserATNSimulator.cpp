@@ -77,6 +77,20 @@ ParserATNSimulator::ParserATNSimulator(Parser *parser, const ATN &atn, std::vect
 }
 
 void ParserATNSimulator::reset() {
+  mergeCache.clear();
+}
+
+int ParserATNSimulator::getLL1Prediction(TokenStream *input, int decision) const {
+  if ((size_t)decision >= atn.decisionToLL1Table.size()) {
+    return ATN::INVALID_ALT_NUMBER; // ATNs which were not deserialized have no tables.
+  }
+
+  const std::vector<uint16_t> &table = atn.decisionToLL1Table[(size_t)decision];
+  size_t index = (size_t)(input->LA(1) + 1);
+  if (index >= table.size()) {
+    return ATN::INVALID_ALT_NUMBER;
+  }
+  return table[index];
 }
 
 void ParserATNSimulator::clearDFA() {
@@ -93,6 +107,12 @@ int ParserATNSimulator::adaptivePredict(TokenStream *input, int decision, Ref<Pa
       << input->LT(1)->getLine() << ":" << input->LT(1)->getCharPositionInLine() << std::endl;
   }
 
+  // No marking, seeking or DFA walk needed if the next token alone determines the alternative.
+  int ll1Alt = getLL1Prediction(input, decision);
+  if (ll1Alt != ATN::INVALID_ALT_NUMBER) {
+    return ll1Alt;
+  }
+
   _input = input;
   _startIndex = (int)input->index();
   _outerContext = outerContext;
@@ -105,7 +125,7 @@ int ParserATNSimulator::adaptivePredict(TokenStream *input, int decision, Ref<Pa
   // Now we are certain to have a specific decision's DFA
   // But, do we still need an initial state?
   auto onExit = finally([this, input, index, m] {
-    mergeCache.clear(); // wack cache after each prediction
+    _configArena.reset();
     _dfa = nullptr;
     input->seek(index);
     input->release(m);
@@ -139,7 +159,9 @@ int ParserATNSimulator::adaptivePredict(TokenStream *input, int decision, Ref<Pa
        * appropriate start state for the precedence level rather
        * than simply setting DFA.s0.
        */
-      dfa.s0->configs = s0_closure; // not used for prediction but useful to know start configs anyway
+      // Not used for prediction but useful to know start configs anyway. s0 is shared, hence the atomic store.
+      s0_closure->promoteConfigs();
+      std::atomic_store(&dfa.s0.load()->configs, s0_closure);
       s0_closure = applyPrecedenceFilter(s0_closure);
 
       dfa::DFAState *newState = new dfa::DFAState(s0_closure); /* mem-check: managed by the DFA or deleted below */
@@ -276,12 +298,12 @@ int ParserATNSimulator::execATN(dfa::DFA &dfa, dfa::DFAState *s0, TokenStream *i
 }
 
 dfa::DFAState *ParserATNSimulator::getExistingTargetState(dfa::DFAState *previousD, ssize_t t) {
-  std::vector<dfa::DFAState *> edges = previousD->edges;
-  if (edges.size() == 0 || t + 1 < 0 || t + 1 >= (ssize_t)edges.size()) {
+  if (t + 1 < 0) {
     return nullptr;
   }
 
-  return edges[(size_t)t + 1];
+  // Lock free: edge tables are published atomically and only ever point to interned states.
+  return previousD->getEdge((size_t)(t + 1));
 }
 
 dfa::DFAState *ParserATNSimulator::computeTargetState(dfa::DFA &dfa, dfa::DFAState *previousD, ssize_t t) {
@@ -490,12 +512,16 @@ Ref<ATNConfigSet> ParserATNSimulator::computeReachSet(Ref<ATNConfigSet> closure_
   std::vector<Ref<ATNConfig>> skippedStopStates;
 
   // First figure out where we can reach on input t
-  for (auto c : closure_->configs) {
+  const FlatATN &flat = atn.flat;
+  for (auto &c : closure_->configs) {
     if (debug) {
       std::cout << "testing " << getTokenName(t) << " at " << c->toString() << std::endl;
     }
 
-    if (is<RuleStopState *>(c->state)) {
+    size_t stateNumber = (size_t)c->state->stateNumber;
+    bool isRuleStopState = flat.isEmpty() ? is<RuleStopState *>(c->state) :
+      flat.states[stateNumber].type == ATNState::RULE_STOP;
+    if (isRuleStopState) {
       assert(c->context->isEmpty());
 
       if (fullCtx || t == Token::EOF) {
@@ -505,12 +531,22 @@ Ref<ATNConfigSet> ParserATNSimulator::computeReachSet(Ref<ATNConfigSet> closure_
       continue;
     }
 
+    if (!flat.isEmpty()) {
+      const FlatATN::Edge *end = flat.transitionsEnd(stateNumber);
+      for (const FlatATN::Edge *edge = flat.transitionsBegin(stateNumber); edge != end; ++edge) {
+        if (flat.matches(*edge, (size_t)t, 0, atn.maxTokenType)) {
+          intermediate->add(_configArena.create<ATNConfig>(c, atn.states[edge->target]), &mergeCache);
+        }
+      }
+      continue;
+    }
+
     size_t n = c->state->getNumberOfTransitions();
     for (size_t ti = 0; ti < n; ti++) { // for each transition
       Transition *trans = c->state->transition(ti);
       ATNState *target = getReachableTarget(trans, (int)t);
       if (target != nullptr) {
-        intermediate->add(std::make_shared<ATNConfig>(c, target), &mergeCache);
+        intermediate->add(_configArena.create<ATNConfig>(c, target), &mergeCache);
       }
     }
   }
@@ -549,7 +585,7 @@ Ref<ATNConfigSet> ParserATNSimulator::computeReachSet(Ref<ATNConfigSet> closure_
     ATNConfig::Set closureBusy;
 
     bool treatEofAsEpsilon = t == Token::EOF;
-    for (auto c : intermediate->configs) {
+    for (auto &c : intermediate->configs) {
       closure(c, reach, closureBusy, false, fullCtx, treatEofAsEpsilon);
     }
   }
@@ -586,7 +622,7 @@ Ref<ATNConfigSet> ParserATNSimulator::computeReachSet(Ref<ATNConfigSet> closure_
   if (skippedStopStates.size() > 0 && (!fullCtx || !PredictionModeClass::hasConfigInRuleStopState(reach))) {
     assert(!skippedStopStates.empty());
 
-    for (auto c : skippedStopStates) {
+    for (auto &c : skippedStopStates) {
       reach->add(c, &mergeCache);
     }
   }
@@ -605,7 +641,7 @@ Ref<ATNConfigSet> ParserATNSimulator::removeAllConfigsNotInRuleStopState(Ref<ATN
 
   Ref<ATNConfigSet> result = std::make_shared<ATNConfigSet>(configs->fullCtx);
 
-  for (auto config : configs->configs) {
+  for (auto &config : configs->configs) {
     if (is<RuleStopState*>(config->state)) {
       result->add(config, &mergeCache);
       continue;
@@ -615,7 +651,7 @@ Ref<ATNConfigSet> ParserATNSimulator::removeAllConfigsNotInRuleStopState(Ref<ATN
       misc::IntervalSet nextTokens = atn.nextTokens(config->state);
       if (nextTokens.contains(Token::EPSILON)) {
         ATNState *endOfRuleState = atn.ruleToStopState[(size_t)config->state->ruleIndex];
-        result->add(std::make_shared<ATNConfig>(config, endOfRuleState), &mergeCache);
+        result->add(_configArena.create<ATNConfig>(config, endOfRuleState), &mergeCache);
       }
     }
   }
@@ -630,7 +666,7 @@ Ref<ATNConfigSet> ParserATNSimulator::computeStartState(ATNState *p, Ref<RuleCon
 
   for (size_t i = 0; i < p->getNumberOfTransitions(); i++) {
     ATNState *target = p->transition(i)->target;
-    Ref<ATNConfig> c = std::make_shared<ATNConfig>(target, (int)i + 1, initialContext);
+    Ref<ATNConfig> c = _configArena.create<ATNConfig>(target, (int)i + 1, initialContext);
     ATNConfig::Set closureBusy;
     closure(c, configs, closureBusy, true, fullCtx, false);
   }
@@ -641,7 +677,7 @@ Ref<ATNConfigSet> ParserATNSimulator::computeStartState(ATNState *p, Ref<RuleCon
 Ref<ATNConfigSet> ParserATNSimulator::applyPrecedenceFilter(Ref<ATNConfigSet> configs) {
   std::map<int, Ref<PredictionContext>> statesFromAlt1;
   Ref<ATNConfigSet> configSet = std::make_shared<ATNConfigSet>(configs->fullCtx);
-  for (Ref<ATNConfig> config : configs->configs) {
+  for (auto &config : configs->configs) {
     // handle alt 1 first
     if (config->alt != 1) {
       continue;
@@ -655,14 +691,14 @@ Ref<ATNConfigSet> ParserATNSimulator::applyPrecedenceFilter(Ref<ATNConfigSet> co
 
     statesFromAlt1[config->state->stateNumber] = config->context;
     if (updatedContext != config->semanticContext) {
-      configSet->add(std::make_shared<ATNConfig>(config, updatedContext), &mergeCache);
+      configSet->add(_configArena.create<ATNConfig>(config, updatedContext), &mergeCache);
     }
     else {
       configSet->add(config, &mergeCache);
     }
   }
 
-  for (Ref<ATNConfig> config : configs->configs) {
+  for (auto &config : configs->configs) {
     if (config->alt == 1) {
       // already handled
       continue;
@@ -711,7 +747,7 @@ std::vector<Ref<SemanticContext>> ParserATNSimulator::getPredsForAmbigAlts(const
    */
   std::vector<Ref<SemanticContext>> altToPred(nalts + 1);
 
-  for (auto c : configs->configs) {
+  for (auto &c : configs->configs) {
     if (ambigAlts.test((size_t)c->alt)) {
       altToPred[(size_t)c->alt] = SemanticContext::Or(altToPred[(size_t)c->alt], c->semanticContext);
     }
@@ -783,7 +819,7 @@ int ParserATNSimulator::getSynValidOrSemInvalidAltThatFinishedDecisionEntryRule(
 
 int ParserATNSimulator::getAltThatFinishedDecisionEntryRule(Ref<ATNConfigSet> configs) {
   misc::IntervalSet alts;
-  for (auto c : configs->configs) {
+  for (auto &c : configs->configs) {
     if (c->getOuterContextDepth() > 0 || (is<RuleStopState *>(c->state) && c->context->hasEmptyPath())) {
       alts.add(c->alt);
     }
@@ -799,7 +835,7 @@ std::pair<Ref<ATNConfigSet>, Ref<ATNConfigSet>> ParserATNSimulator::splitAccordi
 
   Ref<ATNConfigSet> succeeded = std::make_shared<ATNConfigSet>(configs->fullCtx);
   Ref<ATNConfigSet> failed = std::make_shared<ATNConfigSet>(configs->fullCtx);
-  for (Ref<ATNConfig> c : configs->configs) {
+  for (auto &c : configs->configs) {
     if (c->semanticContext != SemanticContext::NONE) {
       bool predicateEvaluationResult = evalSemanticContext(c->semanticContext, outerContext, c->alt, configs->fullCtx);
       if (predicateEvaluationResult) {
@@ -851,15 +887,15 @@ bool ParserATNSimulator::evalSemanticContext(Ref<SemanticContext> pred, Ref<Pars
   return pred->eval(parser, parserCallStack);
 }
 
-void ParserATNSimulator::closure(Ref<ATNConfig> config, Ref<ATNConfigSet> configs, ATNConfig::Set &closureBusy,
-                                 bool collectPredicates, bool fullCtx, bool treatEofAsEpsilon) {
+void ParserATNSimulator::closure(const Ref<ATNConfig> &config, const Ref<ATNConfigSet> &configs,
+  ATNConfig::Set &closureBusy, bool collectPredicates, bool fullCtx, bool treatEofAsEpsilon) {
   const int initialDepth = 0;
   closureCheckingStopState(config, configs, closureBusy, collectPredicates, fullCtx, initialDepth, treatEofAsEpsilon);
 
   assert(!fullCtx || !configs->dipsIntoOuterContext);
 }
 
-void ParserATNSimulator::closureCheckingStopState(Ref<ATNConfig> config, Ref<ATNConfigSet> configs,
+void ParserATNSimulator::closureCheckingStopState(const Ref<ATNConfig> &config, const Ref<ATNConfigSet> &configs,
   ATNConfig::Set &closureBusy, bool collectPredicates, bool fullCtx, int depth, bool treatEofAsEpsilon) {
 
   if (debug) {
@@ -873,7 +909,7 @@ void ParserATNSimulator::closureCheckingStopState(Ref<ATNConfig> config, Ref<ATN
       for (size_t i = 0; i < config->context->size(); i++) {
         if (config->context->getReturnState(i) == PredictionContext::EMPTY_RETURN_STATE) {
           if (fullCtx) {
-            configs->add(std::make_shared<ATNConfig>(config, config->state, PredictionContext::EMPTY), &mergeCache);
+            configs->add(_configArena.create<ATNConfig>(config, config->state, PredictionContext::EMPTY), &mergeCache);
             continue;
           } else {
             // we have no context info, just chase follow links (if greedy)
@@ -886,7 +922,8 @@ void ParserATNSimulator::closureCheckingStopState(Ref<ATNConfig> config, Ref<ATN
         }
         ATNState *returnState = atn.states[(size_t)config->context->getReturnState(i)];
         std::weak_ptr<PredictionContext> newContext = config->context->getParent(i); // "pop" return state
-        Ref<ATNConfig> c = std::make_shared<ATNConfig>(returnState, config->alt, newContext.lock(), config->semanticContext);
+        Ref<ATNConfig> c = _configArena.create<ATNConfig>(returnState, config->alt, newContext.lock(),
+                                                          config->semanticContext);
         // While we have context to pop back from, we may have
         // gotten that context AFTER having falling off a rule.
         // Make sure we track that we are now out of context.
@@ -915,8 +952,8 @@ void ParserATNSimulator::closureCheckingStopState(Ref<ATNConfig> config, Ref<ATN
   closure_(config, configs, closureBusy, collectPredicates, fullCtx, depth, treatEofAsEpsilon);
 }
 
-void ParserATNSimulator::closure_(Ref<ATNConfig> config, Ref<ATNConfigSet> configs, ATNConfig::Set &closureBusy,
-                                  bool collectPredicates, bool fullCtx, int depth, bool treatEofAsEpsilon) {
+void ParserATNSimulator::closure_(const Ref<ATNConfig> &config, const Ref<ATNConfigSet> &configs,
+  ATNConfig::Set &closureBusy, bool collectPredicates, bool fullCtx, int depth, bool treatEofAsEpsilon) {
   ATNState *p = config->state;
   // optimization
   if (!p->onlyHasEpsilonTransitions()) {
@@ -925,12 +962,23 @@ void ParserATNSimulator::closure_(Ref<ATNConfig> config, Ref<ATNConfigSet> confi
     configs->add(config, &mergeCache);
   }
 
-  for (size_t i = 0; i < p->getNumberOfTransitions(); i++) {
-    Transition *t = p->transition(i);
-    bool continueCollecting = !is<ActionTransition*>(t) && collectPredicates;
+  // Transition types come from the flat ATN if there is one, which saves virtual calls and casts.
+  const FlatATN::Edge *edges = atn.flat.isEmpty() ? nullptr : atn.flat.transitionsBegin((size_t)p->stateNumber);
+  bool isRuleStopState = edges != nullptr ? atn.flat.states[(size_t)p->stateNumber].type == ATNState::RULE_STOP :
+    is<RuleStopState*>(p);
+  const std::vector<Transition *> &transitions = p->getTransitions();
+  for (size_t i = 0; i < transitions.size(); i++) {
+    Transition *t = transitions[i];
+    int type = edges != nullptr ? edges[i].type : t->getSerializationType();
+    bool isEpsilon = edges != nullptr ? edges[i].epsilon : t->isEpsilon();
+    if (!isEpsilon && !treatEofAsEpsilon) {
+      continue; // Transitions consuming a symbol only lead to a closure config for EOF.
+    }
+
+    bool continueCollecting = type != Transition::ACTION && collectPredicates;
     Ref<ATNConfig> c = getEpsilonTarget(config, t, continueCollecting, depth == 0, fullCtx, treatEofAsEpsilon);
     if (c != nullptr) {
-      if (!t->isEpsilon()) {
+      if (!isEpsilon) {
         // avoid infinite recursion for EOF* and EOF+
         if (closureBusy.count(c) == 0) {
           closureBusy.insert(c);
@@ -940,7 +988,7 @@ void ParserATNSimulator::closure_(Ref<ATNConfig> config, Ref<ATNConfigSet> confi
       }
 
       int newDepth = depth;
-      if (is<RuleStopState*>(config->state)) {
+      if (isRuleStopState) {
         assert(!fullCtx);
 
         // target fell off end of rule; mark resulting c as having dipped into outer context
@@ -970,7 +1018,7 @@ void ParserATNSimulator::closure_(Ref<ATNConfig> config, Ref<ATNConfigSet> confi
         if (debug) {
           std::cout << "dips into outer ctx: " << c << std::endl;
         }
-      } else if (is<RuleTransition*>(t)) {
+      } else if (type == Transition::RULE) {
         // latch when newDepth goes negative - once we step out of the entry context we can't return
         if (newDepth >= 0) {
           newDepth++;
@@ -989,7 +1037,7 @@ std::string ParserATNSimulator::getRuleName(size_t index) {
   return "<rule " + std::to_string(index) + ">";
 }
 
-Ref<ATNConfig> ParserATNSimulator::getEpsilonTarget(Ref<ATNConfig> config, Transition *t, bool collectPredicates,
+Ref<ATNConfig> ParserATNSimulator::getEpsilonTarget(const Ref<ATNConfig> &config, Transition *t, bool collectPredicates,
                                                     bool inContext, bool fullCtx, bool treatEofAsEpsilon) {
   switch (t->getSerializationType()) {
     case Transition::RULE:
@@ -1005,7 +1053,7 @@ Ref<ATNConfig> ParserATNSimulator::getEpsilonTarget(Ref<ATNConfig> config, Trans
       return actionTransition(config, static_cast<ActionTransition*>(t));
 
     case Transition::EPSILON:
-      return std::make_shared<ATNConfig>(config, t->target);
+      return _configArena.create<ATNConfig>(config, t->target);
 
     case Transition::ATOM:
     case Transition::RANGE:
@@ -1014,7 +1062,7 @@ Ref<ATNConfig> ParserATNSimulator::getEpsilonTarget(Ref<ATNConfig> config, Trans
       // transition is traversed
       if (treatEofAsEpsilon) {
         if (t->matches(Token::EOF, 0, 1)) {
-          return std::make_shared<ATNConfig>(config, t->target);
+          return _configArena.create<ATNConfig>(config, t->target);
         }
       }
       
@@ -1025,14 +1073,14 @@ Ref<ATNConfig> ParserATNSimulator::getEpsilonTarget(Ref<ATNConfig> config, Trans
   }
 }
 
-Ref<ATNConfig> ParserATNSimulator::actionTransition(Ref<ATNConfig> config, ActionTransition *t) {
+Ref<ATNConfig> ParserATNSimulator::actionTransition(const Ref<ATNConfig> &config, ActionTransition *t) {
   if (debug) {
     std::cout << "ACTION edge " << t->ruleIndex << ":" << t->actionIndex << std::endl;
   }
-  return std::make_shared<ATNConfig>(config, t->target);
+  return _configArena.create<ATNConfig>(config, t->target);
 }
 
-Ref<ATNConfig> ParserATNSimulator::precedenceTransition(Ref<ATNConfig> config, PrecedencePredicateTransition *pt,
+Ref<ATNConfig> ParserATNSimulator::precedenceTransition(const Ref<ATNConfig> &config, PrecedencePredicateTransition *pt,
     bool collectPredicates, bool inContext, bool fullCtx) {
   if (debug) {
     std::cout << "PRED (collectPredicates=" << collectPredicates << ") " << pt->precedence << ">=_p" << ", ctx dependent=true" << std::endl;
@@ -1055,14 +1103,14 @@ Ref<ATNConfig> ParserATNSimulator::precedenceTransition(Ref<ATNConfig> config, P
       bool predSucceeds = evalSemanticContext(pt->getPredicate(), _outerContext, config->alt, fullCtx);
       _input->seek(currentPosition);
       if (predSucceeds) {
-        c = std::make_shared<ATNConfig>(config, pt->target); // no pred context
+        c = _configArena.create<ATNConfig>(config, pt->target); // no pred context
       }
     } else {
       Ref<SemanticContext::AND> newSemCtx = std::make_shared<SemanticContext::AND>(config->semanticContext, predicate);
-      c = std::make_shared<ATNConfig>(config, pt->target, newSemCtx);
+      c = _configArena.create<ATNConfig>(config, pt->target, newSemCtx);
     }
   } else {
-    c = std::make_shared<ATNConfig>(config, pt->target);
+    c = _configArena.create<ATNConfig>(config, pt->target);
   }
 
   if (debug) {
@@ -1071,8 +1119,8 @@ Ref<ATNConfig> ParserATNSimulator::precedenceTransition(Ref<ATNConfig> config, P
   return c;
 }
 
-Ref<ATNConfig> ParserATNSimulator::predTransition(Ref<ATNConfig> config, PredicateTransition *pt, bool collectPredicates,
-                                                  bool inContext, bool fullCtx) {
+Ref<ATNConfig> ParserATNSimulator::predTransition(const Ref<ATNConfig> &config, PredicateTransition *pt,
+  bool collectPredicates, bool inContext, bool fullCtx) {
   if (debug) {
     std::cout << "PRED (collectPredicates=" << collectPredicates << ") " << pt->ruleIndex << ":" << pt->predIndex << ", ctx dependent=" << pt->isCtxDependent << std::endl;
     if (parser != nullptr) {
@@ -1093,14 +1141,14 @@ Ref<ATNConfig> ParserATNSimulator::predTransition(Ref<ATNConfig> config, Predica
       bool predSucceeds = evalSemanticContext(pt->getPredicate(), _outerContext, config->alt, fullCtx);
       _input->seek(currentPosition);
       if (predSucceeds) {
-        c = std::make_shared<ATNConfig>(config, pt->target); // no pred context
+        c = _configArena.create<ATNConfig>(config, pt->target); // no pred context
       }
     } else {
       Ref<SemanticContext::AND> newSemCtx = std::make_shared<SemanticContext::AND>(config->semanticContext, predicate);
-      c = std::make_shared<ATNConfig>(config, pt->target, newSemCtx);
+      c = _configArena.create<ATNConfig>(config, pt->target, newSemCtx);
     }
   } else {
-    c = std::make_shared<ATNConfig>(config, pt->target);
+    c = _configArena.create<ATNConfig>(config, pt->target);
   }
 
   if (debug) {
@@ -1109,14 +1157,14 @@ Ref<ATNConfig> ParserATNSimulator::predTransition(Ref<ATNConfig> config, Predica
   return c;
 }
 
-Ref<ATNConfig> ParserATNSimulator::ruleTransition(Ref<ATNConfig> config, RuleTransition *t) {
+Ref<ATNConfig> ParserATNSimulator::ruleTransition(const Ref<ATNConfig> &config, RuleTransition *t) {
   if (debug) {
     std::cout << "CALL rule " << getRuleName((size_t)t->target->ruleIndex) << ", ctx=" << config->context << std::endl;
   }
 
   atn::ATNState *returnState = t->followState;
   Ref<PredictionContext> newContext = SingletonPredictionContext::create(config->context, returnState->stateNumber);
-  return std::make_shared<ATNConfig>(config, t->target, newContext);
+  return _configArena.create<ATNConfig>(config, t->target, newContext);
 }
 
 BitSet ParserATNSimulator::getConflictingAlts(Ref<ATNConfigSet> configs) {
@@ -1180,7 +1228,7 @@ NoViableAltException ParserATNSimulator::noViableAlt(TokenStream *input, Ref<Par
 
 int ParserATNSimulator::getUniqueAlt(Ref<ATNConfigSet> configs) {
   int alt = ATN::INVALID_ALT_NUMBER;
-  for (auto c : configs->configs) {
+  for (auto &c : configs->configs) {
     if (alt == ATN::INVALID_ALT_NUMBER) {
       alt = c->alt; // found first alt
     } else if (c->alt != alt) {
@@ -1204,12 +1252,8 @@ dfa::DFAState *ParserATNSimulator::addDFAEdge(dfa::DFA &dfa, dfa::DFAState *from
     return to;
   }
 
-  {
-    std::lock_guard<std::recursive_mutex> lck(mtx);
-    if (from->edges.empty())
-      from->edges.resize(atn.maxTokenType + 1 + 1);
-    from->edges[(size_t)(t + 1)] = to; // connect
-  }
+  // Make room for tokens 1..n and -1 masquerading as index 0.
+  from->setEdge((size_t)(t + 1), to, atn.maxTokenType + 1 + 1); // connect
 
   if (debug) {
     Ref<dfa::Vocabulary> vocabulary = dfa::VocabularyImpl::EMPTY_VOCABULARY;
@@ -1227,25 +1271,17 @@ dfa::DFAState *ParserATNSimulator::addDFAState(dfa::DFA &dfa, dfa::DFAState *D)
     return D;
   }
 
-  {
-    std::lock_guard<std::recursive_mutex> lck(mtx);
-
-    auto existing = dfa.states.find(D);
-    if (existing != dfa.states.end()) {
-      return existing->second;
-    }
+  // The state must be complete before it is added, since other threads can see it as soon as it is in the DFA.
+  if (!D->configs->isReadonly()) {
+    D->configs->optimizeConfigs(this);
+    D->configs->setReadonly(true);
+  }
 
-    D->stateNumber = (int)dfa.states.size();
-    if (!D->configs->isReadonly()) {
-      D->configs->optimizeConfigs(this);
-      D->configs->setReadonly(true);
-    }
-    dfa.states[D] = D;
-    if (debug) {
-      std::cout << "adding new DFA state: " << D << std::endl;
-    }
-    return D;
+  dfa::DFAState *existing = dfa.addState(D);
+  if (debug && existing == D) {
+    std::cout << "adding new DFA state: " << D << std::endl;
   }
+  return existing;
 }
 
 void ParserATNSimulator::reportAttemptingFullContext(dfa::DFA &dfa, const antlrcpp::BitSet &conflictingAlts,
@@ -1289,6 +1325,10 @@ atn::PredictionMode ParserATNSimulator::getPredictionMode() {
   return mode;
 }
 
+PredictionContextMergeCache& ParserATNSimulator::getMergeCache() {
+  return mergeCache;
+}
+
 Parser* ParserATNSimulator::getParser() {
   return parser;
 }
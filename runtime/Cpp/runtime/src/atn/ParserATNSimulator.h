@@ -32,6 +32,7 @@
 #pragma once
 
 #include "PredictionMode.h"
+#include "atn/PredictionContextMergeCache.h"
 #include "dfa/DFAState.h"
 #include "atn/ATNSimulator.h"
 #include "atn/PredictionContext.h"
@@ -198,29 +199,19 @@ namespace atn {
    * <strong>THREAD SAFETY</strong></p>
    *
    * <p>
-   * The {@link ParserATNSimulator} locks on the {@link #decisionToDFA} field when
-   * it adds a new DFA object to that array. {@link #addDFAEdge}
-   * locks on the DFA for the current decision when setting the
-   * {@link DFAState#edges} field. {@link #addDFAState} locks on
-   * the DFA for the current decision when looking up a DFA state to see if it
-   * already exists. We must make sure that all requests to add DFA states that
-   * are equivalent result in the same shared DFA object. This is because lots of
-   * threads will be trying to update the DFA at once. The
-   * {@link #addDFAState} method also locks inside the DFA lock
-   * but this time on the shared context cache when it rebuilds the
-   * configurations' {@link PredictionContext} objects using cached
-   * subgraphs/nodes. No other locking occurs, even during DFA simulation. This is
-   * safe as long as we can guarantee that all threads referencing
-   * {@code s.edge[t]} get the same physical target {@link DFAState}, or
-   * {@code null}. Once into the DFA, the DFA simulation does not reference the
-   * {@link DFA#states} map. It follows the {@link DFAState#edges} field to new
-   * targets. The DFA simulator will either find {@link DFAState#edges} to be
-   * {@code null}, to be non-{@code null} and {@code dfa.edges[t]} null, or
-   * {@code dfa.edges[t]} to be non-null. The
-   * {@link #addDFAEdge} method could be racing to set the field
-   * but in either case the DFA simulator works; if {@code null}, and requests ATN
-   * simulation. It could also race trying to get {@code dfa.edges[t]}, but either
-   * way it will work because it's not doing a test and set operation.</p>
+   * The {@link DFA} objects in {@link #decisionToDFA} are usually shared between
+   * all parser instances of a grammar. {@link #addDFAState} completes a state
+   * (optimizing its configurations against the shared context cache, which has
+   * its own lock) and only then hands it to {@link DFA#addState}, which locks on
+   * the DFA while looking up an equal state. We must make sure that all requests
+   * to add DFA states that are equivalent result in the same shared DFA object.
+   * No other locking occurs, neither in {@link #addDFAEdge} nor during DFA
+   * simulation. Edge tables are published with a compare-and-swap and their
+   * entries are atomics (see {@link DFAState#setEdge}), so a reader sees either
+   * no table, a table with a {@code null} entry or the final target, which is
+   * always an interned state. If it sees {@code null} it simply falls back to
+   * ATN simulation. Two threads racing to set the same edge store the same
+   * physical target, so it doesn't matter which one wins.</p>
    *
    * <p>
    * <strong>Starting with SLL then failing to combined SLL/LL (Two-Stage
@@ -289,17 +280,15 @@ namespace atn {
   private:
     PredictionMode mode;
 
-    // Mutex to manage synchronized access for multithreading in the parser atn simulator.
-    std::recursive_mutex _lock;
-
     /// <summary>
-    /// Each prediction operation uses a cache for merge of prediction contexts.
-    ///  Don't keep around as it wastes huge amounts of memory. The merge cache
-    ///  isn't synchronized but we're ok since two threads shouldn't reuse same
-    ///  parser/atnsim object because it can only handle one input at a time.
+    /// Prediction operations use a cache for merge of prediction contexts.
     ///  This maps graphs a and b to merged result c. (a,b)->c. We can avoid
     ///  the merge if we ever see a and b again.  Note that (b,a)->c should
-    ///  also be examined during cache lookup.
+    ///  also be examined during cache lookup. The cache is kept for a whole
+    ///  parse (it is cleared in reset()), its size is bounded to limit the memory
+    ///  held by it. The merge cache isn't synchronized but we're ok since two
+    ///  threads shouldn't reuse same parser/atnsim object because it can only
+    ///  handle one input at a time.
     /// </summary>
   protected:
     PredictionContextMergeCache mergeCache;
@@ -322,6 +311,13 @@ namespace atn {
     virtual void clearDFA() override;
     virtual int adaptivePredict(TokenStream *input, int decision, Ref<ParserRuleContext> outerContext);
 
+  protected:
+    /// Predicts an LL(1) decision (see ATN::decisionToLL1Table) from the next token alone. Returns
+    /// ATN::INVALID_ALT_NUMBER if the decision is not LL(1) or the next token is not in its lookahead, then full
+    /// prediction must be used (which also reports the syntax error if there is one).
+    int getLL1Prediction(TokenStream *input, int decision) const;
+
+  public:
     /// <summary>
     /// Performs ATN simulation to compute a predicted alternative based
     ///  upon the remaining input, but also updates the DFA cache to avoid
@@ -582,6 +578,7 @@ namespace atn {
      */
     Ref<ATNConfigSet> applyPrecedenceFilter(Ref<ATNConfigSet> configs);
     
+    /// Only used for ATNs without a flat representation (see ATN::flat).
     virtual ATNState *getReachableTarget(Transition *trans, int ttype);
 
     virtual std::vector<Ref<SemanticContext>> getPredsForAmbigAlts(const antlrcpp::BitSet &ambigAlts,
@@ -701,33 +698,33 @@ namespace atn {
      waste to pursue the closure. Might have to advance when we do
      ambig detection thought :(
      */
-    virtual void closure(Ref<ATNConfig> config, Ref<ATNConfigSet> configs, ATNConfig::Set &closureBusy,
+    virtual void closure(const Ref<ATNConfig> &config, const Ref<ATNConfigSet> &configs, ATNConfig::Set &closureBusy,
                          bool collectPredicates, bool fullCtx, bool treatEofAsEpsilon);
 
-    virtual void closureCheckingStopState(Ref<ATNConfig> config, Ref<ATNConfigSet> configs, ATNConfig::Set &closureBusy,
-                                          bool collectPredicates, bool fullCtx, int depth, bool treatEofAsEpsilon);
+    virtual void closureCheckingStopState(const Ref<ATNConfig> &config, const Ref<ATNConfigSet> &configs,
+      ATNConfig::Set &closureBusy, bool collectPredicates, bool fullCtx, int depth, bool treatEofAsEpsilon);
 
     /// Do the actual work of walking epsilon edges.
-    virtual void closure_(Ref<ATNConfig> config, Ref<ATNConfigSet> configs, ATNConfig::Set &closureBusy,
+    virtual void closure_(const Ref<ATNConfig> &config, const Ref<ATNConfigSet> &configs, ATNConfig::Set &closureBusy,
                           bool collectPredicates, bool fullCtx, int depth, bool treatEofAsEpsilon);
 
   public:
     virtual std::string getRuleName(size_t index);
 
   protected:
-    virtual Ref<ATNConfig> getEpsilonTarget(Ref<ATNConfig> config, Transition *t, bool collectPredicates,
+    virtual Ref<ATNConfig> getEpsilonTarget(const Ref<ATNConfig> &config, Transition *t, bool collectPredicates,
                                             bool inContext, bool fullCtx, bool treatEofAsEpsilon);
-    virtual Ref<ATNConfig> actionTransition(Ref<ATNConfig> config, ActionTransition *t);
+    virtual Ref<ATNConfig> actionTransition(const Ref<ATNConfig> &config, ActionTransition *t);
 
   public:
-    virtual Ref<ATNConfig> precedenceTransition(Ref<ATNConfig> config, PrecedencePredicateTransition *pt,
+    virtual Ref<ATNConfig> precedenceTransition(const Ref<ATNConfig> &config, PrecedencePredicateTransition *pt,
                                                 bool collectPredicates, bool inContext, bool fullCtx);
 
   protected:
-    virtual Ref<ATNConfig> predTransition(Ref<ATNConfig> config, PredicateTransition *pt, bool collectPredicates,
+    virtual Ref<ATNConfig> predTransition(const Ref<ATNConfig> &config, PredicateTransition *pt, bool collectPredicates,
                                           bool inContext, bool fullCtx);
 
-    virtual Ref<ATNConfig> ruleTransition(Ref<ATNConfig> config, RuleTransition *t);
+    virtual Ref<ATNConfig> ruleTransition(const Ref<ATNConfig> &config, RuleTransition *t);
 
     /**
      * Gets a {@link BitSet} containing the alternatives in {@code configs}
@@ -852,6 +849,9 @@ namespace atn {
     void setPredictionMode(PredictionMode mode);
     PredictionMode getPredictionMode();
 
+    /// The merge cache of this simulator, e.g. to change its size limit or to read its hit rate.
+    PredictionContextMergeCache& getMergeCache();
+
     Parser* getParser();
 
   private:
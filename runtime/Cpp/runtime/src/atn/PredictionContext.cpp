@@ -37,6 +37,8 @@
 #include "atn/RuleTransition.h"
 #include "support/Arrays.h"
 #include "support/CPPUtils.h"
+#include "atn/PredictionContextCache.h"
+#include "atn/PredictionContextMergeCache.h"
 
 #include "atn/PredictionContext.h"
 
@@ -46,7 +48,7 @@ using namespace org::antlr::v4::runtime::atn;
 
 using namespace antlrcpp;
 
-int PredictionContext::globalNodeCount = 0;
+std::atomic<int> PredictionContext::globalNodeCount(0);
 const Ref<PredictionContext> PredictionContext::EMPTY = std::make_shared<EmptyPredictionContext>();
 
 PredictionContext::PredictionContext(size_t cachedHashCode) : id(globalNodeCount++), cachedHashCode(cachedHashCode)  {
@@ -163,20 +165,16 @@ Ref<PredictionContext> PredictionContext::mergeSingletons(Ref<SingletonPredictio
   Ref<SingletonPredictionContext> b, bool rootIsWildcard, PredictionContextMergeCache *mergeCache) {
 
   if (mergeCache != nullptr) { // Can be null if not given to the ATNState from which this call originates.
-    auto iterator = mergeCache->find({ a.get(), b.get() });
-    if (iterator != mergeCache->end()) {
-      return iterator->second;
-    }
-    iterator = mergeCache->find({ b.get(), a.get() });
-    if (iterator != mergeCache->end()) {
-      return iterator->second;
+    Ref<PredictionContext> cached = mergeCache->get(a, b, rootIsWildcard); // Also finds (b, a).
+    if (cached) {
+      return cached;
     }
   }
 
   Ref<PredictionContext> rootMerge = mergeRoot(a, b, rootIsWildcard);
   if (rootMerge) {
     if (mergeCache != nullptr) {
-      (*mergeCache)[{ a.get(), b.get() }] = rootMerge;
+      mergeCache->put(a, b, rootIsWildcard, rootMerge);
     }
     return rootMerge;
   }
@@ -200,7 +198,7 @@ Ref<PredictionContext> PredictionContext::mergeSingletons(Ref<SingletonPredictio
     // new joined parent so create new singleton pointing to it, a'
     Ref<PredictionContext> a_ = SingletonPredictionContext::create(parent, a->returnState);
     if (mergeCache != nullptr) {
-      (*mergeCache)[{ a.get(), b.get() }] = a_;
+      mergeCache->put(a, b, rootIsWildcard, a_);
     }
     return a_;
   } else {
@@ -219,7 +217,7 @@ Ref<PredictionContext> PredictionContext::mergeSingletons(Ref<SingletonPredictio
       std::vector<std::weak_ptr<PredictionContext>> parents = { singleParent, singleParent };
       Ref<PredictionContext> a_ = std::make_shared<ArrayPredictionContext>(parents, payloads);
       if (mergeCache != nullptr) {
-        (*mergeCache)[{ a.get(), b.get() }] = a_;
+        mergeCache->put(a, b, rootIsWildcard, a_);
       }
       return a_;
     }
@@ -239,7 +237,7 @@ Ref<PredictionContext> PredictionContext::mergeSingletons(Ref<SingletonPredictio
     }
 
     if (mergeCache != nullptr) {
-      (*mergeCache)[{ a.get(), b.get() }] = a_;
+      mergeCache->put(a, b, rootIsWildcard, a_);
     }
     return a_;
   }
@@ -278,13 +276,9 @@ Ref<PredictionContext> PredictionContext::mergeArrays(Ref<ArrayPredictionContext
   Ref<ArrayPredictionContext> b, bool rootIsWildcard, PredictionContextMergeCache *mergeCache) {
 
   if (mergeCache != nullptr) {
-    auto iterator = mergeCache->find({ a.get(), b.get() });
-    if (iterator != mergeCache->end()) {
-      return iterator->second;
-    }
-    iterator = mergeCache->find({ b.get(), a.get() });
-    if (iterator != mergeCache->end()) {
-      return iterator->second;
+    Ref<PredictionContext> cached = mergeCache->get(a, b, rootIsWildcard); // Also finds (b, a).
+    if (cached) {
+      return cached;
     }
   }
 
@@ -350,7 +344,7 @@ Ref<PredictionContext> PredictionContext::mergeArrays(Ref<ArrayPredictionContext
     if (k == 1) { // for just one merged element, return singleton top
       Ref<PredictionContext> a_ = SingletonPredictionContext::create(mergedParents[0].lock(), mergedReturnStates[0]);
       if (mergeCache != nullptr) {
-        (*mergeCache)[{ a.get(), b.get() }] = a_;
+        mergeCache->put(a, b, rootIsWildcard, a_);
       }
       return a_;
     }
@@ -366,13 +360,13 @@ Ref<PredictionContext> PredictionContext::mergeArrays(Ref<ArrayPredictionContext
   // TO_DO: track whether this is possible above during merge sort for speed
   if (M == a) {
     if (mergeCache != nullptr) {
-      (*mergeCache)[{ a.get(), b.get() }] = a;
+      mergeCache->put(a, b, rootIsWildcard, a);
     }
     return a;
   }
   if (M == b) {
     if (mergeCache != nullptr) {
-      (*mergeCache)[{ a.get(), b.get() }] = b;
+      mergeCache->put(a, b, rootIsWildcard, b);
     }
     return b;
   }
@@ -382,7 +376,7 @@ Ref<PredictionContext> PredictionContext::mergeArrays(Ref<ArrayPredictionContext
     M = std::make_shared<ArrayPredictionContext>(mergedParents, mergedReturnStates);
 
   if (mergeCache != nullptr) {
-    (*mergeCache)[{ a.get(), b.get() }] = M;
+    mergeCache->put(a, b, rootIsWildcard, M);
   }
   return M;
 }
@@ -483,11 +477,11 @@ Ref<PredictionContext> PredictionContext::getCachedContext(Ref<PredictionContext
       return iterator->second; // Not necessarly the same as context.
   }
 
-  auto iterator = contextCache->find(context);
-  if (iterator != contextCache->end()) {
-    visited[context] = *iterator;
+  Ref<PredictionContext> cached = contextCache->get(context);
+  if (cached) {
+    visited[context] = cached;
 
-    return *iterator;
+    return cached;
   }
 
   bool changed = false;
@@ -510,10 +504,11 @@ Ref<PredictionContext> PredictionContext::getCachedContext(Ref<PredictionContext
   }
 
   if (!changed) {
-    contextCache->insert(context);
-    visited[context] = context;
+    // Another thread may have added an equal node meanwhile, which is then used instead.
+    cached = contextCache->add(context);
+    visited[context] = cached;
 
-    return context;
+    return cached;
   }
 
   Ref<PredictionContext> updated;
@@ -525,7 +520,7 @@ Ref<PredictionContext> PredictionContext::getCachedContext(Ref<PredictionContext
     updated = std::make_shared<ArrayPredictionContext>(parents, std::dynamic_pointer_cast<ArrayPredictionContext>(context)->returnStates);
   }
 
-  contextCache->insert(updated);
+  updated = contextCache->add(updated);
   visited[updated] = updated;
   visited[context] = updated;
 
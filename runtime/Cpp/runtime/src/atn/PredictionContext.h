@@ -41,12 +41,6 @@ namespace v4 {
 namespace runtime {
 namespace atn {
 
-  // Cannot use PredictionContext> here as this declared below first.
-  typedef std::unordered_set<Ref<PredictionContext>> PredictionContextCache;
-
-  // For the keys we use raw pointers, as we don't need to access them.
-  typedef std::map<std::pair<PredictionContext *, PredictionContext *>, Ref<PredictionContext>> PredictionContextMergeCache;
-
   class ANTLR4CPP_PUBLIC PredictionContext {
   public:
     struct PredictionContextHasher
@@ -76,7 +70,7 @@ namespace atn {
     static const int INITIAL_HASH = 1;
 
   public:
-    static int globalNodeCount;
+    static std::atomic<int> globalNodeCount;
     const int id;
 
     /// <summary>
@@ -0,0 +1,99 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atn/PredictionContextCache.h"
+
+using namespace org::antlr::v4::runtime::atn;
+
+PredictionContextCache::PredictionContextCache(size_t maxSize) : _maxSize(maxSize) {
+}
+
+Ref<PredictionContext> PredictionContextCache::add(const Ref<PredictionContext> &context) {
+  if (context == PredictionContext::EMPTY) {
+    return PredictionContext::EMPTY;
+  }
+
+  Shard &shard = _shards[getShardIndex(context)];
+  std::lock_guard<std::mutex> lock(shard.lock);
+  auto iterator = shard.contexts.find(context);
+  if (iterator != shard.contexts.end()) {
+    return *iterator;
+  }
+
+  size_t maxSize = _maxSize;
+  if (maxSize > 0 && shard.contexts.size() >= std::max(maxSize / SHARD_COUNT, (size_t)1)) {
+    shard.contexts.clear();
+  }
+  shard.contexts.insert(context);
+  return context;
+}
+
+Ref<PredictionContext> PredictionContextCache::get(const Ref<PredictionContext> &context) const {
+  const Shard &shard = _shards[getShardIndex(context)];
+  std::lock_guard<std::mutex> lock(shard.lock);
+  auto iterator = shard.contexts.find(context);
+  if (iterator == shard.contexts.end()) {
+    return nullptr;
+  }
+  return *iterator;
+}
+
+size_t PredictionContextCache::size() const {
+  size_t result = 0;
+  for (const Shard &shard : _shards) {
+    std::lock_guard<std::mutex> lock(shard.lock);
+    result += shard.contexts.size();
+  }
+  return result;
+}
+
+bool PredictionContextCache::isEmpty() const {
+  return size() == 0;
+}
+
+void PredictionContextCache::clear() {
+  for (Shard &shard : _shards) {
+    std::lock_guard<std::mutex> lock(shard.lock);
+    shard.contexts.clear();
+  }
+}
+
+void PredictionContextCache::setMaxSize(size_t maxSize) {
+  _maxSize = maxSize;
+}
+
+size_t PredictionContextCache::getMaxSize() const {
+  return _maxSize;
+}
+
+size_t PredictionContextCache::getShardIndex(const Ref<PredictionContext> &context) {
+  // Use the high bits of a multiplicative hash, hash tables usually take the low bits of the hash code already.
+  uint32_t hash = (uint32_t)context->hashCode() * 2654435769U;
+  return (hash >> 24) % SHARD_COUNT;
+}
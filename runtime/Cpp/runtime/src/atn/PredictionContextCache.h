@@ -0,0 +1,86 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "atn/PredictionContext.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+namespace atn {
+
+  /// Interns the nodes of prediction context graphs, so that structurally equal nodes created by different
+  /// simulators are shared instead of being duplicated in the config sets of the DFA states. Nodes are keyed
+  /// by their hash code and compared by content.
+  ///
+  /// One cache is usually shared by all recognizers of a grammar, also across threads. To keep lock contention low
+  /// the cache is split into shards with a lock each, a node only ever locks the shard it hashes to.
+  class ANTLR4CPP_PUBLIC PredictionContextCache {
+  public:
+    /// <param name="maxSize"> The number of nodes the cache may hold, 0 for no limit. </param>
+    PredictionContextCache(size_t maxSize = 0);
+
+    /// Returns the cached node equal to {@code context}. If there is none {@code context} is added and returned.
+    Ref<PredictionContext> add(const Ref<PredictionContext> &context);
+
+    /// Returns the cached node equal to {@code context} or null if there is none.
+    Ref<PredictionContext> get(const Ref<PredictionContext> &context) const;
+
+    size_t size() const;
+    bool isEmpty() const;
+    void clear();
+
+    /// Limits the number of cached nodes (0 means no limit). The limit is applied per shard: a shard which runs
+    /// full is emptied before the next node is added. This only costs sharing, nodes in use stay alive where they are
+    /// referenced.
+    void setMaxSize(size_t maxSize);
+    size_t getMaxSize() const;
+
+  private:
+    static const size_t SHARD_COUNT = 16;
+
+    struct Shard {
+      mutable std::mutex lock;
+      std::unordered_set<Ref<PredictionContext>, PredictionContext::PredictionContextHasher,
+        PredictionContext::PredictionContextComparer> contexts;
+    };
+
+    Shard _shards[SHARD_COUNT];
+    std::atomic<size_t> _maxSize;
+
+    static size_t getShardIndex(const Ref<PredictionContext> &context);
+  };
+
+} // namespace atn
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
@@ -0,0 +1,156 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atn/PredictionContext.h"
+
+#include "atn/PredictionContextMergeCache.h"
+
+using namespace org::antlr::v4::runtime::atn;
+
+static const size_t INITIAL_CAPACITY = 64;
+
+PredictionContextMergeCache::PredictionContextMergeCache(size_t maxSize)
+  : _size(0), _maxSize(maxSize), _hits(0), _misses(0) {
+}
+
+Ref<PredictionContext> PredictionContextMergeCache::get(const Ref<PredictionContext> &a,
+  const Ref<PredictionContext> &b, bool rootIsWildcard) {
+  if (_size > 0) {
+    size_t mask = _entries.size() - 1;
+    for (size_t slot = getSlot(a.get(), b.get(), rootIsWildcard); _entries[slot].value; slot = (slot + 1) & mask) {
+      const Entry &entry = _entries[slot];
+      if (entry.rootIsWildcard == rootIsWildcard && ((entry.a.get() == a.get() && entry.b.get() == b.get()) ||
+        (entry.a.get() == b.get() && entry.b.get() == a.get()))) {
+        ++_hits;
+        return entry.value;
+      }
+    }
+  }
+
+  ++_misses;
+  return nullptr;
+}
+
+void PredictionContextMergeCache::put(const Ref<PredictionContext> &a, const Ref<PredictionContext> &b,
+  bool rootIsWildcard, const Ref<PredictionContext> &value) {
+  if (_maxSize > 0 && _size >= _maxSize) {
+    clear();
+  }
+
+  // Keep the load factor at or below 1/2, so probe sequences stay short.
+  if (2 * (_size + 1) > _entries.size()) {
+    rehash(std::max(INITIAL_CAPACITY, 2 * _entries.size()));
+  }
+
+  size_t mask = _entries.size() - 1;
+  size_t slot = getSlot(a.get(), b.get(), rootIsWildcard);
+  for (; _entries[slot].value; slot = (slot + 1) & mask) {
+    Entry &entry = _entries[slot];
+    if (entry.rootIsWildcard == rootIsWildcard && ((entry.a.get() == a.get() && entry.b.get() == b.get()) ||
+      (entry.a.get() == b.get() && entry.b.get() == a.get()))) {
+      entry.value = value;
+      return;
+    }
+  }
+
+  _entries[slot] = { a, b, value, rootIsWildcard };
+  ++_size;
+}
+
+void PredictionContextMergeCache::clear() {
+  if (_size == 0) {
+    return;
+  }
+
+  // Keep the table allocated, it will likely fill up again to the same size.
+  for (Entry &entry : _entries) {
+    entry = Entry();
+  }
+  _size = 0;
+}
+
+size_t PredictionContextMergeCache::size() const {
+  return _size;
+}
+
+void PredictionContextMergeCache::setMaxSize(size_t maxSize) {
+  _maxSize = maxSize;
+  if (_maxSize > 0 && _size > _maxSize) {
+    clear();
+  }
+}
+
+size_t PredictionContextMergeCache::getMaxSize() const {
+  return _maxSize;
+}
+
+size_t PredictionContextMergeCache::getHits() const {
+  return _hits;
+}
+
+size_t PredictionContextMergeCache::getMisses() const {
+  return _misses;
+}
+
+double PredictionContextMergeCache::getHitRate() const {
+  if (_hits + _misses == 0) {
+    return 0;
+  }
+  return (double)_hits / (_hits + _misses);
+}
+
+void PredictionContextMergeCache::resetStatistics() {
+  _hits = 0;
+  _misses = 0;
+}
+
+size_t PredictionContextMergeCache::getSlot(const PredictionContext *a, const PredictionContext *b,
+  bool rootIsWildcard) const {
+  // The sum makes the hash independent of the order of a and b.
+  size_t hash = ((size_t)a >> 3) + ((size_t)b >> 3) + (rootIsWildcard ? 1 : 0);
+  hash *= (size_t)0x9E3779B97F4A7C15ULL;
+  hash ^= hash >> 29;
+  return hash & (_entries.size() - 1);
+}
+
+void PredictionContextMergeCache::rehash(size_t capacity) {
+  std::vector<Entry> entries(capacity);
+  std::swap(entries, _entries);
+
+  size_t mask = capacity - 1;
+  for (Entry &entry : entries) {
+    if (entry.value) {
+      size_t slot = getSlot(entry.a.get(), entry.b.get(), entry.rootIsWildcard);
+      while (_entries[slot].value) {
+        slot = (slot + 1) & mask;
+      }
+      _entries[slot] = std::move(entry);
+    }
+  }
+}
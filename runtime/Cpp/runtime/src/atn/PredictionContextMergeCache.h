@@ -0,0 +1,97 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "antlr4-common.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+namespace atn {
+
+  /// Memoizes the results of PredictionContext::merge. The key is the identity of the two merged contexts (in either
+  /// order) plus the wildcard flag. The keys are kept alive by the cache: otherwise a new context could get the address
+  /// of a released one and would then get the cached merge result of the old one.
+  ///
+  /// The entries live in an open addressing hash table with linear probing. The parser ATN simulator keeps its cache
+  /// for a whole parse, because full context prediction repeats the same merges very often. The number of entries is
+  /// bounded, the table is emptied when it runs full.
+  ///
+  /// Like the simulator owning it, this class is not thread safe.
+  class ANTLR4CPP_PUBLIC PredictionContextMergeCache {
+  public:
+    static const size_t DEFAULT_MAX_SIZE = 1 << 14;
+
+    /// <param name="maxSize"> The maximum number of cached merge results, 0 for no limit. </param>
+    PredictionContextMergeCache(size_t maxSize = DEFAULT_MAX_SIZE);
+
+    /// Returns the cached result of merging {@code a} and {@code b} (or {@code b} and {@code a}) or null if there is none.
+    Ref<PredictionContext> get(const Ref<PredictionContext> &a, const Ref<PredictionContext> &b, bool rootIsWildcard);
+
+    void put(const Ref<PredictionContext> &a, const Ref<PredictionContext> &b, bool rootIsWildcard,
+             const Ref<PredictionContext> &value);
+
+    /// Removes all entries, but keeps the statistics.
+    void clear();
+    size_t size() const;
+
+    void setMaxSize(size_t maxSize);
+    size_t getMaxSize() const;
+
+    /// Lookup statistics, collected since construction or the last resetStatistics call.
+    size_t getHits() const;
+    size_t getMisses() const;
+    double getHitRate() const;
+    void resetStatistics();
+
+  private:
+    struct Entry {
+      Ref<PredictionContext> a;
+      Ref<PredictionContext> b;
+      Ref<PredictionContext> value;
+      bool rootIsWildcard;
+    };
+
+    std::vector<Entry> _entries; // Size is a power of 2, empty slots have no value.
+    size_t _size;
+    size_t _maxSize;
+    size_t _hits;
+    size_t _misses;
+
+    size_t getSlot(const PredictionContext *a, const PredictionContext *b, bool rootIsWildcard) const;
+    void rehash(size_t capacity);
+  };
+
+} // namespace atn
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
@@ -83,7 +83,7 @@ bool PredictionModeClass::hasSLLConflictTerminatingPrediction(PredictionMode mod
     if (configs->hasSemanticContext) {
       // dup configs, tossing out semantic predicates
       Ref<ATNConfigSet> dup = std::make_shared<ATNConfigSet>(true);
-      for (auto config : configs->configs) {
+      for (auto &config : configs->configs) {
         Ref<ATNConfig> c = std::make_shared<ATNConfig>(config, SemanticContext::NONE);
         dup->add(c);
       }
@@ -99,7 +99,7 @@ bool PredictionModeClass::hasSLLConflictTerminatingPrediction(PredictionMode mod
 }
 
 bool PredictionModeClass::hasConfigInRuleStopState(Ref<ATNConfigSet> configs) {
-  for (auto c : configs->configs) {
+  for (auto &c : configs->configs) {
     if (is<RuleStopState *>(c->state)) {
       return true;
     }
@@ -109,7 +109,7 @@ bool PredictionModeClass::hasConfigInRuleStopState(Ref<ATNConfigSet> configs) {
 }
 
 bool PredictionModeClass::allConfigsInRuleStopStates(Ref<ATNConfigSet> configs) {
-  for (auto config : configs->configs) {
+  for (auto &config : configs->configs) {
     if (!is<RuleStopState*>(config->state)) {
       return false;
     }
@@ -177,7 +177,7 @@ antlrcpp::BitSet PredictionModeClass::getAlts(const std::vector<antlrcpp::BitSet
 
 antlrcpp::BitSet PredictionModeClass::getAlts(Ref<ATNConfigSet> configs) {
   antlrcpp::BitSet alts;
-  for (auto config : configs->configs) {
+  for (auto &config : configs->configs) {
     alts.set(config->alt);
   }
   return alts;
@@ -185,11 +185,11 @@ antlrcpp::BitSet PredictionModeClass::getAlts(Ref<ATNConfigSet> configs) {
 
 std::vector<antlrcpp::BitSet> PredictionModeClass::getConflictingAltSubsets(Ref<ATNConfigSet> configs) {
   std::unordered_map<Ref<ATNConfig>, antlrcpp::BitSet, AltAndContextConfigHasher, AltAndContextConfigComparer> configToAlts;
-  for (auto config : configs->configs) {
+  for (auto &config : configs->configs) {
     configToAlts[config].set(config->alt);
   }
   std::vector<antlrcpp::BitSet> values;
-  for (auto it : configToAlts) {
+  for (auto &it : configToAlts) {
     values.push_back(it.second);
   }
   return values;
@@ -197,7 +197,7 @@ std::vector<antlrcpp::BitSet> PredictionModeClass::getConflictingAltSubsets(Ref<
 
 std::map<ATNState*, antlrcpp::BitSet> PredictionModeClass::getStateToAltMap(Ref<ATNConfigSet> configs) {
   std::map<ATNState*, antlrcpp::BitSet> m;
-  for (auto c : configs->configs) {
+  for (auto &c : configs->configs) {
     m[c->state].set((size_t)c->alt);
   }
   return m;
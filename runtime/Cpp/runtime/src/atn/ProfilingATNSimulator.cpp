@@ -62,7 +62,16 @@ int ProfilingATNSimulator::adaptivePredict(TokenStream *input, int decision, Ref
   _llStopIndex = -1;
   _currentDecision = decision;
   high_resolution_clock::time_point start = high_resolution_clock::now(); // expensive but useful info
-  int alt = ParserATNSimulator::adaptivePredict(input, decision, outerContext);
+  int alt = getLL1Prediction(input, decision);
+  if (alt != ATN::INVALID_ALT_NUMBER) {
+    high_resolution_clock::time_point stop = high_resolution_clock::now();
+    _decisions[decision].timeInPrediction += duration_cast<nanoseconds>(stop - start).count();
+    _decisions[decision].invocations++;
+    _decisions[decision].LL1_Predictions++;
+    return alt;
+  }
+
+  alt = ParserATNSimulator::adaptivePredict(input, decision, outerContext);
   high_resolution_clock::time_point stop = high_resolution_clock::now();
   _decisions[decision].timeInPrediction += duration_cast<nanoseconds>(stop - start).count();
   _decisions[decision].invocations++;
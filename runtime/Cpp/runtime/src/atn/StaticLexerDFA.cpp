@@ -0,0 +1,291 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atn/ATN.h"
+#include "atn/LexerATNSimulator.h"
+#include "atn/LexerActionExecutor.h"
+#include "atn/LexerIndexedCustomAction.h"
+#include "atn/OrderedATNConfigSet.h"
+#include "atn/PredictionContextCache.h"
+#include "atn/TokensStartState.h"
+#include "dfa/DFA.h"
+#include "dfa/DFAState.h"
+#include "ANTLRInputStream.h"
+#include "Exceptions.h"
+#include "Lexer.h"
+#include "Token.h"
+#include "support/CPPUtils.h"
+
+#include "atn/StaticLexerDFA.h"
+
+using namespace org::antlr::v4::runtime;
+using namespace org::antlr::v4::runtime::atn;
+using namespace antlrcpp;
+
+const int32_t StaticLexerDFA::NO_MATCH;
+const int32_t StaticLexerDFA::FALLBACK;
+
+/// Explores a mode with the regular simulator code (closure and reach computation), without a recognizer, so that
+/// predicates are not evaluated but only recorded in ATNConfigSet::hasSemanticContext.
+class StaticLexerDFA::Builder : public LexerATNSimulator {
+public:
+  Builder(const ATN &atn, std::vector<dfa::DFA> &decisionToDFA)
+    : LexerATNSimulator(atn, decisionToDFA, std::make_shared<PredictionContextCache>()) {
+    _startIndex = 0;
+  }
+
+  bool build(StaticLexerDFA &result, size_t mode, size_t maxStates) {
+    _mode = mode;
+    _maxStates = maxStates;
+    result._charClassStarts = atn.charClassStarts;
+    result._edgeCount = getEdgeCount() + 1;
+
+    Ref<ATNConfigSet> startConfigs = computeStartState(&_input, atn.modeToStartState[mode]);
+    if (startConfigs->hasSemanticContext) {
+      return false;
+    }
+
+    addState(result, addDFAState(startConfigs));
+    _configArena.reset();
+
+    for (size_t i = 0; i < _dfaStates.size(); ++i) {
+      dfa::DFAState *state = _dfaStates[i];
+      if (state->lexerActionExecutor != nullptr) {
+        for (auto &action : state->lexerActionExecutor->getLexerActions()) {
+          if (is<LexerIndexedCustomAction>(action)) {
+            return false; // The offset of the action depends on the input matched so far.
+          }
+        }
+      }
+
+      // Symbols matched by the same transitions lead to the same state, so the (expensive) reach set is computed
+      // only once per group. EOF is handled separately, as it also makes the closure treat EOF as epsilon.
+      std::map<std::vector<size_t>, int32_t> targets;
+      std::vector<size_t> transitions;
+      for (size_t edge = 0; edge < result._edgeCount; ++edge) {
+        ssize_t t = getSymbol(edge);
+        getMatchingTransitions(state, t, transitions);
+
+        int32_t target = StaticLexerDFA::NO_MATCH;
+        if (!transitions.empty()) {
+          auto iterator = targets.find(transitions);
+          if (iterator != targets.end()) {
+            target = iterator->second;
+          } else {
+            target = computeTarget(result, state, t); // Can grow the edge table.
+            if (t != Token::EOF) {
+              targets[transitions] = target;
+            }
+          }
+        }
+        result._edges[i * result._edgeCount + edge] = target;
+      }
+    }
+
+    return true;
+  }
+
+private:
+  ANTLRInputStream _input; // Only asked for its index, which is the token start.
+  size_t _maxStates;
+  std::vector<dfa::DFAState *> _dfaStates; // All states found so far, by state number.
+  std::unordered_map<dfa::DFAState *, int32_t> _stateNumbers;
+
+  /// The inverse of getEdgeIndex(). The last edge stands for EOF.
+  ssize_t getSymbol(size_t edge) const {
+    if (edge == getEdgeCount()) {
+      return Token::EOF;
+    }
+    if (edge <= MAX_DFA_EDGE - MIN_DFA_EDGE) {
+      return (ssize_t)edge + MIN_DFA_EDGE;
+    }
+    return (ssize_t)atn.charClassStarts[edge - (MAX_DFA_EDGE - MIN_DFA_EDGE + 1)];
+  }
+
+  /// Collects the positions (config index, transition index) of all transitions of the state which match {@code t}.
+  void getMatchingTransitions(dfa::DFAState *state, ssize_t t, std::vector<size_t> &transitions) {
+    transitions.clear();
+    for (size_t c = 0; c < state->configs->configs.size(); ++c) {
+      ATNState *configState = state->configs->configs[c]->state;
+      for (size_t i = 0; i < configState->getNumberOfTransitions(); ++i) {
+        if (getReachableTarget(configState->transition(i), t) != nullptr) {
+          transitions.push_back(c);
+          transitions.push_back(i);
+        }
+      }
+    }
+  }
+
+  int32_t computeTarget(StaticLexerDFA &result, dfa::DFAState *state, ssize_t t) {
+    auto onExit = finally([this] {
+      _configArena.reset();
+    });
+
+    Ref<OrderedATNConfigSet> reach = std::make_shared<OrderedATNConfigSet>();
+    getReachableConfigSet(&_input, state->configs, reach, t);
+    if (reach->hasSemanticContext) {
+      return StaticLexerDFA::FALLBACK;
+    }
+    if (reach->isEmpty()) {
+      return StaticLexerDFA::NO_MATCH;
+    }
+    return addState(result, addDFAState(reach));
+  }
+
+  int32_t addState(StaticLexerDFA &result, dfa::DFAState *state) {
+    auto iterator = _stateNumbers.find(state);
+    if (iterator != _stateNumbers.end()) {
+      return iterator->second;
+    }
+
+    // Beyond the size limit the DFA is left incomplete, the simulator matches the tokens which get there.
+    if (!result._states.empty() && result._states.size() >= _maxStates) {
+      return StaticLexerDFA::FALLBACK;
+    }
+
+    int32_t number = (int32_t)result._states.size();
+    _stateNumbers[state] = number;
+    _dfaStates.push_back(state);
+
+    State entry;
+    entry.isAcceptState = state->isAcceptState;
+    entry.prediction = state->prediction;
+    entry.lexerActionExecutor = state->lexerActionExecutor;
+    result._states.push_back(entry);
+    result._edges.resize(result._states.size() * result._edgeCount, StaticLexerDFA::NO_MATCH);
+    return number;
+  }
+};
+
+StaticLexerDFA::StaticLexerDFA() : _edgeCount(0) {
+}
+
+Ref<StaticLexerDFA> StaticLexerDFA::compile(const ATN &atn, size_t mode, size_t maxStates) {
+  if (mode >= atn.modeToStartState.size()) {
+    throw IllegalArgumentException("Invalid lexer mode.");
+  }
+
+  // The builder's DFA only holds the states during the construction, the result keeps just the tables.
+  std::vector<dfa::DFA> decisionToDFA;
+  for (int i = 0; i < atn.getNumberOfDecisions(); ++i) {
+    decisionToDFA.push_back(dfa::DFA(atn.getDecisionState(i), i));
+  }
+
+  Ref<StaticLexerDFA> result(new StaticLexerDFA());
+  Builder builder(atn, decisionToDFA);
+  if (!builder.build(*result, mode, maxStates)) {
+    return nullptr;
+  }
+  return result;
+}
+
+std::vector<Ref<StaticLexerDFA>> StaticLexerDFA::compileAll(const ATN &atn, size_t maxStates) {
+  std::vector<Ref<StaticLexerDFA>> result;
+  for (size_t mode = 0; mode < atn.modeToStartState.size(); ++mode) {
+    result.push_back(compile(atn, mode, maxStates));
+  }
+  return result;
+}
+
+bool StaticLexerDFA::match(CharStream *input, size_t line, int charPos, Match &result) const {
+  result.accepted = false;
+
+  // Same loop as LexerATNSimulator::execATN, including zero length tokens.
+  size_t state = 0;
+  if (_states[0].isAcceptState) {
+    result.accepted = true;
+    result.prediction = _states[0].prediction;
+    result.lexerActionExecutor = _states[0].lexerActionExecutor;
+    result.index = input->index();
+    result.line = line;
+    result.charPos = charPos;
+  }
+
+  while (true) {
+    ssize_t t = input->LA(1);
+    int32_t target = getTarget(state, t);
+    if (target == FALLBACK) {
+      return false;
+    }
+    if (target == NO_MATCH) {
+      break;
+    }
+
+    if (t != Token::EOF) {
+      if (t == '\n') {
+        line++;
+        charPos = 0;
+      } else {
+        charPos++;
+      }
+      input->consume();
+    }
+
+    const State &next = _states[(size_t)target];
+    if (next.isAcceptState) {
+      result.accepted = true;
+      result.prediction = next.prediction;
+      result.lexerActionExecutor = next.lexerActionExecutor;
+      result.index = input->index();
+      result.line = line;
+      result.charPos = charPos;
+      if (t == Token::EOF) {
+        break;
+      }
+    }
+
+    state = (size_t)target;
+  }
+
+  return true;
+}
+
+size_t StaticLexerDFA::getNumberOfStates() const {
+  return _states.size();
+}
+
+int32_t StaticLexerDFA::getTarget(size_t state, ssize_t t) const {
+  // Maps the symbol to an edge like LexerATNSimulator::getEdgeIndex().
+  size_t edge;
+  if (t == Token::EOF) {
+    edge = _edgeCount - 1;
+  } else if (t < LexerATNSimulator::MIN_DFA_EDGE) {
+    return FALLBACK;
+  } else if (t <= LexerATNSimulator::MAX_DFA_EDGE) {
+    edge = (size_t)(t - LexerATNSimulator::MIN_DFA_EDGE);
+  } else {
+    if (_charClassStarts.empty() || t > (ssize_t)Lexer::MAX_CHAR_VALUE) {
+      return FALLBACK;
+    }
+    auto next = std::upper_bound(_charClassStarts.begin(), _charClassStarts.end(), (size_t)t);
+    edge = LexerATNSimulator::MAX_DFA_EDGE - LexerATNSimulator::MIN_DFA_EDGE + (size_t)(next - _charClassStarts.begin());
+  }
+
+  return _edges[state * _edgeCount + edge];
+}
@@ -0,0 +1,118 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "antlr4-common.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+namespace atn {
+
+  /// A precomputed, immutable DFA for one lexer mode, stored as a dense transition table.
+  ///
+  /// The lexer ATN simulator builds its DFA lazily, one edge at a time, and has to go back to the ATN whenever it
+  /// meets an edge it has not computed yet. This class instead computes the states and edges of a mode in one go
+  /// (see compile()) and matches tokens by table lookups only: no ATN simulation, no DFA updates and no atomic
+  /// operations. Hand it to LexerATNSimulator::setStaticDFAs() to use it.
+  ///
+  /// The tables are computed at runtime from the deserialized ATN (generated lexers do it in compileStaticDFA()), they
+  /// are not emitted by the tool. Emitting them as static const arrays would need a lexer DFA construction in the Java
+  /// tool which matches this runtime's simulation exactly, and would add tables of several thousand states to the
+  /// generated sources of realistic lexers. To avoid paying for the construction on every process start, the tables
+  /// can be written once and loaded by later processes (see dfa::DFASnapshot::saveStaticLexerDFAs() and the
+  /// generated compileStaticDFA(fileName)). Loading only reads the tables, no ATN simulation is involved.
+  ///
+  /// Edges whose target depends on a semantic predicate, code points which are not covered by the DFA edge range and
+  /// states beyond the size limit cannot be expressed in the table. The match() call reports these, and the simulator
+  /// then matches the token with the ATN as usual.
+  class ANTLR4CPP_PUBLIC StaticLexerDFA {
+  public:
+    static const size_t DEFAULT_MAX_STATES = 1 << 10;
+
+    /// The result of a successful match() call.
+    struct Match {
+      /// True if a token was recognized. Everything else is only valid if this is set.
+      bool accepted;
+      int prediction;
+      Ref<LexerActionExecutor> lexerActionExecutor;
+
+      /// The input index, line and char position after the last char of the token.
+      size_t index;
+      size_t line;
+      int charPos;
+    };
+
+    /// Computes the DFA of the given mode, breadth first from the start state up to {@code maxStates} states (the
+    /// full DFA of a mode can be very large). Returns null if the mode cannot be compiled: its start state depends
+    /// on a predicate or it runs position dependent actions (custom actions not at the end of a rule).
+    static Ref<StaticLexerDFA> compile(const ATN &atn, size_t mode, size_t maxStates = DEFAULT_MAX_STATES);
+
+    /// Compiles all modes of the lexer ATN. The entries of modes which cannot be compiled are null.
+    static std::vector<Ref<StaticLexerDFA>> compileAll(const ATN &atn, size_t maxStates = DEFAULT_MAX_STATES);
+
+    /// Runs the DFA from the current input position, consuming input up to the longest match. {@code line} and
+    /// {@code charPos} are the position of the first char. Returns false if the DFA cannot decide the token without
+    /// the ATN. The input is then left at some position within the token.
+    bool match(CharStream *input, size_t line, int charPos, Match &result) const;
+
+    size_t getNumberOfStates() const;
+
+  private:
+    friend class dfa::DFASnapshot;
+
+    /// Special transition targets.
+    static const int32_t NO_MATCH = -1; // No token continues with the symbol.
+    static const int32_t FALLBACK = -2; // The target cannot be expressed in the table.
+
+    struct State {
+      bool isAcceptState;
+      int prediction;
+      Ref<LexerActionExecutor> lexerActionExecutor;
+    };
+
+    class Builder;
+
+    std::vector<State> _states; // The start state is the first.
+    std::vector<size_t> _charClassStarts; // Copy of ATN::charClassStarts.
+    size_t _edgeCount;        // One edge per DFA edge index, plus one for EOF at the end.
+    std::vector<int32_t> _edges; // _edgeCount edges per state.
+
+    StaticLexerDFA();
+
+    int32_t getTarget(size_t state, ssize_t t) const;
+  };
+
+} // namespace atn
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
@@ -0,0 +1,162 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Parser.h"
+#include "ParserRuleContext.h"
+#include "atn/ATNConfigSet.h"
+#include "atn/DecisionState.h"
+#include "dfa/DFA.h"
+
+#include "atn/TelemetryATNSimulator.h"
+
+using namespace org::antlr::v4::runtime;
+using namespace org::antlr::v4::runtime::atn;
+
+TelemetryATNSimulator::TelemetryATNSimulator(Parser *parser, size_t sampleInterval)
+  : ParserATNSimulator(parser, parser->getInterpreter<ParserATNSimulator>()->atn,
+                       parser->getInterpreter<ParserATNSimulator>()->decisionToDFA,
+                       parser->getInterpreter<ParserATNSimulator>()->getSharedContextCache()),
+    _telemetry(atn.decisionToState.size(), sampleInterval), _samplePending(sampleInterval), _currentDecision(-1),
+    _sllStopIndex(-1), _llStopIndex(-1), _usedATN(false) {
+  for (size_t i = 0; i < atn.decisionToState.size(); ++i) {
+    _telemetry.decisionRules[i] = (size_t)atn.decisionToState[i]->ruleIndex;
+  }
+}
+
+int TelemetryATNSimulator::adaptivePredict(TokenStream *input, int decision, Ref<ParserRuleContext> outerContext) {
+  DecisionTelemetry &telemetry = _telemetry.decisions[(size_t)decision];
+  ++telemetry.invocations;
+
+  if (_telemetry.sampleInterval > 0 && --_samplePending == 0) {
+    _samplePending = _telemetry.sampleInterval;
+    sampleStack(decision, outerContext);
+  }
+
+  int alt = getLL1Prediction(input, decision);
+  if (alt != ATN::INVALID_ALT_NUMBER) {
+    ++telemetry.ll1Predictions;
+    ++telemetry.sllLookahead[0];
+    return alt;
+  }
+
+  _currentDecision = decision;
+  _sllStopIndex = -1;
+  _llStopIndex = -1;
+  _usedATN = false;
+
+  alt = ParserATNSimulator::adaptivePredict(input, decision, outerContext);
+
+  // _startIndex was set by the base class.
+  size_t sllLookahead = _sllStopIndex >= _startIndex ? (size_t)(_sllStopIndex - _startIndex + 1) : 1;
+  ++telemetry.sllLookahead[DecisionTelemetry::getLookaheadBucket(sllLookahead)];
+  if (_llStopIndex >= _startIndex) {
+    ++telemetry.llLookahead[DecisionTelemetry::getLookaheadBucket((size_t)(_llStopIndex - _startIndex + 1))];
+  }
+  if (!_usedATN) {
+    ++telemetry.dfaPredictions;
+  }
+
+  _currentDecision = -1;
+  return alt;
+}
+
+ParseTelemetry TelemetryATNSimulator::getTelemetry() const {
+  ParseTelemetry result = _telemetry;
+  for (size_t i = 0; i < result.decisions.size() && i < decisionToDFA.size(); ++i) {
+    result.decisions[i].dfaStates = decisionToDFA[i].getStateCount();
+  }
+  return result;
+}
+
+void TelemetryATNSimulator::resetTelemetry() {
+  _telemetry.reset();
+  _samplePending = _telemetry.sampleInterval;
+}
+
+dfa::DFAState* TelemetryATNSimulator::getExistingTargetState(dfa::DFAState *previousD, ssize_t t) {
+  // Called each time the input position advances during SLL prediction.
+  _sllStopIndex = (int)_input->index();
+
+  dfa::DFAState *existingTargetState = ParserATNSimulator::getExistingTargetState(previousD, t);
+  if (existingTargetState != nullptr) {
+    ++_telemetry.decisions[(size_t)_currentDecision].sllDFATransitions;
+  }
+  return existingTargetState;
+}
+
+dfa::DFAState* TelemetryATNSimulator::computeTargetState(dfa::DFA &dfa, dfa::DFAState *previousD, ssize_t t) {
+  _usedATN = true;
+  return ParserATNSimulator::computeTargetState(dfa, previousD, t);
+}
+
+Ref<ATNConfigSet> TelemetryATNSimulator::computeReachSet(Ref<ATNConfigSet> closure, ssize_t t, bool fullCtx) {
+  DecisionTelemetry &telemetry = _telemetry.decisions[(size_t)_currentDecision];
+  if (fullCtx) {
+    // Called each time the input position advances during full context prediction.
+    _llStopIndex = (int)_input->index();
+    ++telemetry.llATNTransitions;
+  } else {
+    ++telemetry.sllATNTransitions;
+  }
+  return ParserATNSimulator::computeReachSet(closure, t, fullCtx);
+}
+
+Ref<ATNConfigSet> TelemetryATNSimulator::computeStartState(ATNState *p, Ref<RuleContext> ctx, bool fullCtx) {
+  _usedATN = true;
+  return ParserATNSimulator::computeStartState(p, ctx, fullCtx);
+}
+
+dfa::DFAState* TelemetryATNSimulator::addDFAState(dfa::DFA &dfa, dfa::DFAState *D) {
+  dfa::DFAState *existing = ParserATNSimulator::addDFAState(dfa, D);
+  if (existing == D && D != ERROR.get()) {
+    ++_telemetry.decisions[(size_t)dfa.decision].dfaStatesAdded;
+  }
+  return existing;
+}
+
+void TelemetryATNSimulator::reportAttemptingFullContext(dfa::DFA &dfa, const antlrcpp::BitSet &conflictingAlts,
+  Ref<ATNConfigSet> configs, size_t startIndex, size_t stopIndex) {
+  ++_telemetry.decisions[(size_t)dfa.decision].llFallbacks;
+  ParserATNSimulator::reportAttemptingFullContext(dfa, conflictingAlts, configs, startIndex, stopIndex);
+}
+
+void TelemetryATNSimulator::sampleStack(int decision, Ref<ParserRuleContext> const& outerContext) {
+  std::vector<size_t> stack;
+  RuleContext *context = outerContext.get();
+  Ref<RuleContext> parent;
+  while (context != nullptr && context->getRuleIndex() >= 0) {
+    stack.push_back((size_t)context->getRuleIndex());
+    parent = context->parent.lock();
+    context = parent.get();
+  }
+  std::reverse(stack.begin(), stack.end());
+  stack.push_back((size_t)decision);
+
+  _telemetry.stackSamples[stack] += _telemetry.sampleInterval;
+}
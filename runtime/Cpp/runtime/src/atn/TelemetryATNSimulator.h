@@ -0,0 +1,78 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "atn/ParserATNSimulator.h"
+#include "atn/ParseTelemetry.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+namespace atn {
+
+  /// A parser simulator which collects ParseTelemetry while predicting. In contrast to ProfilingATNSimulator it does
+  /// not measure time and only increments counters, so it can stay enabled in production. Rule invocation stacks are
+  /// sampled only every sampleInterval predictions. See Parser::setTelemetry().
+  class ANTLR4CPP_PUBLIC TelemetryATNSimulator : public ParserATNSimulator {
+  public:
+    TelemetryATNSimulator(Parser *parser, size_t sampleInterval);
+
+    virtual int adaptivePredict(TokenStream *input, int decision, Ref<ParserRuleContext> outerContext) override;
+
+    /// Returns a copy of the data collected so far, with the current DFA sizes filled in.
+    virtual ParseTelemetry getTelemetry() const;
+    virtual void resetTelemetry();
+
+  protected:
+    ParseTelemetry _telemetry;
+    size_t _samplePending; // Predictions until the next stack sample.
+
+    int _currentDecision;
+    int _sllStopIndex;
+    int _llStopIndex;
+    bool _usedATN;
+
+    virtual dfa::DFAState* getExistingTargetState(dfa::DFAState *previousD, ssize_t t) override;
+    virtual dfa::DFAState* computeTargetState(dfa::DFA &dfa, dfa::DFAState *previousD, ssize_t t) override;
+    virtual Ref<ATNConfigSet> computeReachSet(Ref<ATNConfigSet> closure, ssize_t t, bool fullCtx) override;
+    virtual Ref<ATNConfigSet> computeStartState(ATNState *p, Ref<RuleContext> ctx, bool fullCtx) override;
+    virtual dfa::DFAState *addDFAState(dfa::DFA &dfa, dfa::DFAState *D) override;
+    virtual void reportAttemptingFullContext(dfa::DFA &dfa, const antlrcpp::BitSet &conflictingAlts,
+                                             Ref<ATNConfigSet> configs, size_t startIndex, size_t stopIndex) override;
+
+    void sampleStack(int decision, Ref<ParserRuleContext> const& outerContext);
+  };
+
+} // namespace atn
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
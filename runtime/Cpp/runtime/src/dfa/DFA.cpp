@@ -46,7 +46,7 @@ DFA::DFA(atn::DecisionState *atnStartState) : DFA(atnStartState, 0) {
 }
 
 DFA::DFA(atn::DecisionState *atnStartState, int decision)
-  : atnStartState(atnStartState), s0(nullptr), decision(decision) {
+  : atnStartState(atnStartState), s0(nullptr), decision(decision), internHits(0), internMisses(0) {
 
   _precedenceDfa = false;
   if (is<atn::StarLoopEntryState *>(atnStartState)) {
@@ -62,19 +62,23 @@ DFA::DFA(atn::DecisionState *atnStartState, int decision)
 
 DFA::DFA(DFA &&other) : atnStartState(std::move(other.atnStartState)), decision(std::move(other.decision)) {
   states = std::move(other.states);
-  s0 = std::move(other.s0);
+  s0 = other.s0.load();
+  internHits = other.internHits;
+  internMisses = other.internMisses;
   _precedenceDfa = std::move(other._precedenceDfa);
 }
 
 DFA::DFA(const DFA &other) : atnStartState(other.atnStartState), decision(other.decision) {
   states = other.states;
-  s0 = other.s0;
+  s0 = other.s0.load();
+  internHits = other.internHits;
+  internMisses = other.internMisses;
   _precedenceDfa = other._precedenceDfa;
 }
 
 DFA::~DFA() {
   for (auto state : states) {
-    delete state.second;
+    delete state;
   }
 }
 
@@ -87,12 +91,11 @@ DFAState* DFA::getPrecedenceStartState(int precedence) const {
     throw IllegalStateException("Only precedence DFAs may contain a precedence start state.");
   }
 
-  // s0.edges is never null for a precedence DFA
-  if (precedence < 0 || precedence >= (int)s0->edges.size()) {
+  if (precedence < 0) {
     return nullptr;
   }
 
-  return s0->edges[precedence];
+  return s0.load()->getEdge((size_t)precedence);
 }
 
 void DFA::setPrecedenceStartState(int precedence, DFAState *startState) {
@@ -104,31 +107,48 @@ void DFA::setPrecedenceStartState(int precedence, DFAState *startState) {
     return;
   }
 
-  // synchronization on s0 here is ok. when the DFA is turned into a
-  // precedence DFA, s0 will be initialized once and not updated again
-  std::unique_lock<std::recursive_mutex> lock(_lock);
-  {
-    // s0.edges is never null for a precedence DFA
-    if (precedence >= (int)s0->edges.size()) {
-      s0->edges.resize(precedence + 1);
-    }
+  // No lock needed here. When the DFA is turned into a precedence DFA, s0 will be initialized once
+  // and not updated again and its edges are published atomically.
+  s0.load()->setEdge((size_t)precedence, startState, (size_t)precedence + 1);
+}
+
+DFAState* DFA::addState(DFAState *state) {
+  std::lock_guard<std::mutex> lock(_lock);
 
-    s0->edges[precedence] = startState;
+  auto existing = states.find(state);
+  if (existing != states.end()) {
+    ++internHits;
+    return *existing;
   }
+
+  ++internMisses;
+  if (state->configs != nullptr) {
+    state->configs->promoteConfigs(); // The state lives as long as the DFA, don't let it pin arena memory.
+  }
+  state->stateNumber = (int)states.size();
+  states.insert(state);
+  return state;
 }
 
 std::vector<DFAState *> DFA::getStates() const {
   std::vector<DFAState *> result;
-  for (auto state : states)
-    result.push_back(state.first);
+  {
+    std::lock_guard<std::mutex> lock(_lock);
+    result.assign(states.begin(), states.end());
+  }
 
   std::sort(result.begin(), result.end(), [](DFAState *o1, DFAState *o2) {
-    return o1->stateNumber - o2->stateNumber;
+    return o1->stateNumber < o2->stateNumber;
   });
 
   return result;
 }
 
+size_t DFA::getStateCount() const {
+  std::lock_guard<std::mutex> lock(_lock);
+  return states.size();
+}
+
 std::string DFA::toString(const std::vector<std::string> &tokenNames) {
   if (s0 == nullptr) {
     return "";
@@ -31,7 +31,7 @@
 
 #pragma once
 
-#include "antlr4-common.h"
+#include "dfa/DFAState.h"
 
 namespace org {
 namespace antlr {
@@ -41,15 +41,23 @@ namespace dfa {
 
   class ANTLR4CPP_PUBLIC DFA {
   public:
-    /// A set of all DFA states. Use a map so we can get old state back.
-    /// Set only allows you to see if it's there.
-
     /// From which ATN state did we create this DFA?
     atn::DecisionState *const atnStartState;
-    std::unordered_map<DFAState *, DFAState *> states; // States are owned by this class.
-    DFAState *s0;
+
+    /// A set of all DFA states, keyed by their ATN config sets (not by address), so we can get an
+    /// existing state back for a newly computed, equal one. States are owned by this class.
+    /// Guarded by an internal lock, see addState().
+    std::unordered_set<DFAState *, DFAState::Hasher, DFAState::Comparer> states;
+
+    /// The start state. Atomic so that simulators sharing this DFA can read it without locking.
+    std::atomic<DFAState *> s0;
     const int decision;
 
+    /// Number of state additions which found an equal state already in this DFA (hits) and which
+    /// really added a new state (misses). Once a grammar is warmed up the misses stop growing.
+    size_t internHits;
+    size_t internMisses;
+
     DFA(atn::DecisionState *atnStartState);
     DFA(atn::DecisionState *atnStartState, int decision);
     DFA(const DFA &other);
@@ -92,10 +100,21 @@ namespace dfa {
      * @see #isPrecedenceDfa()
      */
     void setPrecedenceStartState(int precedence, DFAState *startState);
+
+    /// Returns the state in this DFA which has the same ATN config set as the given state, or, if there is none,
+    /// takes over the given state and returns it (after assigning it the next state number and promoting its configs,
+    /// see ATNConfigSet::promoteConfigs()).
+    /// Callers must delete the passed in state if another one is returned.
+    /// This is thread safe, so multiple simulators can share a DFA. The passed in state must be fully set up
+    /// (and its configs made readonly) before calling this, because once added other threads may see it.
+    DFAState* addState(DFAState *state);
     
     /// Return a list of all states in this DFA, ordered by state number.
     virtual std::vector<DFAState *> getStates() const;
 
+    /// The number of states in this DFA. Thread safe, like addState().
+    size_t getStateCount() const;
+
     /**
      * @deprecated Use {@link #toString(Vocabulary)} instead.
      */
@@ -111,7 +130,7 @@ namespace dfa {
      */
     bool _precedenceDfa;
 
-    std::recursive_mutex _lock; // To synchronize access to s0.
+    mutable std::mutex _lock; // To synchronize access to the states set.
   };
 
 } // namespace atn
@@ -53,8 +53,9 @@ std::string DFASerializer::toString() const {
   std::stringstream ss;
   std::vector<DFAState *> states = _dfa->getStates();
   for (auto s : states) {
-    for (size_t i = 0; i < s->edges.size(); i++) {
-      DFAState *t = s->edges[i];
+    size_t count = s->getEdgeCount();
+    for (size_t i = 0; i < count; i++) {
+      DFAState *t = s->getEdge(i);
       if (t != nullptr && t->stateNumber != INT16_MAX) {
         ss << getStateString(s);
         std::string label = getEdgeLabel(i);
@@ -0,0 +1,938 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atn/ATN.h"
+#include "atn/ATNState.h"
+#include "atn/ATNSimulator.h"
+#include "atn/ATNConfigSet.h"
+#include "atn/ATNType.h"
+#include "atn/LexerATNConfig.h"
+#include "atn/LexerATNSimulator.h"
+#include "atn/LexerActionExecutor.h"
+#include "atn/LexerIndexedCustomAction.h"
+#include "atn/EmptyPredictionContext.h"
+#include "atn/ArrayPredictionContext.h"
+#include "atn/SemanticContext.h"
+#include "atn/StaticLexerDFA.h"
+#include "dfa/DFA.h"
+#include "Exceptions.h"
+
+#include "dfa/DFASnapshot.h"
+
+using namespace org::antlr::v4::runtime;
+using namespace org::antlr::v4::runtime::atn;
+using namespace org::antlr::v4::runtime::dfa;
+
+// Layout of a snapshot (all integers little endian):
+//   header:    magic, version, ATN hash
+//   tables:    semantic contexts, prediction contexts, lexer action executors
+//              (entries only refer to entries before them)
+//   per DFA:   decision, precedence flag, states (with their config sets), edges, start state(s)
+// States, table entries etc. are referenced by their index. Edges pointing to ATNSimulator::ERROR use ERROR_INDEX.
+
+namespace {
+
+  const char MAGIC[4] = { 'A', 'D', 'F', 'A' };
+  const char STATIC_LEXER_MAGIC[4] = { 'A', 'S', 'L', 'D' };
+
+  const int32_t NO_INDEX = -1;
+  const int32_t ERROR_INDEX = -2;
+
+  enum SemanticContextKind : uint8_t {
+    SEMANTIC_NONE, SEMANTIC_PREDICATE, SEMANTIC_PRECEDENCE, SEMANTIC_AND, SEMANTIC_OR
+  };
+
+  enum PredictionContextKind : uint8_t {
+    PREDICTION_EMPTY, PREDICTION_SINGLETON, PREDICTION_ARRAY
+  };
+
+  enum ConfigKind : uint8_t {
+    CONFIG_PARSER, CONFIG_LEXER
+  };
+
+  class ByteWriter {
+  public:
+    std::string data;
+
+    void writeByte(uint8_t value) {
+      data.push_back((char)value);
+    }
+
+    void writeUInt32(uint32_t value) {
+      for (size_t i = 0; i < 4; ++i) {
+        writeByte((uint8_t)(value >> (8 * i)));
+      }
+    }
+
+    void writeInt32(int32_t value) {
+      writeUInt32((uint32_t)value);
+    }
+
+    void writeUInt64(uint64_t value) {
+      writeUInt32((uint32_t)value);
+      writeUInt32((uint32_t)(value >> 32));
+    }
+  };
+
+  class ByteReader {
+  public:
+    ByteReader(const std::string &data) : _data(data), _position(0) {
+    }
+
+    uint8_t readByte() {
+      if (_position >= _data.size()) {
+        throw IllegalArgumentException("DFA snapshot is truncated");
+      }
+      return (uint8_t)_data[_position++];
+    }
+
+    bool readBool() {
+      return readByte() != 0;
+    }
+
+    uint32_t readUInt32() {
+      uint32_t result = 0;
+      for (size_t i = 0; i < 4; ++i) {
+        result |= (uint32_t)readByte() << (8 * i);
+      }
+      return result;
+    }
+
+    int32_t readInt32() {
+      return (int32_t)readUInt32();
+    }
+
+    uint64_t readUInt64() {
+      uint64_t low = readUInt32();
+      return low | ((uint64_t)readUInt32() << 32);
+    }
+
+    /// Reads a number of elements which follow. Each element takes at least one byte, which allows to reject bogus
+    /// counts before reserving memory for them.
+    size_t readCount() {
+      size_t count = readUInt32();
+      if (count > _data.size() - _position) {
+        throw IllegalArgumentException("DFA snapshot is damaged");
+      }
+      return count;
+    }
+
+    /// Reads an index into a table with the given size. Returns NO_INDEX if allowed and found.
+    int32_t readIndex(size_t size, bool allowNone = false) {
+      int32_t index = readInt32();
+      if ((index == NO_INDEX && allowNone) || (index >= 0 && (size_t)index < size)) {
+        return index;
+      }
+      throw IllegalArgumentException("DFA snapshot is damaged");
+    }
+
+    bool atEnd() const {
+      return _position == _data.size();
+    }
+
+  private:
+    const std::string &_data;
+    size_t _position;
+  };
+
+  void check(bool condition) {
+    if (!condition) {
+      throw IllegalArgumentException("DFA snapshot is damaged");
+    }
+  }
+
+  class SnapshotWriter {
+  public:
+    SnapshotWriter(const ATN &atn) : _atn(atn) {
+      for (size_t i = 0; i < atn.lexerActions.size(); ++i) {
+        _lexerActionIndices[atn.lexerActions[i].get()] = (int32_t)i;
+      }
+    }
+
+    void writeDFA(const DFA &dfa) {
+      std::vector<DFAState *> states = dfa.getStates();
+      std::unordered_map<const DFAState *, int32_t> stateIndices;
+      for (size_t i = 0; i < states.size(); ++i) {
+        stateIndices[states[i]] = (int32_t)i;
+      }
+
+      _body.writeInt32(dfa.decision);
+      _body.writeByte(dfa.isPrecedenceDfa() ? 1 : 0);
+      _body.writeUInt32((uint32_t)states.size());
+      for (auto state : states) {
+        writeState(state);
+      }
+      for (auto state : states) {
+        writeEdges(state, stateIndices);
+      }
+
+      DFAState *s0 = dfa.s0.load();
+      if (dfa.isPrecedenceDfa()) {
+        writeEdges(s0, stateIndices);
+      } else {
+        auto iterator = stateIndices.find(s0);
+        _body.writeInt32(iterator == stateIndices.end() ? NO_INDEX : iterator->second);
+      }
+    }
+
+    void finish(std::ostream &output, uint64_t atnHash, size_t dfaCount) {
+      ByteWriter header;
+      header.data.append(MAGIC, sizeof(MAGIC));
+      header.writeUInt32(DFASnapshot::VERSION);
+      header.writeUInt64(atnHash);
+      header.writeUInt32(_semanticContextCount);
+      header.data += _semanticContexts.data;
+      header.writeUInt32(_predictionContextCount);
+      header.data += _predictionContexts.data;
+      header.writeUInt32(_executorCount);
+      header.data += _executors.data;
+      header.writeUInt32((uint32_t)dfaCount);
+
+      output.write(header.data.data(), (std::streamsize)header.data.size());
+      output.write(_body.data.data(), (std::streamsize)_body.data.size());
+    }
+
+  private:
+    const ATN &_atn;
+    std::unordered_map<const LexerAction *, int32_t> _lexerActionIndices;
+
+    ByteWriter _body;
+    ByteWriter _semanticContexts;
+    ByteWriter _predictionContexts;
+    ByteWriter _executors;
+    uint32_t _semanticContextCount = 0;
+    uint32_t _predictionContextCount = 0;
+    uint32_t _executorCount = 0;
+    std::unordered_map<const SemanticContext *, int32_t> _semanticContextIndices;
+    std::unordered_map<const PredictionContext *, int32_t> _predictionContextIndices;
+    std::unordered_map<const LexerActionExecutor *, int32_t> _executorIndices;
+
+    void writeState(DFAState *state) {
+      _body.writeByte(state->isAcceptState ? 1 : 0);
+      _body.writeInt32(state->prediction);
+      _body.writeByte(state->requiresFullContext ? 1 : 0);
+      _body.writeInt32(addExecutor(state->lexerActionExecutor));
+
+      _body.writeUInt32((uint32_t)state->predicates.size());
+      for (auto predicate : state->predicates) {
+        _body.writeInt32(addSemanticContext(predicate->pred));
+        _body.writeInt32(predicate->alt);
+      }
+
+      Ref<ATNConfigSet> configs = state->configs;
+      _body.writeByte(configs->fullCtx ? 1 : 0);
+      _body.writeInt32(configs->uniqueAlt);
+      _body.writeByte(configs->hasSemanticContext ? 1 : 0);
+      _body.writeByte(configs->dipsIntoOuterContext ? 1 : 0);
+      _body.writeUInt32((uint32_t)configs->conflictingAlts.count());
+      for (size_t i = 0; i < configs->conflictingAlts.size(); ++i) {
+        if (configs->conflictingAlts.test(i)) {
+          _body.writeUInt32((uint32_t)i);
+        }
+      }
+
+      _body.writeUInt32((uint32_t)configs->configs.size());
+      for (auto &config : configs->configs) {
+        LexerATNConfig *lexerConfig = dynamic_cast<LexerATNConfig *>(config.get());
+        _body.writeByte(lexerConfig != nullptr ? CONFIG_LEXER : CONFIG_PARSER);
+        _body.writeInt32(config->state->stateNumber);
+        _body.writeInt32(config->alt);
+        _body.writeInt32(addPredictionContext(config->context));
+        _body.writeInt32(config->reachesIntoOuterContext);
+        _body.writeInt32(addSemanticContext(config->semanticContext));
+        if (lexerConfig != nullptr) {
+          _body.writeInt32(addExecutor(lexerConfig->getLexerActionExecutor()));
+          _body.writeByte(lexerConfig->hasPassedThroughNonGreedyDecision() ? 1 : 0);
+        }
+      }
+    }
+
+    void writeEdges(DFAState *state, const std::unordered_map<const DFAState *, int32_t> &stateIndices) {
+      std::vector<std::pair<uint32_t, int32_t>> edges;
+      size_t count = state->getEdgeCount();
+      for (size_t i = 0; i < count; ++i) {
+        DFAState *target = state->getEdge(i);
+        if (target == nullptr) {
+          continue;
+        }
+
+        if (target == ATNSimulator::ERROR.get()) {
+          edges.push_back({ (uint32_t)i, ERROR_INDEX });
+        } else {
+          // Targets which were added after we took the state list are left out.
+          auto iterator = stateIndices.find(target);
+          if (iterator != stateIndices.end()) {
+            edges.push_back({ (uint32_t)i, iterator->second });
+          }
+        }
+      }
+
+      _body.writeUInt32((uint32_t)count);
+      _body.writeUInt32((uint32_t)edges.size());
+      for (auto &edge : edges) {
+        _body.writeUInt32(edge.first);
+        _body.writeInt32(edge.second);
+      }
+    }
+
+    int32_t addSemanticContext(const Ref<SemanticContext> &context) {
+      if (context == nullptr) {
+        return NO_INDEX;
+      }
+
+      auto iterator = _semanticContextIndices.find(context.get());
+      if (iterator != _semanticContextIndices.end()) {
+        return iterator->second;
+      }
+
+      ByteWriter entry;
+      if (context.get() == SemanticContext::NONE.get()) {
+        entry.writeByte(SEMANTIC_NONE);
+      } else if (auto predicate = dynamic_cast<SemanticContext::Predicate *>(context.get())) {
+        entry.writeByte(SEMANTIC_PREDICATE);
+        entry.writeInt32(predicate->ruleIndex);
+        entry.writeInt32(predicate->predIndex);
+        entry.writeByte(predicate->isCtxDependent ? 1 : 0);
+      } else if (auto precedence = dynamic_cast<SemanticContext::PrecedencePredicate *>(context.get())) {
+        entry.writeByte(SEMANTIC_PRECEDENCE);
+        entry.writeInt32(precedence->precedence);
+      } else if (auto op = dynamic_cast<SemanticContext::Operator *>(context.get())) {
+        // Operands first, so they get lower indices.
+        std::vector<Ref<SemanticContext>> operands = op->getOperands();
+        std::vector<int32_t> operandIndices;
+        for (auto &operand : operands) {
+          operandIndices.push_back(addSemanticContext(operand));
+        }
+
+        entry.writeByte(dynamic_cast<SemanticContext::AND *>(op) != nullptr ? SEMANTIC_AND : SEMANTIC_OR);
+        entry.writeUInt32((uint32_t)operandIndices.size());
+        for (int32_t index : operandIndices) {
+          entry.writeInt32(index);
+        }
+      } else {
+        throw IllegalStateException("Unsupported semantic context in DFA: " + context->toString());
+      }
+
+      _semanticContexts.data += entry.data;
+      int32_t index = (int32_t)_semanticContextCount++;
+      _semanticContextIndices[context.get()] = index;
+      return index;
+    }
+
+    int32_t addPredictionContext(const Ref<PredictionContext> &context) {
+      if (context == nullptr) {
+        return NO_INDEX;
+      }
+
+      // Iterative post order walk over the graph, parents are written before their children.
+      std::vector<std::pair<PredictionContext *, bool>> stack;
+      stack.push_back({ context.get(), false });
+      while (!stack.empty()) {
+        PredictionContext *current = stack.back().first;
+        if (_predictionContextIndices.count(current) > 0) {
+          stack.pop_back();
+          continue;
+        }
+
+        std::vector<PredictionContext *> parents;
+        if (dynamic_cast<EmptyPredictionContext *>(current) == nullptr) {
+          if (auto singleton = dynamic_cast<SingletonPredictionContext *>(current)) {
+            parents.push_back(singleton->parent.get());
+          } else {
+            for (auto &parent : static_cast<ArrayPredictionContext *>(current)->parents) {
+              parents.push_back(parent.get());
+            }
+          }
+        }
+
+        if (!stack.back().second) {
+          stack.back().second = true;
+          for (auto parent : parents) {
+            if (parent != nullptr && _predictionContextIndices.count(parent) == 0) {
+              stack.push_back({ parent, false });
+            }
+          }
+          continue;
+        }
+        stack.pop_back();
+
+        auto parentIndex = [this](PredictionContext *parent) {
+          return parent == nullptr ? NO_INDEX : _predictionContextIndices[parent];
+        };
+
+        if (dynamic_cast<EmptyPredictionContext *>(current) != nullptr) {
+          _predictionContexts.writeByte(PREDICTION_EMPTY);
+        } else if (auto singleton = dynamic_cast<SingletonPredictionContext *>(current)) {
+          _predictionContexts.writeByte(PREDICTION_SINGLETON);
+          _predictionContexts.writeInt32(parentIndex(parents[0]));
+          _predictionContexts.writeInt32(singleton->returnState);
+        } else {
+          ArrayPredictionContext *array = static_cast<ArrayPredictionContext *>(current);
+          _predictionContexts.writeByte(PREDICTION_ARRAY);
+          _predictionContexts.writeUInt32((uint32_t)parents.size());
+          for (size_t i = 0; i < parents.size(); ++i) {
+            _predictionContexts.writeInt32(parentIndex(parents[i]));
+            _predictionContexts.writeInt32(array->returnStates[i]);
+          }
+        }
+        _predictionContextIndices[current] = (int32_t)_predictionContextCount++;
+      }
+
+      return _predictionContextIndices[context.get()];
+    }
+
+    int32_t addExecutor(const Ref<LexerActionExecutor> &executor) {
+      if (executor == nullptr) {
+        return NO_INDEX;
+      }
+
+      auto iterator = _executorIndices.find(executor.get());
+      if (iterator != _executorIndices.end()) {
+        return iterator->second;
+      }
+
+      std::vector<Ref<LexerAction>> actions = executor->getLexerActions();
+      _executors.writeUInt32((uint32_t)actions.size());
+      for (auto &action : actions) {
+        // Executors only hold actions from the ATN, possibly wrapped to record a position.
+        auto indexed = std::dynamic_pointer_cast<LexerIndexedCustomAction>(action);
+        _executors.writeByte(indexed != nullptr ? 1 : 0);
+        if (indexed != nullptr) {
+          _executors.writeInt32(indexed->getOffset());
+          _executors.writeInt32(getLexerActionIndex(indexed->getAction()));
+        } else {
+          _executors.writeInt32(getLexerActionIndex(action));
+        }
+      }
+
+      int32_t index = (int32_t)_executorCount++;
+      _executorIndices[executor.get()] = index;
+      return index;
+    }
+
+    int32_t getLexerActionIndex(const Ref<LexerAction> &action) {
+      auto iterator = _lexerActionIndices.find(action.get());
+      if (iterator != _lexerActionIndices.end()) {
+        return iterator->second;
+      }
+
+      for (size_t i = 0; i < _atn.lexerActions.size(); ++i) {
+        if (*_atn.lexerActions[i] == *action) {
+          return (int32_t)i;
+        }
+      }
+      throw IllegalStateException("Lexer action " + action->toString() + " is not part of the ATN");
+    }
+  };
+
+  /// Everything read for a single DFA, kept aside until the whole snapshot has been read successfully.
+  struct LoadedDFA {
+    std::vector<std::unique_ptr<DFAState>> states;
+    int32_t startState = NO_INDEX;
+    std::vector<std::pair<uint32_t, int32_t>> precedenceStartStates;
+    size_t precedenceEdgeCount = 0;
+  };
+
+  class SnapshotReader {
+  public:
+    SnapshotReader(ByteReader &input, const ATN &atn) : _input(input), _atn(atn) {
+    }
+
+    void readTables() {
+      size_t count = _input.readCount();
+      for (size_t i = 0; i < count; ++i) {
+        _semanticContexts.push_back(readSemanticContext());
+      }
+
+      count = _input.readCount();
+      for (size_t i = 0; i < count; ++i) {
+        _predictionContexts.push_back(readPredictionContext());
+      }
+
+      count = _input.readCount();
+      for (size_t i = 0; i < count; ++i) {
+        size_t actionCount = _input.readCount();
+        std::vector<Ref<LexerAction>> actions;
+        for (size_t j = 0; j < actionCount; ++j) {
+          bool indexed = _input.readBool();
+          int offset = indexed ? _input.readInt32() : 0;
+          Ref<LexerAction> action = _atn.lexerActions[(size_t)_input.readIndex(_atn.lexerActions.size())];
+          if (indexed) {
+            action = std::make_shared<LexerIndexedCustomAction>(offset, action);
+          }
+          actions.push_back(action);
+        }
+        _executors.push_back(std::make_shared<LexerActionExecutor>(actions));
+      }
+    }
+
+    void readDFA(const DFA &dfa, LoadedDFA &result) {
+      check(_input.readInt32() == dfa.decision);
+      check(_input.readBool() == dfa.isPrecedenceDfa());
+
+      // Equal states would have been merged in the saved DFA. Rejecting them here guarantees that DFA::addState()
+      // takes over all loaded states later.
+      std::unordered_set<DFAState *, DFAState::Hasher, DFAState::Comparer> distinct;
+
+      size_t count = _input.readCount();
+      for (size_t i = 0; i < count; ++i) {
+        result.states.emplace_back(readState());
+        check(distinct.insert(result.states.back().get()).second);
+      }
+
+      // Edge tables are sized by the simulators, so damaged data is detected before allocating. The lexer has an edge
+      // per ASCII char and character class, the parser one per token type (plus EOF).
+      size_t maxEdgeCount;
+      if (_atn.grammarType == ATNType::LEXER) {
+        maxEdgeCount = LexerATNSimulator::MAX_DFA_EDGE - LexerATNSimulator::MIN_DFA_EDGE + 1 + _atn.charClassStarts.size();
+      } else {
+        maxEdgeCount = _atn.maxTokenType + 2;
+      }
+
+      for (auto &state : result.states) {
+        size_t edgeCount;
+        for (auto &edge : readEdges(result.states.size(), maxEdgeCount, edgeCount)) {
+          state->setEdge(edge.first, target(result.states, edge.second), edgeCount);
+        }
+      }
+
+      if (dfa.isPrecedenceDfa()) {
+        // Indexed by precedence, which is below the number of ATN states. The table at most doubles its size on growth.
+        result.precedenceStartStates = readEdges(result.states.size(), 2 * (_atn.states.size() + 1),
+                                                 result.precedenceEdgeCount);
+      } else {
+        result.startState = _input.readIndex(result.states.size(), true);
+      }
+    }
+
+    static DFAState* target(const std::vector<std::unique_ptr<DFAState>> &states, int32_t index) {
+      return index == ERROR_INDEX ? ATNSimulator::ERROR.get() : states[(size_t)index].get();
+    }
+
+  private:
+    ByteReader &_input;
+    const ATN &_atn;
+
+    std::vector<Ref<SemanticContext>> _semanticContexts;
+    std::vector<Ref<PredictionContext>> _predictionContexts;
+    std::vector<Ref<LexerActionExecutor>> _executors;
+
+    Ref<SemanticContext> readSemanticContext() {
+      uint8_t kind = _input.readByte();
+      switch (kind) {
+        case SEMANTIC_NONE:
+          return SemanticContext::NONE;
+
+        case SEMANTIC_PREDICATE: {
+          int ruleIndex = _input.readInt32();
+          int predIndex = _input.readInt32();
+          return std::make_shared<SemanticContext::Predicate>(ruleIndex, predIndex, _input.readBool());
+        }
+
+        case SEMANTIC_PRECEDENCE:
+          return std::make_shared<SemanticContext::PrecedencePredicate>(_input.readInt32());
+
+        case SEMANTIC_AND:
+        case SEMANTIC_OR: {
+          size_t count = _input.readCount();
+          check(count >= 2);
+          std::vector<Ref<SemanticContext>> operands;
+          for (size_t i = 0; i < count; ++i) {
+            operands.push_back(readSemanticContextReference());
+          }
+
+          // The constructors combine two operands, the complete (already flattened) operand list is set afterwards.
+          if (kind == SEMANTIC_AND) {
+            auto result = std::make_shared<SemanticContext::AND>(operands[0], operands[1]);
+            result->opnds = operands;
+            return result;
+          }
+          auto result = std::make_shared<SemanticContext::OR>(operands[0], operands[1]);
+          result->opnds = operands;
+          return result;
+        }
+
+        default:
+          check(false);
+          return nullptr;
+      }
+    }
+
+    Ref<PredictionContext> readPredictionContext() {
+      switch (_input.readByte()) {
+        case PREDICTION_EMPTY:
+          return PredictionContext::EMPTY;
+
+        case PREDICTION_SINGLETON: {
+          Ref<PredictionContext> parent = readPredictionContextReference();
+          int returnState = _input.readInt32();
+          check(parent != nullptr || returnState == PredictionContext::EMPTY_RETURN_STATE);
+          return std::make_shared<SingletonPredictionContext>(parent, returnState);
+        }
+
+        case PREDICTION_ARRAY: {
+          size_t count = _input.readCount();
+          check(count > 0);
+          std::vector<std::weak_ptr<PredictionContext>> parents;
+          std::vector<int> returnStates;
+          for (size_t i = 0; i < count; ++i) {
+            parents.push_back(readPredictionContextReference());
+            returnStates.push_back(_input.readInt32());
+          }
+          return std::make_shared<ArrayPredictionContext>(parents, returnStates);
+        }
+
+        default:
+          check(false);
+          return nullptr;
+      }
+    }
+
+    Ref<PredictionContext> readPredictionContextReference() {
+      int32_t index = _input.readIndex(_predictionContexts.size(), true);
+      return index == NO_INDEX ? nullptr : _predictionContexts[(size_t)index];
+    }
+
+    Ref<SemanticContext> readSemanticContextReference() {
+      return _semanticContexts[(size_t)_input.readIndex(_semanticContexts.size())];
+    }
+
+    Ref<LexerActionExecutor> readExecutorReference() {
+      int32_t index = _input.readIndex(_executors.size(), true);
+      return index == NO_INDEX ? nullptr : _executors[(size_t)index];
+    }
+
+    DFAState* readState() {
+      std::unique_ptr<DFAState> state(new DFAState()); /* mem-check: returned to caller */
+      state->isAcceptState = _input.readBool();
+      state->prediction = _input.readInt32();
+      state->requiresFullContext = _input.readBool();
+      state->lexerActionExecutor = readExecutorReference();
+
+      size_t count = _input.readCount();
+      for (size_t i = 0; i < count; ++i) {
+        Ref<SemanticContext> pred = readSemanticContextReference();
+        state->predicates.push_back(new DFAState::PredPrediction(pred, _input.readInt32())); /* mem-check: deleted in DFAState d-tor */
+      }
+
+      Ref<ATNConfigSet> configs = std::make_shared<ATNConfigSet>(_input.readBool());
+      configs->uniqueAlt = _input.readInt32();
+      configs->hasSemanticContext = _input.readBool();
+      configs->dipsIntoOuterContext = _input.readBool();
+      count = _input.readCount();
+      for (size_t i = 0; i < count; ++i) {
+        uint32_t alt = _input.readUInt32();
+        check(alt < configs->conflictingAlts.size());
+        configs->conflictingAlts.set(alt);
+      }
+
+      // The configs are added directly, without merging. They were merged already (or intentionally not, as in the
+      // ordered sets of the lexer) when the DFA state was computed.
+      count = _input.readCount();
+      for (size_t i = 0; i < count; ++i) {
+        configs->configs.push_back(readConfig());
+      }
+      configs->setReadonly(true);
+      state->configs = configs;
+
+      return state.release();
+    }
+
+    Ref<ATNConfig> readConfig() {
+      uint8_t kind = _input.readByte();
+      check(kind == CONFIG_PARSER || kind == CONFIG_LEXER);
+
+      ATNState *atnState = _atn.states[(size_t)_input.readIndex(_atn.states.size())];
+      check(atnState != nullptr);
+      int alt = _input.readInt32();
+      Ref<PredictionContext> context = readPredictionContextReference();
+      int reachesIntoOuterContext = _input.readInt32();
+      Ref<SemanticContext> semanticContext = readSemanticContextReference();
+
+      Ref<ATNConfig> config;
+      if (kind == CONFIG_LEXER) {
+        Ref<LexerActionExecutor> executor = readExecutorReference();
+        config = std::make_shared<LexerATNConfig>(atnState, alt, context, executor, _input.readBool());
+        config->semanticContext = semanticContext;
+      } else {
+        config = std::make_shared<ATNConfig>(atnState, alt, context, semanticContext);
+      }
+      config->reachesIntoOuterContext = reachesIntoOuterContext;
+      return config;
+    }
+
+    std::vector<std::pair<uint32_t, int32_t>> readEdges(size_t stateCount, size_t maxEdgeCount, size_t &edgeCount) {
+      edgeCount = _input.readUInt32();
+      check(edgeCount <= maxEdgeCount);
+
+      std::vector<std::pair<uint32_t, int32_t>> edges;
+      size_t count = _input.readCount();
+      for (size_t i = 0; i < count; ++i) {
+        uint32_t index = _input.readUInt32();
+        check(index < edgeCount);
+        int32_t target = _input.readInt32();
+        check(target == ERROR_INDEX || (target >= 0 && (size_t)target < stateCount));
+        edges.push_back({ index, target });
+      }
+      return edges;
+    }
+  };
+
+} // namespace
+
+uint64_t DFASnapshot::getATNHash(const std::vector<uint16_t> &serializedATN) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (uint16_t value : serializedATN) {
+    hash = (hash ^ (value & 0xFF)) * 1099511628211ULL;
+    hash = (hash ^ (value >> 8)) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+void DFASnapshot::save(std::ostream &output, const std::vector<uint16_t> &serializedATN, const atn::ATN &atn,
+                       const std::vector<DFA> &decisionToDFA) {
+  SnapshotWriter writer(atn);
+  for (auto &dfa : decisionToDFA) {
+    writer.writeDFA(dfa);
+  }
+  writer.finish(output, getATNHash(serializedATN), decisionToDFA.size());
+}
+
+bool DFASnapshot::load(std::istream &input, const std::vector<uint16_t> &serializedATN, const atn::ATN &atn,
+                       std::vector<DFA> &decisionToDFA) {
+  for (auto &dfa : decisionToDFA) {
+    DFAState *s0 = dfa.s0.load();
+    if (!dfa.states.empty() || (s0 != nullptr && (!dfa.isPrecedenceDfa() || s0->getEdgeCount() > 0))) {
+      throw IllegalStateException("DFA snapshots can only be loaded into empty DFAs.");
+    }
+  }
+
+  std::string data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+  ByteReader reader(data);
+
+  std::vector<LoadedDFA> loaded(decisionToDFA.size());
+  try {
+    for (char c : MAGIC) {
+      if (reader.readByte() != (uint8_t)c) {
+        return false;
+      }
+    }
+    if (reader.readUInt32() != VERSION || reader.readUInt64() != getATNHash(serializedATN)) {
+      return false;
+    }
+
+    SnapshotReader snapshotReader(reader, atn);
+    snapshotReader.readTables();
+    check(reader.readUInt32() == decisionToDFA.size());
+    for (size_t i = 0; i < decisionToDFA.size(); ++i) {
+      snapshotReader.readDFA(decisionToDFA[i], loaded[i]);
+    }
+    check(reader.atEnd());
+  } catch (IllegalArgumentException &) {
+    return false;
+  }
+
+  // Everything is read and consistent, now hand the states over.
+  for (size_t i = 0; i < decisionToDFA.size(); ++i) {
+    DFA &dfa = decisionToDFA[i];
+    LoadedDFA &entry = loaded[i];
+    for (auto &state : entry.states) {
+      dfa.addState(state.get());
+    }
+
+    if (dfa.isPrecedenceDfa()) {
+      for (auto &edge : entry.precedenceStartStates) {
+        dfa.s0.load()->setEdge(edge.first, SnapshotReader::target(entry.states, edge.second), entry.precedenceEdgeCount);
+      }
+    } else if (entry.startState != NO_INDEX) {
+      dfa.s0 = entry.states[(size_t)entry.startState].get();
+    }
+
+    for (auto &state : entry.states) {
+      state.release();
+    }
+  }
+
+  return true;
+}
+
+bool DFASnapshot::saveToFile(const std::string &fileName, const std::vector<uint16_t> &serializedATN,
+                             const atn::ATN &atn, const std::vector<DFA> &decisionToDFA) {
+  std::ofstream stream(fileName, std::ios::binary);
+  if (!stream) {
+    return false;
+  }
+  save(stream, serializedATN, atn, decisionToDFA);
+  stream.close();
+  return !stream.fail();
+}
+
+bool DFASnapshot::loadFromFile(const std::string &fileName, const std::vector<uint16_t> &serializedATN,
+                               const atn::ATN &atn, std::vector<DFA> &decisionToDFA) {
+  std::ifstream stream(fileName, std::ios::binary);
+  if (!stream) {
+    return false;
+  }
+  return load(stream, serializedATN, atn, decisionToDFA);
+}
+
+void DFASnapshot::saveStaticLexerDFAs(std::ostream &output, const std::vector<uint16_t> &serializedATN,
+                                      const atn::ATN &atn, const std::vector<Ref<StaticLexerDFA>> &staticDFAs) {
+  std::unordered_map<const LexerAction *, int32_t> lexerActionIndices;
+  for (size_t i = 0; i < atn.lexerActions.size(); ++i) {
+    lexerActionIndices[atn.lexerActions[i].get()] = (int32_t)i;
+  }
+
+  ByteWriter writer;
+  writer.data.append(STATIC_LEXER_MAGIC, sizeof(STATIC_LEXER_MAGIC));
+  writer.writeUInt32(VERSION);
+  writer.writeUInt64(getATNHash(serializedATN));
+  writer.writeUInt32((uint32_t)staticDFAs.size());
+  for (auto &staticDFA : staticDFAs) {
+    writer.writeByte(staticDFA != nullptr);
+    if (staticDFA == nullptr) {
+      continue;
+    }
+
+    writer.writeUInt32((uint32_t)staticDFA->_edgeCount);
+    writer.writeUInt32((uint32_t)staticDFA->_states.size());
+    for (auto &state : staticDFA->_states) {
+      writer.writeByte(state.isAcceptState);
+      writer.writeInt32(state.prediction);
+
+      // StaticLexerDFA::compile() rejects indexed custom actions, so all actions are part of the ATN.
+      writer.writeByte(state.lexerActionExecutor != nullptr);
+      if (state.lexerActionExecutor != nullptr) {
+        std::vector<Ref<LexerAction>> actions = state.lexerActionExecutor->getLexerActions();
+        writer.writeUInt32((uint32_t)actions.size());
+        for (auto &action : actions) {
+          auto iterator = lexerActionIndices.find(action.get());
+          if (iterator == lexerActionIndices.end()) {
+            throw IllegalStateException("Lexer action " + action->toString() + " is not part of the ATN");
+          }
+          writer.writeInt32(iterator->second);
+        }
+      }
+    }
+
+    for (int32_t target : staticDFA->_edges) {
+      writer.writeInt32(target);
+    }
+  }
+
+  output.write(writer.data.data(), (std::streamsize)writer.data.size());
+}
+
+bool DFASnapshot::loadStaticLexerDFAs(std::istream &input, const std::vector<uint16_t> &serializedATN,
+                                      const atn::ATN &atn, std::vector<Ref<StaticLexerDFA>> &staticDFAs) {
+  std::string data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+  ByteReader reader(data);
+
+  std::vector<Ref<StaticLexerDFA>> loaded;
+  try {
+    for (char c : STATIC_LEXER_MAGIC) {
+      if (reader.readByte() != (uint8_t)c) {
+        return false;
+      }
+    }
+    if (reader.readUInt32() != VERSION || reader.readUInt64() != getATNHash(serializedATN)) {
+      return false;
+    }
+
+    // The tables must have the layout StaticLexerDFA::compile() creates for this ATN: one edge per DFA edge index of
+    // the simulator, plus one for EOF.
+    size_t edgeCount = LexerATNSimulator::MAX_DFA_EDGE - LexerATNSimulator::MIN_DFA_EDGE + 1 +
+      atn.charClassStarts.size() + 1;
+
+    check(reader.readUInt32() == atn.modeToStartState.size());
+    for (size_t mode = 0; mode < atn.modeToStartState.size(); ++mode) {
+      if (!reader.readBool()) {
+        loaded.push_back(nullptr);
+        continue;
+      }
+
+      Ref<StaticLexerDFA> staticDFA(new StaticLexerDFA());
+      staticDFA->_charClassStarts = atn.charClassStarts;
+      staticDFA->_edgeCount = edgeCount;
+      check(reader.readUInt32() == edgeCount);
+
+      size_t stateCount = reader.readCount();
+      check(stateCount > 0);
+      for (size_t i = 0; i < stateCount; ++i) {
+        StaticLexerDFA::State state;
+        state.isAcceptState = reader.readBool();
+        state.prediction = reader.readInt32();
+        if (reader.readBool()) {
+          size_t actionCount = reader.readCount();
+          std::vector<Ref<LexerAction>> actions;
+          for (size_t j = 0; j < actionCount; ++j) {
+            actions.push_back(atn.lexerActions[(size_t)reader.readIndex(atn.lexerActions.size())]);
+          }
+          state.lexerActionExecutor = std::make_shared<LexerActionExecutor>(actions);
+        }
+        staticDFA->_states.push_back(state);
+      }
+
+      // Not reserved up front, so that a damaged state count fails on the missing data instead of allocating.
+      for (size_t i = 0; i < stateCount * edgeCount; ++i) {
+        int32_t target = reader.readInt32();
+        check(target == StaticLexerDFA::NO_MATCH || target == StaticLexerDFA::FALLBACK ||
+              (target >= 0 && (size_t)target < stateCount));
+        staticDFA->_edges.push_back(target);
+      }
+      loaded.push_back(staticDFA);
+    }
+    check(reader.atEnd());
+  } catch (IllegalArgumentException &) {
+    return false;
+  }
+
+  staticDFAs = std::move(loaded);
+  return true;
+}
+
+bool DFASnapshot::saveStaticLexerDFAsToFile(const std::string &fileName, const std::vector<uint16_t> &serializedATN,
+                                            const atn::ATN &atn, const std::vector<Ref<StaticLexerDFA>> &staticDFAs) {
+  std::ofstream stream(fileName, std::ios::binary);
+  if (!stream) {
+    return false;
+  }
+  saveStaticLexerDFAs(stream, serializedATN, atn, staticDFAs);
+  stream.close();
+  return !stream.fail();
+}
+
+bool DFASnapshot::loadStaticLexerDFAsFromFile(const std::string &fileName, const std::vector<uint16_t> &serializedATN,
+                                              const atn::ATN &atn, std::vector<Ref<StaticLexerDFA>> &staticDFAs) {
+  std::ifstream stream(fileName, std::ios::binary);
+  if (!stream) {
+    return false;
+  }
+  return loadStaticLexerDFAs(stream, serializedATN, atn, staticDFAs);
+}
@@ -0,0 +1,98 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "antlr4-common.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+namespace dfa {
+
+  /// Binary snapshots of the DFAs a recognizer has built so far (the static _decisionToDFA of generated lexers and
+  /// parsers). A process which loads a snapshot taken from a warmed-up process starts with all its DFA states, edges
+  /// and accept predictions (including lexer action executors and predicate lists) in place, instead of having to
+  /// compute them again via ATN simulation while parsing its first inputs.
+  ///
+  /// The configuration sets of the states are part of the snapshot too, so the simulators can still extend the
+  /// loaded DFAs for input which the warm-up didn't cover.
+  ///
+  /// A snapshot is keyed by a hash of the serialized ATN it was taken for. Loading it for another (e.g. changed)
+  /// grammar is rejected.
+  class ANTLR4CPP_PUBLIC DFASnapshot {
+  public:
+    /// Format version, stored in each snapshot. Snapshots with another version are rejected by load().
+    static const uint32_t VERSION = 1;
+
+    /// Returns the key of snapshots taken for the given serialized ATN (a 64 bit FNV-1a hash).
+    static uint64_t getATNHash(const std::vector<uint16_t> &serializedATN);
+
+    /// Writes all states currently in the given DFAs (which belong to the given ATN) to the output stream.
+    /// The DFAs can still be in use by other threads. States added while saving might be missing in the snapshot,
+    /// which only means they will be computed again after loading.
+    static void save(std::ostream &output, const std::vector<uint16_t> &serializedATN, const atn::ATN &atn,
+                     const std::vector<DFA> &decisionToDFA);
+
+    /// Loads a snapshot into the given DFAs, which must all be empty (i.e. this must be called before the first
+    /// recognizer using them runs). The atn must be the one deserialized from serializedATN.
+    /// Returns false (and leaves the DFAs untouched) if the snapshot was taken for a different ATN, has another format
+    /// version or is damaged.
+    static bool load(std::istream &input, const std::vector<uint16_t> &serializedATN, const atn::ATN &atn,
+                     std::vector<DFA> &decisionToDFA);
+
+    /// Convenience wrappers for save() and load() using a file. Both return false if the file cannot be written
+    /// or read.
+    static bool saveToFile(const std::string &fileName, const std::vector<uint16_t> &serializedATN,
+                           const atn::ATN &atn, const std::vector<DFA> &decisionToDFA);
+    static bool loadFromFile(const std::string &fileName, const std::vector<uint16_t> &serializedATN,
+                             const atn::ATN &atn, std::vector<DFA> &decisionToDFA);
+
+    /// Writes the static DFAs of a lexer (see atn::StaticLexerDFA), indexed by mode, to the output stream. They have a
+    /// format of their own, as they are plain tables without configuration sets.
+    static void saveStaticLexerDFAs(std::ostream &output, const std::vector<uint16_t> &serializedATN,
+                                    const atn::ATN &atn, const std::vector<Ref<atn::StaticLexerDFA>> &staticDFAs);
+
+    /// Loads static lexer DFAs written by saveStaticLexerDFAs(). Returns false (and leaves staticDFAs untouched) under
+    /// the same conditions as load().
+    static bool loadStaticLexerDFAs(std::istream &input, const std::vector<uint16_t> &serializedATN,
+                                    const atn::ATN &atn, std::vector<Ref<atn::StaticLexerDFA>> &staticDFAs);
+
+    static bool saveStaticLexerDFAsToFile(const std::string &fileName, const std::vector<uint16_t> &serializedATN,
+                                          const atn::ATN &atn, const std::vector<Ref<atn::StaticLexerDFA>> &staticDFAs);
+    static bool loadStaticLexerDFAsFromFile(const std::string &fileName, const std::vector<uint16_t> &serializedATN,
+                                            const atn::ATN &atn, std::vector<Ref<atn::StaticLexerDFA>> &staticDFAs);
+  };
+
+} // namespace atn
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
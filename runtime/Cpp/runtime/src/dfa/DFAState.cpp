@@ -68,6 +68,61 @@ DFAState::~DFAState() {
   for (auto predicate : predicates) {
     delete predicate;
   }
+
+  EdgeTable *table = _edges.load();
+  while (table != nullptr) {
+    EdgeTable *previous = table->previous;
+    delete table;
+    table = previous;
+  }
+}
+
+DFAState::EdgeTable::EdgeTable(size_t size, EdgeTable *previous)
+  : size(size), targets(new std::atomic<DFAState *>[size]), previous(previous) {
+  for (size_t i = 0; i < size; ++i) {
+    targets[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+DFAState* DFAState::getEdge(size_t index) const {
+  EdgeTable *table = _edges.load(std::memory_order_acquire);
+  if (table == nullptr || index >= table->size) {
+    return nullptr;
+  }
+
+  return table->targets[index].load(std::memory_order_acquire);
+}
+
+void DFAState::setEdge(size_t index, DFAState *target, size_t capacity) {
+  EdgeTable *table = _edges.load(std::memory_order_acquire);
+  while (table == nullptr || index >= table->size) {
+    size_t size = std::max(capacity, index + 1);
+    if (table != nullptr) {
+      size = std::max(size, 2 * table->size);
+    }
+
+    EdgeTable *newTable = new EdgeTable(size, table); /* mem-check: deleted in d-tor or below */
+    if (table != nullptr) {
+      for (size_t i = 0; i < table->size; ++i) {
+        newTable->targets[i].store(table->targets[i].load(std::memory_order_acquire), std::memory_order_relaxed);
+      }
+    }
+
+    // On failure table is updated to the winning table and we retry (or use it, if it's large enough).
+    if (_edges.compare_exchange_strong(table, newTable, std::memory_order_acq_rel, std::memory_order_acquire)) {
+      table = newTable;
+    } else {
+      newTable->previous = nullptr;
+      delete newTable;
+    }
+  }
+
+  table->targets[index].store(target, std::memory_order_release);
+}
+
+size_t DFAState::getEdgeCount() const {
+  EdgeTable *table = _edges.load(std::memory_order_acquire);
+  return table == nullptr ? 0 : table->size;
 }
 
 std::set<int> DFAState::getAltSet() {
@@ -93,7 +148,15 @@ bool DFAState::operator == (const DFAState &o) {
     return true;
   }
 
-  return configs == o.configs;
+  if (configs == o.configs) {
+    return true;
+  }
+
+  if (configs == nullptr || o.configs == nullptr) {
+    return false;
+  }
+
+  return *configs == *o.configs;
 }
 
 std::string DFAState::toString() {
@@ -116,6 +179,7 @@ std::string DFAState::toString() {
 }
 
 void DFAState::InitializeInstanceFields() {
+  _edges.store(nullptr);
   stateNumber = -1;
   isAcceptState = false;
   prediction = 0;
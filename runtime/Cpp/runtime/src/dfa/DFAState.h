@@ -84,12 +84,6 @@ namespace dfa {
 
     Ref<atn::ATNConfigSet> configs;
 
-    /// <summary>
-    /// {@code edges[symbol]} points to target of symbol. Shift up by 1 so (-1)
-    ///  <seealso cref="Token#EOF"/> maps to {@code edges[0]}.
-    /// </summary>
-    std::vector<DFAState *> edges;
-
     bool isAcceptState;
 
     /// <summary>
@@ -130,6 +124,23 @@ namespace dfa {
     DFAState(Ref<atn::ATNConfigSet> configs);
     virtual ~DFAState();
 
+    /// <summary>
+    /// {@code edges[symbol]} points to target of symbol. Shift up by 1 so (-1)
+    ///  <seealso cref="Token#EOF"/> maps to {@code edges[0]}.
+    /// Returns nullptr if that edge has not been computed (yet). This never locks: edge tables are
+    /// published with a CAS and their entries are atomics.
+    /// </summary>
+    DFAState* getEdge(size_t index) const;
+
+    /// Sets the target for the given edge index. The edge table is created on first use with
+    /// {@code max(capacity, index + 1)} entries and grown (copy + CAS) if index is out of range.
+    /// Concurrent writers may race, but all of them store interned states, so it doesn't matter who wins.
+    /// A write racing with a growth of the table may get lost, which is harmless: the edge is simply computed again.
+    void setEdge(size_t index, DFAState *target, size_t capacity);
+
+    /// The number of edge slots currently allocated (0 if there are no edges yet).
+    size_t getEdgeCount() const;
+
     /// <summary>
     /// Get the set of all alts mentioned by all ATN configurations in this
     ///  DFA state.
@@ -138,6 +149,21 @@ namespace dfa {
 
     virtual size_t hashCode();
 
+    /// Hasher and comparer for the content-addressed state table in DFA (see DFA::states).
+    struct Hasher
+    {
+      size_t operator()(DFAState *k) const {
+        return k->hashCode();
+      }
+    };
+
+    struct Comparer {
+      bool operator()(DFAState *lhs, DFAState *rhs) const
+      {
+        return *lhs == *rhs;
+      }
+    };
+
     /// Two DFAState instances are equal if their ATN configuration sets
     /// are the same. This method is used to see if a state already exists.
     ///
@@ -154,6 +180,18 @@ namespace dfa {
     virtual std::string toString();
 
   private:
+    struct EdgeTable {
+      EdgeTable(size_t size, EdgeTable *previous);
+
+      const size_t size;
+      std::unique_ptr<std::atomic<DFAState *>[]> targets;
+
+      // Tables replaced by a larger one stay alive until this state is destroyed, for readers still using them.
+      EdgeTable *previous;
+    };
+
+    std::atomic<EdgeTable *> _edges;
+
     void InitializeInstanceFields();
   };
 
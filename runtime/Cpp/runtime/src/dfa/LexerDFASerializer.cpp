@@ -30,6 +30,7 @@
  */
 
 #include "VocabularyImpl.h"
+#include "atn/LexerATNSimulator.h"
 
 #include "dfa/LexerDFASerializer.h"
 
@@ -39,5 +40,9 @@ LexerDFASerializer::LexerDFASerializer(DFA *dfa) : DFASerializer(dfa, Vocabulary
 }
 
 std::string LexerDFASerializer::getEdgeLabel(size_t i) const {
+  if (i > atn::LexerATNSimulator::MAX_DFA_EDGE) {
+    // Non-ASCII edges are per character class, not per code point.
+    return "<class " + std::to_string(i - atn::LexerATNSimulator::MAX_DFA_EDGE - 1) + ">";
+  }
   return std::string("'") + static_cast<char>(i) + "'";
 }
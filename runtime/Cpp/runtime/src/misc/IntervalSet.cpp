@@ -64,6 +64,22 @@ IntervalSet::IntervalSet(const IntervalSet &set) : IntervalSet() {
   addAll(set);
 }
 
+IntervalSet::IntervalSet(IntervalSet &&set) : IntervalSet() {
+  _intervals = std::move(set._intervals);
+}
+
+IntervalSet& IntervalSet::operator = (const IntervalSet &other) {
+  _intervals = other._intervals;
+  _readonly = other._readonly;
+  return *this;
+}
+
+IntervalSet& IntervalSet::operator = (IntervalSet &&other) {
+  _intervals = std::move(other._intervals);
+  _readonly = other._readonly;
+  return *this;
+}
+
 IntervalSet::IntervalSet(int n, ...) : IntervalSet() {
   va_list vlist;
   va_start(vlist, n);
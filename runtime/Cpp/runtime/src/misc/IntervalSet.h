@@ -65,10 +65,15 @@ namespace misc {
     IntervalSet();
     IntervalSet(const std::vector<Interval> &intervals);
     IntervalSet(const IntervalSet &set);
+    IntervalSet(IntervalSet &&set);
     IntervalSet(int numArgs, ...);
 
     virtual ~IntervalSet() {}
 
+    /// Assignment replaces the intervals and takes over the read only state of the other set.
+    IntervalSet& operator = (const IntervalSet &other);
+    IntervalSet& operator = (IntervalSet &&other);
+
     /// <summary>
     /// Create a set with a single element, el. </summary>
     static IntervalSet of(int a);
@@ -0,0 +1,140 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "support/Arena.h"
+
+using namespace antlrcpp;
+
+// A chunk tracks its live blocks without touching the atomic counter on allocation. Each release decrements
+// "released", and "allocated" is only added once the arena gives up the chunk. Before that the counter cannot reach 0
+// by a release, afterwards it does so exactly when the last block is returned.
+struct Arena::Chunk {
+  std::atomic<ptrdiff_t> released;
+  size_t allocated;
+  char *start;
+};
+
+namespace {
+
+  const size_t HEADER_SIZE = Arena::ALIGNMENT; // Holds the owning chunk before each block.
+
+  inline size_t align(size_t size) {
+    return (size + Arena::ALIGNMENT - 1) & ~(Arena::ALIGNMENT - 1);
+  }
+
+}
+
+Arena::Arena() : _chunk(nullptr), _next(nullptr), _end(nullptr), _chunkCount(0) {
+}
+
+Arena::~Arena() {
+  if (_chunk != nullptr) {
+    retire(_chunk);
+  }
+}
+
+void* Arena::allocate(size_t size) {
+  size = align(size) + HEADER_SIZE;
+  if (size > CHUNK_SIZE / 4) {
+    return allocateLarge(size);
+  }
+
+  if (_chunk == nullptr || (size_t)(_end - _next) < size) {
+    if (_chunk != nullptr) {
+      retire(_chunk);
+    }
+    _chunk = createChunk(CHUNK_SIZE);
+    _next = _chunk->start;
+    _end = reinterpret_cast<char *>(_chunk) + CHUNK_SIZE;
+    ++_chunkCount;
+  }
+
+  char *block = _next;
+  _next += size;
+  ++_chunk->allocated;
+
+  *reinterpret_cast<Chunk **>(block) = _chunk;
+  return block + HEADER_SIZE;
+}
+
+void Arena::deallocate(void *p) {
+  Chunk *chunk = *reinterpret_cast<Chunk **>(static_cast<char *>(p) - HEADER_SIZE);
+  if (chunk->released.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    destroyChunk(chunk);
+  }
+}
+
+void Arena::reset() {
+  if (_chunk == nullptr || _chunk->allocated == 0) {
+    return;
+  }
+
+  // Once all blocks are released no other thread can touch the chunk anymore.
+  if (_chunk->released.load(std::memory_order_acquire) + (ptrdiff_t)_chunk->allocated == 0) {
+    _chunk->released.store(0, std::memory_order_relaxed);
+    _chunk->allocated = 0;
+    _next = _chunk->start;
+  }
+}
+
+size_t Arena::getChunkCount() const {
+  return _chunkCount;
+}
+
+Arena::Chunk* Arena::createChunk(size_t size) {
+  void *memory = ::operator new(size);
+  Chunk *chunk = new (memory) Chunk();
+  chunk->released = 0;
+  chunk->allocated = 0;
+  chunk->start = static_cast<char *>(memory) + align(sizeof(Chunk));
+  return chunk;
+}
+
+void Arena::destroyChunk(Chunk *chunk) {
+  chunk->~Chunk();
+  ::operator delete(chunk);
+}
+
+void Arena::retire(Chunk *chunk) {
+  ptrdiff_t allocated = (ptrdiff_t)chunk->allocated;
+  if (chunk->released.fetch_add(allocated, std::memory_order_acq_rel) + allocated == 0) {
+    destroyChunk(chunk);
+  }
+}
+
+void* Arena::allocateLarge(size_t size) {
+  Chunk *chunk = createChunk(align(sizeof(Chunk)) + size);
+  ++_chunkCount;
+
+  chunk->allocated = 1;
+  *reinterpret_cast<Chunk **>(chunk->start) = chunk;
+  void *result = chunk->start + HEADER_SIZE;
+  retire(chunk);
+  return result;
+}
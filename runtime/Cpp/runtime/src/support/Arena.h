@@ -0,0 +1,128 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "antlr4-common.h"
+
+namespace antlrcpp {
+
+  /// A bump pointer arena for large numbers of small, reference counted objects that mostly die together, e.g.
+  /// the ATN configurations created during a prediction or the nodes of a parse tree.
+  ///
+  /// Taking such objects from larger chunks of memory is much cheaper than a trip to the heap for each of them.
+  /// Objects are still reference counted (see create()), so any object which outlives the others stays valid:
+  /// a chunk is only released once the last object allocated from it is gone. Releasing an object only decrements a
+  /// counter in its chunk, the memory goes back to the heap a chunk at a time.
+  ///
+  /// An arena must only be used by a single thread at a time. Objects allocated from it however can be released in
+  /// any thread.
+  class ANTLR4CPP_PUBLIC Arena {
+  public:
+    /// Size of a single chunk. Larger allocations get a chunk of their own.
+    static const size_t CHUNK_SIZE = 64 * 1024;
+
+    /// Alignment of all blocks allocated from the arena.
+    static const size_t ALIGNMENT = 8;
+
+    /// A standard allocator for std::allocate_shared.
+    template<typename T>
+    class Allocator {
+    public:
+      typedef T value_type;
+
+      template<typename U>
+      struct rebind {
+        typedef Allocator<U> other;
+      };
+
+      Allocator(Arena *arena) : arena(arena) {}
+
+      template<typename U>
+      Allocator(const Allocator<U> &other) : arena(other.arena) {}
+
+      T* allocate(size_t n) {
+        static_assert(std::alignment_of<T>::value <= ALIGNMENT, "Type needs a larger alignment than the arena provides");
+        return static_cast<T *>(arena->allocate(n * sizeof(T)));
+      }
+
+      void deallocate(T *p, size_t /*n*/) {
+        Arena::deallocate(p);
+      }
+
+      template<typename U>
+      bool operator == (const Allocator<U> &other) const {
+        return arena == other.arena;
+      }
+
+      template<typename U>
+      bool operator != (const Allocator<U> &other) const {
+        return arena != other.arena;
+      }
+
+      Arena *arena;
+    };
+
+    Arena();
+    Arena(const Arena &) = delete;
+    ~Arena();
+
+    Arena& operator = (const Arena &) = delete;
+
+    /// Creates a reference counted object in this arena.
+    template<typename T, typename... Args>
+    Ref<T> create(Args&&... args) {
+      return std::allocate_shared<T>(Allocator<T>(this), std::forward<Args>(args)...);
+    }
+
+    void* allocate(size_t size);
+    static void deallocate(void *p);
+
+    /// Reuses the current chunk from the start if nothing allocated from it is alive anymore.
+    /// Call this when a batch of objects is done with (e.g. at the end of a prediction).
+    void reset();
+
+    /// The number of chunks allocated so far (for statistics).
+    size_t getChunkCount() const;
+
+  private:
+    struct Chunk;
+
+    Chunk *_chunk;
+    char *_next;
+    char *_end;
+    size_t _chunkCount;
+
+    static Chunk* createChunk(size_t size);
+    static void destroyChunk(Chunk *chunk);
+    static void retire(Chunk *chunk);
+    void* allocateLarge(size_t size);
+  };
+
+} // namespace antlrcpp
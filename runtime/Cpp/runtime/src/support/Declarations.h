@@ -62,10 +62,12 @@ namespace org {
         class CommonToken;
         class CommonTokenFactory;
         class CommonTokenStream;
+        class ConcurrentTokenStream;
         class ConsoleErrorListener;
         class DefaultErrorStrategy;
         class DiagnosticErrorListener;
         class FailedPredicateException;
+        class IncrementalParser;
         class InputMismatchException;
         class IntStream;
         class InterpreterRuleContext;
@@ -74,19 +76,24 @@ namespace org {
         class LexerInterpreter;
         class LexerNoViableAltException;
         class ListTokenSource;
+        class MappedFileStream;
         class NoViableAltException;
+        class ParallelParseDriver;
         class Parser;
         class ParserInterpreter;
         class ParserRuleContext;
         class ProxyErrorListener;
         class RecognitionException;
         class Recognizer;
+        class RingBufferCharStream;
         class RuleContext;
         class Token;
         template<typename Symbol> class TokenFactory;
         class TokenSource;
+        class TokenStore;
         class TokenStream;
         class TokenStreamRewriter;
+        class UTF8CharStream;
         class UnbufferedCharStream;
         class UnbufferedTokenStream;
         class WritableToken;
@@ -122,6 +129,7 @@ namespace org {
           class DecisionState;
           class EmptyPredictionContext;
           class EpsilonTransition;
+          class FlatATN;
           class LL1Analyzer;
           class LexerAction;
           class LexerActionExecutor;
@@ -136,11 +144,14 @@ namespace org {
           class OrderedATNConfigSet;
           class ParseInfo;
           class ParserATNSimulator;
+          class ParseTelemetry;
           class PlusBlockStartState;
           class PlusLoopbackState;
           class PrecedencePredicateTransition;
           class PredicateTransition;
           class PredictionContext;
+          class PredictionContextCache;
+          class PredictionContextMergeCache;
           enum class PredictionMode;
           class PredictionModeClass;
           class RangeTransition;
@@ -153,6 +164,8 @@ namespace org {
           class StarBlockStartState;
           class StarLoopEntryState;
           class StarLoopbackState;
+          class StaticLexerDFA;
+          class TelemetryATNSimulator;
           class TokensStartState;
           class Transition;
           class WildcardTransition;
@@ -160,6 +173,7 @@ namespace org {
         namespace dfa {
           class DFA;
           class DFASerializer;
+          class DFASnapshot;
           class DFAState;
           class LexerDFASerializer;
           class Vocabulary;
@@ -171,6 +185,7 @@ namespace org {
           class ParseTree;
           class ParseTreeListener;
           template<typename T> class ParseTreeProperty;
+          enum class ParseTreeType;
           template<typename T> class ParseTreeVisitor;
           class ParseTreeWalker;
           class RuleNode;
@@ -182,6 +197,7 @@ namespace org {
 
           namespace pattern {
             class Chunk;
+            class MultiPatternMatcher;
             class ParseTreeMatch;
             class ParseTreePattern;
             class ParseTreePatternMatcher;
@@ -191,6 +207,12 @@ namespace org {
             class TokenTagToken;
           }
 
+          namespace xpath {
+            class XPath;
+            class XPathElement;
+            class XPathMatcher;
+          }
+
         }
       }
     }
@@ -44,14 +44,109 @@ void replaceAll(std::string& str, const std::string& from, const std::string& to
   }
 }
 
+namespace {
+
+  void appendUTF8(std::string &result, char32_t c) {
+    if (c < 0x80) {
+      result.push_back((char)c);
+    } else if (c < 0x800) {
+      result.push_back((char)(0xC0 | (c >> 6)));
+      result.push_back((char)(0x80 | (c & 0x3F)));
+    } else if (c < 0x10000) {
+      result.push_back((char)(0xE0 | (c >> 12)));
+      result.push_back((char)(0x80 | ((c >> 6) & 0x3F)));
+      result.push_back((char)(0x80 | (c & 0x3F)));
+    } else if (c <= 0x10FFFF) {
+      result.push_back((char)(0xF0 | (c >> 18)));
+      result.push_back((char)(0x80 | ((c >> 12) & 0x3F)));
+      result.push_back((char)(0x80 | ((c >> 6) & 0x3F)));
+      result.push_back((char)(0x80 | (c & 0x3F)));
+    } else {
+      throw std::range_error("Cannot convert a code point above U+10FFFF to UTF-8");
+    }
+  }
+
+}
+
+std::u32string UTFConverter::from_bytes(const std::string &bytes) const {
+  std::u32string result;
+  result.reserve(bytes.size());
+
+  size_t i = 0;
+  while (i < bytes.size()) {
+    unsigned char c = (unsigned char)bytes[i];
+    if (c < 0x80) {
+      result.push_back(c);
+      ++i;
+      continue;
+    }
+
+    size_t length;
+    char32_t codePoint;
+    char32_t minimum;
+    if (c >= 0xC2 && c <= 0xDF) { // 0xC0 and 0xC1 could only start overlong forms.
+      length = 2;
+      codePoint = c & 0x1F;
+      minimum = 0x80;
+    } else if ((c & 0xF0) == 0xE0) {
+      length = 3;
+      codePoint = c & 0x0F;
+      minimum = 0x800;
+    } else if (c >= 0xF0 && c <= 0xF4) { // Larger lead bytes can only start values beyond U+10FFFF.
+      length = 4;
+      codePoint = c & 0x07;
+      minimum = 0x10000;
+    } else {
+      throw std::range_error("Invalid UTF-8 lead byte");
+    }
+
+    if (i + length > bytes.size()) {
+      break; // A sequence cut off at the end is dropped, as std::wstring_convert does.
+    }
+    for (size_t j = 1; j < length; ++j) {
+      unsigned char next = (unsigned char)bytes[i + j];
+      if ((next & 0xC0) != 0x80) {
+        throw std::range_error("Invalid UTF-8 continuation byte");
+      }
+      codePoint = (codePoint << 6) | (next & 0x3F);
+    }
+
+    // Overlong forms and values beyond the Unicode range are rejected. Encoded surrogates pass, as they did with
+    // std::codecvt_utf8.
+    if (codePoint < minimum || codePoint > 0x10FFFF) {
+      throw std::range_error("Invalid UTF-8 sequence");
+    }
+    result.push_back(codePoint);
+    i += length;
+  }
+
+  return result;
+}
+
+std::string UTFConverter::to_bytes(const std::u32string &text) const {
+  std::string result;
+  result.reserve(text.size());
+  for (char32_t c : text) {
+    appendUTF8(result, c);
+  }
+  return result;
+}
+
+std::string UTFConverter::to_bytes(char32_t c) const {
+  std::string result;
+  appendUTF8(result, c);
+  return result;
+}
+
+// No static converters below, std::wstring_convert instances must not be shared between threads.
 std::string ws2s(const std::wstring &wstr) {
-  static std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+  std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
   std::string narrow = converter.to_bytes(wstr);
   return narrow;
 }
 
 std::wstring s2ws(const std::string &str) {
-  static std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+  std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
   std::wstring wide = converter.from_bytes(str);
   return wide;
 }
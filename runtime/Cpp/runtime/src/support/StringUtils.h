@@ -33,8 +33,20 @@
 #include "antlr4-common.h"
 
 namespace antlrcpp {
+  /// Converts between UTF-8 and UTF-32, with the interface of the std::wstring_convert it replaces. Unlike that one it
+  /// has no conversion state, so a single instance can be used by any number of threads at the same time.
+  /// Throws std::range_error for invalid input (like std::wstring_convert).
+  class ANTLR4CPP_PUBLIC UTFConverter {
+  public:
+    UTFConverter() {}
+
+    std::u32string from_bytes(const std::string &bytes) const;
+    std::string to_bytes(const std::u32string &text) const;
+    std::string to_bytes(char32_t c) const;
+  };
+
   // For all conversions utf8 <-> utf32.
-  static std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t> utfConverter;
+  static const UTFConverter utfConverter;
   
   void replaceAll(std::string& str, const std::string& from, const std::string& to);
 
@@ -38,4 +38,5 @@ using namespace org::antlr::v4::runtime::misc;
 using namespace org::antlr::v4::runtime::tree;
 
 ErrorNodeImpl::ErrorNodeImpl(Ref<Token> token) : TerminalNodeImpl(token) {
+  treeType = ParseTreeType::ERROR_NODE;
 }
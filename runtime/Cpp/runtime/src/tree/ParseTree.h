@@ -32,6 +32,7 @@
 #pragma once
 
 #include "tree/SyntaxTree.h"
+#include "tree/ParseTreeType.h"
 
 namespace org {
 namespace antlr {
@@ -50,6 +51,8 @@ namespace tree {
   class ANTLR4CPP_PUBLIC ParseTree : public SyntaxTree {
     // the following methods narrow the return type; they are not additional methods
   public:
+    ParseTree() : treeType(ParseTreeType::OTHER) {};
+
     std::weak_ptr<ParseTree> getParent() { return std::dynamic_pointer_cast<ParseTree>(getParentReference().lock()); };
     virtual Ref<ParseTree> getChild(size_t i) { return std::dynamic_pointer_cast<ParseTree>(getChildReference(i)); };
 
@@ -70,6 +73,13 @@ namespace tree {
     /// 	based upon the parser.
     /// </summary>
     virtual std::string toStringTree(Parser *parser) = 0;
+
+    /// The kind of this node, which allows for a cast to the matching node class without RTTI.
+    ParseTreeType getTreeType() const { return treeType; };
+
+  protected:
+    /// Set by the constructors of the runtime node classes.
+    ParseTreeType treeType;
   };
 
 } // namespace tree
@@ -54,10 +54,12 @@ namespace tree {
   public:
     virtual ~ParseTreeListener() {};
     
-    virtual void visitTerminal(Ref<TerminalNode> node) = 0;
-    virtual void visitErrorNode(Ref<ErrorNode> node) = 0;
-    virtual void enterEveryRule(Ref<ParserRuleContext> ctx) = 0;
-    virtual void exitEveryRule(Ref<ParserRuleContext> ctx) = 0;
+    // Nodes are passed as plain pointers (like in ParseTreeVisitor), so walking a tree doesn't touch the reference
+    // counts. The nodes stay alive for the duration of the call.
+    virtual void visitTerminal(TerminalNode *node) = 0;
+    virtual void visitErrorNode(ErrorNode *node) = 0;
+    virtual void enterEveryRule(ParserRuleContext *ctx) = 0;
+    virtual void exitEveryRule(ParserRuleContext *ctx) = 0;
 
     bool operator == (const ParseTreeListener &other) {
       return this == &other;
@@ -32,40 +32,90 @@
 #include "tree/ErrorNode.h"
 #include "ParserRuleContext.h"
 #include "tree/ParseTreeListener.h"
-#include "support/CPPUtils.h"
 
 #include "tree/ParseTreeWalker.h"
 
+using namespace org::antlr::v4::runtime;
 using namespace org::antlr::v4::runtime::tree;
-using namespace antlrcpp;
 
 const Ref<ParseTreeWalker> ParseTreeWalker::DEFAULT = std::make_shared<ParseTreeWalker>();
 
-void ParseTreeWalker::walk(Ref<ParseTreeListener> listener, Ref<ParseTree> t) {
-  if (is<ErrorNode>(t)) {
-    listener->visitErrorNode(std::dynamic_pointer_cast<ErrorNode>(t));
-    return;
-  } else if (is<TerminalNode>(t)) {
-    listener->visitTerminal(std::dynamic_pointer_cast<TerminalNode>(t));
-    return;
-  }
-  Ref<RuleNode> r = std::dynamic_pointer_cast<RuleNode>(t);
-  enterRule(listener, r);
-  std::size_t n = r->getChildCount();
-  for (std::size_t i = 0; i < n; i++) {
-    walk(listener, r->getChild(i));
+void ParseTreeWalker::walk(ParseTreeListener *listener, ParseTree *t) {
+  // The rule contexts entered so far, each with the index of the child currently being walked.
+  std::vector<std::pair<ParserRuleContext *, size_t>> stack;
+
+  ParseTree *node = t;
+  while (true) {
+    ParserRuleContext *ctx = nullptr;
+    switch (node->getTreeType()) {
+      case ParseTreeType::RULE_NODE:
+        ctx = static_cast<ParserRuleContext *>(node);
+        break;
+
+      case ParseTreeType::TERMINAL_NODE:
+        listener->visitTerminal(static_cast<TerminalNode *>(node));
+        break;
+
+      case ParseTreeType::ERROR_NODE:
+        // ErrorNode is a virtual base class of the implementation, so a static downcast is not possible here.
+        // Error nodes only exist for erroneous input, though.
+        listener->visitErrorNode(dynamic_cast<ErrorNode *>(node));
+        break;
+
+      default:
+        ctx = visitOther(listener, node);
+        break;
+    }
+
+    if (ctx != nullptr) {
+      enterRule(listener, ctx);
+      if (!ctx->children.empty()) {
+        stack.push_back({ ctx, 0 });
+        node = ctx->children[0].get();
+        continue;
+      }
+      exitRule(listener, ctx);
+    }
+
+    // Move on to the next sibling, leaving all rules whose children are done.
+    while (true) {
+      if (stack.empty()) {
+        return;
+      }
+
+      std::pair<ParserRuleContext *, size_t> &top = stack.back();
+      if (++top.second < top.first->children.size()) {
+        node = top.first->children[top.second].get();
+        break;
+      }
+      exitRule(listener, top.first);
+      stack.pop_back();
+    }
   }
-  exitRule(listener, r);
 }
 
-void ParseTreeWalker::enterRule(Ref<ParseTreeListener> listener, Ref<RuleNode> r) {
-  Ref<ParserRuleContext> ctx = std::dynamic_pointer_cast<ParserRuleContext>(r->getRuleContext());
+void ParseTreeWalker::enterRule(ParseTreeListener *listener, ParserRuleContext *ctx) {
   listener->enterEveryRule(ctx);
   ctx->enterRule(listener);
 }
 
-void ParseTreeWalker::exitRule(Ref<ParseTreeListener> listener, Ref<RuleNode> r) {
-  Ref<ParserRuleContext> ctx = std::dynamic_pointer_cast<ParserRuleContext>(r->getRuleContext());
+void ParseTreeWalker::exitRule(ParseTreeListener *listener, ParserRuleContext *ctx) {
   ctx->exitRule(listener);
   listener->exitEveryRule(ctx);
 }
+
+ParserRuleContext* ParseTreeWalker::visitOther(ParseTreeListener *listener, ParseTree *t) {
+  ErrorNode *errorNode = dynamic_cast<ErrorNode *>(t);
+  if (errorNode != nullptr) {
+    listener->visitErrorNode(errorNode);
+    return nullptr;
+  }
+
+  TerminalNode *terminalNode = dynamic_cast<TerminalNode *>(t);
+  if (terminalNode != nullptr) {
+    listener->visitTerminal(terminalNode);
+    return nullptr;
+  }
+
+  return dynamic_cast<ParserRuleContext *>(t);
+}
@@ -42,8 +42,15 @@ namespace tree {
     static const Ref<ParseTreeWalker> DEFAULT;
 
     virtual ~ParseTreeWalker() {};
-    
-    virtual void walk(Ref<ParseTreeListener> listener, Ref<ParseTree> t);
+
+    /// Walks the tree depth-first, sending the listener events for each node. The walk uses an explicit stack
+    /// instead of recursion (so tree depth is limited only by memory), dispatches on ParseTree::getTreeType and
+    /// does not change any reference count while traversing.
+    virtual void walk(ParseTreeListener *listener, ParseTree *t);
+
+    void walk(Ref<ParseTreeListener> const& listener, Ref<ParseTree> const& t) {
+      walk(listener.get(), t.get());
+    };
 
     /// <summary>
     /// The discovery of a rule node, involves sending two events: the generic
@@ -52,9 +59,14 @@ namespace tree {
     /// the rule specific. We to them in reverse order upon finishing the node.
     /// </summary>
   protected:
-    virtual void enterRule(Ref<ParseTreeListener> listener, Ref<RuleNode> r);
+    virtual void enterRule(ParseTreeListener *listener, ParserRuleContext *ctx);
+
+    virtual void exitRule(ParseTreeListener *listener, ParserRuleContext *ctx);
 
-    virtual void exitRule(Ref<ParseTreeListener> listener, Ref<RuleNode> r);
+  private:
+    /// For nodes which are not of a runtime node class (ParseTreeType::OTHER). Returns the rule context to descend
+    /// into, if any.
+    ParserRuleContext* visitOther(ParseTreeListener *listener, ParseTree *t);
   };
 
 } // namespace tree
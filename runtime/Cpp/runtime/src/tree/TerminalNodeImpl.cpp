@@ -39,6 +39,7 @@ using namespace org::antlr::v4::runtime::tree;
 
 TerminalNodeImpl::TerminalNodeImpl(Ref<Token> symbol) {
   this->symbol = symbol;
+  treeType = ParseTreeType::TERMINAL_NODE;
 }
 
 Ref<Token> TerminalNodeImpl::getSymbol() {
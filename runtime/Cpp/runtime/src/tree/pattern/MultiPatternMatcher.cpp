@@ -0,0 +1,317 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "Exceptions.h"
+#include "ParserRuleContext.h"
+#include "tree/ErrorNode.h"
+#include "tree/TerminalNode.h"
+#include "tree/pattern/ParseTreeMatch.h"
+#include "tree/pattern/ParseTreePattern.h"
+#include "tree/pattern/RuleTagToken.h"
+#include "tree/pattern/TokenTagToken.h"
+
+#include "tree/pattern/MultiPatternMatcher.h"
+
+using namespace org::antlr::v4::runtime;
+using namespace org::antlr::v4::runtime::tree;
+using namespace org::antlr::v4::runtime::tree::pattern;
+
+// Node type checks, without RTTI for the node classes of the runtime.
+static ParserRuleContext* asContext(ParseTree *node) {
+  switch (node->getTreeType()) {
+    case ParseTreeType::RULE_NODE:
+      return static_cast<ParserRuleContext *>(node);
+    case ParseTreeType::OTHER:
+      return dynamic_cast<ParserRuleContext *>(node);
+    default:
+      return nullptr;
+  }
+}
+
+static TerminalNode* asTerminal(ParseTree *node) {
+  switch (node->getTreeType()) {
+    case ParseTreeType::TERMINAL_NODE:
+      return static_cast<TerminalNode *>(node);
+    case ParseTreeType::ERROR_NODE:
+      return dynamic_cast<ErrorNode *>(node);
+    case ParseTreeType::OTHER:
+      return dynamic_cast<TerminalNode *>(node);
+    default:
+      return nullptr;
+  }
+}
+
+// The type of the leftmost token below the node, or INVALID_TYPE if there is none.
+static size_t firstTokenType(ParseTree *node) {
+  while (true) {
+    ParserRuleContext *context = asContext(node);
+    if (context == nullptr) {
+      break;
+    }
+    if (context->children.empty()) {
+      return Token::INVALID_TYPE;
+    }
+    node = context->children[0].get();
+  }
+
+  TerminalNode *terminal = asTerminal(node);
+  return terminal == nullptr ? Token::INVALID_TYPE : (size_t)terminal->getSymbol()->getType();
+}
+
+MultiPatternMatcher::MultiPatternMatcher() {
+}
+
+size_t MultiPatternMatcher::add(const ParseTreePattern &pattern) {
+  if (pattern.getPatternTree() == nullptr) {
+    throw IllegalArgumentException("patternTree cannot be null");
+  }
+  if (pattern.getPatternRuleIndex() < 0) {
+    throw IllegalArgumentException("Invalid pattern rule index " + std::to_string(pattern.getPatternRuleIndex()));
+  }
+
+  Pattern entry;
+  entry.pattern = &pattern;
+  addNodes(pattern.getPatternTree().get(), entry.nodes);
+
+  // The first token is known unless the leftmost path of the pattern ends in a rule tag or an empty rule.
+  size_t first = 0;
+  while (entry.nodes[first].kind == Node::RULE && entry.nodes[first].childCount > 0) {
+    ++first;
+  }
+
+  size_t index = _patterns.size();
+  _patterns.push_back(std::move(entry));
+
+  size_t ruleIndex = (size_t)pattern.getPatternRuleIndex();
+  if (ruleIndex >= _rules.size()) {
+    _rules.resize(ruleIndex + 1);
+  }
+  const Node &firstNode = _patterns.back().nodes[first];
+  if (firstNode.kind == Node::TOKEN || firstNode.kind == Node::TOKEN_TAG) {
+    std::vector<std::pair<size_t, size_t>> &byToken = _rules[ruleIndex].byToken;
+    std::pair<size_t, size_t> key(firstNode.type, index);
+    byToken.insert(std::upper_bound(byToken.begin(), byToken.end(), key), key);
+  } else {
+    _rules[ruleIndex].anyToken.push_back(index);
+  }
+
+  return index;
+}
+
+size_t MultiPatternMatcher::size() const {
+  return _patterns.size();
+}
+
+void MultiPatternMatcher::match(const Ref<ParseTree> &tree, const MatchFunction &match) const {
+  if (tree == nullptr || _patterns.empty()) {
+    return;
+  }
+
+  // Labels are collected here for all attempts.
+  std::vector<Label> labels;
+
+  // Tries the patterns for the rule and first token of a node.
+  auto tryPatterns = [&](const Ref<ParseTree> &node, ParserRuleContext *context, size_t firstToken) {
+    ssize_t ruleIndex = context->getRuleIndex();
+    if (ruleIndex < 0 || (size_t)ruleIndex >= _rules.size()) {
+      return;
+    }
+
+    // Merge both candidate lists, to try the patterns in the order they were added.
+    const RulePatterns &rule = _rules[(size_t)ruleIndex];
+    auto any = rule.anyToken.begin();
+    auto token = std::lower_bound(rule.byToken.begin(), rule.byToken.end(), std::make_pair(firstToken, (size_t)0));
+    auto tokenEnd = std::upper_bound(token, rule.byToken.end(), std::make_pair(firstToken, std::numeric_limits<size_t>::max()));
+    while (any != rule.anyToken.end() || token != tokenEnd) {
+      size_t pattern;
+      if (token == tokenEnd || (any != rule.anyToken.end() && *any < token->second)) {
+        pattern = *any++;
+      } else {
+        pattern = (token++)->second;
+      }
+
+      labels.clear();
+      size_t next = 0;
+      if (matches(node, _patterns[pattern].nodes, next, labels)) {
+        report(node, pattern, labels, match);
+      }
+    }
+  };
+
+  // Pre-order traversal without recursion. The first token of a node is that of its parent if it is the first child.
+  struct Frame {
+    ParserRuleContext *context;
+    size_t nextChild;
+    size_t firstToken;
+  };
+  std::vector<Frame> stack;
+
+  ParserRuleContext *context = asContext(tree.get());
+  if (context == nullptr) {
+    return;
+  }
+  size_t firstToken = firstTokenType(tree.get());
+  tryPatterns(tree, context, firstToken);
+  stack.push_back({ context, 0, firstToken });
+
+  while (!stack.empty()) {
+    Frame &frame = stack.back();
+    if (frame.nextChild == frame.context->children.size()) {
+      stack.pop_back();
+      continue;
+    }
+
+    size_t childIndex = frame.nextChild++;
+    const Ref<ParseTree> &child = frame.context->children[childIndex];
+    context = asContext(child.get());
+    if (context == nullptr) {
+      continue;
+    }
+
+    firstToken = childIndex == 0 ? frame.firstToken : firstTokenType(child.get());
+    tryPatterns(child, context, firstToken);
+    if (!context->children.empty()) {
+      stack.push_back({ context, 0, firstToken }); // frame is invalid from here on.
+    }
+  }
+}
+
+void MultiPatternMatcher::addNodes(ParseTree *tree, std::vector<Node> &nodes) {
+  Node node;
+  node.childCount = 0;
+
+  ParserRuleContext *context = dynamic_cast<ParserRuleContext *>(tree);
+  TerminalNode *terminal = dynamic_cast<TerminalNode *>(tree);
+  if (context != nullptr) {
+    // Same check as in ParseTreePatternMatcher::getRuleTagToken().
+    if (context->children.size() == 1) {
+      TerminalNode *tagNode = dynamic_cast<TerminalNode *>(context->children[0].get());
+      RuleTagToken *tag = tagNode == nullptr ? nullptr : dynamic_cast<RuleTagToken *>(tagNode->getSymbol().get());
+      if (tag != nullptr) {
+        node.kind = Node::RULE_TAG;
+        node.type = (size_t)context->getRuleIndex();
+        node.text = tag->getRuleName();
+        node.label = tag->getLabel();
+        nodes.push_back(node);
+        return;
+      }
+    }
+
+    node.kind = Node::RULE;
+    node.type = (size_t)context->getRuleIndex();
+    node.childCount = context->children.size();
+    nodes.push_back(node);
+    for (auto &child : context->children) {
+      addNodes(child.get(), nodes);
+    }
+  } else if (terminal != nullptr) {
+    Ref<Token> symbol = terminal->getSymbol();
+    TokenTagToken *tag = dynamic_cast<TokenTagToken *>(symbol.get());
+    node.type = (size_t)symbol->getType();
+    if (tag != nullptr) {
+      node.kind = Node::TOKEN_TAG;
+      node.text = tag->getTokenName();
+      node.label = tag->getLabel();
+    } else {
+      node.kind = Node::TOKEN;
+      node.text = symbol->getText();
+    }
+    nodes.push_back(node);
+  } else {
+    throw IllegalArgumentException("Pattern trees can only contain rule contexts and terminal nodes.");
+  }
+}
+
+bool MultiPatternMatcher::matches(const Ref<ParseTree> &tree, const std::vector<Node> &nodes, size_t &next,
+                                  std::vector<Label> &labels) const {
+  // Mirrors ParseTreePatternMatcher::matchImpl().
+  size_t index = next++;
+  const Node &node = nodes[index];
+  switch (node.kind) {
+    case Node::RULE: {
+      ParserRuleContext *context = asContext(tree.get());
+      if (context == nullptr || context->children.size() != node.childCount) {
+        return false;
+      }
+      for (auto &child : context->children) {
+        if (!matches(child, nodes, next, labels)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    case Node::RULE_TAG: {
+      ParserRuleContext *context = asContext(tree.get());
+      if (context == nullptr || context->getRuleIndex() != (ssize_t)node.type) {
+        return false;
+      }
+      labels.push_back(Label(index, &tree));
+      return true;
+    }
+
+    case Node::TOKEN:
+    case Node::TOKEN_TAG: {
+      TerminalNode *terminal = asTerminal(tree.get());
+      if (terminal == nullptr) {
+        return false;
+      }
+      const Ref<Token> &symbol = terminal->getSymbol();
+      if ((size_t)symbol->getType() != node.type) {
+        return false;
+      }
+      if (node.kind == Node::TOKEN_TAG) {
+        labels.push_back(Label(index, &tree));
+        return true;
+      }
+      return symbol->getText() == node.text;
+    }
+  }
+
+  return false;
+}
+
+void MultiPatternMatcher::report(const Ref<ParseTree> &tree, size_t pattern, const std::vector<Label> &labels,
+                                 const MatchFunction &match) const {
+  const Pattern &entry = _patterns[pattern];
+
+  // Same labels as collected by ParseTreePatternMatcher::matchImpl().
+  std::map<std::string, std::vector<Ref<ParseTree>>> labelMap;
+  for (auto &label : labels) {
+    const Node &tag = entry.nodes[label.first];
+    labelMap[tag.text].push_back(*label.second);
+    if (!tag.label.empty()) {
+      labelMap[tag.label].push_back(*label.second);
+    }
+  }
+
+  ParseTreeMatch result(tree, *entry.pattern, labelMap, nullptr);
+  match(pattern, result);
+}
@@ -0,0 +1,120 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include "antlr4-common.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+namespace tree {
+namespace pattern {
+
+  /// Matches any number of compiled tree patterns against all nodes of a parse tree in a single traversal.
+  ///
+  /// A pattern is only tried on rule nodes of its pattern rule (see ParseTreePattern::getPatternRuleIndex()),
+  /// like a search for {@code //rule} followed by ParseTreePatternMatcher::match() would do. Patterns are indexed by
+  /// that rule and by the type of their first token (if the pattern doesn't start with a rule tag), so for every node
+  /// only the patterns which can match it are tried. Each pattern is converted to a flat list of nodes when added.
+  /// Labels are collected in a buffer which is reused for all attempts, a ParseTreeMatch (with its label map) is only
+  /// created for successful matches.
+  ///
+  /// The result is the same as that of ParseTreePatternMatcher::match() for the pattern and the node, unless a
+  /// subclass of ParseTreePatternMatcher overrides matchImpl().
+  class ANTLR4CPP_PUBLIC MultiPatternMatcher {
+  public:
+    /// Called for each node matched by a pattern, with the index of that pattern (see add()).
+    typedef std::function<void(size_t pattern, ParseTreeMatch &match)> MatchFunction;
+
+    MultiPatternMatcher();
+    virtual ~MultiPatternMatcher() {};
+
+    /// Adds a pattern and returns its index. The matches refer to the pattern, so it must live as long as this
+    /// matcher and its matches (ParseTreePatternMatcher::getCompiledPattern() returns such patterns).
+    size_t add(const ParseTreePattern &pattern);
+
+    /// The number of patterns added.
+    size_t size() const;
+
+    /// Calls match for each node of the tree and each pattern matching it, in document order. Several patterns
+    /// matching the same node are reported in the order they were added. The tree must not be changed while
+    /// matching.
+    void match(const Ref<ParseTree> &tree, const MatchFunction &match) const;
+
+  private:
+    /// A node of a pattern tree. The nodes of a pattern are stored in pre-order.
+    struct Node {
+      enum Kind {
+        RULE,      // A rule context, matching rule contexts with the same number of (matching) children.
+        RULE_TAG,  // A rule tag like <expr>, matching contexts of that rule.
+        TOKEN,     // A token, matching tokens of the same type and text.
+        TOKEN_TAG  // A token tag like <ID>, matching tokens of that type.
+      };
+
+      Kind kind;
+      size_t type; // The rule index of a rule tag or the token type.
+      size_t childCount;
+      std::string text; // The token text, or the rule or token name of a tag.
+      std::string label;
+    };
+
+    struct Pattern {
+      const ParseTreePattern *pattern;
+      std::vector<Node> nodes;
+    };
+
+    /// The patterns of one rule, with or without a known first token type. Pairs hold a token type and a pattern
+    /// index and are sorted.
+    struct RulePatterns {
+      std::vector<size_t> anyToken;
+      std::vector<std::pair<size_t, size_t>> byToken;
+    };
+
+    /// A label found during a match: the tag (index in Pattern::nodes) and the node matching it.
+    typedef std::pair<size_t, const Ref<ParseTree> *> Label;
+
+    std::vector<Pattern> _patterns;
+    std::vector<RulePatterns> _rules; // Indexed by rule index.
+
+    void addNodes(ParseTree *tree, std::vector<Node> &nodes);
+    bool matches(const Ref<ParseTree> &tree, const std::vector<Node> &nodes, size_t &next,
+                 std::vector<Label> &labels) const;
+    void report(const Ref<ParseTree> &tree, size_t pattern, const std::vector<Label> &labels,
+                const MatchFunction &match) const;
+  };
+
+} // namespace pattern
+} // namespace tree
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
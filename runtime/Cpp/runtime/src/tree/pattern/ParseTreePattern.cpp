@@ -31,7 +31,7 @@
 
 #include "tree/pattern/ParseTreePatternMatcher.h"
 #include "tree/pattern/ParseTreeMatch.h"
-//#include "XPath.h"
+#include "tree/xpath/XPath.h"
 
 #include "tree/pattern/ParseTreePattern.h"
 
@@ -51,19 +51,17 @@ bool ParseTreePattern::matches(Ref<ParseTree> tree) {
   return matcher->match(tree, *this).succeeded();
 }
 
-/*
-std::vector<ParseTreeMatch*> ParseTreePattern::findAll(ParseTree *tree, const std::string &xpath) {
-  std::vector<ParseTree*> subtrees = xpath::XPath::findAll(tree, xpath, matcher->getParser());
-  std::vector<ParseTreeMatch*> matches = std::vector<ParseTreeMatch*>();
-  for (auto t : subtrees) {
-    ParseTreeMatch *aMatch = match(t);
-    if (aMatch->succeeded()) {
+std::vector<ParseTreeMatch> ParseTreePattern::findAll(const Ref<ParseTree> &tree, const std::string &xpath) {
+  std::vector<Ref<ParseTree>> subtrees = xpath::XPath::findAll(tree, xpath, matcher->getParser());
+  std::vector<ParseTreeMatch> matches;
+  for (auto &t : subtrees) {
+    ParseTreeMatch aMatch = match(t);
+    if (aMatch.succeeded()) {
       matches.push_back(aMatch);
     }
   }
   return matches;
 }
-*/
 
 ParseTreePatternMatcher *ParseTreePattern::getMatcher() const {
   return matcher;
@@ -84,10 +84,7 @@ namespace pattern {
     /// @returns A collection of ParseTreeMatch objects describing the
     /// successful matches. Unsuccessful matches are omitted from the result,
     /// regardless of the reason for the failure.
-
-    // A full blown XPath implementation just for this single function which is nowhere used?
-    // Readd the XPath stuff from ANTLR if you really need that.
-    //virtual std::vector<ParseTreeMatch*> findAll(ParseTree *tree, const std::string &xpath);
+    virtual std::vector<ParseTreeMatch> findAll(const Ref<ParseTree> &tree, const std::string &xpath);
 
     /// <summary>
     /// Get the <seealso cref="ParseTreePatternMatcher"/> which created this tree pattern.
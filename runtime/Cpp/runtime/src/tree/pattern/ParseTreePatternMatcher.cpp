@@ -44,6 +44,7 @@
 
 #include "ListTokenSource.h"
 #include "tree/pattern/TextChunk.h"
+#include "CommonTokenFactory.h"
 #include "ANTLRInputStream.h"
 #include "support/Arrays.h"
 #include "Exceptions.h"
@@ -73,14 +74,17 @@ void ParseTreePatternMatcher::setDelimiters(const std::string &start, const std:
     throw IllegalArgumentException("stop cannot be null or empty");
   }
 
- _start = start;
+  if (start != _start || stop != _stop || escapeLeft != _escape) {
+    _patternCache.clear(); // The cached patterns were split with the old delimiters.
+  }
+
+  _start = start;
   _stop = stop;
   _escape = escapeLeft;
 }
 
 bool ParseTreePatternMatcher::matches(Ref<ParseTree> tree, const std::string &pattern, int patternRuleIndex) {
-  ParseTreePattern p = compile(pattern, patternRuleIndex);
-  return matches(tree, p);
+  return matches(tree, getCompiledPattern(pattern, patternRuleIndex));
 }
 
 bool ParseTreePatternMatcher::matches(Ref<ParseTree> tree, const ParseTreePattern &pattern) {
@@ -90,8 +94,8 @@ bool ParseTreePatternMatcher::matches(Ref<ParseTree> tree, const ParseTreePatter
 }
 
 ParseTreeMatch ParseTreePatternMatcher::match(Ref<ParseTree> tree, const std::string &pattern, int patternRuleIndex) {
-  ParseTreePattern p = compile(pattern, patternRuleIndex);
-  return match(tree, p);
+  // The match refers to the pattern, so it must not be a temporary.
+  return match(tree, getCompiledPattern(pattern, patternRuleIndex));
 }
 
 ParseTreeMatch ParseTreePatternMatcher::match(Ref<ParseTree> tree, const ParseTreePattern &pattern) {
@@ -143,6 +147,15 @@ ParseTreePattern ParseTreePatternMatcher::compile(const std::string &pattern, in
   return ParseTreePattern(this, pattern, patternRuleIndex, tree);
 }
 
+const ParseTreePattern& ParseTreePatternMatcher::getCompiledPattern(const std::string &pattern, int patternRuleIndex) {
+  std::pair<int, std::string> key(patternRuleIndex, pattern);
+  auto iterator = _patternCache.find(key);
+  if (iterator == _patternCache.end()) {
+    iterator = _patternCache.insert(std::make_pair(key, compile(pattern, patternRuleIndex))).first;
+  }
+  return iterator->second;
+}
+
 Lexer* ParseTreePatternMatcher::getLexer() {
   return _lexer;
 }
@@ -257,13 +270,21 @@ Ref<RuleTagToken> ParseTreePatternMatcher::getRuleTagToken(Ref<ParseTree> t) {
 
 std::vector<Ref<Token>> ParseTreePatternMatcher::tokenize(const std::string &pattern) {
   // split pattern into chunks: sea (raw input) and islands (<ID>, <expr>)
-  std::vector<Chunk> chunks = split(pattern);
+  std::vector<Ref<Chunk>> chunks = split(pattern);
+
+  // The text chunks are lexed from temporary input streams, so the tokens must keep a copy of their text.
+  Ref<TokenFactory<CommonToken>> tokenFactory = _lexer->getTokenFactory();
+  _lexer->setTokenFactory(std::make_shared<CommonTokenFactory>(true));
+  auto onExit = finally([this, tokenFactory]() {
+    _lexer->setInputStream(nullptr);
+    _lexer->setTokenFactory(tokenFactory);
+  });
 
   // create token stream from text and tags
   std::vector<Ref<Token>> tokens;
-  for (auto chunk : chunks) {
+  for (auto &chunk : chunks) {
     if (is<TagChunk>(chunk)) {
-      TagChunk &tagChunk = (TagChunk&)chunk;
+      TagChunk &tagChunk = static_cast<TagChunk&>(*chunk);
       // add special rule token or conjure up new token from name
       if (isupper(tagChunk.getTag()[0])) {
         size_t ttype = _parser->getTokenType(tagChunk.getTag());
@@ -283,7 +304,7 @@ std::vector<Ref<Token>> ParseTreePatternMatcher::tokenize(const std::string &pat
         throw IllegalArgumentException("invalid tag: " + tagChunk.getTag() + " in pattern: " + pattern);
       }
     } else {
-      TextChunk &textChunk = (TextChunk&)chunk;
+      TextChunk &textChunk = static_cast<TextChunk&>(*chunk);
       ANTLRInputStream input(textChunk.getText());
       _lexer->setInputStream(&input);
       Ref<Token> t = _lexer->nextToken();
@@ -291,17 +312,16 @@ std::vector<Ref<Token>> ParseTreePatternMatcher::tokenize(const std::string &pat
         tokens.push_back(t);
         t = _lexer->nextToken();
       }
-      _lexer->setInputStream(nullptr);
     }
   }
 
   return tokens;
 }
 
-std::vector<Chunk> ParseTreePatternMatcher::split(const std::string &pattern) {
+std::vector<Ref<Chunk>> ParseTreePatternMatcher::split(const std::string &pattern) {
   size_t p = 0;
   size_t n = pattern.length();
-  std::vector<Chunk> chunks;
+  std::vector<Ref<Chunk>> chunks;
   
   // find all start and stop indexes first, then collect
   std::vector<size_t> starts;
@@ -340,12 +360,12 @@ std::vector<Chunk> ParseTreePatternMatcher::split(const std::string &pattern) {
   // collect into chunks now
   if (ntags == 0) {
     std::string text = pattern.substr(0, n);
-    chunks.push_back(TextChunk(text));
+    chunks.push_back(std::make_shared<TextChunk>(text));
   }
 
   if (ntags > 0 && starts[0] > 0) { // copy text up to first tag into chunks
     std::string text = pattern.substr(0, starts[0]);
-    chunks.push_back(TextChunk(text));
+    chunks.push_back(std::make_shared<TextChunk>(text));
   }
   for (size_t i = 0; i < ntags; i++) {
     // copy inside of <tag>
@@ -357,30 +377,29 @@ std::vector<Chunk> ParseTreePatternMatcher::split(const std::string &pattern) {
       label = tag.substr(0,colon);
       ruleOrToken = tag.substr(colon + 1, tag.length() - (colon + 1));
     }
-    chunks.push_back(TagChunk(label, ruleOrToken));
+    chunks.push_back(std::make_shared<TagChunk>(label, ruleOrToken));
     if (i + 1 < ntags) {
       // copy from end of <tag> to start of next
       std::string text = pattern.substr(stops[i] + _stop.length(), starts[i + 1] - (stops[i] + _stop.length()));
-      chunks.push_back(TextChunk(text));
+      chunks.push_back(std::make_shared<TextChunk>(text));
     }
   }
   if (ntags > 0) {
     size_t afterLastTag = stops[ntags - 1] + _stop.length();
     if (afterLastTag < n) { // copy text from end of last tag to end
       std::string text = pattern.substr(afterLastTag, n - afterLastTag);
-      chunks.push_back(TextChunk(text));
+      chunks.push_back(std::make_shared<TextChunk>(text));
     }
   }
 
   // strip out all backslashes from text chunks but not tags
   for (size_t i = 0; i < chunks.size(); i++) {
-    Chunk &c = chunks[i];
-    if (is<TextChunk>(c)) {
-      TextChunk &tc = (TextChunk&)c;
+    if (is<TextChunk>(chunks[i])) {
+      TextChunk &tc = static_cast<TextChunk&>(*chunks[i]);
       std::string unescaped = tc.getText();
       unescaped.erase(std::remove(unescaped.begin(), unescaped.end(), '\\'), unescaped.end());
       if (unescaped.length() < tc.getText().length()) {
-        chunks[i] = TextChunk(unescaped);
+        chunks[i] = std::make_shared<TextChunk>(unescaped);
       }
     }
   }
@@ -32,6 +32,7 @@
 #pragma once
 
 #include "Exceptions.h"
+#include "tree/pattern/ParseTreePattern.h"
 
 namespace org {
 namespace antlr {
@@ -129,7 +130,8 @@ namespace pattern {
     virtual void setDelimiters(const std::string &start, const std::string &stop, const std::string &escapeLeft);
 
     /// <summary>
-    /// Does {@code pattern} matched as rule {@code patternRuleIndex} match {@code tree}? </summary>
+    /// Does {@code pattern} matched as rule {@code patternRuleIndex} match {@code tree}? The pattern is compiled only
+    /// on first use (see getCompiledPattern()). </summary>
     virtual bool matches(Ref<ParseTree> tree, const std::string &pattern, int patternRuleIndex);
 
     /// <summary>
@@ -141,7 +143,8 @@ namespace pattern {
     /// <summary>
     /// Compare {@code pattern} matched as rule {@code patternRuleIndex} against
     /// {@code tree} and return a <seealso cref="ParseTreeMatch"/> object that contains the
-    /// matched elements, or the node at which the match failed.
+    /// matched elements, or the node at which the match failed. The pattern is compiled
+    /// only on first use (see getCompiledPattern()).
     /// </summary>
     virtual ParseTreeMatch match(Ref<ParseTree> tree, const std::string &pattern, int patternRuleIndex);
 
@@ -159,6 +162,12 @@ namespace pattern {
     /// </summary>
     virtual ParseTreePattern compile(const std::string &pattern, int patternRuleIndex);
 
+    /// Returns the compiled form of {@code pattern} for rule {@code patternRuleIndex}, compiling it only if it was
+    /// not requested before. The pattern is owned by this matcher and stays valid until the matcher is destroyed or
+    /// the delimiters are changed with setDelimiters(), which empties the cache. Errors are not cached, a pattern
+    /// that failed to compile throws again on the next request.
+    virtual const ParseTreePattern& getCompiledPattern(const std::string &pattern, int patternRuleIndex);
+
     /// <summary>
     /// Used to convert the tree pattern string into a series of tokens. The
     /// input stream is reset.
@@ -176,13 +185,16 @@ namespace pattern {
     virtual std::vector<Ref<Token>> tokenize(const std::string &pattern);
 
     /// Split "<ID> = <e:expr>;" into 4 chunks for tokenizing by tokenize().
-    virtual std::vector<Chunk> split(const std::string &pattern);
+    virtual std::vector<Ref<Chunk>> split(const std::string &pattern);
     
   protected:
     std::string _start;
     std::string _stop;
     std::string _escape; // e.g., \< and \> must escape BOTH!
 
+    /// The patterns compiled by getCompiledPattern(), keyed by rule index and pattern text.
+    std::map<std::pair<int, std::string>, ParseTreePattern> _patternCache;
+
     /// Recursively walk {@code tree} against {@code patternTree}, filling
     /// {@code match.}<seealso cref="ParseTreeMatch#labels labels"/>.
     ///
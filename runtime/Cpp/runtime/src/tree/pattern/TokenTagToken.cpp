@@ -33,8 +33,8 @@
 
 using namespace org::antlr::v4::runtime::tree::pattern;
 
-TokenTagToken::TokenTagToken(const std::string &/*tokenName*/, int type)
-  : CommonToken(type), tokenName(""), label("") {
+TokenTagToken::TokenTagToken(const std::string &tokenName, int type)
+  : CommonToken(type), tokenName(tokenName), label("") {
 }
 
 TokenTagToken::TokenTagToken(const std::string &tokenName, int type, const std::string &label)
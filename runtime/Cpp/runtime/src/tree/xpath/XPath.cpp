@@ -0,0 +1,151 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Exceptions.h"
+#include "Parser.h"
+#include "Token.h"
+
+#include "tree/xpath/XPath.h"
+
+using namespace org::antlr::v4::runtime;
+using namespace org::antlr::v4::runtime::tree;
+using namespace org::antlr::v4::runtime::tree::xpath;
+
+const std::string XPath::WILDCARD = "*";
+const std::string XPath::NOT = "!";
+
+// Names are ASCII letters, digits and underscores, starting with a letter. Any non-ASCII byte is accepted too,
+// so UTF-8 encoded names work.
+static bool isNameStartChar(char c) {
+  unsigned char u = (unsigned char)c;
+  return (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || u >= 0x80;
+}
+
+static bool isNameChar(char c) {
+  return isNameStartChar(c) || (c >= '0' && c <= '9') || c == '_';
+}
+
+XPath::XPath(Parser *parser, const std::string &path) : _path(path), _parser(parser) {
+  _elements = split(path);
+  _matcher.add(_elements);
+}
+
+std::vector<Ref<ParseTree>> XPath::findAll(const Ref<ParseTree> &tree, const std::string &xpath, Parser *parser) {
+  XPath p(parser, xpath);
+  return p.evaluate(tree);
+}
+
+std::vector<Ref<ParseTree>> XPath::evaluate(const Ref<ParseTree> &t) const {
+  std::vector<Ref<ParseTree>> result;
+  _matcher.match(t, [&result](size_t /*path*/, const Ref<ParseTree> &node) {
+    result.push_back(node);
+  });
+  return result;
+}
+
+std::string XPath::getPath() const {
+  return _path;
+}
+
+const std::vector<XPathElement>& XPath::getElements() const {
+  return _elements;
+}
+
+std::vector<XPathElement> XPath::split(const std::string &path) {
+  std::vector<XPathElement> elements;
+
+  size_t i = 0;
+  while (i < path.size()) {
+    // A separator is required before all but the first element, which is then a child of the root.
+    bool anywhere = false;
+    if (path.compare(i, 2, "//") == 0) {
+      anywhere = true;
+      i += 2;
+    } else if (path[i] == '/') {
+      i += 1;
+    } else if (!elements.empty()) {
+      throw IllegalArgumentException("Missing separator at index " + std::to_string(i) + " in path '" + path + "'");
+    }
+
+    bool invert = path.compare(i, NOT.size(), NOT) == 0;
+    if (invert) {
+      i += NOT.size();
+    }
+
+    if (i == path.size()) {
+      throw IllegalArgumentException("Missing path element at end of path '" + path + "'");
+    }
+
+    size_t wordStart = i;
+    if (path.compare(i, WILDCARD.size(), WILDCARD) == 0) {
+      i += WILDCARD.size();
+    } else if (path[i] == '\'') {
+      size_t end = path.find('\'', i + 1);
+      if (end == std::string::npos) {
+        throw IllegalArgumentException("Unterminated string at index " + std::to_string(i) + " in path '" + path + "'");
+      }
+      i = end + 1;
+    } else if (isNameStartChar(path[i])) {
+      while (++i < path.size() && isNameChar(path[i])) {
+      }
+    } else {
+      throw IllegalArgumentException("Invalid tokens or characters at index " + std::to_string(i) + " in path '" +
+                                     path + "'");
+    }
+
+    elements.push_back(getXPathElement(path.substr(wordStart, i - wordStart), wordStart, anywhere, invert));
+  }
+
+  if (elements.empty()) {
+    throw IllegalArgumentException("Empty path");
+  }
+
+  return elements;
+}
+
+XPathElement XPath::getXPathElement(const std::string &word, size_t wordStart, bool anywhere, bool invert) {
+  if (word == WILDCARD) {
+    return XPathElement(word, XPathElement::Kind::WILDCARD, 0, anywhere, invert);
+  }
+
+  // Token names start with an uppercase letter, literals with a quote.
+  if (word[0] == '\'' || (word[0] >= 'A' && word[0] <= 'Z')) {
+    size_t ttype = _parser->getTokenType(word);
+    if (ttype == Token::INVALID_TYPE) {
+      throw IllegalArgumentException(word + " at index " + std::to_string(wordStart) + " isn't a valid token name");
+    }
+    return XPathElement(word, XPathElement::Kind::TOKEN, ttype, anywhere, invert);
+  }
+
+  ssize_t ruleIndex = _parser->getRuleIndex(word);
+  if (ruleIndex < 0) {
+    throw IllegalArgumentException(word + " at index " + std::to_string(wordStart) + " isn't a valid rule name");
+  }
+  return XPathElement(word, XPathElement::Kind::RULE, (size_t)ruleIndex, anywhere, invert);
+}
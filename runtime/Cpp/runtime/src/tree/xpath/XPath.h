@@ -0,0 +1,108 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "tree/xpath/XPathElement.h"
+#include "tree/xpath/XPathMatcher.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+namespace tree {
+namespace xpath {
+
+  /// Represent a subset of XPath XML path syntax for use in identifying nodes in
+  /// parse trees.
+  ///
+  /// <p>
+  /// Split path into words and separators {@code /} and {@code //} then walk from
+  /// the root node down. {@code //} selects any descendant of the nodes selected so
+  /// far (or of the root), {@code /} only direct children.</p>
+  ///
+  /// <p>
+  /// Whitespace is not allowed.</p>
+  ///
+  /// <ul>
+  /// <li>{@code /classdef} the root node if it is a classdef</li>
+  /// <li>{@code classdef} the same, a leading {@code /} is optional</li>
+  /// <li>{@code //ID} all ID tokens anywhere in the tree</li>
+  /// <li>{@code //'return'} all return keywords (literal token names)</li>
+  /// <li>{@code //expr/primary/ID} the ID tokens under primary under any expr</li>
+  /// <li>{@code /classdef/*} all children of classdef</li>
+  /// <li>{@code //classdef//!ID} all non-ID tokens anywhere below any classdef</li>
+  /// <li>{@code //func/!stat} all rules under func except stat</li>
+  /// </ul>
+  ///
+  /// <p>
+  /// Unlike the Java runtime, {@code //} never selects the node selected by the previous step itself and
+  /// {@code !} is also honored for {@code //} steps.</p>
+  ///
+  /// <p>
+  /// The path is compiled once, on construction. Use XPathMatcher to evaluate several paths in one traversal.</p>
+  class ANTLR4CPP_PUBLIC XPath {
+  public:
+    static const std::string WILDCARD; // word not operator/separator
+    static const std::string NOT; // word for invert operator
+
+    /// Compiles the path, resolving token and rule names with the given parser. Throws an IllegalArgumentException
+    /// for invalid paths and unknown names.
+    XPath(Parser *parser, const std::string &path);
+    virtual ~XPath() {};
+
+    /// Compiles the path and evaluates it on the given tree.
+    static std::vector<Ref<ParseTree>> findAll(const Ref<ParseTree> &tree, const std::string &xpath, Parser *parser);
+
+    /// Returns the nodes of the tree selected by this path, in document order.
+    virtual std::vector<Ref<ParseTree>> evaluate(const Ref<ParseTree> &t) const;
+
+    std::string getPath() const;
+    const std::vector<XPathElement>& getElements() const;
+
+  protected:
+    std::string _path;
+    std::vector<XPathElement> _elements;
+    Parser *_parser;
+
+    std::vector<XPathElement> split(const std::string &path);
+
+    /// Convert word like {@code *} or {@code ID} or {@code expr} to a path element.
+    XPathElement getXPathElement(const std::string &word, size_t wordStart, bool anywhere, bool invert);
+
+  private:
+    XPathMatcher _matcher;
+  };
+
+} // namespace xpath
+} // namespace tree
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
@@ -0,0 +1,234 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Exceptions.h"
+#include "ParserRuleContext.h"
+#include "Token.h"
+#include "tree/ErrorNode.h"
+#include "tree/xpath/XPath.h"
+
+#include "tree/xpath/XPathMatcher.h"
+
+using namespace org::antlr::v4::runtime;
+using namespace org::antlr::v4::runtime::tree;
+using namespace org::antlr::v4::runtime::tree::xpath;
+
+XPathMatcher::XPathMatcher() {
+}
+
+XPathMatcher::XPathMatcher(const std::vector<XPath> &paths) {
+  for (auto &path : paths) {
+    add(path);
+  }
+}
+
+size_t XPathMatcher::add(const XPath &path) {
+  return add(path.getElements());
+}
+
+size_t XPathMatcher::add(const std::vector<XPathElement> &elements) {
+  if (elements.empty()) {
+    throw IllegalArgumentException("An XPath needs at least one step.");
+  }
+
+  size_t path = _starts.size();
+  _starts.push_back(_positions.size());
+  for (auto &element : elements) {
+    _positions.push_back({ element.kind, element.index, element.anywhere, element.invert, false, path });
+  }
+  _positions.push_back({ XPathElement::Kind::WILDCARD, 0, false, false, true, path });
+
+  return path;
+}
+
+size_t XPathMatcher::size() const {
+  return _starts.size();
+}
+
+void XPathMatcher::match(const Ref<ParseTree> &tree, const MatchFunction &match) const {
+  if (tree == nullptr || _starts.empty()) {
+    return;
+  }
+
+  // The positions reached at a node (for steps to its children) and those pending for all its descendants are
+  // slices of this stack. A node without new pending positions shares the slice of its parent.
+  std::vector<size_t> sets;
+
+  // Marks the positions already added to the pending slice of the current node.
+  std::vector<size_t> stamps(_positions.size(), 0);
+  size_t stamp = 0;
+
+  struct Frame {
+    ParserRuleContext *ctx;
+    size_t nextChild;
+    size_t setsStart;
+    size_t reachedBegin;
+    size_t reachedEnd;
+    size_t pendingBegin;
+    size_t pendingEnd;
+  };
+  std::vector<Frame> stack;
+
+  // The implicit document node, whose only child is the tree root.
+  Frame document = { nullptr, 0, 0, 0, 0, 0, 0 };
+  for (size_t start : _starts) {
+    if (!_positions[start].anywhere) {
+      sets.push_back(start);
+    }
+  }
+  document.reachedEnd = document.pendingBegin = sets.size();
+  for (size_t start : _starts) {
+    if (_positions[start].anywhere) {
+      sets.push_back(start);
+    }
+  }
+  document.pendingEnd = sets.size();
+
+  auto visit = [&](const Ref<ParseTree> &node, const Frame &parent) {
+    size_t setsStart = sets.size();
+    bool newPending = false;
+
+    // Child steps from the parent and descendant steps from any ancestor.
+    auto advance = [&](size_t position) {
+      if (!matches(_positions[position], node.get())) {
+        return;
+      }
+
+      const Position &next = _positions[position + 1];
+      if (next.isFinal) {
+        match(next.path, node);
+      } else {
+        sets.push_back(position + 1);
+        newPending |= next.anywhere;
+      }
+    };
+    for (size_t i = parent.reachedBegin; i < parent.reachedEnd; ++i) {
+      if (!_positions[sets[i]].anywhere) {
+        advance(sets[i]);
+      }
+    }
+    for (size_t i = parent.pendingBegin; i < parent.pendingEnd; ++i) {
+      advance(sets[i]);
+    }
+
+    Frame frame = { nullptr, 0, setsStart, setsStart, sets.size(), parent.pendingBegin, parent.pendingEnd };
+    if (newPending) {
+      ++stamp;
+      frame.pendingBegin = sets.size();
+      for (size_t i = parent.pendingBegin; i < parent.pendingEnd; ++i) {
+        size_t position = sets[i];
+        stamps[position] = stamp;
+        sets.push_back(position);
+      }
+      for (size_t i = frame.reachedBegin; i < frame.reachedEnd; ++i) {
+        size_t position = sets[i];
+        if (_positions[position].anywhere && stamps[position] != stamp) {
+          stamps[position] = stamp;
+          sets.push_back(position);
+        }
+      }
+      frame.pendingEnd = sets.size();
+    }
+
+    // Only rule contexts have children.
+    if (node->getTreeType() == ParseTreeType::RULE_NODE) {
+      frame.ctx = static_cast<ParserRuleContext *>(node.get());
+    } else if (node->getTreeType() == ParseTreeType::OTHER) {
+      frame.ctx = dynamic_cast<ParserRuleContext *>(node.get());
+    }
+
+    bool canMatchBelow = frame.reachedEnd > frame.reachedBegin || frame.pendingEnd > frame.pendingBegin;
+    if (frame.ctx != nullptr && !frame.ctx->children.empty() && canMatchBelow) {
+      stack.push_back(frame);
+    } else {
+      sets.resize(setsStart);
+    }
+  };
+
+  visit(tree, document);
+  while (!stack.empty()) {
+    Frame &top = stack.back();
+    if (top.nextChild < top.ctx->children.size()) {
+      const Ref<ParseTree> &child = top.ctx->children[top.nextChild++];
+      Frame parent = top; // visit() may push to the stack.
+      visit(child, parent);
+    } else {
+      sets.resize(top.setsStart);
+      stack.pop_back();
+    }
+  }
+}
+
+std::vector<std::vector<Ref<ParseTree>>> XPathMatcher::evaluate(const Ref<ParseTree> &tree) const {
+  std::vector<std::vector<Ref<ParseTree>>> result(_starts.size());
+  match(tree, [&result](size_t path, const Ref<ParseTree> &node) {
+    result[path].push_back(node);
+  });
+  return result;
+}
+
+bool XPathMatcher::matches(const Position &position, ParseTree *node) const {
+  if (position.kind == XPathElement::Kind::WILDCARD) {
+    return !position.invert; // !* is weird but valid (matches nothing).
+  }
+
+  TerminalNode *terminal = nullptr;
+  switch (node->getTreeType()) {
+    case ParseTreeType::RULE_NODE:
+      if (position.kind != XPathElement::Kind::RULE) {
+        return false;
+      }
+      return (static_cast<ParserRuleContext *>(node)->getRuleIndex() == (ssize_t)position.index) != position.invert;
+
+    case ParseTreeType::TERMINAL_NODE:
+      terminal = static_cast<TerminalNode *>(node);
+      break;
+
+    case ParseTreeType::ERROR_NODE:
+      terminal = dynamic_cast<ErrorNode *>(node);
+      break;
+
+    default: {
+      ParserRuleContext *ctx = dynamic_cast<ParserRuleContext *>(node);
+      if (ctx != nullptr) {
+        if (position.kind != XPathElement::Kind::RULE) {
+          return false;
+        }
+        return (ctx->getRuleIndex() == (ssize_t)position.index) != position.invert;
+      }
+      terminal = dynamic_cast<TerminalNode *>(node);
+      break;
+    }
+  }
+
+  if (terminal == nullptr || position.kind != XPathElement::Kind::TOKEN) {
+    return false;
+  }
+  return ((size_t)terminal->getSymbol()->getType() == position.index) != position.invert;
+}
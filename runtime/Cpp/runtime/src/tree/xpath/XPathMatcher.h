@@ -0,0 +1,102 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ *  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ *  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *  NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "tree/xpath/XPathElement.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+namespace tree {
+namespace xpath {
+
+  /// Evaluates any number of compiled XPaths together in a single pre-order traversal of a parse tree.
+  ///
+  /// All paths are flattened into one table of positions (a path with n steps has n + 1 positions: "i steps
+  /// matched"). During the traversal every node gets the positions reached at that node and those which are pending
+  /// for its descendants (a {@code //} step still waiting for a match). Both are computed from the parent's sets
+  /// only, kept in a single stack which is reused for the whole traversal, so there are no intermediate node
+  /// collections per step as in XPath::evaluate() of the Java runtime. Subtrees which can't contain a match are
+  /// skipped.
+  ///
+  /// A matcher is immutable once its paths are added and can be used from several threads at the same time.
+  class ANTLR4CPP_PUBLIC XPathMatcher {
+  public:
+    /// Called for each node matched by a path, with the index of that path (see add()).
+    typedef std::function<void(size_t path, const Ref<ParseTree> &node)> MatchFunction;
+
+    XPathMatcher();
+    XPathMatcher(const std::vector<XPath> &paths);
+    virtual ~XPathMatcher() {};
+
+    /// Adds a compiled path and returns its index.
+    size_t add(const XPath &path);
+
+    /// Adds the steps of a path and returns its index. Throws an IllegalArgumentException if there are no steps.
+    size_t add(const std::vector<XPathElement> &elements);
+
+    /// The number of paths added.
+    size_t size() const;
+
+    /// Calls match for every node selected by any of the paths, in document order. A node selected by several
+    /// paths is reported once for each of them (in the order the paths were added). The tree root is treated
+    /// as the only child of an implicit document node, so {@code /prog} selects the root if it is a prog context.
+    void match(const Ref<ParseTree> &tree, const MatchFunction &match) const;
+
+    /// Returns the nodes selected by each path (indexed like the paths), in document order.
+    std::vector<std::vector<Ref<ParseTree>>> evaluate(const Ref<ParseTree> &tree) const;
+
+  private:
+    // One entry per position. All but the last position of a path hold the step leading to the next position,
+    // the last one is marked as final and holds the path index.
+    struct Position {
+      XPathElement::Kind kind;
+      size_t index;
+      bool anywhere;
+      bool invert;
+      bool isFinal;
+      size_t path;
+    };
+
+    std::vector<Position> _positions;
+
+    // The first position of each path.
+    std::vector<size_t> _starts;
+
+    bool matches(const Position &position, ParseTree *node) const;
+  };
+
+} // namespace xpath
+} // namespace tree
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org